@@ -37,11 +37,23 @@
 /* max pending connections for listening socket */
 #define SERVER_LISTEN_BACKLOG  3
 
+/* initial size of a client's receive-buffer (grows on demand) */
+#define SERVER_RECVBUF_INITIAL  1024
+
+/* the hard-limit a client's receive-buffer may grow to */
+#define SERVER_RECVBUF_HARDLIMIT  1024*1024
+
+/* initial size of a client's send-buffer (allocated once output is pending) */
+#define SERVER_SENDBUF_INITIAL  4096
+
+/* the hard-limit a client's send-buffer may grow to */
+#define SERVER_SENDBUF_HARDLIMIT  4*1024*1024
+
 /* time to wait for an action on the non-blocking sockets (in u-secs) */
 #define SERVER_SELECT_TIMEOUT_USEC  150 * 1000
 
-/* server testing mode used in test-programs (define to enable) */
-#undef SERVER_TESTING
+/* server testing mode used in test-programs (define to enable, e.g. by -DSERVER_TESTING) */
+/* #define SERVER_TESTING */
 
 
 /* client manual website; menu Help->Handbook */
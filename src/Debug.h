@@ -24,30 +24,14 @@
 #ifndef _DEBUG_H
 #define _DEBUG_H
 
-#if DEBUG
-#include <stdio.h>
-#include <time.h>
+#include "Logger.h"
 
+/* Debug messages are logged at debug level into the category given; they
+   are compiled in only if LOG_MIN_LEVEL (see Logger.h) includes debug. */
 #ifndef _MSC_VER
-
-# define dbg_msg(level, s, args...) \
-	do { fprintf(stderr, "[%ld %10s]  "s"\n", time(0), level, ##args) ; fflush(stderr); } while(0)
-
-#else /* _MSC_VER */
-
-# define dbg_msg(level, s, ...) \
-	do { fprintf(stderr, "[%ld %10s]  "s"\n", time(0), level, __VA_ARGS__) ; fflush(stderr); } while(0)
-
-#endif /* _MSC_VER */
-
-#else
-
-#ifndef _MSC_VER
-# define dbg_msg(level, s, args...)
+# define dbg_msg(category, s, args...)	log_debug(category, s, ##args)
 #else /* _MSC_VER */
-# define dbg_msg(level, s, ...)
+# define dbg_msg(category, s, ...)	log_debug(category, s, __VA_ARGS__)
 #endif /* _MSC_VER */
 
-#endif /* DEBUG */
-
 #endif /* _DEBUG_H */
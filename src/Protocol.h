@@ -58,7 +58,7 @@ typedef enum {
 typedef enum {
 	SnapGameStateStart	= 0x01,
 	SnapGameStateEnd	= 0x02,
-	SnapGameStateSeat	= 0x03,   // TODO
+	SnapGameStateSeat	= 0x03,   // cid, tid: player moved to another table
 	SnapGameStateNewHand	= 0x04,
 	SnapGameStateBlinds	= 0x05,
 	SnapGameStateWon	= 0x10,
@@ -87,6 +87,7 @@ typedef enum {
 typedef enum {
 	SnapFoyerJoin		= 0x01,
 	SnapFoyerLeave		= 0x02,
+	SnapFoyerPresent	= 0x03,  // presence snapshot for newly joined clients
 } snap_foyer_type;
 
 
@@ -119,9 +120,22 @@ typedef enum {
 	StatsClientsIntroduced		= 0x11,
 	StatsClientsIncompatible	= 0x12,
 	StatsGamesCreated		= 0x20,
+	StatsBytesOutRaw		= 0x30,
+	StatsBytesOutCompressed		= 0x31,
+	StatsBytesInRaw			= 0x32,
+	StatsBytesInCompressed		= 0x33,
 	StatsClientCount		= 0x100,
 	StatsGamesCount			= 0x101,
 	StatsConarchiveCount		= 0x120,
+	StatsPoolGamesUsed		= 0x130,
+	StatsPoolGamesFree		= 0x131,
+	StatsPoolTablesUsed		= 0x132,
+	StatsPoolTablesFree		= 0x133,
+	StatsPoolPlayersUsed		= 0x134,
+	StatsPoolPlayersFree		= 0x135,
+	StatsRankingQueued		= 0x140,
+	StatsRankingCommitTime		= 0x141,
+	StatsRankingCommitTimeMax	= 0x142,
 } serverstats_codes;
 
 typedef enum {
@@ -132,4 +146,22 @@ typedef enum {
 	PlayerStatsGameCount		= 0x12,
 } playerstats_codes;
 
+//! \brief Frame types of the binary protocol (negotiated by PCLIENT/PSERVER)
+typedef enum {
+	WireText		= 0x01,  // text protocol message, '\0'-terminated
+	WireSnap		= 0x02,  // gid, tid, snaptype, typed snapshot body
+	WireGameinfo		= 0x03,
+	WireMsg			= 0x04,
+	WireAction		= 0x05,  // client only
+	WireRecords		= 0x06,  // record type, count, count omitted, records
+	WireClientinfo		= 0x07,  // only as record of WireRecords
+} wireframe_type;
+
+//! \brief Field types of a binary snapshot body (except SnapTable)
+typedef enum {
+	WireFieldInt		= 0x01,
+	WireFieldCard		= 0x02,
+	WireFieldString		= 0x03,
+} wirefield_type;
+
 #endif /* _PROTOCOL_H */
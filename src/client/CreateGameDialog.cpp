@@ -73,7 +73,7 @@ CreateGameDialog::CreateGameDialog(QWidget *parent) : QDialog(parent)
 	QLabel *labelPlayers = new QLabel(tr("Max. players"), this);
 	spinPlayers = new QSpinBox(this);
 	spinPlayers->setMinimum(2);
-	spinPlayers->setMaximum(10);
+	spinPlayers->setMaximum(100);  // more than 10 play at several tables
 	spinPlayers->setSingleStep(1);
 	spinPlayers->setValue(5);
 	
@@ -230,6 +230,18 @@ void GameListTableModel::updatePassword(int gid, bool value)
 	updateValue(gid, 5, value);
 }
 
+void GameListTableModel::removeGame(int gid)
+{
+	for (int i = 0; i < games.size(); ++i)
+	{
+		if (games.at(i).gid == gid)
+		{
+			removeRows(i, 1);
+			return;
+		}
+	}
+}
+
 void GameListTableModel::clear()
 {
 	if (rowCount() > 0)
@@ -69,6 +69,9 @@ public:
 	void updateGameState(int gid, const QString& value);
 	void updatePassword(int gid, bool value);
 
+	//! \brief removes a single game
+	void removeGame(int gid);
+
 	//! \brief clear's the list
 	void clear();
 
@@ -410,19 +410,9 @@ WMain::WMain(QWidget *parent) : QMainWindow(parent, 0)
 	menuBar()->addMenu(menuHelp)->setText(tr("&Help"));
 	
 	
-	// gamelist update timer
-	timerGamelistUpdate = new QTimer(this);
-	connect(timerGamelistUpdate, SIGNAL(timeout()), qApp, SLOT(requestGamelist()));
+	// game-list, game infos and server stats are pushed by server (lobby)
 	
-	// current selected game update timer
-	timerSelectedGameUpdate = new QTimer(this);
-	connect(timerSelectedGameUpdate, SIGNAL(timeout()), this, SLOT(actionSelectedGameUpdate()));
-	
-	// server stats update timer
-	timerServerStatsUpdate = new QTimer(this);
-	connect(timerServerStatsUpdate, SIGNAL(timeout()), qApp, SLOT(requestServerStats()));
-	
-	// current selected game update timer
+	// server time update timer
 	timerServerTimeUpdate= new QTimer(this);
 	connect(timerServerTimeUpdate, SIGNAL(timeout()), this, SLOT(updateServerTimeLabel()));
 	
@@ -529,10 +519,7 @@ void WMain::updateConnectionStatus()
 		btnClose->setEnabled(true);
 		cbSrvAddr->setEnabled(false);
 		
-		// setup timers for gamelist update, select-game update, server-stats, server-time update
-		timerGamelistUpdate->start(60*1000);
-		timerServerStatsUpdate->start(3*60*1000);
-		timerSelectedGameUpdate->start(15*1000);
+		// setup timer for server-time update
 		timerServerTimeUpdate->start(1000);
 		
 		wConnection->setVisible(false);
@@ -548,9 +535,6 @@ void WMain::updateConnectionStatus()
 		
 		modelGameList->clear();
 		
-		timerGamelistUpdate->stop();
-		timerServerStatsUpdate->stop();
-		timerSelectedGameUpdate->stop();
 		timerServerTimeUpdate->stop();
 		
 		wConnection->setVisible(true);
@@ -723,8 +707,9 @@ void WMain::doRegister(bool bRegister, bool subscription)
 		}
 		
 		((PClient*)qApp)->doRegister(gid, bRegister, subscription, password);
+		
+		// the player-list is fetched once the gameinfo has arrived
 		((PClient*)qApp)->requestGameinfo(gid);
-		((PClient*)qApp)->requestPlayerlist(gid);
 	}
 }
 
@@ -840,7 +825,6 @@ void WMain::actionCreateGame()
 	gc.password = dialogCreateGame.getPassword();
 
 	((PClient*)qApp)->createGame(&gc);
-	((PClient*)qApp)->requestGamelist();
 }
 
 void WMain::actionChat(QString msg)
@@ -875,8 +859,8 @@ void WMain::gameListSelectionChanged(
 		const int selected_row = proxyModelGameList->mapToSource((*selected.begin()).topLeft()).row();
 		const int gid = modelGameList->findGidByRow(selected_row);
 		
+		// the player-list is fetched once the gameinfo has arrived
 		((PClient*)qApp)->requestGameinfo(gid);
-		((PClient*)qApp)->requestPlayerlist(gid);
 		
 		updateGameinfo(gid);
 	}
@@ -978,14 +962,21 @@ void WMain::notifyGameinfo(int gid)
 		const int sel_gid = modelGameList->findGidByRow(selected_row);
 		
 		if (gid == sel_gid)
+		{
 			updateGameinfo(gid);
+			
+			// the player-list isn't pushed; a GAMEINFO is pushed whenever
+			// the game info revision changes, which includes every player
+			// joining or leaving, so the list is fetched along with it
+			((PClient*)qApp)->requestPlayerlist(gid);
+		}
 	}
 }
 
 void WMain::notifyGamelist()
 {
 	// remove all vanished items from modelGameList
-	for (int i=0; i < modelGameList->rowCount(); i++)
+	for (int i=modelGameList->rowCount() - 1; i >= 0; i--)
 	{
 		const int gid = modelGameList->findGidByRow(i);
 		
@@ -995,31 +986,16 @@ void WMain::notifyGamelist()
 	}
 }
 
-// timer update
-void WMain::actionSelectedGameUpdate()
+void WMain::notifyGameRemoved(int gid)
 {
-#if 0
-	// do not update if window hasn't the focus
-	if (!isActiveWindow())
-		return;
-#endif
-	
+	modelGameList->removeGame(gid);
 	
 	QItemSelectionModel *pSelect = viewGameList->selectionModel();
-
 	Q_ASSERT_X(pSelect, Q_FUNC_INFO, "invalid selection model pointer");
 	
-	// only update gameinfo is a game is selected
+	// clear gameinfo panel if the selected game vanished
 	if (!pSelect->hasSelection())
-		return;
-	
-	const int selected_row = proxyModelGameList->mapToSource(pSelect->selectedRows().at(0)).row();
-	const int gid = modelGameList->findGidByRow(selected_row);
-	
-	//dbg_msg(Q_FUNC_INFO, "timer: updating game %d", gid);
-	
-	((PClient*)qApp)->requestGameinfo(gid);
-	((PClient*)qApp)->requestPlayerlist(gid);
+		updateGameinfo(-1);
 }
 
 void WMain::updateWelcomeLabel()
@@ -67,6 +67,7 @@ public:
 	
 	void notifyGameinfo(int gid);
 	void notifyGamelist();
+	void notifyGameRemoved(int gid);
 
 //	void notifyPlayerinfo(int cid);
 //	void notifyPlayerlist(int gid);
@@ -115,8 +116,6 @@ private slots:
 		const QItemSelection& selected,
 		const QItemSelection& deselected);
 	
-	void actionSelectedGameUpdate();
-	
 	void gameFilterChanged();
 	
 	void updateServerTimeLabel();
@@ -198,16 +197,7 @@ private:
 	QPushButton		*btnOpenTable;
 	QPushButton		*btnStartGame;
 	
-	//! \brief Timer for updating the gamelist
-	QTimer			*timerGamelistUpdate;
-	
-	//! \brief Timer for updating the selected game
-	QTimer			*timerSelectedGameUpdate;
-	
-	//! \brief Timer for updating the server stats
-	QTimer			*timerServerStatsUpdate;
-	
-	//! \brief Timer for updating the server timerGamelistUpdate
+	//! \brief Timer for updating the server time
 	QTimer			*timerServerTimeUpdate;
 };
 
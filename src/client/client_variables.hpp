@@ -27,6 +27,8 @@ config.set("auto_connect",	false);			// automatically connect to default server
 config.set("player_name",	"Unnamed");		// the player name
 config.set("info_location",	"");			// info: geographical location of the player
 config.set("uuid",		"");			// unique ID for re-connect
+config.set("binary_protocol",	true);			// use binary protocol if server supports it
+config.set("compression",	true);			// use compression if server supports it
 config.set("locale",		"");			// language/locale to use
 config.set("encoding",		"UTF-8");		// temporary fix for localized chat
 config.set("log",		true);			// log to file
@@ -34,6 +34,7 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
 #include <ctime>
 #include <string>
 
@@ -51,7 +52,7 @@
 ConfigParser config;
 
 
-// server command PSERVER <version> <client-id> <time>
+// server command PSERVER <version> <client-id> <time> [binary:<version>] [deflate]
 void PClient::serverCmdPserver(Tokenizer &t)
 {
 	srv.version = t.getNextInt();
@@ -60,6 +61,25 @@ void PClient::serverCmdPserver(Tokenizer &t)
 	const unsigned int time_remote = t.getNextInt();
 	srv.time_remote_delta = time_remote - QDateTime::currentDateTime().toTime_t();
 	
+	// server accepted binary protocol; all following messages are framed
+	// server accepted compression; all following data is deflated
+	std::string sopt;
+	while (t.getNext(sopt))
+	{
+		const strview sv = { sopt.c_str(), (unsigned int) sopt.length() };
+		
+		if (sopt == "deflate")
+		{
+#ifndef NOZLIB
+			srv.zout = zstream_deflate_create(6, 0);
+			srv.zin = zstream_inflate_create();
+			srv.inflate_pending = true;
+#endif
+		}
+		else
+			wire_parse_version(sv, &srv.wire_version);
+	}
+	
 	srv.introduced = true;
 		
 	wMain->addLog(tr("Server running version %1.%2.%3. Your client ID is %4.")
@@ -100,11 +120,8 @@ void PClient::serverCmdPserver(Tokenizer &t)
 	netSendMsg(msg);
 	
 	
-	// request initial game-list and start update-timer
-	requestGamelist();
-	
-	// request initial server stats
-	requestServerStats();
+	// request initial game-list and server stats; changes are pushed
+	requestLobby();
 }
 
 // server command ERR [<code>] [<text>]
@@ -126,41 +143,20 @@ void PClient::serverCmdErr(Tokenizer &t)
 }
 
 // server command MSG <from> <sender-name> <message>
-void PClient::serverCmdMsg(Tokenizer &t)
+void PClient::serverCmdMsg(const wire_msg &m)
 {
-	const std::string idfrom = t.getNext();
-
-	Tokenizer ft(":");
-	ft.parse(idfrom);
-		
-	int from = -1;
-	int gid = -1;
-	int tid = -1;
-	int cid = -1;
-
-	if (ft.count() == 2)
-	{
-		// message from table
-		gid = ft.getNextInt();
-		tid = ft.getNextInt();
-	}
-	else if (ft.count() == 3)
-	{
-		// client message from table
-		gid = ft.getNextInt();
-		tid = ft.getNextInt();
-		cid = ft.getNextInt();
-	}
-	else
-	{
-		// message from foyer or client
-		from = ft.getNextInt();
-	}
+	const int gid = m.gid;
+	const int tid = m.tid;
+	
+	// message from foyer or client
+	const int from = (m.gid == -1) ? m.cid : -1;
+	// client message from table
+	const int cid = (m.gid == -1) ? -1 : m.cid;
 
 	// playername
-	const QString qsfrom(QString::fromStdString(t.getNext()));
+	const QString qsfrom(QString::fromStdString(ViewTokenizer::view2string(m.name)));
 	// chatmessage
-	QString qchatmsg(QString::fromStdString(t.getTillEnd()));
+	QString qchatmsg(QString::fromStdString(ViewTokenizer::view2string(m.text)));
 
 	// replace all occurrences of "[cid]" in server-msg with player-name
 	if (from == -1)
@@ -209,7 +205,7 @@ void PClient::serverCmdMsg(Tokenizer &t)
 }
 
 // table snapshot
-void PClient::serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinfo)
+void PClient::serverCmdSnapTable(const wire_table_snap &ts, int gid, int tid, tableinfo* tinfo)
 {
 	// silently drop message if there is no table-info
 	if (!tinfo)
@@ -218,57 +214,32 @@ void PClient::serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinf
 	table_snapshot &table = tinfo->snap;
 	HoleCards &holecards = tinfo->holecards;
 	
-	Tokenizer st(":");
-	
 	// state:betting_round
-	std::string tmp = t.getNext();
-	st.parse(tmp);
-	
-	table.state = st.getNextInt();
-	table.betting_round = st.getNextInt();
+	table.state = ts.state;
+	table.betting_round = ts.betround;
 	
 	// dealer:sb:bb:current:lastbet
-	tmp = t.getNext();
-	st.parse(tmp);
-	table.s_dealer = st.getNextInt();
-	table.s_sb = st.getNextInt();
-	table.s_bb = st.getNextInt();
-	table.s_cur = st.getNextInt();
-	table.s_lastbet = st.getNextInt();
+	table.s_dealer = ts.s_dealer;
+	table.s_sb = ts.s_sb;
+	table.s_bb = ts.s_bb;
+	table.s_cur = ts.s_cur;
+	table.s_lastbet = ts.s_lastbet;
 	
 	// community-cards
 	{
-		std::string board = t.getNext().substr(3);
 		CommunityCards &cc = table.communitycards;
 		
-		Tokenizer ct(":");
-		ct.parse(board);
-		
-		if (ct.count() == 0)
+		if (ts.cc_count == 0)
 			cc.clear();
 		
-		if (ct.count() >= 3)
-		{
-			Card cf1(ct.getNext().c_str());
-			Card cf2(ct.getNext().c_str());
-			Card cf3(ct.getNext().c_str());
-			
-			cc.setFlop(cf1, cf2, cf3);
-		}
+		if (ts.cc_count >= 3)
+			cc.setFlop(Card(ts.cc[0]), Card(ts.cc[1]), Card(ts.cc[2]));
 		
-		if (ct.count() >= 4)
-		{
-			Card ct1(ct.getNext().c_str());
-			
-			cc.setTurn(ct1);
-		}
+		if (ts.cc_count >= 4)
+			cc.setTurn(Card(ts.cc[3]));
 		
-		if (ct.count() == 5)
-		{
-			Card cr1(ct.getNext().c_str());
-			
-			cc.setRiver(cr1);
-		}
+		if (ts.cc_count == 5)
+			cc.setRiver(Card(ts.cc[4]));
 	}
 	
 	// table.seats
@@ -278,40 +249,32 @@ void PClient::serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinf
 	const unsigned int seat_max = 10;
 	memset(table.seats, 0, seat_max*sizeof(seatinfo));
 	
-	tmp = t.getNext();
-	do {
-		//dbg_msg("seat", "%s", tmp.c_str());
-		
-		Tokenizer st(":");
-		st.parse(tmp);
-		
-		unsigned int seat_no = Tokenizer::string2int(st.getNext().substr(1));
+	for (unsigned int i=0; i < ts.seat_count; i++)
+	{
+		const wire_seat &s = ts.seats[i];
+		const unsigned int seat_no = s.seat_no;
 		
 		seatinfo si;
 		memset(&si, 0, sizeof(si));
 		
 		si.valid = true;
-		si.client_id = st.getNextInt();
+		si.client_id = s.client_id;
 		
 		if (si.client_id == srv.cid)
 			table.my_seat = seat_no;
 		
-		int pstate = st.getNextInt();
-		if (pstate & PlayerInRound)
+		if (s.pstate & PlayerInRound)
 			si.in_round = true;
-		if (pstate & PlayerSitout)
+		if (s.pstate & PlayerSitout)
 			si.sitout = true;
 		
-		si.stake = st.getNextInt();
-		si.bet = st.getNextInt();
-		si.action = (Player::PlayerAction) st.getNextInt();
+		si.stake = s.stake;
+		si.bet = s.bet;
+		si.action = (Player::PlayerAction) s.action;
 		
-		std::string shole = st.getNext();
-		if (shole.length() == 4)
+		if (s.hole_count == 2)
 		{
-			Card h1(shole.substr(0, 2).c_str());
-			Card h2(shole.substr(2, 2).c_str());
-			si.holecards.setCards(h1, h2);
+			si.holecards.setCards(Card(s.hole[0]), Card(s.hole[1]));
 			
 			// if there are hole-cards in the snapshot
 			// then there's no further action possible
@@ -322,28 +285,17 @@ void PClient::serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinf
 		
 		if (seat_no < seat_max)
 			table.seats[seat_no] = si;
-		
-		tmp = t.getNext();
-	} while (tmp[0] == 's');
+	}
 	
 	
+	// pots
 	table.pots.clear();
 	
-	// pots
-	do {
-		//dbg_msg("pot", "%s", tmp.c_str());
-		Tokenizer pt(":");
-		pt.parse(tmp);
-		
-		pt.getNext();   // pot-no; unused
-		chips_type potsize = pt.getNextInt();
-		table.pots.push_back(potsize);
-		
-		tmp = t.getNext();
-	} while (tmp[0] == 'p');
+	for (unsigned int i=0; i < ts.pot_count; i++)
+		table.pots.push_back(ts.pots[i]);
 	
 	
-	table.minimum_bet = Tokenizer::string2int(tmp);
+	table.minimum_bet = ts.minimum_bet;
 	
 	
 	if (table.state == Table::NewRound)
@@ -353,6 +305,49 @@ void PClient::serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinf
 		tinfo->window->updateView();
 }
 
+// table snapshot (binary); either full or the changes since the previous one
+void PClient::serverCmdSnapTable(wire_reader *r, int gid, int tid, tableinfo* tinfo)
+{
+	const unsigned int seq = wire_get_uvar(r);
+	const unsigned int base_seq = wire_get_uvar(r);
+	
+	// silently drop message if there is no table-info
+	if (!tinfo)
+		return;
+	
+	if (!base_seq)
+	{
+		if (!wire_decode_table_snap(r, &tinfo->wire_snap))
+		{
+			log_msg("snap", "error: invalid table snapshot (gid=%d tid=%d)", gid, tid);
+			tinfo->snap_seq = 0;
+			return;
+		}
+		
+		tinfo->snap_resync = false;
+	}
+	else if (base_seq != tinfo->snap_seq || !wire_decode_table_delta(r, &tinfo->wire_snap))
+	{
+		// missed a snapshot; ask for the current state (only once)
+		tinfo->snap_seq = 0;
+		
+		if (!tinfo->snap_resync)
+		{
+			char msg[64];
+			snprintf(msg, sizeof(msg), "REQUEST snapshot %d %d", gid, tid);
+			netSendMsg(msg);
+			
+			tinfo->snap_resync = true;
+		}
+		
+		return;
+	}
+	
+	tinfo->snap_seq = seq;
+	
+	serverCmdSnapTable(tinfo->wire_snap, gid, tid, tinfo);
+}
+
 // snapshot with gamestate info
 void PClient::serverCmdSnapGamestate(Tokenizer &t, int gid, int tid, tableinfo* tinfo)
 {
@@ -414,7 +409,21 @@ void PClient::serverCmdSnapGamestate(Tokenizer &t, int gid, int tid, tableinfo*
 				.arg(player_name) +
 			((position != -1) ? QString(" #%1").arg(position) : QString()));
 	}
-	// TODO: else if (type == "your_seat")
+	else if (type == SnapGameStateSeat)
+	{
+		const int cid = t.getNextInt();
+		const int to_tid = t.getNextInt();
+		const QString player_name = modelPlayerList->getPlayerName(cid);
+		
+		// silently drop message if there is no table-info
+		if (!tinfo)
+			return;
+		
+		tinfo->window->addServerMessage(
+			tr("Player %1 moved to table %2.")
+				.arg(player_name)
+				.arg(to_tid + 1));
+	}
 }
 
 // cards snapshot
@@ -597,22 +606,34 @@ void PClient::serverCmdSnapPlayerShow(Tokenizer &t, int gid, int tid, tableinfo*
 
 void PClient::serverCmdSnapFoyer(Tokenizer &t)
 {
-	const snap_foyer_type type = (snap_foyer_type) t.getNextInt();
-	const int cid = t.getNextInt();
-	const std::string cname = t.getNext();
+	// batched form: any count of <type> <cid> <name> triples
+	int present = 0;
 	
-	if (type == SnapFoyerJoin && config.getInt("chat_verbosity_foyer") & 0x2)
+	std::string stype, scid, cname;
+	while (t.getNext(stype) && t.getNext(scid) && t.getNext(cname))
 	{
-		wMain->addServerMessage(tr("%2 (%1) joined foyer.")
-			.arg(cid)
-			.arg(QString::fromStdString(cname)));
-	}
-	else if (type == SnapFoyerLeave && config.getInt("chat_verbosity_foyer") & 0x2)
-	{
-		wMain->addServerMessage(tr("%2 (%1) left foyer.")
-			.arg(cid)
-			.arg(QString::fromStdString(cname)));
+		const snap_foyer_type type = (snap_foyer_type) Tokenizer::string2int(stype);
+		const int cid = Tokenizer::string2int(scid);
+		
+		if (type == SnapFoyerJoin && config.getInt("chat_verbosity_foyer") & 0x2)
+		{
+			wMain->addServerMessage(tr("%2 (%1) joined foyer.")
+				.arg(cid)
+				.arg(QString::fromStdString(cname)));
+		}
+		else if (type == SnapFoyerLeave && config.getInt("chat_verbosity_foyer") & 0x2)
+		{
+			wMain->addServerMessage(tr("%2 (%1) left foyer.")
+				.arg(cid)
+				.arg(QString::fromStdString(cname)));
+		}
+		else if (type == SnapFoyerPresent)
+			present++;
 	}
+	
+	// presence snapshot after joining; may be split into several messages
+	if (present && config.getInt("chat_verbosity_foyer") & 0x2)
+		wMain->addServerMessage(tr("%1 more players in foyer.").arg(present));
 }
 
 // server cmd SNAP
@@ -623,18 +644,31 @@ void PClient::serverCmdSnap(Tokenizer &t)
 	ft.parse(from);
 	const int gid = ft.getNextInt();
 	const int tid = ft.getNextInt();
-	tableinfo *tinfo = getTableInfo(gid, tid);
 	
-	snaptype snap = (snaptype)t.getNextInt();
+	const int snap = t.getNextInt();
+	
+	serverCmdSnap(gid, tid, snap, t);
+}
+
+// snapshot arguments, either from text or from a field list frame
+void PClient::serverCmdSnap(int gid, int tid, int snap, Tokenizer &t)
+{
+	tableinfo *tinfo = getTableInfo(gid, tid);
 	
-	switch ((int)snap)
+	switch (snap)
 	{
 	case SnapGameState:
 		serverCmdSnapGamestate(t, gid, tid, tinfo);
 		break;
 	
 	case SnapTable:
-		serverCmdSnapTable(t, gid, tid, tinfo);
+		{
+			const std::string args = t.getTillEnd();
+			wire_table_snap ts;
+			
+			if (wire_parse_table_snap(args.c_str(), args.length(), &ts))
+				serverCmdSnapTable(ts, gid, tid, tinfo);
+		}
 		break;
 	
 	case SnapCards:
@@ -735,7 +769,7 @@ void PClient::serverCmdPlayerlist(Tokenizer &t)
 	// only request client-info if there are unknown clients left
 	if (sreq_clean.length())
 	{
-		snprintf(msg, sizeof(msg), "REQUEST clientinfo %s", sreq_clean.c_str());
+		snprintf(msg, sizeof(msg), "REQUEST clients %s", sreq_clean.c_str());
 		netSendMsg(msg);
 	}
 	
@@ -766,10 +800,50 @@ void PClient::serverCmdClientinfo(Tokenizer &t)
 	}
 }
 
+// client info record of a bulk response (binary)
+void PClient::serverCmdClientinfo(const wire_clientinfo &ci)
+{
+	Q_ASSERT_X(modelPlayerList, Q_FUNC_INFO, "invalid modelPlayerList pointer");
+	
+	modelPlayerList->updatePlayerName(ci.cid,
+		QString::fromStdString(ViewTokenizer::view2string(ci.name)));
+	modelPlayerList->updatePlayerLocation(ci.cid,
+		QString::fromStdString(ViewTokenizer::view2string(ci.location)));
+}
+
+// bulk response <type> <count> <omitted> <records> (binary)
+void PClient::serverCmdRecords(wire_reader *r)
+{
+	const unsigned int type = wire_get_u8(r);
+	const unsigned int count = wire_get_uvar(r);
+	const unsigned int omitted = wire_get_uvar(r);
+	
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		if (type == WireGameinfo)
+		{
+			wire_gameinfo gi;
+			if (wire_decode_gameinfo(r, &gi))
+				serverCmdGameinfo(gi);
+		}
+		else if (type == WireClientinfo)
+		{
+			wire_clientinfo ci;
+			if (wire_decode_clientinfo(r, &ci))
+				serverCmdClientinfo(ci);
+		}
+		else
+			break;
+	}
+	
+	if (omitted)
+		log_msg("records", "%d records exceeded the server limit", omitted);
+}
+
 // server command GAMEINFO <gid> <type>:<value> [...]
-void PClient::serverCmdGameinfo(Tokenizer &t)
+void PClient::serverCmdGameinfo(const wire_gameinfo &wgi)
 {
-	const int gid = t.getNextInt();
+	const int gid = wgi.gid;
 	
 	games_type::iterator git = games.find(gid);
 	
@@ -785,40 +859,29 @@ void PClient::serverCmdGameinfo(Tokenizer &t)
 	
 	
 	// unpack info
-	const std::string sinfo = t.getNext();
-	
-	Tokenizer it(":");
-	it.parse(sinfo);
+	gi->type = (gametype) wgi.type;
+	gi->mode = (gamemode) wgi.mode;
+	gi->state = (gamestate) wgi.state;
 	
-	gi->type = (gametype) it.getNextInt();
-	gi->mode = (gamemode) it.getNextInt();
-	gi->state = (gamestate) it.getNextInt();
+	gi->registered = wgi.flags & GameInfoRegistered;
+	gi->subscribed = wgi.flags & GameInfoSubscribed;
+	gi->password = wgi.flags & GameInfoPassword;
+	gi->owner = wgi.flags & GameInfoOwner;
 	
-	unsigned int flags = it.getNextInt();
-	gi->registered = flags & GameInfoRegistered;
-	gi->subscribed = flags & GameInfoSubscribed;
-	gi->password = flags & GameInfoPassword;
-	gi->owner = flags & GameInfoOwner;
-	
-//	qDebug() << "[" << getMyCId() << "]" << gid << "owner" << gi->owner;
-	
-	gi->players_max = it.getNextInt();
-	gi->players_count = it.getNextInt();
-	gi->player_timeout = it.getNextInt();
-	gi->initial_stakes = it.getNextInt();
+	gi->players_max = wgi.players_max;
+	gi->players_count = wgi.players_count;
+	gi->player_timeout = wgi.timeout;
+	gi->initial_stakes = wgi.stakes;
 	
 	
 	// unpack blinds-rule
-	const std::string sblinds = t.getNext();
-	it.parse(sblinds);
-	
-	gi->blinds_start = it.getNextInt();
-	gi->blinds_factor = it.getNextInt() / 10.0;
-	gi->blinds_time = it.getNextInt();
+	gi->blinds_start = wgi.blinds_start;
+	gi->blinds_factor = wgi.blinds_factor / 10.0;
+	gi->blinds_time = wgi.blinds_time;
 	
 	
 	// game name
-	gi->name = QString::fromStdString(t.getNext());
+	gi->name = QString::fromStdString(ViewTokenizer::view2string(wgi.name));
 	
 	
 	// notify WMain there's an updated gameinfo available
@@ -831,23 +894,44 @@ void PClient::serverCmdGameinfo(Tokenizer &t)
 void PClient::serverCmdGamelist(Tokenizer &t)
 {
 	// game-list
-	std::string sreq;
-	
 	gamelist.clear();
 	
 	std::string sgid;
 	while (t.getNext(sgid))
-	{
 		gamelist.push_back(Tokenizer::string2int(sgid));
-		sreq += sgid + " ";
-	}
 	
-	// get game info
-	requestGameinfo(sreq.c_str());
+	// get game info; lobby subscribers get it without asking
+	if (!srv.lobby)
+		requestGames();
 	
 	wMain->notifyGamelist();
 }
 
+// server command LOBBY <created|removed> <gid> [...]
+void PClient::serverCmdLobby(Tokenizer &t)
+{
+	const std::string event = t.getNext();
+	
+	std::string sgid;
+	while (t.getNext(sgid))
+	{
+		const int gid = Tokenizer::string2int(sgid);
+		
+		if (event == "created")
+		{
+			// game info follows
+			if (!isGameInList(gid))
+				gamelist.push_back(gid);
+		}
+		else if (event == "removed")
+		{
+			gamelist.erase(std::remove(gamelist.begin(), gamelist.end(), gid), gamelist.end());
+			
+			wMain->notifyGameRemoved(gid);
+		}
+	}
+}
+
 void PClient::serverCmdServerinfo(Tokenizer &t)
 {
 	std::string spair;
@@ -941,27 +1025,182 @@ int PClient::serverExecute(const char *cmd)
 	}
 	else if (command == "ERR")
 		serverCmdErr(t);
-	else if (command == "MSG")
-		serverCmdMsg(t);
+	else if (command == "MSG" || command == "GAMEINFO")
+	{
+		// raw arguments; the message text must not be re-tokenized
+		ViewTokenizer vt;
+		vt.parse(cmd, strlen(cmd));
+		if (srv.last_msgid != -1)
+			vt.getNext();
+		vt.getNext();
+		
+		const strview args = vt.getTillEnd();
+		
+		if (command == "MSG")
+		{
+			wire_msg m;
+			if (wire_parse_msg(args.str, args.len, &m))
+				serverCmdMsg(m);
+		}
+		else
+		{
+			wire_gameinfo gi;
+			if (wire_parse_gameinfo(args.str, args.len, &gi))
+				serverCmdGameinfo(gi);
+		}
+	}
 	else if (command == "SNAP")
 		serverCmdSnap(t);
 	else if (command == "PLAYERLIST")
 		serverCmdPlayerlist(t);
 	else if (command == "CLIENTINFO")
 		serverCmdClientinfo(t);
-	else if (command == "GAMEINFO")
-		serverCmdGameinfo(t);
 	else if (command == "GAMELIST")
 		serverCmdGamelist(t);
+	else if (command == "LOBBY")
+		serverCmdLobby(t);
+	else if (command == "RECORDS")
+	{
+		// header of a bulk response; the records follow as regular messages
+	}
 	else if (command == "SERVERINFO")
 		serverCmdServerinfo(t);
 
 	return 0;
 }
 
+int PClient::serverExecuteFrame(const char *payload, unsigned int len)
+{
+	wire_reader r;
+	wire_reader_init(&r, payload, len);
+	
+	const unsigned int type = wire_get_u8(&r);
+	
+	if (type == WireText)
+	{
+		// text protocol message; must be '\0'-terminated
+		if (len < 2 || payload[len - 1] != '\0')
+		{
+			log_msg("connectsock", "error: invalid text frame");
+			return 0;
+		}
+		
+		return serverExecute(payload + 1);
+	}
+	
+	// typed messages are only sent after introduction and never carry a msgid
+	if (!srv.introduced)
+	{
+		log_msg("connectsock", "error: unexpected frame (type=%d)", type);
+		return 0;
+	}
+	
+	srv.last_msgid = -1;
+	
+	switch (type)
+	{
+	case WireSnap:
+		{
+			const int gid = wire_get_var(&r);
+			const int tid = wire_get_var(&r);
+			const int snap = wire_get_u8(&r);
+			
+			if (snap == SnapTable)
+			{
+				serverCmdSnapTable(&r, gid, tid, getTableInfo(gid, tid));
+				return 0;
+			}
+			
+			wire_fields f;
+			if (!wire_decode_fields(&r, &f))
+				break;
+			
+			// rebuild the argument list for the text handlers
+			Tokenizer t(" ");
+			for (unsigned int i=0; i < f.count; i++)
+			{
+				const wire_field &field = f.fields[i];
+				
+				if (field.type == WireFieldInt)
+				{
+					char tmp[16];
+					snprintf(tmp, sizeof(tmp), "%d", field.value);
+					t.add(tmp);
+				}
+				else if (field.type == WireFieldCard)
+					t.add(field.card);
+				else
+					t.add(ViewTokenizer::view2string(field.str));
+			}
+			
+			serverCmdSnap(gid, tid, snap, t);
+			return 0;
+		}
+	
+	case WireGameinfo:
+		{
+			wire_gameinfo gi;
+			if (!wire_decode_gameinfo(&r, &gi))
+				break;
+			
+			serverCmdGameinfo(gi);
+			return 0;
+		}
+	
+	case WireMsg:
+		{
+			wire_msg m;
+			if (!wire_decode_msg(&r, &m))
+				break;
+			
+			serverCmdMsg(m);
+			return 0;
+		}
+	
+	case WireRecords:
+		serverCmdRecords(&r);
+		return 0;
+	}
+	
+	log_msg("connectsock", "error: invalid frame (type=%d, len=%d)", type, len);
+	return 0;
+}
+
+// returns zero if no complete frame was found or no bytes remaining after exec
+int PClient::serverParseframe()
+{
+	if (srv.buflen < WIRE_HEADER_SIZE)
+		return 0;
+	
+	const size_t framelen = wire_frame_length(srv.msgbuf);
+	if (!framelen || framelen > sizeof(srv.msgbuf) - WIRE_HEADER_SIZE)
+	{
+		log_msg("connectsock", "error: invalid frame length (%d)", (int) framelen);
+		srv.buflen = 0;
+		return 0;
+	}
+	
+	const int total = WIRE_HEADER_SIZE + framelen;
+	
+	// wait for the frame to be complete
+	if (srv.buflen < total)
+		return 0;
+	
+	serverExecuteFrame(srv.msgbuf + WIRE_HEADER_SIZE, framelen);
+	
+	// move the rest to front
+	memmove(srv.msgbuf, srv.msgbuf + total, srv.buflen - total);
+	srv.buflen -= total;
+	
+	return srv.buflen;
+}
+
 // returns zero if no cmd was found or no bytes remaining after exec
 int PClient::serverParsebuffer()
 {
+	if (srv.wire_version)
+		return serverParseframe();
+	
 	//log_msg("clientsock", "(%d) parse (bufferlen=%d)", srv.sock, srv.buflen);
 	
 	int found_nl = -1;
@@ -995,6 +1234,18 @@ int PClient::serverParsebuffer()
 			//log_msg("clientsock", "(%d) new buffer after cmd (bufferlen=%d)", srv.sock, srv.buflen);
 			
 			retval = srv.buflen;
+			
+			// the rest has been received compressed along with PSERVER
+			if (srv.inflate_pending)
+			{
+				srv.inflate_pending = false;
+				
+				const std::string rest(srv.msgbuf, srv.buflen);
+				srv.buflen = 0;
+				netInflate(rest.data(), rest.length());
+				
+				retval = 0;
+			}
 		}
 		else
 			retval = 0;
@@ -1142,6 +1393,27 @@ bool PClient::doSetAction(int gid, Player::PlayerAction action, chips_type amoun
 		break;
 	}
 	
+	if (srv.wire_version)
+	{
+		wire_action a;
+		a.msgid = -1;
+		a.gid = gid;
+		a.action = action;
+		a.amount = bAmount ? amount : 0;
+		
+		char frame[64];
+		wire_writer w;
+		wire_writer_init(&w, frame, sizeof(frame));
+		
+		const size_t start = wire_frame_begin(&w, WireAction);
+		wire_encode_action(&w, &a);
+		wire_frame_end(&w, start);
+		
+		netSendFrame(&w);
+		
+		return true;
+	}
+	
 	char msg[1024];
 	if (bAmount)
 		snprintf(msg, sizeof(msg), "ACTION %d %s %d",
@@ -1250,14 +1522,67 @@ QDateTime PClient::getServerTime()
 
 int PClient::netSendMsg(const char *msg)
 {
-	char buf[1024];
-	const int len = snprintf(buf, sizeof(buf), "%s\n", msg);
-	
 #ifdef DEBUG
 	if (config.getBool("dbg_srv_cmd"))
 		dbg_msg("netSendMsg", "req= %s", msg);
 #endif
 	
+	if (srv.wire_version)
+	{
+		char frame[1024 + WIRE_HEADER_SIZE + 2];
+		wire_writer w;
+		wire_writer_init(&w, frame, sizeof(frame));
+		
+		const size_t start = wire_frame_begin(&w, WireText);
+		wire_put_bytes(&w, msg, strlen(msg) + 1);
+		wire_frame_end(&w, start);
+		
+		return netSendFrame(&w);
+	}
+	
+	char buf[1024];
+	const int len = snprintf(buf, sizeof(buf), "%s\n", msg);
+	
+	return netSend(buf, len);
+}
+
+int PClient::netSendFrame(const wire_writer *w)
+{
+	if (w->overflow)
+	{
+		log_msg("connectsock", "error: frame exceeds buffer size");
+		return -1;
+	}
+	
+	return netSend(w->data, w->len);
+}
+
+#ifndef NOZLIB
+static int net_sink(void *arg, const char *buf, size_t len)
+{
+	QTcpSocket *socket = (QTcpSocket*) arg;
+	
+	return socket->write(buf, len);
+}
+#endif
+
+int PClient::netSend(const char *buf, int len)
+{
+#ifndef NOZLIB
+	// messages are compressed one at a time; there is no batching on client side
+	if (srv.zout)
+	{
+		if (zstream_append(srv.zout, buf, len) ||
+			zstream_flush(srv.zout, net_sink, tcpSocket) == -1)
+		{
+			log_msg("connectsock", "error: compression failed");
+			return -1;
+		}
+		
+		return len;
+	}
+#endif
+	
 	const int bytes = tcpSocket->write(buf, len);
 	
 	// FIXME: send remaining bytes if not all have been sent
@@ -1268,6 +1593,44 @@ int PClient::netSendMsg(const char *msg)
 	return bytes;
 }
 
+void PClient::netReceive(const char *buf, int len)
+{
+	if (srv.buflen + len > (int)sizeof(srv.msgbuf))
+	{
+		log_msg("connectsock", "error: buffer size exceeded");
+		srv.buflen = 0;
+	}
+	else
+	{
+		memcpy(srv.msgbuf + srv.buflen, buf, len);
+		srv.buflen += len;
+		
+		// parse and execute all commands in queue
+		while (serverParsebuffer());
+	}
+}
+
+void PClient::netInflate(const char *buf, int len)
+{
+#ifndef NOZLIB
+	char out[4096];
+	int produced;
+	
+	zstream_input(srv.zin, buf, len);
+	
+	do
+	{
+		if ((produced = zstream_inflate(srv.zin, out, sizeof(out))) == -1)
+		{
+			log_msg("connectsock", "error: corrupt compressed stream");
+			return;
+		}
+		
+		netReceive(out, produced);
+	} while (sizeof(out) == produced);
+#endif
+}
+
 void PClient::netRead()
 {
 	char buf[1024];
@@ -1281,24 +1644,26 @@ void PClient::netRead()
 		
 		//log_msg("connectsock", "(%d) DATA len=%d", sock, bytes);
 		
-		if (srv.buflen + bytes > (int)sizeof(srv.msgbuf))
-		{
-			log_msg("connectsock", "error: buffer size exceeded");
-			srv.buflen = 0;
-		}
+		if (srv.zin)
+			netInflate(buf, bytes);
 		else
-		{
-			memcpy(srv.msgbuf + srv.buflen, buf, bytes);
-			srv.buflen += bytes;
-			
-			// parse and execute all commands in queue
-			while (serverParsebuffer());
-		}
+			netReceive(buf, bytes);
 	} while (sizeof(buf) == bytes);
 	
 	return;
 }
 
+void PClient::netResetCompression()
+{
+#ifndef NOZLIB
+	zstream_destroy(srv.zout);
+	zstream_destroy(srv.zin);
+#endif
+	srv.zout = NULL;
+	srv.zin = NULL;
+	srv.inflate_pending = false;
+}
+
 void PClient::netError(QAbstractSocket::SocketError socketError)
 {
 	log_msg("net", "Connection error: %s", tcpSocket->errorString().toStdString().c_str());
@@ -1315,6 +1680,7 @@ void PClient::netConnected()
 	log_msg("net", "Connection established");
 	wMain->addLog(tr("Connected."));
 	
+	netResetCompression();
 	memset(&srv, 0, sizeof(srv));
 	
 	connected = true;
@@ -1324,10 +1690,20 @@ void PClient::netConnected()
 	
 	// send protocol introduction
 	char msg[1024];
-	snprintf(msg, sizeof(msg), "PCLIENT %d %s",
+	int len = snprintf(msg, sizeof(msg), "PCLIENT %d %s",
 		VERSION,
 		config.get("uuid").c_str());
 	
+	// offer binary protocol; server confirms it in PSERVER
+	if (config.getBool("binary_protocol"))
+		len += snprintf(msg + len, sizeof(msg) - len, " binary:%d", WIRE_PROTOCOL_VERSION);
+	
+#ifndef NOZLIB
+	// offer compression; nothing else may be sent until PSERVER has arrived
+	if (config.getBool("compression"))
+		snprintf(msg + len, sizeof(msg) - len, " deflate");
+#endif
+	
 	netSendMsg(msg);
 }
 
@@ -1336,6 +1712,8 @@ void PClient::netDisconnected()
 	log_msg("net", "Connection closed");
 	wMain->addLog(tr("Connection closed."));
 	
+	netResetCompression();
+	
 	connected = false;
 	connecting = false;
 	
@@ -1384,6 +1762,13 @@ void PClient::requestServerStats()
 	netSendMsg("REQUEST serverinfo");
 }
 
+void PClient::requestLobby()
+{
+	// initial game-list, game infos and server stats; then changes only
+	netSendMsg("REQUEST lobby");
+	srv.lobby = true;
+}
+
 bool PClient::isGameInList(int gid)
 {
 	for (gamelist_type::const_iterator e = gamelist.begin(); e != gamelist.end(); e++) 
@@ -1402,6 +1787,12 @@ void PClient::requestGameinfo(const char *glist)
 	netSendMsg(msg);
 }
 
+void PClient::requestGames()
+{
+	// infos of all games as one response
+	netSendMsg("REQUEST games");
+}
+
 void PClient::requestGameinfo(int gid)
 {
 	char msg[1024];
@@ -1439,6 +1830,8 @@ PClient::PClient(int &argc, char **argv) : QApplication(argc, argv)
 	connected = false;
 	connecting = false;
 	
+	memset(&srv, 0, sizeof(srv));
+	
 	tcpSocket = new QTcpSocket(this);
 	connect(tcpSocket, SIGNAL(readyRead()), this, SLOT(netRead()));
 	connect(tcpSocket, SIGNAL(error(QAbstractSocket::SocketError)),
@@ -37,6 +37,8 @@
 #include <QRegExp>
 
 #include "Tokenizer.hpp"
+#include "WireProtocol.hpp"
+#include "ZStream.h"
 
 #include "Card.hpp"
 #include "HoleCards.hpp"
@@ -56,9 +58,15 @@ typedef struct {
 	int buflen;
 	int last_msgid;
 	
+	unsigned int wire_version;   // binary protocol version in use (0 for text)
+	
+	zstream *zout, *zin;   // compression streams; NULL if not negotiated
+	bool inflate_pending;   // data following PSERVER still needs to be inflated
+	
 	int cid;   // our client-id assigned by server
 	
 	bool introduced;   // PCLIENT->PSERVER sequence success
+	bool lobby;   // subscribed to game-list updates
 	
 	uint time_remote_delta;
 } servercon;
@@ -69,6 +77,11 @@ typedef struct {
 	table_snapshot snap;
 	HoleCards holecards;
 	WTable *window;
+	
+	// binary protocol: last table snapshot, base for deltas
+	wire_table_snap wire_snap;
+	unsigned int snap_seq;
+	bool snap_resync;   // full snapshot has been requested
 } tableinfo;
 
 typedef std::map<int,tableinfo>		tables_type;
@@ -177,6 +190,7 @@ public:
 	
 	void requestGameinfo(const char *glist);
 	void requestGameinfo(int gid);
+	void requestGames();
 	
 	void sendDebugMsg(const QString& msg);
 	
@@ -200,24 +214,36 @@ private:
 	
 private:	
 	int netSendMsg(const char *msg);
+	int netSendFrame(const wire_writer *w);
+	int netSend(const char *buf, int len);
+	void netReceive(const char *buf, int len);
+	void netInflate(const char *buf, int len);
+	void netResetCompression();
 	
 	int serverExecute(const char *cmd);
+	int serverExecuteFrame(const char *payload, unsigned int len);
 	int serverParsebuffer();
+	int serverParseframe();
 	
 	void serverCmdPserver(Tokenizer &t);
 	void serverCmdErr(Tokenizer &t);
-	void serverCmdMsg(Tokenizer &t);
+	void serverCmdMsg(const wire_msg &m);
 	void serverCmdSnap(Tokenizer &t);
+	void serverCmdSnap(int gid, int tid, int snap, Tokenizer &t);
 	void serverCmdSnapGamestate(Tokenizer &t, int gid, int tid, tableinfo* tinfo);
-	void serverCmdSnapTable(Tokenizer &t, int gid, int tid, tableinfo* tinfo);
+	void serverCmdSnapTable(const wire_table_snap &ts, int gid, int tid, tableinfo* tinfo);
+	void serverCmdSnapTable(wire_reader *r, int gid, int tid, tableinfo* tinfo);
 	void serverCmdSnapCards(Tokenizer &t, int gid, int tid, tableinfo* tinfo);
 	void serverCmdSnapPlayerAction(Tokenizer &t, int gid, int tid, tableinfo* tinfo);
 	void serverCmdSnapPlayerShow(Tokenizer &t, int gid, int tid, tableinfo* tinfo);
 	void serverCmdSnapFoyer(Tokenizer &t);
 	void serverCmdPlayerlist(Tokenizer &t);
 	void serverCmdClientinfo(Tokenizer &t);
-	void serverCmdGameinfo(Tokenizer &t);
+	void serverCmdClientinfo(const wire_clientinfo &ci);
+	void serverCmdRecords(wire_reader *r);
+	void serverCmdGameinfo(const wire_gameinfo &gi);
 	void serverCmdGamelist(Tokenizer &t);
+	void serverCmdLobby(Tokenizer &t);
 	void serverCmdServerinfo(Tokenizer &t);
 	
 	bool addTable(int gid, int tid);
@@ -229,6 +255,9 @@ public slots:
 	//! \brief request server stats
 	void requestServerStats();
 	
+	//! \brief subscribe to game-list updates pushed by server
+	void requestLobby();
+	
 private slots:
 	void netRead();
 	void netError(QAbstractSocket::SocketError socketError);
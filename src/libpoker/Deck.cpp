@@ -25,6 +25,7 @@
 
 #include "GameDebug.hpp"
 #include "Deck.hpp"
+#include "Random.hpp"
 
 using namespace std;
 
@@ -73,6 +74,13 @@ bool Deck::shuffle()
 	return true;
 }
 
+bool Deck::shuffle(const RandomSeed &seed)
+{
+	Random rnd(seed);
+	rnd.shuffle(cards);
+	return true;
+}
+
 
 void Deck::debug()
 {
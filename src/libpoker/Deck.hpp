@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "Card.hpp"
+#include "Random.hpp"
 
 class Deck
 {
@@ -38,6 +39,9 @@ public:
 	bool push(Card card);
 	bool pop(Card &card);
 	bool shuffle();
+	bool shuffle(const RandomSeed &seed);
+	
+	void copyCards(std::vector<Card> *v) const { v->insert(v->end(), cards.begin(), cards.end()); };
 	
 	void debugRemoveCard(Card card);
 	void debugPushCards(const std::vector<Card> *cardsvec);
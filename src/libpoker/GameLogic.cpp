@@ -24,7 +24,6 @@
 #include <algorithm>
 #include <functional>
 
-#include "Debug.h"
 #include "GameDebug.hpp"
 #include "GameLogic.hpp"
 
@@ -21,14 +21,26 @@
  */
 
 
-#include "Debug.h"
 #include "Player.hpp"
 
 using namespace std;
 
 Player::Player()
 {
+	recycle();
+}
+
+void Player::recycle()
+{
+	client_id = -1;
+	table_id = -1;
+	uuid.clear();
+	stake = 0;
+	stake_before = 0;
+	holecards.clear();
 	next_action.valid = false;
+	next_action.action = Player::None;
+	next_action.amount = 0;
 	last_action = Player::None;
 	sitout = false;
 }
@@ -64,7 +64,11 @@ public:
 	
 	Player();
 	
+	//! \brief Reset to the state of a new player; keeps container capacity
+	void recycle();
+	
 	chips_type getStake() const { return stake; };
+	bool isSitout() const { return sitout; };
 	int getClientId() const { return client_id; };
 	
 	const std::string& getPlayerUUID() const { return uuid; };
@@ -74,6 +78,7 @@ public:
 	
 private:
 	int client_id;
+	int table_id;		// table the player is seated at or moving to
 	
 	// NOTE: redundant information here, because client may disconnect
 	std::string uuid;	/* copy of uuid needed */
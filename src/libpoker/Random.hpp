@@ -0,0 +1,98 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _RANDOM_H
+#define _RANDOM_H
+
+#include <vector>
+#include <algorithm>
+
+//! \brief Seed of a Random (128 bits)
+typedef struct {
+	unsigned int word[4];
+} RandomSeed;
+
+//! \brief Seeded PRNG (xoshiro128**, 128 bits of state); the same seed gives
+//!        the same sequence on every platform
+class Random
+{
+public:
+	Random(const RandomSeed &seed)
+	{
+		for (int i=0; i < 4; i++)
+			state[i] = seed.word[i] & 0xffffffffu;
+		
+		// the state must not be all zero
+		if (!(state[0] | state[1] | state[2] | state[3]))
+			state[0] = 0x9e3779b9u;
+	};
+	
+	unsigned int next()
+	{
+		const unsigned int result = (rotl((state[1] * 5) & 0xffffffffu, 7) * 9) & 0xffffffffu;
+		const unsigned int t = (state[1] << 9) & 0xffffffffu;
+		
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 11);
+		
+		return result;
+	};
+	
+	//! \brief Uniform value below n (n > 0); values that would favour the
+	//!        low results are drawn again instead of taken modulo n
+	unsigned int below(unsigned int n)
+	{
+		// 2^32 % n: count of the values above the last complete range of n
+		const unsigned int skip = (0xffffffffu - n + 1) % n;
+		unsigned int value;
+		
+		do
+			value = next();
+		while (value < skip);
+		
+		return value % n;
+	};
+	
+	//! \brief Fisher-Yates shuffle (independent of the STL implementation)
+	template <class T>
+	void shuffle(std::vector<T> &v)
+	{
+		for (unsigned int i = v.size(); i > 1; i--)
+			std::swap(v[i - 1], v[below(i)]);
+	};
+	
+private:
+	static unsigned int rotl(unsigned int x, int k)
+	{
+		return ((x << k) | (x >> (32 - k))) & 0xffffffffu;
+	};
+	
+	unsigned int state[4];
+};
+
+#endif /* _RANDOM_H */
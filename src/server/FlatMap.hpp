@@ -0,0 +1,91 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _FLATMAP_H
+#define _FLATMAP_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+
+//! \brief Map kept as a sorted vector of key/value pairs
+//!
+//! Lookups are binary searches over contiguous memory and iteration is in
+//! key order, like std::map. Inserting and erasing move the following
+//! elements and invalidate iterators; meant for small maps that are
+//! iterated far more often than they are modified.
+template <class K, class V>
+class FlatMap
+{
+public:
+	typedef std::pair<K,V> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+	typedef typename std::vector<value_type>::size_type size_type;
+	
+	iterator begin() { return elements.begin(); };
+	iterator end() { return elements.end(); };
+	const_iterator begin() const { return elements.begin(); };
+	const_iterator end() const { return elements.end(); };
+	
+	size_type size() const { return elements.size(); };
+	bool empty() const { return elements.empty(); };
+	
+	//! \brief Remove all elements; the capacity is kept
+	void clear() { elements.clear(); };
+	void reserve(size_type n) { elements.reserve(n); };
+	
+	iterator find(const K &key)
+	{
+		iterator it = std::lower_bound(elements.begin(), elements.end(), key, key_less);
+		return (it != elements.end() && !(key < it->first)) ? it : elements.end();
+	};
+	
+	const_iterator find(const K &key) const
+	{
+		const_iterator it = std::lower_bound(elements.begin(), elements.end(), key, key_less);
+		return (it != elements.end() && !(key < it->first)) ? it : elements.end();
+	};
+	
+	V& operator[](const K &key)
+	{
+		iterator it = std::lower_bound(elements.begin(), elements.end(), key, key_less);
+		if (it == elements.end() || key < it->first)
+			it = elements.insert(it, value_type(key, V()));
+		
+		return it->second;
+	};
+	
+	//! \brief Remove the element; returns the iterator following it
+	iterator erase(iterator it) { return elements.erase(it); };
+	
+private:
+	static bool key_less(const value_type &e, const K &key) { return e.first < key; };
+	
+	std::vector<value_type> elements;
+};
+
+
+#endif /* _FLATMAP_H */
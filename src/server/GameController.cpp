@@ -32,6 +32,10 @@
 #include "GameController.hpp"
 #include "GameLogic.hpp"
 #include "Card.hpp"
+#include "Random.hpp"
+#include "WireProtocol.hpp"
+#include "SysAccess.h"
+#include "Trace.h"
 
 #include "game.hpp"
 
@@ -42,9 +46,78 @@ using namespace std;
 static char msg[1024];
 
 
+// free games hold no players or tables; the game pool is destroyed first
+ObjectPool<Player> GameController::player_pool(1024);
+ObjectPool<Table> GameController::table_pool(128);
+ObjectPool<GameController> GameController::game_pool(64);
+
+handlog_writer* GameController::handlog = NULL;
+journal* GameController::event_journal = NULL;
+time_t (*GameController::clock_source)() = NULL;
+
+
 GameController::GameController()
 {
+	info_revision = 0;
+	recording.file = NULL;
+	recording.sink = NULL;
+	reset();
+	setDefaults();
+}
+
+GameController::GameController(const GameController& g)
+{
+	info_revision = 0;
+	recording.file = NULL;
+	recording.sink = NULL;
 	reset();
+	copySettings(g);
+}
+
+GameController::~GameController()
+{
+	stopRecording();
+	releaseObjects();
+}
+
+GameController* GameController::create()
+{
+	return game_pool.acquire();
+}
+
+GameController* GameController::create(const GameController &g)
+{
+	GameController *newgame = game_pool.acquire();
+	newgame->copySettings(g);
+	
+	return newgame;
+}
+
+void GameController::destroy(GameController *g)
+{
+	game_pool.release(g);
+}
+
+const ObjectPool<GameController>& GameController::getGamePool()
+{
+	return game_pool;
+}
+
+const ObjectPool<Table>& GameController::getTablePool()
+{
+	return table_pool;
+}
+
+const ObjectPool<Player>& GameController::getPlayerPool()
+{
+	return player_pool;
+}
+
+void GameController::setDefaults()
+{
+	spectator.rate = 0;
+	spectator.delay = 0;
+	spectator.max = 0;
 	
 	max_players = 10;
 	restart = false;
@@ -60,9 +133,11 @@ GameController::GameController()
 	owner = -1;
 }
 
-GameController::GameController(const GameController& g)
+void GameController::copySettings(const GameController &g)
 {
-	reset();
+	setSpectatorRate(g.getSpectatorRate());
+	setSpectatorDelay(g.getSpectatorDelay());
+	setSpectatorMax(g.getSpectatorMax());
 	
 	setName(g.getName());
 	setRestart(g.getRestart());
@@ -77,14 +152,35 @@ GameController::GameController(const GameController& g)
 	setPassword(g.getPassword());
 }
 
-GameController::~GameController()
+void GameController::releaseObjects()
 {
 	// remove all players
-	for (players_type::iterator e = players.begin(); e != players.end();)
+	for (players_type::iterator e = players.begin(); e != players.end(); e++)
+		player_pool.release(e->second);
+	players.clear();
+	
+	// remove all tables
+	for (tables_type::iterator e = tables.begin(); e != tables.end(); e++)
+		table_pool.release(e->second);
+	tables.clear();
+}
+
+// seeds must not be guessable from the cards seen by a player
+void GameController::drawSeed(RandomSeed *s)
+{
+	static bool warned = false;
+	
+	if (sys_random(s->word, sizeof(s->word)) == 0)
+		return;
+	
+	if (!warned)
 	{
-		delete e->second;
-		players.erase(e++);
+		log_error("game", "error: no random source of the system; the cards are predictable");
+		warned = true;
 	}
+	
+	for (unsigned int i=0; i < 4; i++)
+		s->word[i] = ((unsigned int) rand() << 16) ^ (unsigned int) rand() ^ (unsigned int) time(NULL);
 }
 
 void GameController::reset()
@@ -92,6 +188,7 @@ void GameController::reset()
 	game_id = -1;
 	
 	type = SNG;	// FIXME
+	limit = NoLimit;
 	blind.blindrule = BlindByTime;	// FIXME:
 	
 	started = false;
@@ -99,19 +196,30 @@ void GameController::reset()
 	finished = false;
 	
 	hand_no = 0;
+	drawSeed(&seed);
+	hand_seeds.clear();
 	
-	// remove all players
-	for (players_type::iterator e = players.begin(); e != players.end();)
-	{
-		delete e->second;
-		players.erase(e++);
-	}
+	stopRecording();
+	recording.ticks = 0;
+	recording.clock = 0;
+	
+	releaseObjects();
 	
 	// remove all spectators
 	spectators.clear();
+	spectator.queue.clear();
+	spectator.last_flush = 0;
 	
 	// clear finish list
 	finish_list.clear();
+	
+	++info_revision;
+}
+
+void GameController::recycle()
+{
+	reset();
+	setDefaults();
 }
 
 bool GameController::addPlayer(int cid, const std::string &uuid)
@@ -128,7 +236,7 @@ bool GameController::addPlayer(int cid, const std::string &uuid)
 	if (isSpectator(cid))
 		removeSpectator(cid);
 	
-	Player *p = new Player;
+	Player *p = player_pool.acquire();
 	p->client_id = cid;
 	p->stake = player_stakes;
 	
@@ -136,6 +244,7 @@ bool GameController::addPlayer(int cid, const std::string &uuid)
 	p->uuid = uuid;
 	
 	players[cid] = p;
+	++info_revision;
 	
 	return true;
 }
@@ -156,9 +265,10 @@ bool GameController::removePlayer(int cid)
 	if (owner == cid)
 		bIsOwner = true;
 	
-	delete it->second;
+	player_pool.release(it->second);
 	
 	players.erase(it);
+	++info_revision;
 	
 	
 	// find a new owner
@@ -178,12 +288,26 @@ bool GameController::isPlayer(int cid) const
 	return true;
 }
 
+const Player* GameController::getPlayer(int cid) const
+{
+	players_type::const_iterator it = players.find(cid);
+	
+	if (it == players.end())
+		return NULL;
+	
+	return it->second;
+}
+
 bool GameController::addSpectator(int cid)
 {
 	// is the client already a spectator (or a player)?
 	if (isSpectator(cid) || isPlayer(cid))
 		return false;
 	
+	// spectator limit reached?
+	if (spectator.max && spectators.size() >= spectator.max)
+		return false;
+	
 	spectators.insert(cid);
 	
 	return true;
@@ -198,6 +322,8 @@ bool GameController::removeSpectator(int cid)
 	
 	spectators.erase(it);
 	
+	forgetListener(cid);
+	
 	return true;
 }
 
@@ -227,6 +353,7 @@ bool GameController::setPlayerMax(unsigned int max)
 		return false;
 	
 	max_players = max;
+	++info_revision;
 	return true;
 }
 
@@ -236,6 +363,7 @@ bool GameController::setPlayerStakes(chips_type stake)
 		return false;
 	
 	player_stakes = stake;
+	++info_revision;
 	
 	return true;
 }
@@ -250,6 +378,18 @@ bool GameController::getPlayerList(vector<int> &client_list) const
 	return true;
 }
 
+bool GameController::getPlayerList(int tid, vector<int> &client_list) const
+{
+	client_list.clear();
+	
+	// players seated at (or moving to) the table; busted players keep watching their last table
+	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
+		if (e->second->table_id == tid)
+			client_list.push_back(e->first);
+	
+	return true;
+}
+
 bool GameController::getListenerList(vector<int> &client_list) const
 {
 	client_list.clear();
@@ -280,6 +420,9 @@ void GameController::selectNewOwner()
 
 void GameController::chat(int tid, const char* msg)
 {
+	if (recording.sink)
+		recordChat(tid, -1, msg);
+	
 	// players
 	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
 		client_chat(game_id, tid, e->first, msg);
@@ -291,22 +434,37 @@ void GameController::chat(int tid, const char* msg)
 
 void GameController::chat(int cid, int tid, const char* msg)
 {
+	if (recording.sink)
+		recordChat(tid, cid, msg);
+	
 	client_chat(game_id, tid, cid, msg);
 }
 
 void GameController::snap(int tid, int sid, const char* msg)
 {
-	// players
+	if (recording.sink)
+		recordSnap(tid, -1, sid, msg);
+	
+	// players; table snapshots only go to the players of that table
 	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
-		client_snapshot(game_id, tid, e->first, sid, msg);
+		if (tid == -1 || e->second->table_id == tid)
+			client_snapshot(game_id, tid, e->first, sid, msg);
 	
 	// spectators
-	for (spectators_type::const_iterator e = spectators.begin(); e != spectators.end(); e++)
-		client_snapshot(game_id, tid, *e, sid, msg);
+	if (spectator.rate)
+		queueSpectatorUpdate(tid, sid, msg);
+	else
+	{
+		for (spectators_type::const_iterator e = spectators.begin(); e != spectators.end(); e++)
+			client_snapshot(game_id, tid, *e, sid, msg);
+	}
 }
 
 void GameController::snap(int cid, int tid, int sid, const char* msg)
 {
+	if (recording.sink)
+		recordSnap(tid, cid, sid, msg);
+	
 	client_snapshot(game_id, tid, cid, sid, msg);
 }
 
@@ -317,6 +475,11 @@ bool GameController::setPlayerAction(int cid, Player::PlayerAction action, chips
 	if (!p)
 		return false;
 	
+	if (recording.sink)
+		recordAction(cid, action, amount);
+	if (event_journal)
+		journalAction(cid, action, amount);
+	
 	if (action == Player::ResetAction)   // reset a previously set action
 	{
 		p->next_action.valid = false;
@@ -325,11 +488,13 @@ bool GameController::setPlayerAction(int cid, Player::PlayerAction action, chips
 	else if (action == Player::Sitout)   // player wants to sit out
 	{
 		p->sitout = true;
+		updatePlayerSeat(p);
 		return true;
 	}
 	else if (action == Player::Back)     // player says "I'm back", end sitout
 	{
 		p->sitout = false;
+		updatePlayerSeat(p);
 		return true;
 	}
 	
@@ -340,6 +505,24 @@ bool GameController::setPlayerAction(int cid, Player::PlayerAction action, chips
 	return true;
 }
 
+void GameController::updatePlayerSeat(Player *p)
+{
+	tables_type::iterator e = tables.find(p->table_id);
+	if (e == tables.end())
+		return;
+	
+	Table *t = e->second;
+	
+	for (unsigned int i=0; i < 10; i++)
+	{
+		if (t->seats[i].occupied && t->seats[i].player == p)
+		{
+			t->updateSeat(i);
+			break;
+		}
+	}
+}
+
 bool GameController::createWinlist(Table *t, vector< vector<HandStrength> > &winlist)
 {
 	vector<HandStrength> wl;
@@ -363,23 +546,22 @@ bool GameController::createWinlist(Table *t, vector< vector<HandStrength> > &win
 
 void GameController::sendTableSnapshot(Table *t)
 {
-	// assemble community-cards string
-	string scards;
-	vector<Card> cards;
+	wire_table_snap ts;
+	memset(&ts, 0, sizeof(ts));
+	
+	ts.state = t->state;
+	ts.betround = (t->state == Table::Betting) ? t->betround : -1;
+	
 	
+	// community-cards
+	vector<Card> cards;
 	t->communitycards.copyCards(&cards);
 	
-	for (unsigned int i=0; i < cards.size(); i++)
-	{
-		scards += cards[i].getName();
-		
-		if (i < cards.size() -1)
-			scards += ':';
-	}
+	for (unsigned int i=0; i < cards.size() && i < 5; i++)
+		strcpy(ts.cc[ts.cc_count++], cards[i].getName());
 	
 	
-	// assemble seats string
-	string sseats;
+	// seats
 	for (unsigned int i=0; i < 10; i++)
 	{
 		Table::Seat *s = &(t->seats[i]);
@@ -388,20 +570,17 @@ void GameController::sendTableSnapshot(Table *t)
 			continue;
 		
 		Player *p = s->player;
+		wire_seat *ws = &(ts.seats[ts.seat_count++]);
 		
-		// assemble hole-cards string
-		string shole;
+		// hole-cards
 		if (t->nomoreaction || s->showcards)
 		{
-			vector<Card> cards;
-		
-			p->holecards.copyCards(&cards);
+			vector<Card> hole;
+			p->holecards.copyCards(&hole);
 			
-			for (unsigned int i=0; i < cards.size(); i++)
-				shole += cards[i].getName();
+			for (unsigned int c=0; c < hole.size() && c < 2; c++)
+				strcpy(ws->hole[ws->hole_count++], hole[c].getName());
 		}
-		else
-			shole = "-";
 		
 		int pstate = 0;
 		if (s->in_round)
@@ -409,84 +588,212 @@ void GameController::sendTableSnapshot(Table *t)
 		if (p->sitout)
 			pstate |= PlayerSitout;
 		
-		char tmp[1024];
-		snprintf(tmp, sizeof(tmp),
-			"s%d:%d:%d:%d:%d:%d:%s",
-			s->seat_no,
-			p->client_id,
-			pstate,
-			p->stake,
-			s->bet,
-			p->last_action,
-			shole.c_str());
-		
-		sseats += tmp;
-		
-		sseats += ' ';
+		ws->seat_no = s->seat_no;
+		ws->client_id = p->client_id;
+		ws->pstate = pstate;
+		ws->stake = p->stake;
+		ws->bet = s->bet;
+		ws->action = p->last_action;
 	}
 	
 	
-	// assemble pots string
-	string spots;
-	for (unsigned int i=0; i < t->pots.size(); i++)
-	{
-		Table::Pot *pot = &(t->pots[i]);
-		
-		char tmp[1024];
-		
-		snprintf(tmp, sizeof(tmp),
-			"p%d:%d",
-			i, pot->amount);
-		
-		spots += tmp;
-		
-		if (i < t->pots.size() -1)
-			spots += ' ';
-	}
+	// pots
+	for (unsigned int i=0; i < t->pots.size() && i < WIRE_MAX_POTS; i++)
+		ts.pots[ts.pot_count++] = t->pots[i].amount;
 	
 	
-	// assemble 'whose-turn' string
-	string sturn;
+	// whose turn
 	if (t->state == Table::GameStart ||
 		t->state == Table::ElectDealer)
 	{
-		sturn = "-1";
+		ts.has_turn = false;
+		ts.s_dealer = -1;
 	}
 	else
 	{
-		char tmp[128];
-		snprintf(tmp, sizeof(tmp), "%d:%d:%d:%d:%d",
-			t->seats[t->dealer].seat_no,
-			t->seats[t->sb].seat_no,
-			t->seats[t->bb].seat_no,
-			(t->cur_player == -1) ? -1 : (int)t->seats[t->cur_player].seat_no,
-			t->seats[t->last_bet_player].seat_no);
-		sturn = tmp;
+		ts.has_turn = true;
+		ts.s_dealer = t->seats[t->dealer].seat_no;
+		ts.s_sb = t->seats[t->sb].seat_no;
+		ts.s_bb = t->seats[t->bb].seat_no;
+		ts.s_cur = (t->cur_player == -1) ? -1 : (int)t->seats[t->cur_player].seat_no;
+		ts.s_lastbet = t->seats[t->last_bet_player].seat_no;
 	}
 	
 	
-	chips_type minimum_bet;
 	if (t->state == Table::Betting)
-		minimum_bet = determineMinimumBet(t);
+		ts.minimum_bet = determineMinimumBet(t);
 	else
-		minimum_bet = 0;
+		ts.minimum_bet = 0;
+	
+	
+	// listeners which got the previous snapshot only get the changes
+	const unsigned int seq = ++t->snap_seq;
+	
+	if (recording.sink)
+		recordTable(t->table_id, seq, &ts);
+	
+	vector<int> client_list;
+	getPlayerList(t->table_id, client_list);
+	
+	if (spectator.rate)
+		queueSpectatorUpdate(t->table_id, SnapTable, "", seq, &ts);
+	else
+		client_list.insert(client_list.end(), spectators.begin(), spectators.end());
+	
+	for (unsigned int i=0; i < client_list.size(); i++)
+	{
+		const int cid = client_list[i];
+		map<int,unsigned int>::iterator e = t->snap_sent.find(cid);
+		
+		const bool insync = (e != t->snap_sent.end() && e->second == seq - 1);
+		
+		if (client_snapshot_table(game_id, t->table_id, cid, seq, &ts, insync ? &t->snap_last : NULL, seq - 1))
+			t->snap_sent[cid] = seq;
+		else if (e != t->snap_sent.end())
+			t->snap_sent.erase(e);
+	}
+	
+	t->snap_last = ts;
+}
+
+bool GameController::resendTableSnapshot(int cid, int tid)
+{
+	if (!isPlayer(cid) && !isSpectator(cid))
+		return false;
+	
+	tables_type::iterator e = tables.find(tid);
+	if (e == tables.end())
+		return false;
+	
+	Table *t = e->second;
 	
+	// spectators only get what has been flushed to them
+	const bool held_back = (spectator.rate && isSpectator(cid));
+	const unsigned int seq = held_back ? t->spec_seq : t->snap_seq;
 	
-	snprintf(msg, sizeof(msg),
-		"%d:%d "           // <state>:<betting-round>
-		"%s "              // <dealer>:<SB>:<BB>:<current>:<last-bet>
-		"cc:%s "           // <community-cards>
-		"%s "              // seats
-		"%s "              // pots
-		"%d",              // minimum bet
-		t->state, (t->state == Table::Betting) ? t->betround : -1,
-		sturn.c_str(),
-		scards.c_str(),
-		sseats.c_str(),
-		spots.c_str(),
-		minimum_bet);
+	// nothing sent yet; the next snapshot will be a full one
+	if (!seq)
+		return true;
+	
+	if (!client_snapshot_table(game_id, tid, cid, seq, held_back ? &t->spec_last : &t->snap_last, NULL, 0))
+		return false;
+	
+	t->snap_sent[cid] = seq;
+	
+	return true;
+}
+
+void GameController::forgetListener(int cid)
+{
+	for (tables_type::iterator e = tables.begin(); e != tables.end(); e++)
+		e->second->snap_sent.erase(cid);
+}
+
+void GameController::queueSpectatorUpdate(int tid, int sid, const char *msg,
+	unsigned int seq, const wire_table_snap *ts)
+{
+	// nobody watching; later spectators start with a full snapshot anyway
+	if (spectators.empty())
+		return;
+	
+	spectator_update u;
+	u.time = sys_time_ms();
+	u.tid = tid;
+	u.sid = sid;
+	u.message = msg;
+	u.seq = seq;
+	if (ts)
+		u.ts = *ts;
+	
+	spectator.queue.push_back(u);
+}
+
+void GameController::flushSpectators()
+{
+	if (spectator.queue.empty())
+		return;
+	
+	const unsigned long now = sys_time_ms();
+	
+	// at most <rate> deliveries per second
+	if (spectator.last_flush && now - spectator.last_flush < 1000 / spectator.rate)
+		return;
+	
+	// only updates older than the delay are due
+	const unsigned long delay = spectator.delay * 1000;
+	unsigned int count = 0;
+	while (count < spectator.queue.size() && now - spectator.queue[count].time >= delay)
+		count++;
+	
+	if (!count)
+		return;
+	
+	spectator.last_flush = now;
+	
+	// the latest due table snapshot supersedes earlier ones and the player
+	// actions leading to it, so each flush ends at a consistent table state
+	map<int,unsigned int> latest;
+	for (unsigned int i=0; i < count; i++)
+		if (spectator.queue[i].sid == SnapTable)
+			latest[spectator.queue[i].tid] = i;
+	
+	for (unsigned int i=0; i < count; i++)
+	{
+		const spectator_update &u = spectator.queue[i];
+		map<int,unsigned int>::const_iterator l = latest.find(u.tid);
+		
+		if (u.sid == SnapTable)
+		{
+			if (l->second != i)
+				continue;
+			
+			// the table may be gone in the meantime
+			tables_type::iterator e = tables.find(u.tid);
+			Table *t = (e == tables.end()) ? NULL : e->second;
+			
+			for (spectators_type::const_iterator s = spectators.begin(); s != spectators.end(); s++)
+			{
+				const int cid = *s;
+				bool insync = false;
+				
+				if (t && t->spec_seq)
+				{
+					map<int,unsigned int>::const_iterator se = t->snap_sent.find(cid);
+					insync = (se != t->snap_sent.end() && se->second == t->spec_seq);
+				}
+				
+				const bool sent = client_snapshot_table(game_id, u.tid, cid, u.seq, &u.ts,
+						insync ? &t->spec_last : NULL, insync ? t->spec_seq : 0);
+				
+				if (!t)
+					continue;
+				
+				if (sent)
+					t->snap_sent[cid] = u.seq;
+				else
+					t->snap_sent.erase(cid);
+			}
+			
+			if (t)
+			{
+				t->spec_seq = u.seq;
+				t->spec_last = u.ts;
+			}
+		}
+		else
+		{
+			if ((u.sid == SnapPlayerAction || u.sid == SnapPlayerCurrent) &&
+				l != latest.end() && l->second > i)
+			{
+				continue;
+			}
+			
+			for (spectators_type::const_iterator s = spectators.begin(); s != spectators.end(); s++)
+				client_snapshot(game_id, u.tid, *s, u.sid, u.message.c_str());
+		}
+	}
 	
-	snap(t->table_id, SnapTable, msg);
+	spectator.queue.erase(spectator.queue.begin(), spectator.queue.begin() + count);
 }
 
 void GameController::sendPlayerShowSnapshot(Table *t, Player *p)
@@ -506,6 +813,46 @@ void GameController::sendPlayerShowSnapshot(Table *t, Player *p)
 	snap(t->table_id, SnapPlayerShow, msg);
 }
 
+void GameController::logHand(const Table *t, int type, int seat, chips_type amount,
+	unsigned int action, unsigned int flags, const Card *cards, unsigned int ncards)
+{
+	if (!handlog)
+		return;
+	
+	handlog_record rec;
+	memset(&rec, 0, sizeof(rec));
+	
+	rec.type = type;
+	rec.seat = (seat < 0) ? HANDLOG_NO_SEAT : seat;
+	rec.round = t->betround;
+	rec.action = action;
+	rec.game = game_id;
+	rec.hand = t->hand_no;
+	rec.table = t->table_id;
+	rec.flags = flags;
+	rec.client = (seat >= 0 && t->seats[seat].occupied) ? t->seats[seat].player->client_id : -1;
+	rec.amount = amount;
+	rec.time = (unsigned int) now();
+	
+	for (unsigned int i=0; i < ncards && i < sizeof(rec.cards); i++, rec.ncards++)
+		rec.cards[i] = HANDLOG_CARD(cards[i].getFace(), cards[i].getSuit());
+	
+	// buffered; the writer is flushed periodically by the game loop
+	handlog_append(handlog, &rec);
+}
+
+void GameController::logShow(const Table *t, unsigned int s)
+{
+	if (!handlog)
+		return;
+	
+	vector<Card> cards;
+	t->seats[s].player->holecards.copyCards(&cards);
+	
+	if (!cards.empty())
+		logHand(t, HandlogShow, s, 0, Player::Show, 0, &cards[0], cards.size());
+}
+
 chips_type GameController::determineMinimumBet(Table *t) const
 {
 	if (t->bet_amount == 0)
@@ -530,6 +877,9 @@ void GameController::dealHole(Table *t)
 		t->deck.pop(c2);
 		p->holecards.setCards(c1, c2);
 		
+		const Card hole[2] = { c1, c2 };
+		logHand(t, HandlogHole, i, 0, 0, 0, hole, 2);
+		
 		char card1[3], card2[3];
 		strcpy(card1, c1.getName());
 		strcpy(card2, c2.getName());
@@ -551,6 +901,9 @@ void GameController::dealFlop(Table *t)
 	t->deck.pop(f3);
 	t->communitycards.setFlop(f1, f2, f3);
 	
+	const Card flop[3] = { f1, f2, f3 };
+	logHand(t, HandlogBoard, -1, 0, 0, 0, flop, 3);
+	
 	char card1[3], card2[3], card3[3];
 	strcpy(card1, f1.getName());
 	strcpy(card2, f2.getName());
@@ -565,6 +918,7 @@ void GameController::dealTurn(Table *t)
 	Card tc;
 	t->deck.pop(tc);
 	t->communitycards.setTurn(tc);
+	logHand(t, HandlogBoard, -1, 0, 0, 0, &tc, 1);
 	
 	char card[3];
 	strcpy(card, tc.getName());
@@ -578,6 +932,7 @@ void GameController::dealRiver(Table *t)
 	Card r;
 	t->deck.pop(r);
 	t->communitycards.setRiver(r);
+	logHand(t, HandlogBoard, -1, 0, 0, 0, &r, 1);
 	
 	char card[3];
 	strcpy(card, r.getName());
@@ -586,36 +941,213 @@ void GameController::dealRiver(Table *t)
 	snap(t->table_id, SnapCards, msg);
 }
 
+bool GameController::balanceTables(Table *t)
+{
+	// players at the table after this hand boundary
+	unsigned int load = t->countPlayers() + t->arriving.size();
+	
+	unsigned int total = 0, open_tables = 0;
+	for (tables_type::const_iterator e = tables.begin(); e != tables.end(); e++)
+	{
+		Table *ot = e->second;
+		if (ot->state == Table::Closed)
+			continue;
+		
+		total += ot->countPlayers() + ot->arriving.size();
+		open_tables++;
+	}
+	
+	if (open_tables < 2)
+		return false;
+	
+	
+	// the smallest table gets broken up as soon as the others can seat everybody
+	bool smallest = true;
+	for (tables_type::const_iterator e = tables.begin(); e != tables.end(); e++)
+	{
+		Table *ot = e->second;
+		if (ot != t && ot->state != Table::Closed && ot->countPlayers() + ot->arriving.size() < load)
+			smallest = false;
+	}
+	
+	const bool breakup = (smallest && total <= (open_tables - 1) * 10);
+	
+	
+	// move players to the table with the fewest players; on breakup all of
+	// them, otherwise until the tables differ by at most one player
+	for (;;)
+	{
+		Table *to = NULL;
+		unsigned int to_load = 0;
+		
+		for (tables_type::const_iterator e = tables.begin(); e != tables.end(); e++)
+		{
+			Table *ot = e->second;
+			if (ot == t || ot->state == Table::Closed)
+				continue;
+			
+			const unsigned int ot_load = ot->countPlayers() + ot->arriving.size();
+			if (!to || ot_load < to_load)
+			{
+				to = ot;
+				to_load = ot_load;
+			}
+		}
+		
+		if (!to || to_load >= 10)
+			break;
+		
+		if (!breakup && load < to_load + 2)
+			break;
+		
+		if (t->arriving.size())
+		{
+			// players still moving in simply move on
+			Player *p = t->arriving.back();
+			t->arriving.pop_back();
+			
+			p->table_id = to->table_id;
+			to->arriving.push_back(p);
+		}
+		else
+		{
+			int seat = -1;
+			
+			if (breakup)
+			{
+				for (unsigned int i=0; i < 10 && seat == -1; i++)
+					if (t->seats[i].occupied)
+						seat = i;
+			}
+			else
+			{
+				// move the player who would be big blind next; never the dealer
+				seat = t->getNextPlayer(t->dealer);
+				if (seat != -1)
+					seat = t->getNextPlayer(seat);
+				if (seat == t->dealer)
+					seat = -1;
+			}
+			
+			if (seat == -1)
+				break;
+			
+			movePlayer(t, seat, to);
+		}
+		
+		if (!--load)
+			break;
+	}
+	
+	if (!breakup)
+		return false;
+	
+	
+	log_info("game", "game %d: table %d has been broken up", game_id, t->table_id);
+	
+	t->state = Table::Closed;
+	
+	return true;
+}
+
+void GameController::movePlayer(Table *from, unsigned int seat, Table *to)
+{
+	Player *p = from->seats[seat].player;
+	
+	from->unseatPlayer(seat);
+	
+	// the moving player gets this as the last snapshot of the old table
+	snprintf(msg, sizeof(msg), "%d %d %d",
+		SnapGameStateSeat,
+		p->client_id,
+		to->table_id);
+	snap(from->table_id, SnapGameState, msg);
+	
+	from->snap_sent.erase(p->client_id);
+	
+	p->table_id = to->table_id;
+	to->arriving.push_back(p);
+	
+	trace("balance", "game %d: moving player %d from table %d to %d",
+		game_id, p->client_id, from->table_id, to->table_id);
+}
+
 void GameController::stateNewRound(Table *t)
 {
+	// hand boundary: balance the tables of multi-table games
+	if (tables.size() > 1 && balanceTables(t))
+		return;
+	
+	// seat the players moved here from other tables
+	for (vector<Player*>::const_iterator e = t->arriving.begin(); e != t->arriving.end(); e++)
+	{
+		for (unsigned int i=0; i < 10; i++)
+		{
+			if (t->seats[i].occupied)
+				continue;
+			
+			t->seatPlayer(i, *e);
+			break;
+		}
+	}
+	
+	t->arriving.clear();
+	
+	// wait for players from the other tables
+	if (t->countPlayers() < 2)
+	{
+		t->scheduleState(Table::NewRound, 2);
+		return;
+	}
+	
 	// count up current hand number
 	hand_no++;
+	t->hand_no = hand_no;
 	
 	snprintf(msg, sizeof(msg), "%d %d", SnapGameStateNewHand, hand_no);
 	snap(t->table_id, SnapGameState, msg);
 	
-#ifdef DEBUG
-	log_msg("Table", "Hand #%d (gid=%d tid=%d)", hand_no, game_id, t->table_id);
-#endif
+	// a fresh seed for every hand; it is an input of the game, so the
+	// record and the journal get it before anything depends on it
+	RandomSeed hand_seed;
+	if (hand_seeds.size())
+	{
+		hand_seed = hand_seeds.front();
+		hand_seeds.pop_front();
+	}
+	else
+		drawSeed(&hand_seed);
+	
+	if (recording.sink)
+		recordSeed(t->table_id, hand_seed);
+	
+	if (event_journal)
+	{
+		journalSeed(t, hand_seed);
+		journalHand(t);
+	}
+	
+	trace("hand", "game %d table %d: hand #%u dealer %d",
+		game_id, t->table_id, hand_no, t->dealer);
 	
 
 #ifndef SERVER_TESTING
-	// fill and shuffle card-deck
+	// fill and shuffle card-deck; the order only depends on the seed of the hand
 	t->deck.fill();
-	t->deck.shuffle();
+	t->deck.shuffle(hand_seed);
 #else
 	// set defined cards for testing
 	if (debug_cards.size())
 	{
-		dbg_msg("deck", "using defined cards");
+		trace("deck", "using defined cards");
 		t->deck.empty();
 		t->deck.debugPushCards(&debug_cards);
 	}
 	else
 	{
-		dbg_msg("deck", "using random cards");
+		trace("deck", "using random cards");
 		t->deck.fill();
-		t->deck.shuffle();
+		t->deck.shuffle(hand_seed);
 	}
 #endif
 	
@@ -631,6 +1163,7 @@ void GameController::stateNewRound(Table *t)
 	t->pots.clear();
 	Table::Pot pot;
 	pot.amount = 0;
+	pot.involved = 0;
 	pot.final = false;
 	t->pots.push_back(pot);
 	
@@ -641,7 +1174,7 @@ void GameController::stateNewRound(Table *t)
 		if (!t->seats[i].occupied)
 			continue;
 		
-		t->seats[i].in_round = true;
+		t->setInRound(i, true);
 		t->seats[i].showcards = false;
 		t->seats[i].bet = 0;
 		
@@ -652,6 +1185,8 @@ void GameController::stateNewRound(Table *t)
 		p->resetLastAction();
 		
 		p->stake_before = p->stake;	// remember stake before this hand
+		
+		t->updateSeat(i);
 	}
 	
 	
@@ -674,6 +1209,16 @@ void GameController::stateNewRound(Table *t)
 	t->last_bet_player = t->cur_player;
 	
 	
+	t->betround = Table::Preflop;
+	logHand(t, HandlogHandStart, t->dealer, blind.amount);
+	
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		if (t->seats[i].occupied)
+			logHand(t, HandlogSeat, i, t->seats[i].player->stake);
+	}
+	
+	
 	sendTableSnapshot(t);
 	
 	t->state = Table::Blinds;
@@ -685,9 +1230,9 @@ void GameController::stateBlinds(Table *t)
 	switch ((int) blind.blindrule)
 	{
 	case BlindByTime:
-		if (difftime(time(NULL), blind.last_blinds_time) > blind.blinds_time)
+		if (difftime(now(), blind.last_blinds_time) > blind.blinds_time)
 		{
-			blind.last_blinds_time = time(NULL);
+			blind.last_blinds_time = now();
 			blind.amount = (blind.blinds_factor * blind.amount) / 10;
 			
 			// send out blinds snapshot
@@ -715,6 +1260,8 @@ void GameController::stateBlinds(Table *t)
 	
 	t->seats[t->sb].bet = amount;
 	pSmall->stake -= amount;
+	t->updateSeat(t->sb);
+	logHand(t, HandlogBlind, t->sb, amount, 0);
 	
 	
 	// set the player's BB
@@ -725,10 +1272,12 @@ void GameController::stateBlinds(Table *t)
 	
 	t->seats[t->bb].bet = amount;
 	pBig->stake -= amount;
+	t->updateSeat(t->bb);
+	logHand(t, HandlogBlind, t->bb, amount, 1);
 	
 	
 	// initialize the player's timeout
-	t->timeout_start = time(NULL);
+	t->timeout_start = now();
 	
 	
 	// give out hole-cards
@@ -747,7 +1296,7 @@ void GameController::stateBlinds(Table *t)
 			(pBig->stake == 0 && t->seats[t->sb].bet >= t->seats[t->bb].bet) ||  // BB is allin, and SB has bet more or equal BB
 			(pSmall->stake == 0))  // SB is allin
 		{
-			dbg_msg("no-more-action", "sb-allin:%s  bb-allin:%s",
+			trace("no-more-action", "sb-allin:%s  bb-allin:%s",
 				pSmall->stake ? "no" : "yes",
 				pBig->stake ? "no" : "yes");
 			t->nomoreaction = true;
@@ -865,10 +1414,11 @@ void GameController::stateBetting(Table *t)
 	{
 		// handle player timeout
 #ifndef SERVER_TESTING
-		if (p->sitout || (unsigned int)difftime(time(NULL), t->timeout_start) > timeout)
+		if (p->sitout || (unsigned int)difftime(now(), t->timeout_start) > timeout)
 		{
 			// let player sit out (if not already sitting out)
 			p->sitout = true;
+			t->updateSeat(t->cur_player);
 			
 			// auto-action: fold, or check if possible
 			if (t->seats[t->cur_player].bet < t->bet_amount)
@@ -899,7 +1449,7 @@ void GameController::stateBetting(Table *t)
 	}
 	else if (action == Player::Fold)
 	{
-		t->seats[t->cur_player].in_round = false;
+		t->setInRound(t->cur_player, false);
 		
 		snprintf(msg, sizeof(msg), "%d %d %d", SnapPlayerActionFolded, p->client_id, auto_action ? 1 : 0);
 		snap(t->table_id, SnapPlayerAction, msg);
@@ -918,6 +1468,7 @@ void GameController::stateBetting(Table *t)
 		// move chips from player's stake to seat-bet
 		t->seats[t->cur_player].bet += amount;
 		p->stake -= amount;
+		t->updateSeat(t->cur_player);
 		
 		if (action == Player::Bet || action == Player::Raise || action == Player::Allin)
 		{
@@ -944,6 +1495,15 @@ void GameController::stateBetting(Table *t)
 		snap(t->table_id, SnapPlayerAction, msg);
 	}
 	
+	if (action != Player::None)
+	{
+		logHand(t, HandlogAction, t->cur_player, amount, action, auto_action ? HandlogFlagAuto : 0);
+		
+		trace("action", "game %d table %d: player %d seat %d action %d amount %u%s stake %u",
+			game_id, t->table_id, p->client_id, t->cur_player, (int) action, amount,
+			auto_action ? " (auto)" : "", p->stake);
+	}
+	
 	// all players except one folded, so end this hand
 	if (t->countActivePlayers() == 1)
 	{
@@ -956,7 +1516,7 @@ void GameController::stateBetting(Table *t)
 		t->cur_player = t->getNextActivePlayer(t->cur_player);
 		
 		// initialize the player's timeout
-		t->timeout_start = time(NULL);
+		t->timeout_start = now();
 		
 		sendTableSnapshot(t);
 		t->resetLastPlayerActions();
@@ -1005,7 +1565,7 @@ void GameController::stateBetting(Table *t)
 			t->cur_player = t->getNextActivePlayer(t->last_bet_player);
 			
 			// initialize the player's timeout
-			t->timeout_start = time(NULL);
+			t->timeout_start = now();
 			
 			
 			// end of hand, do showdown/ ask for show
@@ -1033,7 +1593,7 @@ void GameController::stateBetting(Table *t)
 		t->cur_player = t->getNextActivePlayer(t->dealer);
 		
 		// re-initialize the player's timeout
-		t->timeout_start = time(NULL);
+		t->timeout_start = now();
 		
 		
 		// first action for next betting round is at this player
@@ -1052,7 +1612,7 @@ void GameController::stateBetting(Table *t)
 		
 		// find next player
 		t->cur_player = t->getNextActivePlayer(t->cur_player);
-		t->timeout_start = time(NULL);
+		t->timeout_start = now();
 		
 		// reset current player's last action
 		p = t->seats[t->cur_player].player;
@@ -1111,7 +1671,7 @@ void GameController::stateAskShow(Table *t)
 #ifndef SERVER_TESTING
 		// handle player timeout
 		const int timeout = 4;   // FIXME: configurable
-		if ((int)difftime(time(NULL), t->timeout_start) > timeout || p->sitout)
+		if ((int)difftime(now(), t->timeout_start) > timeout || p->sitout)
 		{
 			// default on showdown is "to show"
 			// Note: client needs to determine if it's hand is
@@ -1150,7 +1710,7 @@ void GameController::stateAskShow(Table *t)
 	{
 		// player is out if he don't want to show his cards
 		if (t->seats[t->cur_player].showcards == false)
-			t->seats[t->cur_player].in_round = false;
+			t->setInRound(t->cur_player, false);
 		
 		
 		if (t->getNextActivePlayer(t->cur_player) == t->last_bet_player)
@@ -1163,7 +1723,7 @@ void GameController::stateAskShow(Table *t)
 			// find next player
 			t->cur_player = t->getNextActivePlayer(t->cur_player);
 			
-			t->timeout_start = time(NULL);
+			t->timeout_start = now();
 			
 			// send update snapshot
 			sendTableSnapshot(t);
@@ -1178,15 +1738,22 @@ void GameController::stateAllFolded(Table *t)
 	
 	// send PlayerShow snapshot if cards were shown
 	if (t->seats[t->cur_player].showcards)
+	{
 		sendPlayerShowSnapshot(t, p);
+		logShow(t, t->cur_player);
+	}
 	
 	
 	p->stake += t->pots[0].amount;
 	t->seats[t->cur_player].bet = t->pots[0].amount;
+	t->updateSeat(t->cur_player);
 	
 	// send pot-win snapshot
 	snprintf(msg, sizeof(msg), "%d %d %d", p->client_id, 0, t->pots[0].amount);
 	snap(t->table_id, SnapWinPot, msg);
+	logHand(t, HandlogPayout, t->cur_player, t->pots[0].amount, 0);
+	if (event_journal)
+		journalPot(t, t->cur_player, t->pots[0].amount);
 	
 	
 	sendTableSnapshot(t);
@@ -1206,6 +1773,7 @@ void GameController::stateShowdown(Table *t)
 			Player *p = t->seats[showdown_player].player;
 			
 			sendPlayerShowSnapshot(t, p);
+			logShow(t, showdown_player);
 		}
 		
 		showdown_player = t->getNextActivePlayer(showdown_player);
@@ -1222,11 +1790,16 @@ void GameController::stateShowdown(Table *t)
 		vector<HandStrength> &tw = winlist[i];
 		const unsigned int winner_count = tw.size();
 		
+		unsigned int winners = 0;
+		for (unsigned int pi=0; pi < winner_count; pi++)
+			winners |= 1u << tw[pi].getId();
+		
 		// for each pot
 		for (unsigned int poti=0; poti < t->pots.size(); poti++)
 		{
 			Table::Pot *pot = &(t->pots[poti]);
-			const unsigned int involved_count = t->getInvolvedInPotCount(pot, tw);
+			const unsigned int involved_winners = pot->involved & winners;
+			const unsigned int involved_count = Table::countSeats(involved_winners);
 			
 			
 			chips_type win_amount = 0;
@@ -1252,17 +1825,16 @@ void GameController::stateShowdown(Table *t)
 				Player *p = seat->player;
 				
 				// skip pot if player not involved in it
-				if (!t->isSeatInvolvedInPot(pot, seat_num))
+				if (!(involved_winners & (1u << seat_num)))
 					continue;
-#if 0
-				dbg_msg("winlist", "wl #%d involved-count=%d player #%d (seat:%d) pot #%d ($%d) ",
-					i+1, involved_count, pi, seat_num, poti, pot->amount);
-#endif
+				trace("winlist", "game %d table %d: wl #%u involved-count=%u player %d (seat:%u) pot #%u ($%u) win %u",
+					game_id, t->table_id, i+1, involved_count, p->client_id, seat_num, poti, pot->amount, win_amount);
 				
 				if (win_amount > 0)
 				{
 					// transfer winning amount to player
 					p->stake += win_amount;
+					t->updateSeat(seat_num);
 					
 					// put winnings to seat (needed for snapshot)
 					seat->bet += win_amount;
@@ -1272,6 +1844,9 @@ void GameController::stateShowdown(Table *t)
 					
 					snprintf(msg, sizeof(msg), "%d %d %d", p->client_id, poti, win_amount);
 					snap(t->table_id, SnapWinPot, msg);
+					logHand(t, HandlogPayout, seat_num, win_amount, poti);
+					if (event_journal)
+						journalPot(t, seat_num, win_amount);
 				}
 			}
 			
@@ -1279,10 +1854,7 @@ void GameController::stateShowdown(Table *t)
 			if (odd_chips)
 			{
 				// find the next player behind button which is involved in pot
-				unsigned int oddchips_player = t->getNextActivePlayer(t->dealer);
-				
-				while (!t->isSeatInvolvedInPot(pot, oddchips_player))
-					oddchips_player = t->getNextActivePlayer(oddchips_player);
+				const unsigned int oddchips_player = t->getNextInvolvedPlayer(pot, t->dealer);
 				
 				
 				Table::Seat *seat = &(t->seats[oddchips_player]);
@@ -1290,9 +1862,13 @@ void GameController::stateShowdown(Table *t)
 				
 				p->stake += odd_chips;
 				seat->bet += odd_chips;
+				t->updateSeat(oddchips_player);
 				
 				snprintf(msg, sizeof(msg), "%d %d %d", p->client_id, poti, odd_chips);
 				snap(t->table_id, SnapOddChips, msg);
+				logHand(t, HandlogPayout, oddchips_player, odd_chips, poti, HandlogFlagOddChips);
+				if (event_journal)
+					journalPot(t, oddchips_player, odd_chips);
 				
 				cashout_amount += odd_chips;
 			}
@@ -1311,7 +1887,7 @@ void GameController::stateShowdown(Table *t)
 		
 		if (pot->amount > 0)
 		{
-			log_msg("winlist", "error: remaining chips in pot %d: %d",
+			log_error("winlist", "error: remaining chips in pot %d: %d",
 				i, pot->amount);
 		}
 	}
@@ -1375,17 +1951,26 @@ void GameController::stateEndRound(Table *t)
 		
 		snap(t->table_id, SnapGameState, msg);
 		
+		logHand(t, HandlogBust, seat_num, getPlayerCount() - (int)finish_list.size() + 1);
+		if (event_journal)
+			journalBust(p, getPlayerCount() - finish_list.size() + 1);
+		
 		
 		// mark seat as unused
-		t->seats[seat_num].occupied = false;
+		t->unseatPlayer(seat_num);
 	}
 	
+	logHand(t, HandlogHandEnd, -1, getPlayerCount() - finish_list.size());
+	flushRecording();
+	
 	
 	sendTableSnapshot(t);
 	
 	
-	// determine next dealer
-	t->dealer = t->getNextPlayer(t->dealer);
+	// determine next dealer (a single player waiting for others keeps the button)
+	const int next_dealer = t->getNextPlayer(t->dealer);
+	if (next_dealer != -1)
+		t->dealer = next_dealer;
 	
 	t->scheduleState(Table::NewRound, 2);
 }
@@ -1393,7 +1978,7 @@ void GameController::stateEndRound(Table *t)
 void GameController::stateDelay(Table *t)
 {
 #ifndef SERVER_TESTING
-	if ((unsigned int) difftime(time(NULL), t->delay_start) >= t->delay)
+	if ((unsigned int) difftime(now(), t->delay_start) >= t->delay)
 		t->delay = 0;
 #else
 	t->delay = 0;
@@ -1426,8 +2011,12 @@ int GameController::handleTable(Table *t)
 		stateEndRound(t);
 	
 	
-	// only 1 player left? close table
-	if (t->countPlayers() == 1)
+	// table broken up?
+	if (t->state == Table::Closed)
+		return -1;
+	
+	// only 1 player left in the game? close table
+	if (tables.size() == 1 && t->countPlayers() + t->arriving.size() == 1)
 		return -1;
 	
 	return 0;
@@ -1440,39 +2029,28 @@ void GameController::start()
 		return;
 	
 	
-	log_msg("game", "game %d has been started", game_id);
+	log_info("game", "game %d has been started", game_id);
 	
 	started = true;
+	++info_revision;
 	
-	// TODO: support more than 1 table
-	const int tid = 0;
-	Table *t = new Table();
-	t->setTableId(tid);
-	
-	memset(t->seats, 0, sizeof(Table::Seat) * 10);
+	if (recording.sink)
+		recordStart();
+	if (event_journal)
+		journalStart();
 	
 	
-	// place players at table
+	// place players at tables
 	vector<Player*> rndseats;
 	
 	for (players_type::const_iterator e = players.begin(); e != players.end(); ++e)
 		rndseats.push_back(e->second);
 	
 #ifndef SERVER_TESTING
-	random_shuffle(rndseats.begin(), rndseats.end());
+	Random rnd(seed);
+	rnd.shuffle(rndseats);
 #endif
 	
-	for (unsigned int i=0; i < 10; i++)
-	{
-		Table::Seat *seat = &(t->seats[i]);
-		
-		seat->seat_no = i;
-		seat->occupied = false;
-	}
-	
-	
-	bool chose_dealer = false;
-	
 	const int placement[10][10] = {
 		{ 4 },					//  1 player
 		{ 4, 9 },				//  2 players
@@ -1486,49 +2064,80 @@ void GameController::start()
 		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }	// 10 players
 	};
 	
-	const unsigned int place_row = players.size() - 1;
-	unsigned int place_idx = 0;
+	// as few tables as possible, players spread evenly
+	const unsigned int table_count = (rndseats.size() + 9) / 10;
 	vector<Player*>::const_iterator it = rndseats.begin();
 	
-	do
+	for (unsigned int tid=0; tid < table_count; tid++)
 	{
-		const unsigned int place = placement[place_row][place_idx];
-		Table::Seat *seat = &(t->seats[place]);
-		const Player *p = *it;
-		
-		dbg_msg("placing", "place_row=%d place_idx=%d place=%d player=%d",
-			place_row, place_idx, place, p->client_id);
+		Table *t = table_pool.acquire();
+		t->setTableId(tid);
 		
-		seat->occupied = true;
-		seat->player = (Player*)p;
+		memset(t->seats, 0, sizeof(Table::Seat) * 10);
 		
-		// FIXME: implement choosing dealer correctly
-		if (!chose_dealer)
+		for (unsigned int i=0; i < 10; i++)
 		{
-			t->dealer = place;
-			chose_dealer = true;
+			Table::Seat *seat = &(t->seats[i]);
+			
+			seat->seat_no = i;
+			seat->occupied = false;
 		}
 		
-		it++;
-	} while (++place_idx <= place_row);
-	
-	
-	t->state = Table::GameStart;
-	tables[tid] = t;
+		
+		bool chose_dealer = false;
+		
+		const unsigned int table_players = rndseats.size() / table_count +
+			((tid < rndseats.size() % table_count) ? 1 : 0);
+		const unsigned int place_row = table_players - 1;
+		unsigned int place_idx = 0;
+		
+		do
+		{
+			const unsigned int place = placement[place_row][place_idx];
+			Player *p = *it;
+			
+			trace("placing", "tid=%d place_row=%d place_idx=%d place=%d player=%d",
+				tid, place_row, place_idx, place, p->client_id);
+			
+			t->seatPlayer(place, p);
+			p->table_id = tid;
+			
+			// FIXME: implement choosing dealer correctly
+			if (!chose_dealer)
+			{
+				t->dealer = place;
+				chose_dealer = true;
+			}
+			
+			it++;
+		} while (++place_idx <= place_row);
+		
+		
+		t->state = Table::GameStart;
+		tables[tid] = t;
+	}
 	
 	blind.amount = blind.start;
-	blind.last_blinds_time = time(NULL);
+	blind.last_blinds_time = now();
 	
-	snprintf(msg, sizeof(msg), "%d", SnapGameStateStart);
-	snap(tid, SnapGameState, msg);
-	
-	sendTableSnapshot(t);
-	
-	t->scheduleState(Table::NewRound, 5);
+	for (tables_type::iterator e = tables.begin(); e != tables.end(); e++)
+	{
+		Table *t = e->second;
+		
+		snprintf(msg, sizeof(msg), "%d", SnapGameStateStart);
+		snap(t->table_id, SnapGameState, msg);
+		
+		sendTableSnapshot(t);
+		
+		t->scheduleState(Table::NewRound, 5);
+	}
 }
 
 int GameController::tick()
 {
+	if (spectator.rate)
+		flushSpectators();
+	
 	if (!started)
 	{
 		if (getPlayerCount() == max_players)  // start game if player count reached
@@ -1541,7 +2150,7 @@ int GameController::tick()
 	else if (ended)
 	{
 		// delay before game gets deleted
-		if ((unsigned int) difftime(time(NULL), ended_time) >= 4 * 60)
+		if ((unsigned int) difftime(now(), ended_time) >= 4 * 60)
 		{
 			return -1;
 		}
@@ -1549,6 +2158,17 @@ int GameController::tick()
 			return 1;
 	}
 	
+	// the clock is an input of the game
+	if ((recording.sink || event_journal) && now() != recording.clock)
+	{
+		recording.clock = now();
+		
+		if (recording.sink)
+			recordClock();
+		if (event_journal)
+			journalClock();
+	}
+	
 	// handle all tables
 	for (tables_type::iterator e = tables.begin(); e != tables.end();)
 	{
@@ -1561,7 +2181,8 @@ int GameController::tick()
 			if (tables.size() == 1)
 			{
 				ended = true;
-				ended_time = time(NULL);
+				ended_time = now();
+				++info_revision;
 				
 				snprintf(msg, sizeof(msg), "%d", SnapGameStateEnd);
 				snap(-1, SnapGameState, msg);
@@ -1573,14 +2194,28 @@ int GameController::tick()
 						finish_list.push_back(t->seats[i].player);
 						break;
 					}
+				
+				if (t->arriving.size())
+					finish_list.push_back(t->arriving.front());
+				
+				if (recording.sink)
+				{
+					recordEnd();
+					stopRecording();
+				}
+				
+				if (event_journal)
+					journalEnd();
 			}
 			
-			delete t;
+			table_pool.release(t);
 			tables.erase(e++);
 		}
 		else
 			++e;
 	}
 	
+	recording.ticks++;
+	
 	return 0;
 }
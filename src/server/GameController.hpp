@@ -25,18 +25,30 @@
 #define _GAMECONTROLLER_H
 
 #include <vector>
+#include <deque>
 #include <map>
 #include <set>
 #include <string>
 #include <ctime>
+#include <cstdio>
 
 #include "Card.hpp"
 #include "Deck.hpp"
+#include "Random.hpp"
 #include "HoleCards.hpp"
 #include "CommunityCards.hpp"
 #include "Table.hpp"
 #include "Player.hpp"
 #include "GameLogic.hpp"
+#include "FlatMap.hpp"
+#include "ObjectPool.hpp"
+#include "WireFormat.h"
+#include "HandLog.h"
+#include "Journal.h"
+
+
+//! \brief Version of the game record format
+#define GAME_RECORD_VERSION  2
 
 
 class GameController
@@ -45,7 +57,7 @@ friend class TestCaseGameController;
 
 public:
 	typedef std::map<int,Table*>	tables_type;
-	typedef std::map<int,Player*>	players_type;
+	typedef FlatMap<int,Player*>	players_type;
 	typedef std::set<int>		spectators_type;
 	
 	typedef std::vector<Player*>	finish_list_type;
@@ -74,32 +86,113 @@ public:
 	GameController(const GameController& g);
 	~GameController();
 	
+	//! \brief Get a game from the pool; with default or copied settings
+	static GameController* create();
+	static GameController* create(const GameController &g);
+	//! \brief Return a game obtained by create() to the pool
+	static void destroy(GameController *g);
+	
+	//! \brief Pools of games, tables and players
+	static const ObjectPool<GameController>& getGamePool();
+	static const ObjectPool<Table>& getTablePool();
+	static const ObjectPool<Player>& getPlayerPool();
+	
+	//! \brief Hand-history writer shared by all games (NULL: disabled)
+	static void setHandLog(handlog_writer *hw) { handlog = hw; };
+	
+	//! \brief Event journal shared by all games (NULL: disabled)
+	static void setJournal(journal *j) { event_journal = j; };
+	
+	//! \brief Clock of all games; time(NULL) unless replaced (replay)
+	static time_t now() { return clock_source ? clock_source() : time(NULL); };
+	static void setClock(time_t (*source)()) { clock_source = source; };
+	
+	//! \brief Seed for seating; drawn from the system's random source for each new game
+	void setSeed(const RandomSeed &s) { seed = s; };
+	const RandomSeed& getSeed() const { return seed; };
+	//! \brief Seed of a following hand (replay, recovery); otherwise each hand draws a fresh one
+	void feedHandSeed(const RandomSeed &s) { hand_seeds.push_back(s); };
+	
+	static void putSeed(wire_writer *w, const RandomSeed &s);
+	static RandomSeed readSeed(wire_reader *r);
+	
+	//! \brief Frames of a game record (see GameRecord.cpp)
+	typedef enum {
+		RecordStart = 1,
+		RecordClock,
+		RecordAction,
+		RecordSnap,
+		RecordChat,
+		RecordTable,
+		RecordEnd,
+		RecordSeed
+	} RecordType;
+	
+	//! \brief Records of the event journal; the server writes the first ones,
+	//!        the games the others (see GameJournal.cpp)
+	typedef enum {
+		JournalServer = 1,
+		JournalGame,
+		JournalRegister,
+		JournalUnregister,
+		JournalFinished,
+		JournalDelete,
+		JournalStart,
+		JournalClock,
+		JournalAction,
+		JournalHand,
+		JournalPot,
+		JournalBust,
+		JournalEnd,
+		JournalSeed
+	} JournalType;
+	
+	//! \brief Apply a game record read back from the journal (recovery)
+	bool recoverEvent(int type, wire_reader *r);
+	
+	//! \brief Receives a record frame; returns count of bytes taken or -1
+	typedef int (*record_sink)(void *arg, const char *buf, size_t len);
+	
+	//! \brief Record inputs and outputs of the game from its start into a file or a sink
+	bool recordTo(const char *filename);
+	void recordTo(record_sink sink, void *arg);
+	void stopRecording();
+	void flushRecording();
+	//! \brief Count of ticks since the start of the game
+	unsigned int getTicks() const { return recording.ticks; };
+	
 	void reset();
+	void recycle();
+	
+	//! \brief Write the complete game state (server upgrade)
+	void saveState(wire_writer *w) const;
+	//! \brief Restore a state written by saveState() into a new game
+	bool loadState(wire_reader *r);
 	
-	bool setGameId(int gid) { game_id = gid; return true; };
+	bool setGameId(int gid) { game_id = gid; ++info_revision; return true; };
 	int getGameId() const { return game_id; };
 	
 	GameType getGameType() const { return type; };
 	
-	void setPlayerTimeout(unsigned int respite) { timeout = respite; };
+	void setPlayerTimeout(unsigned int respite) { timeout = respite; ++info_revision; };
 	unsigned int getPlayerTimeout() const { return timeout; };
 	
-	void setBlindsStart(chips_type blinds_start) { blind.start = blinds_start; };
+	void setBlindsStart(chips_type blinds_start) { blind.start = blinds_start; ++info_revision; };
 	chips_type getBlindsStart() const { return blind.start; };
-	void setBlindsFactor(unsigned int blinds_factor) { blind.blinds_factor = blinds_factor; };
+	void setBlindsFactor(unsigned int blinds_factor) { blind.blinds_factor = blinds_factor; ++info_revision; };
 	unsigned int getBlindsFactor() const { return blind.blinds_factor; };
-	void setBlindsTime(unsigned int blinds_time) { blind.blinds_time = blinds_time; };
+	void setBlindsTime(unsigned int blinds_time) { blind.blinds_time = blinds_time; ++info_revision; };
 	unsigned int getBlindsTime() const { return blind.blinds_time; };
 	
 	bool setPlayerStakes(chips_type stake);
 	chips_type getPlayerStakes() const { return player_stakes; };
 	
 	std::string getName() const { return name; };
-	bool setName(const std::string &str) { name = str; return true; }; // FIXME: validate
+	bool setName(const std::string &str) { name = str; ++info_revision; return true; }; // FIXME: validate
 	
 	bool checkPassword(const std::string &passwd) const { return (!password.length() || password == passwd); };
 	bool hasPassword() const { return password.length(); };
-	bool setPassword(const std::string &str) { password = str; return true; };
+	bool setPassword(const std::string &str) { password = str; ++info_revision; return true; };
 	std::string getPassword() const { return password; };
 	
 	bool setPlayerMax(unsigned int max);
@@ -107,25 +200,41 @@ public:
 	unsigned int getPlayerCount() const { return players.size(); };
 	
 	bool getPlayerList(std::vector<int> &client_list) const;
+	bool getPlayerList(int tid, std::vector<int> &client_list) const;
 	bool getListenerList(std::vector<int> &client_list) const;
 	void getFinishList(std::vector<Player*> &player_list) const;
 	
-	void setRestart(bool bRestart) { restart = bRestart; };
+	void setRestart(bool bRestart) { restart = bRestart; ++info_revision; };
 	bool getRestart() const { return restart; };
 	
 	bool isStarted() const { return started; };
 	bool isEnded() const { return ended; };
 	
 	bool isFinished() const { return finished; };
+	
+	//! \brief Changes whenever the public game info (GAMEINFO) changes
+	unsigned int getInfoRevision() const { return info_revision; };
 	void setFinished() { finished = true; };
 	
 	bool addPlayer(int cid, const std::string &uuid);
 	bool removePlayer(int cid);
 	bool isPlayer(int cid) const;
+	const Player* getPlayer(int cid) const;
 	
 	bool addSpectator(int cid);
 	bool removeSpectator(int cid);
 	bool isSpectator(int cid) const;
+	unsigned int getSpectatorCount() const { return spectators.size(); };
+	
+	//! \brief Limit spectator updates to <rate> per second (0 delivers them immediately)
+	void setSpectatorRate(unsigned int rate) { spectator.rate = rate; };
+	unsigned int getSpectatorRate() const { return spectator.rate; };
+	//! \brief Delay spectator updates by <delay> seconds (only with a rate set)
+	void setSpectatorDelay(unsigned int delay) { spectator.delay = delay; };
+	unsigned int getSpectatorDelay() const { return spectator.delay; };
+	//! \brief Limit the count of spectators (0 for no limit); players are not affected
+	void setSpectatorMax(unsigned int max) { spectator.max = max; };
+	unsigned int getSpectatorMax() const { return spectator.max; };
 	
 	void setOwner(int cid) { owner = cid; };
 	int getOwner() const { return owner; };
@@ -135,17 +244,29 @@ public:
 	
 	bool setPlayerAction(int cid, Player::PlayerAction action, chips_type amount);
 	
+	bool resendTableSnapshot(int cid, int tid);
+	
 	void start();
 	
 	int tick();
 	
 	
 protected:
+	void setDefaults();
+	void copySettings(const GameController &g);
+	void releaseObjects();
+	
 	Player* findPlayer(int cid);
+	void updatePlayerSeat(Player *p);
 	void selectNewOwner();
 	
 	void snap(int tid, int sid, const char* msg="");
 	void snap(int cid, int tid, int sid, const char* msg="");
+	void forgetListener(int cid);
+	
+	void queueSpectatorUpdate(int tid, int sid, const char *msg,
+		unsigned int seq=0, const wire_table_snap *ts=NULL);
+	void flushSpectators();
 	
 	bool createWinlist(Table *t, std::vector< std::vector<HandStrength> > &winlist);
 	chips_type determineMinimumBet(Table *t) const;
@@ -168,9 +289,39 @@ protected:
 	void dealTurn(Table *t);
 	void dealRiver(Table *t);
 	
+	bool balanceTables(Table *t);
+	void movePlayer(Table *from, unsigned int seat, Table *to);
+	
 	void sendTableSnapshot(Table *t);
 	void sendPlayerShowSnapshot(Table *t, Player *p);
 	
+	void logHand(const Table *t, int type, int seat, chips_type amount=0,
+		unsigned int action=0, unsigned int flags=0,
+		const Card *cards=NULL, unsigned int ncards=0);
+	void logShow(const Table *t, unsigned int s);
+	
+	static void drawSeed(RandomSeed *s);
+	
+	void recordFrame(wire_writer *w, size_t frame_start);
+	void recordStart();
+	void recordClock();
+	void recordAction(int cid, Player::PlayerAction action, chips_type amount);
+	void recordSnap(int tid, int cid, int sid, const char *msg);
+	void recordChat(int tid, int cid, const char *msg);
+	void recordTable(int tid, unsigned int seq, const wire_table_snap *ts);
+	void recordEnd();
+	void recordSeed(int tid, const RandomSeed &s);
+	
+	void journalEvent(int type, wire_writer *w);
+	void journalStart();
+	void journalClock();
+	void journalAction(int cid, Player::PlayerAction action, chips_type amount);
+	void journalSeed(const Table *t, const RandomSeed &s);
+	void journalHand(const Table *t);
+	void journalPot(const Table *t, unsigned int seat, chips_type amount);
+	void journalBust(const Player *p, unsigned int position);
+	void journalEnd();
+	
 private:
 	int game_id;
 	
@@ -186,6 +337,25 @@ private:
 	spectators_type		spectators;
 	tables_type		tables;
 	
+	//! \brief Snapshot held back for spectators
+	typedef struct {
+		unsigned long time;   // sys_time_ms() when queued
+		int tid;
+		int sid;
+		std::string message;
+		// SnapTable only
+		unsigned int seq;
+		wire_table_snap ts;
+	} spectator_update;
+	
+	struct {
+		unsigned int rate;    // updates per second
+		unsigned int delay;   // seconds
+		unsigned int max;
+		unsigned long last_flush;
+		std::deque<spectator_update> queue;
+	} spectator;
+	
 	struct {
 		chips_type start;
 		chips_type amount;
@@ -196,6 +366,17 @@ private:
 	} blind;
 	
 	unsigned int hand_no;
+	RandomSeed seed;
+	std::deque<RandomSeed> hand_seeds;   // fed in for the next hands
+	
+	struct {
+		record_sink sink;
+		void *arg;
+		FILE *file;
+		std::string filename;
+		unsigned int ticks;
+		time_t clock;   // clock of the last tick
+	} recording;
 	
 	int owner;   // owner of a game
 	bool restart;   // should be restarted when ended?
@@ -209,6 +390,16 @@ private:
 	std::string name;
 	std::string password;
 	
+	unsigned int info_revision;
+	
+	static ObjectPool<GameController> game_pool;
+	static ObjectPool<Table> table_pool;
+	static ObjectPool<Player> player_pool;
+	
+	static handlog_writer *handlog;
+	static journal *event_journal;
+	static time_t (*clock_source)();
+	
 #ifdef DEBUG
 	std::vector<Card> debug_cards;
 #endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+
+#include <cstring>
+#include <algorithm>
+
+#include "Logger.h"
+#include "GameController.hpp"
+#include "WireFormat.h"
+
+using namespace std;
+
+/* Events of a running game for the server's journal (see game.cpp). Each
+   record starts with the game id and the count of ticks since the start.
+   The clock, the start, the actions and the seeds of the hands are the
+   inputs of the game; played again at the same ticks they bring a game
+   restored from a snapshot to the state it had (the same way a replay
+   does, see GameRecord.cpp). Hands, pots, busts and the end are outcomes;
+   a recovery only checks that the game gets there again. */
+
+
+// clock seen by a game while its events are applied
+static time_t recovery_clock;
+
+static time_t get_recovery_clock()
+{
+	return recovery_clock;
+}
+
+
+void GameController::journalEvent(int type, wire_writer *w)
+{
+	if (w->overflow || journal_append(event_journal, type, w->data, w->len) < 0)
+		log_error("journal", "error: journaling event of game %d failed", game_id);
+}
+
+void GameController::journalStart()
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_ulong(&w, now());
+	
+	journalEvent(JournalStart, &w);
+}
+
+void GameController::journalClock()
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_ulong(&w, recording.clock);
+	
+	journalEvent(JournalClock, &w);
+}
+
+void GameController::journalAction(int cid, Player::PlayerAction action, chips_type amount)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, cid);
+	wire_put_u8(&w, action);
+	wire_put_uvar(&w, amount);
+	
+	journalEvent(JournalAction, &w);
+}
+
+void GameController::journalSeed(const Table *t, const RandomSeed &s)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, t->table_id);
+	putSeed(&w, s);
+	
+	journalEvent(JournalSeed, &w);
+}
+
+void GameController::journalHand(const Table *t)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, t->table_id);
+	wire_put_uvar(&w, t->hand_no);
+	
+	journalEvent(JournalHand, &w);
+}
+
+void GameController::journalPot(const Table *t, unsigned int seat, chips_type amount)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, t->table_id);
+	wire_put_i32(&w, t->seats[seat].player->client_id);
+	wire_put_uvar(&w, amount);
+	
+	journalEvent(JournalPot, &w);
+}
+
+void GameController::journalBust(const Player *p, unsigned int position)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, p->client_id);
+	wire_put_uvar(&w, position);
+	
+	journalEvent(JournalBust, &w);
+}
+
+void GameController::journalEnd()
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	wire_put_i32(&w, game_id);
+	wire_put_uvar(&w, recording.ticks);
+	
+	journalEvent(JournalEnd, &w);
+}
+
+// the game id has been read by the caller
+bool GameController::recoverEvent(int type, wire_reader *r)
+{
+	const unsigned int ticks = wire_get_uvar(r);
+	
+	// outcomes are checked after the tick they happened in
+	const bool outcome = (type == JournalHand || type == JournalPot ||
+		type == JournalBust || type == JournalEnd);
+	const unsigned int target = outcome ? ticks + 1 : ticks;
+	
+	if (r->error || recording.ticks > target)
+		return false;
+	
+	time_t (*const prev_clock)() = clock_source;
+	setClock(get_recovery_clock);
+	recovery_clock = recording.clock;
+	
+	while (recording.ticks < target && started && !ended)
+		tick();
+	
+	bool ok = (recording.ticks == target);
+	
+	switch (type)
+	{
+	case JournalStart:
+		recovery_clock = (time_t) wire_get_ulong(r);
+		recording.clock = recovery_clock;
+		start();
+		ok = ok && started;
+		break;
+	case JournalClock:
+		// written by the tick seeing the new clock; every later event
+		// belongs to that tick or a following one
+		recovery_clock = (time_t) wire_get_ulong(r);
+		recording.clock = recovery_clock;
+		if (ok && !r->error)
+			tick();
+		break;
+	case JournalAction:
+		{
+			const int cid = wire_get_i32(r);
+			const Player::PlayerAction action = (Player::PlayerAction) wire_get_u8(r);
+			const chips_type amount = wire_get_uvar(r);
+			
+			ok = ok && setPlayerAction(cid, action, amount);
+		}
+		break;
+	case JournalSeed:
+		// dealt by the following tick
+		wire_get_i32(r);
+		feedHandSeed(readSeed(r));
+		break;
+	case JournalHand:
+		wire_get_i32(r);
+		ok = ok && hand_no >= wire_get_uvar(r);
+		break;
+	case JournalPot:
+		break;
+	case JournalBust:
+		{
+			const Player *p = findPlayer(wire_get_i32(r));
+			ok = ok && p && find(finish_list.begin(), finish_list.end(), p) != finish_list.end();
+		}
+		break;
+	case JournalEnd:
+		ok = ok && ended;
+		break;
+	default:
+		ok = false;
+	}
+	
+	setClock(prev_clock);
+	
+	return ok && !r->error;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Logger.h"
+#include "GameController.hpp"
+#include "WireFormat.h"
+#include "WireProtocol.hpp"
+
+using namespace std;
+
+/* A game record holds everything needed to play a game again: settings,
+   seating seed and players at the start as the first frame, then the
+   clock, the player actions and the seed of each hand as inputs and all snapshots and chat messages the
+   game produced as outputs. Frames use the framing of the binary protocol;
+   each payload starts with the count of ticks since the start, so a replay
+   can feed the inputs at the same point between two ticks. */
+
+
+void GameController::putSeed(wire_writer *w, const RandomSeed &s)
+{
+	for (unsigned int i=0; i < 4; i++)
+		wire_put_u32(w, s.word[i]);
+}
+
+RandomSeed GameController::readSeed(wire_reader *r)
+{
+	RandomSeed s;
+	
+	for (unsigned int i=0; i < 4; i++)
+		s.word[i] = wire_get_u32(r);
+	
+	return s;
+}
+
+
+static int record_file_sink(void *arg, const char *buf, size_t len)
+{
+	return (fwrite(buf, 1, len, (FILE*) arg) == len) ? (int) len : -1;
+}
+
+bool GameController::recordTo(const char *filename)
+{
+	stopRecording();
+	
+	// append; a record is continued by the server taking over on an upgrade
+	FILE *fp = fopen(filename, "ab");
+	if (!fp)
+		return false;
+	
+	recording.file = fp;
+	recording.filename = filename;
+	recording.sink = record_file_sink;
+	recording.arg = fp;
+	
+	return true;
+}
+
+void GameController::recordTo(record_sink sink, void *arg)
+{
+	stopRecording();
+	
+	recording.sink = sink;
+	recording.arg = arg;
+}
+
+void GameController::stopRecording()
+{
+	if (recording.file)
+		fclose(recording.file);
+	
+	recording.file = NULL;
+	recording.filename.clear();
+	recording.sink = NULL;
+	recording.arg = NULL;
+}
+
+void GameController::flushRecording()
+{
+	if (recording.file)
+		fflush(recording.file);
+}
+
+void GameController::recordFrame(wire_writer *w, size_t frame_start)
+{
+	// anything before the start is not part of the game
+	if (!started)
+		return;
+	
+	wire_frame_end(w, frame_start);
+	
+	if (w->overflow || recording.sink(recording.arg, w->data, w->len) != (int) w->len)
+	{
+		log_error("record", "error: recording game %d failed, stopped", game_id);
+		stopRecording();
+	}
+}
+
+void GameController::recordStart()
+{
+	vector<char> buf(1024 + players.size() * 64);
+	wire_writer w;
+	wire_writer_init(&w, &buf[0], buf.size());
+	
+	recording.ticks = 0;
+	recording.clock = now();
+	
+	const size_t frame = wire_frame_begin(&w, RecordStart);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_u16(&w, GAME_RECORD_VERSION);
+	wire_put_i32(&w, game_id);
+	wire_put_u8(&w, type);
+	wire_put_u8(&w, limit);
+	wire_put_u8(&w, blind.blindrule);
+	wire_put_uvar(&w, max_players);
+	wire_put_uvar(&w, player_stakes);
+	wire_put_uvar(&w, timeout);
+	wire_put_uvar(&w, blind.start);
+	wire_put_uvar(&w, blind.blinds_factor);
+	wire_put_uvar(&w, blind.blinds_time);
+	wire_put_string(&w, name.c_str(), name.length());
+	putSeed(&w, seed);
+	wire_put_ulong(&w, recording.clock);
+	
+	// players with actions they have set before the start
+	wire_put_uvar(&w, players.size());
+	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
+	{
+		const Player *p = e->second;
+		
+		wire_put_i32(&w, p->client_id);
+		wire_put_string(&w, p->uuid.c_str(), p->uuid.length());
+		wire_put_u8(&w, p->sitout);
+		wire_put_u8(&w, p->next_action.valid);
+		wire_put_u8(&w, p->next_action.valid ? p->next_action.action : 0);
+		wire_put_uvar(&w, p->next_action.valid ? p->next_action.amount : 0);
+	}
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordClock()
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordClock);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_ulong(&w, recording.clock);
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordAction(int cid, Player::PlayerAction action, chips_type amount)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordAction);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_i32(&w, cid);
+	wire_put_u8(&w, action);
+	wire_put_uvar(&w, amount);
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordSnap(int tid, int cid, int sid, const char *msg)
+{
+	char buf[2048];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordSnap);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_var(&w, tid);
+	wire_put_var(&w, cid);
+	wire_put_uvar(&w, sid);
+	wire_put_string(&w, msg, strlen(msg));
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordChat(int tid, int cid, const char *msg)
+{
+	char buf[2048];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordChat);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_var(&w, tid);
+	wire_put_var(&w, cid);
+	wire_put_string(&w, msg, strlen(msg));
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordTable(int tid, unsigned int seq, const wire_table_snap *ts)
+{
+	char buf[1024];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordTable);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_var(&w, tid);
+	wire_put_uvar(&w, seq);
+	wire_encode_table_snap(&w, ts);
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordSeed(int tid, const RandomSeed &s)
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordSeed);
+	wire_put_uvar(&w, recording.ticks);
+	wire_put_var(&w, tid);
+	putSeed(&w, s);
+	
+	recordFrame(&w, frame);
+}
+
+void GameController::recordEnd()
+{
+	char buf[64];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	
+	const size_t frame = wire_frame_begin(&w, RecordEnd);
+	wire_put_uvar(&w, recording.ticks);
+	
+	recordFrame(&w, frame);
+}
@@ -0,0 +1,450 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <vector>
+
+#include "Logger.h"
+#include "GameController.hpp"
+#include "Card.hpp"
+#include "WireFormat.h"
+#include "WireProtocol.hpp"
+
+using namespace std;
+
+/* Complete state of a game; written by the running server and read back
+   by the server it hands over to on an upgrade. Both sides have to be
+   built from the same state format (see upgrade.hpp). */
+
+
+static void put_cards(wire_writer *w, const vector<Card> &cards)
+{
+	wire_put_u8(w, cards.size());
+	for (vector<Card>::const_iterator e = cards.begin(); e != cards.end(); e++)
+	{
+		wire_put_u8(w, e->getFace());
+		wire_put_u8(w, e->getSuit());
+	}
+}
+
+static bool get_cards(wire_reader *r, vector<Card> &cards)
+{
+	const unsigned int count = wire_get_u8(r);
+	if (count > 52)
+		return false;
+	
+	cards.clear();
+	for (unsigned int i=0; i < count; i++)
+	{
+		const unsigned int face = wire_get_u8(r);
+		const unsigned int suit = wire_get_u8(r);
+		
+		if (face < Card::FirstFace || face > Card::LastFace ||
+			suit < Card::FirstSuit || suit > Card::LastSuit)
+			return false;
+		
+		cards.push_back(Card((Card::Face) face, (Card::Suit) suit));
+	}
+	
+	return !r->error;
+}
+
+static int player_id(const Player *p)
+{
+	return p ? p->getClientId() : -1;
+}
+
+void GameController::saveState(wire_writer *w) const
+{
+	wire_put_i32(w, game_id);
+	wire_put_u8(w, type);
+	wire_put_u8(w, limit);
+	wire_put_uvar(w, max_players);
+	wire_put_uvar(w, player_stakes);
+	wire_put_uvar(w, timeout);
+	wire_put_i32(w, owner);
+	wire_put_string(w, name.data(), name.length());
+	wire_put_string(w, password.data(), password.length());
+	wire_put_u8(w, restart);
+	wire_put_u8(w, started);
+	wire_put_u8(w, ended);
+	wire_put_u32(w, (unsigned int) ended_time);
+	wire_put_u8(w, finished);
+	wire_put_uvar(w, hand_no);
+	wire_put_uvar(w, info_revision);
+	putSeed(w, seed);
+	wire_put_uvar(w, hand_seeds.size());
+	for (unsigned int i=0; i < hand_seeds.size(); i++)
+		putSeed(w, hand_seeds[i]);
+	
+	// the new server continues the record in the same file
+	if (recording.file)
+		fflush(recording.file);
+	
+	wire_put_string(w, recording.filename.data(), recording.filename.length());
+	wire_put_uvar(w, recording.ticks);
+	wire_put_ulong(w, recording.clock);
+	
+	wire_put_uvar(w, blind.start);
+	wire_put_uvar(w, blind.amount);
+	wire_put_u8(w, blind.blindrule);
+	wire_put_uvar(w, blind.blinds_time);
+	wire_put_u32(w, (unsigned int) blind.last_blinds_time);
+	wire_put_uvar(w, blind.blinds_factor);
+	
+	// players
+	wire_put_uvar(w, players.size());
+	for (players_type::const_iterator e = players.begin(); e != players.end(); e++)
+	{
+		const Player *p = e->second;
+		vector<Card> cards;
+		p->holecards.copyCards(&cards);
+		
+		wire_put_i32(w, p->client_id);
+		wire_put_i32(w, p->table_id);
+		wire_put_string(w, p->uuid.data(), p->uuid.length());
+		wire_put_uvar(w, p->stake);
+		wire_put_uvar(w, p->stake_before);
+		put_cards(w, cards);
+		wire_put_u8(w, p->next_action.valid);
+		wire_put_u8(w, p->next_action.action);
+		wire_put_uvar(w, p->next_action.amount);
+		wire_put_u8(w, p->last_action);
+		wire_put_u8(w, p->sitout);
+	}
+	
+	wire_put_uvar(w, finish_list.size());
+	for (finish_list_type::const_iterator e = finish_list.begin(); e != finish_list.end(); e++)
+		wire_put_i32(w, player_id(*e));
+	
+	// spectators and their held back updates
+	wire_put_uvar(w, spectators.size());
+	for (spectators_type::const_iterator e = spectators.begin(); e != spectators.end(); e++)
+		wire_put_i32(w, *e);
+	
+	wire_put_uvar(w, spectator.rate);
+	wire_put_uvar(w, spectator.delay);
+	wire_put_uvar(w, spectator.max);
+	wire_put_ulong(w, spectator.last_flush);
+	
+	wire_put_uvar(w, spectator.queue.size());
+	for (deque<spectator_update>::const_iterator e = spectator.queue.begin(); e != spectator.queue.end(); e++)
+	{
+		wire_put_ulong(w, e->time);
+		wire_put_i32(w, e->tid);
+		wire_put_i32(w, e->sid);
+		wire_put_string(w, e->message.data(), e->message.length());
+		wire_put_uvar(w, e->seq);
+		if (e->seq)
+			wire_encode_table_snap(w, &e->ts);
+	}
+	
+	// tables
+	wire_put_uvar(w, tables.size());
+	for (tables_type::const_iterator e = tables.begin(); e != tables.end(); e++)
+	{
+		const Table *t = e->second;
+		vector<Card> cards;
+		
+		wire_put_i32(w, t->table_id);
+		wire_put_u8(w, t->state);
+		wire_put_u32(w, (unsigned int) t->delay_start);
+		wire_put_uvar(w, t->delay);
+		wire_put_u32(w, (unsigned int) t->timeout_start);
+		wire_put_u8(w, t->nomoreaction);
+		wire_put_u8(w, t->betround);
+		
+		t->deck.copyCards(&cards);
+		put_cards(w, cards);
+		cards.clear();
+		t->communitycards.copyCards(&cards);
+		put_cards(w, cards);
+		
+		for (unsigned int i=0; i < 10; i++)
+		{
+			const Table::Seat *s = &(t->seats[i]);
+			
+			wire_put_u8(w, s->occupied);
+			wire_put_i32(w, s->occupied ? player_id(s->player) : -1);
+			wire_put_uvar(w, s->bet);
+			wire_put_u8(w, s->in_round);
+			wire_put_u8(w, s->showcards);
+		}
+		
+		wire_put_u16(w, t->mask_occupied);
+		wire_put_u16(w, t->mask_inround);
+		wire_put_u16(w, t->mask_allin);
+		wire_put_u16(w, t->mask_sitout);
+		
+		wire_put_uvar(w, t->hand_no);
+		wire_put_var(w, t->dealer);
+		wire_put_var(w, t->sb);
+		wire_put_var(w, t->bb);
+		wire_put_var(w, t->cur_player);
+		wire_put_var(w, t->last_bet_player);
+		wire_put_uvar(w, t->bet_amount);
+		wire_put_uvar(w, t->last_bet_amount);
+		
+		wire_put_uvar(w, t->pots.size());
+		for (vector<Table::Pot>::const_iterator p = t->pots.begin(); p != t->pots.end(); p++)
+		{
+			wire_put_uvar(w, p->amount);
+			wire_put_u16(w, p->involved);
+			wire_put_u8(w, p->final);
+		}
+		
+		wire_put_uvar(w, t->arriving.size());
+		for (vector<Player*>::const_iterator p = t->arriving.begin(); p != t->arriving.end(); p++)
+			wire_put_i32(w, player_id(*p));
+		
+		// snapshot state; keeps the table deltas of all listeners going
+		wire_put_uvar(w, t->snap_seq);
+		if (t->snap_seq)
+			wire_encode_table_snap(w, &t->snap_last);
+		
+		wire_put_uvar(w, t->snap_sent.size());
+		for (map<int,unsigned int>::const_iterator s = t->snap_sent.begin(); s != t->snap_sent.end(); s++)
+		{
+			wire_put_i32(w, s->first);
+			wire_put_uvar(w, s->second);
+		}
+		
+		wire_put_uvar(w, t->spec_seq);
+		if (t->spec_seq)
+			wire_encode_table_snap(w, &t->spec_last);
+	}
+}
+
+bool GameController::loadState(wire_reader *r)
+{
+	size_t len;
+	const char *str;
+	unsigned int count;
+	
+	game_id = wire_get_i32(r);
+	type = (GameType) wire_get_u8(r);
+	limit = (LimitRule) wire_get_u8(r);
+	max_players = wire_get_uvar(r);
+	player_stakes = wire_get_uvar(r);
+	timeout = wire_get_uvar(r);
+	owner = wire_get_i32(r);
+	str = wire_get_string(r, &len);
+	name.assign(str, len);
+	str = wire_get_string(r, &len);
+	password.assign(str, len);
+	restart = wire_get_u8(r);
+	started = wire_get_u8(r);
+	ended = wire_get_u8(r);
+	ended_time = (time_t) wire_get_u32(r);
+	finished = wire_get_u8(r);
+	hand_no = wire_get_uvar(r);
+	info_revision = wire_get_uvar(r);
+	seed = readSeed(r);
+	hand_seeds.clear();
+	const unsigned int seeds = wire_get_uvar(r);
+	for (unsigned int i=0; i < seeds && !r->error; i++)
+		hand_seeds.push_back(readSeed(r));
+	
+	str = wire_get_string(r, &len);
+	if (len && !recordTo(string(str, len).c_str()))
+		log_error("record", "error: cannot continue record of game %d", game_id);
+	recording.ticks = wire_get_uvar(r);
+	recording.clock = (time_t) wire_get_ulong(r);
+	
+	blind.start = wire_get_uvar(r);
+	blind.amount = wire_get_uvar(r);
+	blind.blindrule = (BlindRule) wire_get_u8(r);
+	blind.blinds_time = wire_get_uvar(r);
+	blind.last_blinds_time = (time_t) wire_get_u32(r);
+	blind.blinds_factor = wire_get_uvar(r);
+	
+	// players
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		vector<Card> cards;
+		
+		const int cid = wire_get_i32(r);
+		if (isPlayer(cid))
+			return false;
+		
+		Player *p = player_pool.acquire();
+		players[cid] = p;
+		
+		p->client_id = cid;
+		p->table_id = wire_get_i32(r);
+		str = wire_get_string(r, &len);
+		p->uuid.assign(str, len);
+		p->stake = wire_get_uvar(r);
+		p->stake_before = wire_get_uvar(r);
+		
+		if (!get_cards(r, cards))
+			return false;
+		if (cards.size() == 2)
+			p->holecards.setCards(cards[0], cards[1]);
+		
+		p->next_action.valid = wire_get_u8(r);
+		p->next_action.action = (Player::PlayerAction) wire_get_u8(r);
+		p->next_action.amount = wire_get_uvar(r);
+		p->last_action = (Player::PlayerAction) wire_get_u8(r);
+		p->sitout = wire_get_u8(r);
+	}
+	
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		Player *p = findPlayer(wire_get_i32(r));
+		if (!p)
+			return false;
+		
+		finish_list.push_back(p);
+	}
+	
+	// spectators and their held back updates
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+		spectators.insert(wire_get_i32(r));
+	
+	spectator.rate = wire_get_uvar(r);
+	spectator.delay = wire_get_uvar(r);
+	spectator.max = wire_get_uvar(r);
+	spectator.last_flush = wire_get_ulong(r);
+	
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		spectator_update u;
+		u.time = wire_get_ulong(r);
+		u.tid = wire_get_i32(r);
+		u.sid = wire_get_i32(r);
+		str = wire_get_string(r, &len);
+		u.message.assign(str, len);
+		u.seq = wire_get_uvar(r);
+		if (u.seq && !wire_decode_table_snap(r, &u.ts))
+			return false;
+		
+		spectator.queue.push_back(u);
+	}
+	
+	// tables
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		vector<Card> cards;
+		
+		Table *t = table_pool.acquire();
+		t->table_id = wire_get_i32(r);
+		tables[t->table_id] = t;
+		
+		t->state = (Table::State) wire_get_u8(r);
+		t->delay_start = (time_t) wire_get_u32(r);
+		t->delay = wire_get_uvar(r);
+		t->timeout_start = (time_t) wire_get_u32(r);
+		t->nomoreaction = wire_get_u8(r);
+		t->betround = (Table::BettingRound) wire_get_u8(r);
+		
+		if (!get_cards(r, cards))
+			return false;
+		t->deck.debugPushCards(&cards);
+		
+		if (!get_cards(r, cards))
+			return false;
+		if (cards.size() >= 3)
+			t->communitycards.setFlop(cards[0], cards[1], cards[2]);
+		if (cards.size() >= 4)
+			t->communitycards.setTurn(cards[3]);
+		if (cards.size() == 5)
+			t->communitycards.setRiver(cards[4]);
+		
+		for (unsigned int s=0; s < 10; s++)
+		{
+			Table::Seat *seat = &(t->seats[s]);
+			
+			seat->seat_no = s;
+			seat->occupied = wire_get_u8(r);
+			seat->player = findPlayer(wire_get_i32(r));
+			seat->bet = wire_get_uvar(r);
+			seat->in_round = wire_get_u8(r);
+			seat->showcards = wire_get_u8(r);
+			
+			if (seat->occupied && !seat->player)
+				return false;
+		}
+		
+		t->mask_occupied = wire_get_u16(r);
+		t->mask_inround = wire_get_u16(r);
+		t->mask_allin = wire_get_u16(r);
+		t->mask_sitout = wire_get_u16(r);
+		
+		t->hand_no = wire_get_uvar(r);
+		t->dealer = wire_get_var(r);
+		t->sb = wire_get_var(r);
+		t->bb = wire_get_var(r);
+		t->cur_player = wire_get_var(r);
+		t->last_bet_player = wire_get_var(r);
+		t->bet_amount = wire_get_uvar(r);
+		t->last_bet_amount = wire_get_uvar(r);
+		
+		const unsigned int pot_count = wire_get_uvar(r);
+		for (unsigned int p=0; p < pot_count && !r->error; p++)
+		{
+			Table::Pot pot;
+			pot.amount = wire_get_uvar(r);
+			pot.involved = wire_get_u16(r);
+			pot.final = wire_get_u8(r);
+			
+			t->pots.push_back(pot);
+		}
+		
+		const unsigned int arriving_count = wire_get_uvar(r);
+		for (unsigned int p=0; p < arriving_count && !r->error; p++)
+		{
+			Player *player = findPlayer(wire_get_i32(r));
+			if (!player)
+				return false;
+			
+			t->arriving.push_back(player);
+		}
+		
+		t->snap_seq = wire_get_uvar(r);
+		if (t->snap_seq && !wire_decode_table_snap(r, &t->snap_last))
+			return false;
+		
+		const unsigned int sent_count = wire_get_uvar(r);
+		for (unsigned int s=0; s < sent_count && !r->error; s++)
+		{
+			const int cid = wire_get_i32(r);
+			t->snap_sent[cid] = wire_get_uvar(r);
+		}
+		
+		t->spec_seq = wire_get_uvar(r);
+		if (t->spec_seq && !wire_decode_table_snap(r, &t->spec_last))
+			return false;
+		
+#ifdef DEBUG
+		t->checkSeatMasks();
+#endif
+	}
+	
+	return !r->error;
+}
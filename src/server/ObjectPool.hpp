@@ -0,0 +1,90 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _OBJECTPOOL_H
+#define _OBJECTPOOL_H
+
+#include <vector>
+
+
+//! \brief Typed pool recycling objects instead of freeing them
+//!
+//! Released objects are recycle()d and kept on a free list, so they retain
+//! the capacity of their containers for the next user. The free list holds
+//! at most max_free objects; surplus objects are deleted.
+template <class T>
+class ObjectPool
+{
+public:
+	ObjectPool(unsigned int max) : used(0), max_free(max) { };
+	
+	~ObjectPool()
+	{
+		for (typename std::vector<T*>::iterator e = free_list.begin(); e != free_list.end(); e++)
+			delete *e;
+	};
+	
+	//! \brief Get a recycled object, or a new one if none is free
+	T* acquire()
+	{
+		++used;
+		
+		if (free_list.empty())
+			return new T();
+		
+		T *obj = free_list.back();
+		free_list.pop_back();
+		
+		return obj;
+	};
+	
+	//! \brief Return an object obtained by acquire()
+	void release(T *obj)
+	{
+		--used;
+		
+		if (free_list.size() >= max_free)
+		{
+			delete obj;
+			return;
+		}
+		
+		obj->recycle();
+		free_list.push_back(obj);
+	};
+	
+	unsigned int getUsed() const { return used; };
+	unsigned int getFree() const { return free_list.size(); };
+	
+private:
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator=(const ObjectPool&);
+	
+	std::vector<T*> free_list;
+	unsigned int used;
+	unsigned int max_free;
+};
+
+
+#endif /* _OBJECTPOOL_H */
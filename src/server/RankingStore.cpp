@@ -0,0 +1,228 @@
+/*
+ * Copyright 2008-2010, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <algorithm>
+
+#include "RankingStore.hpp"
+
+
+RankingStore::RankingStore(int max_score)
+{
+	this->max_score = max_score;
+	clear();
+}
+
+void RankingStore::clear()
+{
+	entries.clear();
+	dirty_list.clear();
+	buckets.assign(64, -1);
+	tree.assign(max_score + 2, 0);
+	by_score.assign(max_score + 1, std::vector<int>());
+}
+
+// FNV-1a
+unsigned int RankingStore::hash(const std::string &uuid)
+{
+	unsigned int h = 2166136261u;
+	
+	for (unsigned int i=0; i < uuid.length(); i++)
+	{
+		h ^= (unsigned char) uuid[i];
+		h *= 16777619u;
+	}
+	
+	return h;
+}
+
+int RankingStore::clamp(int ranking) const
+{
+	if (ranking < 0)
+		return 0;
+	else if (ranking > max_score)
+		return max_score;
+	
+	return ranking;
+}
+
+int RankingStore::find(const std::string &uuid) const
+{
+	for (int i = buckets[hash(uuid) & (buckets.size() - 1)]; i != -1; i = entries[i].next)
+	{
+		if (entries[i].uuid == uuid)
+			return i;
+	}
+	
+	return -1;
+}
+
+void RankingStore::rehash(unsigned int bucket_count)
+{
+	buckets.assign(bucket_count, -1);
+	
+	for (unsigned int i=0; i < entries.size(); i++)
+	{
+		int &head = buckets[hash(entries[i].uuid) & (bucket_count - 1)];
+		entries[i].next = head;
+		head = i;
+	}
+}
+
+int RankingStore::insert(const std::string &uuid, const std::string &name, int ranking, int gamecount, bool changed)
+{
+	const int idx = entries.size();
+	
+	Entry e;
+	e.uuid = uuid;
+	e.name = name;
+	e.ranking = clamp(ranking);
+	e.gamecount = gamecount;
+	e.dirty = changed;
+	e.next = -1;
+	entries.push_back(e);
+	
+	if (changed)
+		dirty_list.push_back(idx);
+	
+	// keep the load factor at most 1
+	if (entries.size() > buckets.size())
+		rehash(buckets.size() * 2);
+	else
+	{
+		int &head = buckets[hash(uuid) & (buckets.size() - 1)];
+		entries[idx].next = head;
+		head = idx;
+	}
+	
+	addScore(idx);
+	
+	return idx;
+}
+
+void RankingStore::update(int idx, const std::string &name, int ranking, int gamecount)
+{
+	Entry &e = entries[idx];
+	
+	if (clamp(ranking) != e.ranking)
+	{
+		removeScore(idx);
+		e.ranking = clamp(ranking);
+		addScore(idx);
+	}
+	
+	e.name = name;
+	e.gamecount = gamecount;
+	
+	if (!e.dirty)
+	{
+		e.dirty = true;
+		dirty_list.push_back(idx);
+	}
+}
+
+void RankingStore::takeDirty(std::vector<int> &list)
+{
+	for (unsigned int i=0; i < dirty_list.size(); i++)
+		entries[dirty_list[i]].dirty = false;
+	
+	list.swap(dirty_list);
+	dirty_list.clear();
+}
+
+// players of a score are kept sorted by uuid
+struct ranking_uuid_less
+{
+	const std::vector<RankingStore::Entry> *entries;
+	
+	bool operator()(int a, int b) const { return (*entries)[a].uuid < (*entries)[b].uuid; };
+};
+
+void RankingStore::addScore(int idx)
+{
+	const int score = entries[idx].ranking;
+	
+	for (unsigned int i = score + 1; i < tree.size(); i += i & -i)
+		tree[i]++;
+	
+	ranking_uuid_less less = { &entries };
+	std::vector<int> &list = by_score[score];
+	list.insert(std::lower_bound(list.begin(), list.end(), idx, less), idx);
+}
+
+void RankingStore::removeScore(int idx)
+{
+	const int score = entries[idx].ranking;
+	
+	for (unsigned int i = score + 1; i < tree.size(); i += i & -i)
+		tree[i]--;
+	
+	ranking_uuid_less less = { &entries };
+	std::vector<int> &list = by_score[score];
+	list.erase(std::lower_bound(list.begin(), list.end(), idx, less));
+}
+
+// number of players with a score of at most score
+unsigned int RankingStore::countUpTo(int score) const
+{
+	unsigned int count = 0;
+	
+	for (unsigned int i = score + 1; i > 0; i -= i & -i)
+		count += tree[i];
+	
+	return count;
+}
+
+unsigned int RankingStore::getPosition(int idx) const
+{
+	return entries.size() - countUpTo(entries[idx].ranking) + 1;
+}
+
+int RankingStore::getAt(unsigned int index) const
+{
+	if (index >= entries.size())
+		return -1;
+	
+	// the leaderboard is in descending order; find the smallest score with
+	// more than (size - 1 - index) players at or below it
+	unsigned int remaining = entries.size() - index;
+	unsigned int pos = 0;
+	unsigned int step = 1;
+	
+	while (step * 2 < tree.size())
+		step *= 2;
+	
+	for (; step; step /= 2)
+	{
+		if (pos + step < tree.size() && tree[pos + step] < remaining)
+		{
+			pos += step;
+			remaining -= tree[pos];
+		}
+	}
+	
+	// pos is the score; the players above it come first
+	const int score = pos;
+	const unsigned int above = entries.size() - countUpTo(score);
+	
+	return by_score[score][index - above];
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2008-2010, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _RANKINGSTORE_H
+#define _RANKINGSTORE_H
+
+#include <string>
+#include <vector>
+
+
+//! \brief Rankings of all players, kept in memory
+/*! Players are found by uuid through a hash table. Scores are bounded, so a
+    Fenwick tree counting the players per score serves as order-statistics
+    tree: the position of a score and the score at a position are found in
+    O(log max_score). Players with the same score share a position and are
+    listed in uuid order. */
+class RankingStore
+{
+public:
+	struct Entry
+	{
+		std::string uuid;
+		std::string name;
+		int ranking;
+		int gamecount;
+		bool dirty;	// changed since the last takeDirty()
+		int next;	// next entry of the hash bucket
+	};
+	
+	RankingStore(int max_score);
+	
+	void clear();
+	unsigned int size() const { return entries.size(); };
+	
+	//! \brief Index of the player or -1
+	int find(const std::string &uuid) const;
+	//! \brief Add a player; returns its index
+	int insert(const std::string &uuid, const std::string &name, int ranking, int gamecount, bool changed = false);
+	//! \brief Change a player and mark it as changed
+	void update(int idx, const std::string &name, int ranking, int gamecount);
+	
+	const Entry& get(int idx) const { return entries[idx]; };
+	
+	//! \brief Position of a player (1 = best)
+	unsigned int getPosition(int idx) const;
+	//! \brief Player at an index of the leaderboard (0 = first) or -1
+	int getAt(unsigned int index) const;
+	
+	//! \brief Move the changed players into the list and unmark them
+	void takeDirty(std::vector<int> &list);
+	unsigned int countDirty() const { return dirty_list.size(); };
+	
+private:
+	static unsigned int hash(const std::string &uuid);
+	int clamp(int ranking) const;
+	
+	void rehash(unsigned int bucket_count);
+	void addScore(int idx);
+	void removeScore(int idx);
+	unsigned int countUpTo(int score) const;
+	
+	int max_score;
+	std::vector<Entry> entries;
+	std::vector<int> buckets;
+	std::vector<unsigned int> tree;			// Fenwick tree of scores 0..max_score
+	std::vector< std::vector<int> > by_score;	// players of a score in uuid order
+	std::vector<int> dirty_list;
+};
+
+#endif /* _RANKINGSTORE_H */
@@ -24,254 +24,294 @@
 #include "Logger.h"
 #include "Debug.h"
 #include "Table.hpp"
+#include "GameController.hpp"
 
 #include <ctime>
+#include <cassert>
+#include <algorithm>
 
 using namespace std;
 
 
+#define SEATS_ALL	0x3ff
+
+#ifdef DEBUG
+# define CHECK_SEAT_MASKS()	checkSeatMasks()
+#else
+# define CHECK_SEAT_MASKS()
+#endif
+
+
+static inline unsigned int bit_count(unsigned int mask)
+{
+#if defined(__GNUC__)
+	return __builtin_popcount(mask);
+#else
+	unsigned int count = 0;
+	for (; mask; mask &= mask - 1)
+		count++;
+	return count;
+#endif
+}
+
+// index of the lowest set bit; mask must not be 0
+static inline unsigned int lowest_bit(unsigned int mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(mask);
+#else
+	unsigned int n = 0;
+	for (; !(mask & 1); mask >>= 1)
+		n++;
+	return n;
+#endif
+}
+
+// next seat of mask following pos (wrapping around, pos itself excluded); -1 if none
+static int next_seat(unsigned int mask, unsigned int pos)
+{
+	if (pos < 10)
+		mask &= ~(1u << pos);
+	else
+		pos = 9;   // invalid position: start at the first seat
+	
+	if (!mask)
+		return -1;
+	
+	// rotate seat pos+1 into bit 0
+	const unsigned int shift = (pos + 1) % 10;
+	const unsigned int rotated = ((mask >> shift) | (mask << (10 - shift))) & SEATS_ALL;
+	
+	return (shift + lowest_bit(rotated)) % 10;
+}
+
+
 Table::Table()
 {
-	table_id = -1;
+	recycle();
 }
 
-int Table::getNextPlayer(unsigned int pos)
+void Table::recycle()
 {
-	unsigned int start = pos;
-	unsigned int cur = pos;
-	bool found = false;
+	table_id = -1;
+	hand_no = 0;
+	snap_seq = 0;
+	spec_seq = 0;
 	
-	do
-	{
-		cur += 1;
-		if (cur >= 10)
-			cur = 0;
-		
-		// no active player left
-		if (start == cur)
-			return -1;
-		
-		if (seats[cur].occupied)
-			found = true;
-		
-	} while (!found);
+	delay_start = 0;
+	delay = 0;
+	timeout_start = 0;
+	nomoreaction = false;
+	betround = Preflop;
+	dealer = sb = bb = -1;
+	cur_player = last_bet_player = -1;
+	bet_amount = 0;
+	last_bet_amount = 0;
+	
+	mask_occupied = 0;
+	mask_inround = 0;
+	mask_allin = 0;
+	mask_sitout = 0;
 	
-	return cur;
+	deck.empty();
+	communitycards.clear();
+	pots.clear();
+	arriving.clear();
+	snap_sent.clear();
 }
 
-int Table::getNextActivePlayer(unsigned int pos)
+void Table::seatPlayer(unsigned int s, Player *p)
 {
-	unsigned int start = pos;
-	unsigned int cur = pos;
-	bool found = false;
+	seats[s].occupied = true;
+	seats[s].player = p;
 	
-	do
-	{
-		cur = getNextPlayer(cur);
-		
-		// no active player left
-		if (start == cur)
-			return -1;
-		
-		if (seats[cur].in_round)
-			found = true;
-	} while (!found);
+	mask_occupied |= 1u << s;
+	updateSeat(s);
+}
+
+void Table::unseatPlayer(unsigned int s)
+{
+	seats[s].occupied = false;
 	
-	return cur;
+	mask_occupied &= ~(1u << s);
+	mask_allin &= ~(1u << s);
+	mask_sitout &= ~(1u << s);
 }
 
-unsigned int Table::countPlayers()
+void Table::setInRound(unsigned int s, bool in_round)
 {
-	unsigned int count = 0;
+	seats[s].in_round = in_round;
 	
+	if (in_round)
+		mask_inround |= 1u << s;
+	else
+		mask_inround &= ~(1u << s);
+}
+
+// refresh the all-in and sit-out state after the seat's player changed
+void Table::updateSeat(unsigned int s)
+{
+	const unsigned int bit = 1u << s;
+	const Player *p = seats[s].player;
+	
+	if (seats[s].occupied && p->getStake() == 0)
+		mask_allin |= bit;
+	else
+		mask_allin &= ~bit;
+	
+	if (seats[s].occupied && p->isSitout())
+		mask_sitout |= bit;
+	else
+		mask_sitout &= ~bit;
+}
+
+#ifdef DEBUG
+void Table::checkSeatMasks() const
+{
 	for (unsigned int i=0; i < 10; i++)
 	{
-		if (seats[i].occupied)
-			count++;
+		const unsigned int bit = 1u << i;
+		const bool occupied = seats[i].occupied;
+		
+		assert(!(mask_occupied & bit) == !occupied);
+		assert(!(mask_inround & bit) == !seats[i].in_round);
+		assert(!(mask_allin & bit) == !(occupied && seats[i].player->getStake() == 0));
+		assert(!(mask_sitout & bit) == !(occupied && seats[i].player->isSitout()));
 	}
+}
+#endif
+
+int Table::getNextPlayer(unsigned int pos)
+{
+	CHECK_SEAT_MASKS();
 	
-	return count;
+	return next_seat(mask_occupied, pos);
 }
 
-unsigned int Table::countActivePlayers()
+int Table::getNextActivePlayer(unsigned int pos)
 {
-	unsigned int count = 0;
+	CHECK_SEAT_MASKS();
 	
-	for (unsigned int i=0; i < 10; i++)
-	{
-		if (seats[i].occupied && seats[i].in_round)
-			count++;
-	}
+	return next_seat(mask_occupied & mask_inround, pos);
+}
+
+unsigned int Table::countPlayers()
+{
+	CHECK_SEAT_MASKS();
 	
-	return count;
+	return bit_count(mask_occupied);
+}
+
+unsigned int Table::countActivePlayers()
+{
+	CHECK_SEAT_MASKS();
+	
+	return bit_count(mask_occupied & mask_inround);
 }
 
 // all (or except one) players are allin
 bool Table::isAllin()
 {
-	unsigned int count = 0;
-	unsigned int active_players = 0;
+	CHECK_SEAT_MASKS();
 	
-	for (unsigned int i=0; i < 10; i++)
-	{
-		if (seats[i].occupied && seats[i].in_round)
-		{
-			active_players++;
-			
-			Player *p = seats[i].player;
-			
-			if (p->getStake() == 0)
-				count++;
-		}
-	}
+	const unsigned int active = mask_occupied & mask_inround;
+	const unsigned int active_players = bit_count(active);
 	
-	return (count >= active_players - 1);
+	return (bit_count(active & mask_allin) >= active_players - 1);
 }
 
-bool Table::isSeatInvolvedInPot(Pot *pot, unsigned int s)
+// next player in the hand after pos who is involved in pot; pos itself comes last
+int Table::getNextInvolvedPlayer(const Pot *pot, unsigned int pos)
 {
-	for (unsigned int i=0; i < pot->vseats.size(); i++)
-	{
-		if (pot->vseats[i] == s)
-			return true;
-	}
+	CHECK_SEAT_MASKS();
+	
+	const unsigned int mask = mask_occupied & mask_inround & pot->involved;
+	const int next = next_seat(mask, pos);
 	
-	return false;
+	if (next == -1 && pos < 10 && (mask & (1u << pos)))
+		return pos;
+	
+	return next;
 }
 
-unsigned int Table::getInvolvedInPotCount(Pot *pot, std::vector<HandStrength> &wl)
+unsigned int Table::countSeats(unsigned int mask)
 {
-	unsigned int involved_count = 0;
-	
-	for (unsigned int i=0; i < pot->vseats.size(); i++)
-	{
-		const unsigned int s = pot->vseats[i];
-		
-		for (unsigned int j=0; j < wl.size(); j++)
-		{
-			if ((unsigned int) wl[j].getId() == s)
-				involved_count++;
-		}
-	}
-	
-	return involved_count;
+	return bit_count(mask);
 }
 
+// move all bets into the pots; every distinct bet level of the players
+// still in the hand ends a layer, layers go into the current pot until
+// an all-in player finalizes it
 void Table::collectBets()
 {
-	do
+	CHECK_SEAT_MASKS();
+	
+	const unsigned int active = mask_occupied & mask_inround;
+	
+	// seats still in the hand with a bet, ordered by their bet
+	std::pair<chips_type,unsigned int> order[10];
+	unsigned int count = 0;
+	chips_type folded = 0;
+	
+	for (unsigned int i=0; i < 10; i++)
 	{
-		// find smallest bet
-		chips_type smallest_bet = 0;
-		bool need_sidepot = false;
-		
-		for (unsigned int i=0; i < 10; i++)
-		{
-			// skip folded and already handled players
-			if (!seats[i].occupied || !seats[i].in_round || seats[i].bet == 0)
-				continue;
-			
-			if (smallest_bet == 0)   // set an initial value
-				smallest_bet = seats[i].bet;
-			else if (seats[i].bet < smallest_bet)  // new smallest bet
-			{
-				smallest_bet = seats[i].bet;
-				need_sidepot = true;
-			}
-			else if (seats[i].bet > smallest_bet)  // bets are not equal,
-				need_sidepot = true;           // so there must be a smallest bet
-		}
-		
-		
-#if 0
-		log_msg("collectBets", "smallest_bet: sidepot=%s with %d", 
-			need_sidepot ? "true" : "false", smallest_bet);
-#endif
-		// there are no bets, do nothing
-		if (smallest_bet == 0)
-			return;
-		
-		
-		// last pot is current pot
-		Pot *cur_pot = &(pots[pots.size() - 1]);
+		if (!seats[i].occupied || seats[i].bet == 0)
+			continue;
 		
+		if (active & (1u << i))
+			order[count++] = std::make_pair(seats[i].bet, i);
+		else
+			folded += seats[i].bet;
+	}
+	
+	// there are no bets, do nothing
+	if (!count)
+		return;
+	
+	std::sort(order, order + count);
+	
+	
+	unsigned int eligible = 0;
+	for (unsigned int i=0; i < count; i++)
+		eligible |= 1u << order[i].second;
+	
+	chips_type level = 0;
+	
+	for (unsigned int i=0; i < count;)
+	{
 		// if current pot is final, create a new one
-		if (cur_pot->final)
+		if (pots.back().final)
 		{
 			Pot pot;
 			pot.amount = 0;
+			pot.involved = 0;
 			pot.final = false;
 			pots.push_back(pot);
-			
-			cur_pot = &(pots[pots.size() - 1]);
 		}
 		
+		Pot *cur_pot = &(pots.back());
 		
-		// collect the bet of each player
-		for (unsigned int i=0; i < 10; i++)
-		{
-			// skip invalid seats
-			if (!seats[i].occupied)
-				continue;
-			
-			// skip already handled players
-			if (seats[i].bet == 0)
-				continue;
-			
-			// collect bet of folded players and skip them
-			if (!seats[i].in_round)
-			{
-				cur_pot->amount += seats[i].bet;
-				seats[i].bet = 0;
-				continue;
-			}
-			
-			// collect the bet into pot
-			if (!need_sidepot)
-			{
-				cur_pot->amount += seats[i].bet;
-				seats[i].bet = 0;
-			}
-			else
-			{
-				cur_pot->amount += smallest_bet;
-				seats[i].bet -= smallest_bet;
-			}
-			
-			// mark pot as final if at least one player is allin
-			Player *p = seats[i].player;
-			if (p->getStake() == 0)
-				cur_pot->final = true;
-			
-			// set player 'involved in pot'
-			if (!isSeatInvolvedInPot(cur_pot, i))
-				cur_pot->vseats.push_back(i);
-		}
+		// bets of folded players go into the first layer
+		const chips_type next_level = order[i].first;
+		cur_pot->amount += (next_level - level) * bit_count(eligible) + folded;
+		folded = 0;
 		
+		cur_pot->involved |= eligible;
 		
-		if (!need_sidepot)  // all player bets are the same, end here
-			break;
+		// mark pot as final if at least one player is allin
+		if (eligible & mask_allin)
+			cur_pot->final = true;
 		
-	} while (true);
-
-#if 0
-	for (unsigned int i=0; i < pots.size(); i++)
-	{
-		log_msg("pot", "#%d: amount=%0.2f players=%d",
-			i+1, pots[i].amount, (int)pots[i].players.size());
+		// players who bet exactly this level are done
+		for (; i < count && order[i].first == next_level; i++)
+			eligible &= ~(1u << order[i].second);
 		
-		for (unsigned int j=0; j < pots[i].players.size(); j++)
-		{
-			Player *p = pots[i].players[j];
-			log_msg("pot", "    player %d", p->getClientId());
-		}
+		level = next_level;
 	}
 	
-	for (unsigned int i=0; i < seats.size(); i++)
-	{
-		log_msg("seat-bets", "seat-%d: %.2f", i, seats[i].bet);
-	}
-#endif
+	for (unsigned int i=0; i < 10; i++)
+		if (seats[i].occupied)
+			seats[i].bet = 0;
 }
 
 void Table::resetLastPlayerActions()
@@ -290,5 +330,5 @@ void Table::scheduleState(State sched_state, unsigned int delay_sec)
 {
 	state = sched_state;
 	delay = delay_sec;
-	delay_start = time(NULL);
+	delay_start = GameController::now();
 }
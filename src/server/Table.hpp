@@ -25,11 +25,13 @@
 #define _TABLE_H
 
 #include <ctime>
+#include <map>
 
 #include "Deck.hpp"
 #include "CommunityCards.hpp"
 #include "Player.hpp"
 #include "GameLogic.hpp"
+#include "WireProtocol.hpp"
 
 class Table
 {
@@ -47,7 +49,8 @@ public:
 		AskShow,
 		AllFolded,
 		Showdown,
-		EndRound
+		EndRound,
+		Closed       // broken up; players moved to other tables
 	} State;
 	
 	typedef enum {
@@ -68,16 +71,24 @@ public:
 	
 	typedef struct {
 		chips_type amount;
-		std::vector<unsigned int> vseats;
+		unsigned int involved;   // bitmask of the seats eligible to win the pot
 		bool final;
 	} Pot;
 	
 	
 	Table();
 	
+	//! \brief Reset to the state of a new table; keeps container capacity
+	void recycle();
+	
 	bool setTableId(int tid) { table_id = tid; return true; };
 	int getTableId() { return table_id; };
 	
+	void seatPlayer(unsigned int s, Player *p);
+	void unseatPlayer(unsigned int s);
+	void setInRound(unsigned int s, bool in_round);
+	void updateSeat(unsigned int s);
+	
 	int getNextPlayer(unsigned int pos);
 	int getNextActivePlayer(unsigned int pos);
 	unsigned int countPlayers();
@@ -85,9 +96,10 @@ public:
 	bool isAllin();
 	void resetLastPlayerActions();
 	
+	int getNextInvolvedPlayer(const Pot *pot, unsigned int pos);
+	static unsigned int countSeats(unsigned int mask);
+	
 	void collectBets();
-	bool isSeatInvolvedInPot(Pot *pot, unsigned int s);
-	unsigned int getInvolvedInPotCount(Pot *pot, std::vector<HandStrength> &wl);
 	
 	void scheduleState(State sched_state, unsigned int delay_sec);
 	
@@ -112,6 +124,20 @@ private:
 	BettingRound betround;
 	
 	Seat seats[10];
+	
+	//! \brief Seat state as bitmasks (bit n: seats[n]), kept in sync by the seat setters
+	unsigned int mask_occupied;
+	unsigned int mask_inround;
+	unsigned int mask_allin;    // occupied seats whose player has no stake left
+	unsigned int mask_sitout;   // occupied seats whose player sits out
+	
+#ifdef DEBUG
+	void checkSeatMasks() const;
+#endif
+	
+	//! \brief Game-wide number of the hand currently played at this table
+	unsigned int hand_no;
+	
 	int dealer, sb, bb;
 	int cur_player;
 	int last_bet_player;
@@ -119,6 +145,20 @@ private:
 	chips_type bet_amount;
 	chips_type last_bet_amount;
 	std::vector<Pot> pots;
+	
+	//! \brief Players moved here from other tables; seated at the next hand
+	std::vector<Player*> arriving;
+	
+	//! \brief Sequence number of the last table snapshot (0 if none yet)
+	unsigned int snap_seq;
+	//! \brief Last table snapshot; base of the next delta
+	wire_table_snap snap_last;
+	//! \brief Sequence number of the last snapshot each listener got (client-id)
+	std::map<int,unsigned int> snap_sent;
+	//! \brief Sequence number of the last snapshot flushed to spectators (0 if none yet)
+	unsigned int spec_seq;
+	//! \brief Last snapshot flushed to spectators; base of their next delta
+	wire_table_snap spec_last;
 };
 
 
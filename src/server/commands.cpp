@@ -0,0 +1,165 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstddef>
+#include <cstring>
+
+#include "Player.hpp"
+
+#include "commands.hpp"
+
+
+/* The tables below are indexed by keyword_hash(). The multipliers and the
+   mask of each table were found by brute-force search, so that no two
+   keywords of a table share a slot. When adding a keyword, search new
+   parameters and re-order the slots; keyword_table_check() verifies a table. */
+
+static inline unsigned int keyword_hash(const keyword_table &kt, const char *str, unsigned int len)
+{
+	return (len +
+		(unsigned char)str[0] * kt.mul_first +
+		(unsigned char)str[len / 2] * kt.mul_middle +
+		(unsigned char)str[len - 1] * kt.mul_last) & kt.mask;
+}
+
+static const keyword command_slots[32] = {
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "INFO",		CmdInfo },
+	{ NULL,		0 },
+	{ "CONFIG",		CmdConfig },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "REGISTER",		CmdRegister },
+	{ "AUTH",		CmdAuth },
+	{ "CHAT",		CmdChat },
+	{ "UNSUBSCRIBE",	CmdUnsubscribe },
+	{ "CREATE",		CmdCreate },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "REQUEST",		CmdRequest },
+	{ "QUIT",		CmdQuit },
+	{ NULL,		0 },
+	{ "ACTION",		CmdAction },
+	{ "PCLIENT",		CmdPclient },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "UNREGISTER",		CmdUnregister },
+	{ "SUBSCRIBE",		CmdSubscribe },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+};
+
+const keyword_table command_table = { 0, 5, 0, 31, command_slots };
+
+static const keyword request_slots[32] = {
+	{ "clientinfo",		RequestClientinfo },
+	{ NULL,		0 },
+	{ "snapshot",		RequestSnapshot },
+	{ "lobby",		RequestLobby },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "restart",		RequestRestart },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "clients",		RequestClients },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "start",		RequestStart },
+	{ "serverinfo",		RequestServerinfo },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "gamelist",		RequestGamelist },
+	{ "games",		RequestGames },
+	{ NULL,		0 },
+	{ NULL,		0 },
+	{ "gameinfo",		RequestGameinfo },
+	{ "playerstats",		RequestPlayerstats },
+	{ "playerlist",		RequestPlayerlist },
+	{ "leaderboard",		RequestLeaderboard },
+};
+
+const keyword_table request_table = { 0, 6, 2, 31, request_slots };
+
+static const keyword action_slots[16] = {
+	{ "allin",		Player::Allin },
+	{ "sitout",		Player::Sitout },
+	{ NULL,		0 },
+	{ "back",		Player::Back },
+	{ NULL,		0 },
+	{ "bet",		Player::Bet },
+	{ "fold",		Player::Fold },
+	{ NULL,		0 },
+	{ "show",		Player::Show },
+	{ NULL,		0 },
+	{ "raise",		Player::Raise },
+	{ "call",		Player::Call },
+	{ NULL,		0 },
+	{ "check",		Player::Check },
+	{ "muck",		Player::Muck },
+	{ "reset",		Player::ResetAction },
+};
+
+const keyword_table action_table = { 1, 4, 3, 15, action_slots };
+
+
+int keyword_lookup(const keyword_table &kt, const strview &sv, int notfound)
+{
+	if (!sv.len)
+		return notfound;
+	
+	const keyword *k = &(kt.slots[keyword_hash(kt, sv.str, sv.len)]);
+	
+	if (k->name && ViewTokenizer::equals(sv, k->name))
+		return k->value;
+	
+	return notfound;
+}
+
+bool keyword_table_check(const keyword_table &kt)
+{
+	for (unsigned int i=0; i <= kt.mask; i++)
+	{
+		const keyword *k = &(kt.slots[i]);
+		
+		if (k->name && keyword_hash(kt, k->name, strlen(k->name)) != i)
+			return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _COMMANDS_H
+#define _COMMANDS_H
+
+#include "ViewTokenizer.hpp"
+
+
+//! \brief Client commands
+typedef enum {
+	CmdUnknown = 0,
+	CmdPclient,
+	CmdInfo,
+	CmdChat,
+	CmdRequest,
+	CmdRegister,
+	CmdUnregister,
+	CmdSubscribe,
+	CmdUnsubscribe,
+	CmdAction,
+	CmdCreate,
+	CmdAuth,
+	CmdConfig,
+	CmdQuit
+} command_type;
+
+//! \brief Client request types (REQUEST <type>)
+typedef enum {
+	RequestUnknown = 0,
+	RequestClientinfo,
+	RequestGameinfo,
+	RequestGamelist,
+	RequestPlayerlist,
+	RequestServerinfo,
+	RequestStart,
+	RequestRestart,
+	RequestSnapshot,
+	RequestLobby,
+	RequestClients,
+	RequestGames,
+	RequestPlayerstats,
+	RequestLeaderboard
+} request_type;
+
+
+//! \brief Keyword and its associated value
+typedef struct {
+	const char	*name;
+	int		value;
+} keyword;
+
+//! \brief Collision-free (perfect) hash table of keywords
+typedef struct {
+	unsigned int	mul_first;
+	unsigned int	mul_middle;
+	unsigned int	mul_last;
+	unsigned int	mask;
+	const keyword	*slots;
+} keyword_table;
+
+extern const keyword_table command_table;
+extern const keyword_table request_table;
+extern const keyword_table action_table;
+
+int keyword_lookup(const keyword_table &kt, const strview &sv, int notfound);
+bool keyword_table_check(const keyword_table &kt);
+
+#endif /* _COMMANDS_H */
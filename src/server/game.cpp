@@ -24,16 +24,20 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <set>
 
 #include "Config.h"
 #include "Platform.h"
 #include "Network.h"
 #include "Debug.h"
 #include "Logger.h"
-#include "Tokenizer.hpp"
+#include "Trace.h"
+#include "ViewTokenizer.hpp"
+#include "WireProtocol.hpp"
 #include "ConfigParser.hpp"
 
 #include "game.hpp"
+#include "commands.hpp"
 #include "ranking.hpp"
 
 
@@ -55,8 +59,30 @@ static unsigned int cid_counter = 0;
 static clientconar_type con_archive;
 static time_t last_conarchive_cleanup = 0;   // last time scan
 
+static gameinfocache_type gameinfo_caches;
+
+static foyerevents_type foyer_events;   // joins/leaves since the last broadcast
+static set<int> foyer_arrivals;   // clients joined since; they get a presence snapshot
+static time_t last_foyer_update = 0;
+
+static lobbygames_type lobby_games;   // game-list state lobby subscribers have seen
+static time_t last_lobby_update = 0;
+static time_t last_lobby_stats = 0;
+static unsigned int lobby_clients_count = 0, lobby_games_count = 0;
+
 static server_stats stats;
 
+static handlog_writer *handlog = NULL;
+static time_t last_handlog_flush = 0;
+
+static time_t last_trace_flush = 0;
+
+static time_t last_ranking_flush = 0;
+
+static journal *game_journal = NULL;
+static unsigned long last_journal_commit = 0;   // sys_time_ms()
+static time_t last_journal_checkpoint = 0;
+
 
 
 GameController* get_game_by_id(int gid)
@@ -68,6 +94,48 @@ GameController* get_game_by_id(int gid)
 		return NULL;
 }
 
+// journal the complete state of a game; a new game or changed settings
+static void journal_game(const GameController *g)
+{
+	if (!game_journal)
+		return;
+	
+	vector<char> buf(16 * 1024);
+	wire_writer w;
+	
+	for (;;)
+	{
+		wire_writer_init(&w, &buf[0], buf.size());
+		wire_put_i32(&w, g->getGameId());
+		g->saveState(&w);
+		
+		if (!w.overflow)
+			break;
+		
+		buf.resize(buf.size() * 2);
+	}
+	
+	if (journal_append(game_journal, GameController::JournalGame, w.data, w.len) < 0)
+		log_error("journal", "error: journaling game %d failed", g->getGameId());
+}
+
+// journal a change of a game not made by the game itself
+static void journal_event(int type, int gid, int cid = -1, const char *uuid = "")
+{
+	if (!game_journal)
+		return;
+	
+	char buf[128];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	wire_put_i32(&w, gid);
+	wire_put_i32(&w, cid);
+	wire_put_string(&w, uuid, strlen(uuid));
+	
+	if (w.overflow || journal_append(game_journal, type, w.data, w.len) < 0)
+		log_error("journal", "error: journaling event of game %d failed", gid);
+}
+
 // for pserver.cpp filling FD_SET
 clients_type& get_client_vector()
 {
@@ -92,14 +160,11 @@ clientcon* get_client_by_id(int cid)
 	return NULL;
 }
 
-int send_msg(socktype sock, const char *message)
+// write to a socket without a client; the connection is closed anyway
+int send_raw(socktype sock, const char *buf, int len)
 {
-	char buf[MSG_BUFFER_SIZE];
-	const int len = snprintf(buf, sizeof(buf), "%s\r\n", message);
 	const int bytes = socket_write(sock, buf, len);
 	
-	// FIXME: send remaining bytes if not all have been sent
-	// FIXME: handle client-dead case
 	if (len != bytes)
 		dbg_msg("clientsock", "(%d) warning: not all bytes written (%d != %d).",
 			sock, len, bytes);
@@ -107,7 +172,195 @@ int send_msg(socktype sock, const char *message)
 	return bytes;
 }
 
-bool send_response(socktype sock, bool is_success, int last_msgid, int code=0, const char *str="")
+// send a text protocol line; used as long as no client is associated
+int send_line(socktype sock, const char *message)
+{
+	char buf[MSG_BUFFER_SIZE];
+	const int len = snprintf(buf, sizeof(buf), "%s\r\n", message);
+	
+	return send_raw(sock, buf, len);
+}
+
+static size_t sendbuf_max()
+{
+	const unsigned int max = (unsigned int) config.getInt("max_sendbuf_size");
+	
+	return (max < SERVER_SENDBUF_INITIAL || max > SERVER_SENDBUF_HARDLIMIT) ? SERVER_SENDBUF_HARDLIMIT : max;
+}
+
+/* Write to a client. Output the socket does not take is kept in the
+   send-buffer and written in order once the socket is writable; a stream
+   (compressed or framed) must never continue after a gap, so a client
+   whose output can't be kept is dropped. */
+static int client_write(clientcon *client, const char *buf, int len)
+{
+	int bytes = 0;
+	
+	if (client->state & Dropped)
+		return -1;
+	
+	// nothing may overtake pending output
+	if (!client->wbuf.len)
+	{
+		bytes = socket_write(client->sock, buf, len);
+		
+		if (bytes == len)
+			return len;
+		
+		if (bytes < 0)
+		{
+			if (!network_isinprogress())
+			{
+				client->state |= Dropped;
+				return -1;
+			}
+			
+			bytes = 0;
+		}
+	}
+	
+	if ((!client->wbuf.data && ringbuf_init(&client->wbuf, SERVER_SENDBUF_INITIAL, sendbuf_max())) ||
+		ringbuf_write(&client->wbuf, buf + bytes, len - bytes) != (size_t) (len - bytes))
+	{
+		log_warn("clientsock", "(%d) send-buffer limit exceeded; dropping client", client->sock);
+		client->state |= Dropped;
+		return -1;
+	}
+	
+	return len;
+}
+
+// the socket of a client is writable; returns -1 if the client is dropped
+int client_handle_write(socktype sock)
+{
+	clientcon *client = get_client_by_sock(sock);
+	if (!client)
+		return -1;
+	
+	ringbuffer *wb = &(client->wbuf);
+	
+	while (wb->len && !(client->state & Dropped))
+	{
+		// the stored bytes up to the end of the buffer
+		const size_t count = (wb->head + wb->len <= wb->size) ? wb->len : wb->size - wb->head;
+		const int bytes = socket_write(sock, wb->data + wb->head, count);
+		
+		if (bytes > 0)
+			ringbuf_consume(wb, bytes);
+		else if (bytes < 0 && network_isinprogress())
+			break;
+		else
+			client->state |= Dropped;
+	}
+	
+	return (client->state & Dropped) ? -1 : 0;
+}
+
+// data for compressing clients is queued until the end of the batch
+int send_data(clientcon *client, const char *buf, int len)
+{
+#ifndef NOZLIB
+	if (client->zout)
+		return zstream_append(client->zout, buf, len) ? -1 : len;
+#endif
+	
+	return client_write(client, buf, len);
+}
+
+int send_text(clientcon *client, const char *message)
+{
+	char buf[MSG_BUFFER_SIZE];
+	const int len = snprintf(buf, sizeof(buf), "%s\r\n", message);
+	
+	return send_data(client, buf, len);
+}
+
+int send_frame(clientcon *client, const wire_writer *w)
+{
+	if (w->overflow)
+	{
+		log_error("clientsock", "(%d) error: frame exceeds buffer size", client->sock);
+		return -1;
+	}
+	
+	return send_data(client, w->data, w->len);
+}
+
+#ifndef NOZLIB
+static int client_sink(void *arg, const char *buf, size_t len)
+{
+	clientcon *client = (clientcon*) arg;
+	
+	return client_write(client, buf, len);
+}
+#endif
+
+// compress and send the output queued for a client
+void client_flush(clientcon *client)
+{
+#ifndef NOZLIB
+	if (!client->zout || !zstream_pending(client->zout) || (client->state & Dropped))
+		return;
+	
+	const size_t raw = zstream_pending(client->zout);
+	const int bytes = zstream_flush(client->zout, client_sink, client);
+	
+	if (bytes == -1)
+	{
+		if (!(client->state & Dropped))
+			log_error("clientsock", "(%d) error: compression failed", client->sock);
+		
+		// the stream can't be continued
+		client->state |= Dropped;
+	}
+	else
+	{
+		stats.bytes_out_raw += raw;
+		stats.bytes_out_compressed += bytes;
+	}
+#endif
+}
+
+// end of a batch; called by the main loop before waiting for new input
+void clients_flush()
+{
+	for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
+		client_flush(&*e);
+}
+
+// close the clients whose output could not be sent
+void clients_drop()
+{
+	for (unsigned int i=0; i < clients.size();)
+	{
+		if (clients[i].state & Dropped)
+		{
+			log_info("clientsock", "(%d) socket closed (output lost)", clients[i].sock);
+			client_remove(clients[i].sock);
+		}
+		else
+			i++;
+	}
+}
+
+int send_msg(clientcon *client, const char *message)
+{
+	if (!client->wire_version)
+		return send_text(client, message);
+	
+	// messages without typed layout are wrapped into a text frame
+	char buf[MSG_BUFFER_SIZE];
+	wire_writer w;
+	
+	wire_writer_init(&w, buf, sizeof(buf));
+	const size_t frame = wire_frame_begin(&w, WireText);
+	wire_put_bytes(&w, message, strlen(message) + 1);
+	wire_frame_end(&w, frame);
+	
+	return send_frame(client, &w);
+}
+
+bool send_response(clientcon *client, bool is_success, int last_msgid, int code=0, const char *str="")
 {
 	char buf[512];
 	if (last_msgid == -1)
@@ -117,13 +370,13 @@ bool send_response(socktype sock, bool is_success, int last_msgid, int code=0, c
 		snprintf(buf, sizeof(buf), "%d %s %d %s",
 			  last_msgid, is_success ? "OK" : "ERR", code, str);
 	
-	return send_msg(sock, buf);
+	return send_msg(client, buf);
 }
 
 bool send_ok(clientcon *client, int code=0, const char *str="")
 {
 #if 0
-	return send_response(client->sock, true, client->last_msgid, code, str);
+	return send_response(client, true, client->last_msgid, code, str);
 #else
 	return true;
 #endif
@@ -131,29 +384,68 @@ bool send_ok(clientcon *client, int code=0, const char *str="")
 
 bool send_err(clientcon *client, int code=0, const char *str="")
 {
-	return send_response(client->sock, false, client->last_msgid, code, str);
+	return send_response(client, false, client->last_msgid, code, str);
+}
+
+//! \brief Chat message encoded for both protocols; built once, sent to many clients
+typedef struct {
+	char line[256];
+	char frame[256 + 64];
+	wire_writer w;
+} chatmsg;
+
+static void chatmsg_encode(chatmsg *cm, wire_msg *m)
+{
+	char *p = cm->line;
+	p += snprintf(cm->line, sizeof(cm->line), "MSG ");
+	wire_format_msg(m, p, sizeof(cm->line) - (p - cm->line));
+	
+	// keep the binary frame within the same limits as the text line
+	if (m->text.len > sizeof(cm->line))
+		m->text.len = sizeof(cm->line);
+	
+	wire_writer_init(&cm->w, cm->frame, sizeof(cm->frame));
+	const size_t frame = wire_frame_begin(&cm->w, WireMsg);
+	wire_encode_msg(&cm->w, m);
+	wire_frame_end(&cm->w, frame);
+}
+
+static void chatmsg_send(clientcon *client, const chatmsg *cm)
+{
+	if (client->wire_version)
+		send_frame(client, &cm->w);
+	else
+		send_text(client, cm->line);
+}
+
+static strview make_view(const char *str)
+{
+	const strview sv = { str, (unsigned int) strlen(str) };
+	return sv;
 }
 
 // from client/foyer to client/foyer
 bool client_chat(int from, int to, const char *message)
 {
-	char msg[256];
+	chatmsg cm;
+	wire_msg m;
+	
+	m.gid = -1;
+	m.tid = -1;
+	m.cid = from;
+	m.text = make_view(message);
 	
 	if (from == -1)
-	{
-		snprintf(msg, sizeof(msg), "MSG %d %s %s",
-			from, "foyer", message);
-	}
+		m.name = make_view("foyer");
 	else
 	{
 		clientcon* fromclient = get_client_by_id(from);
 		
-		snprintf(msg, sizeof(msg), "MSG %d \"%s\" %s",
-			from,
-			(fromclient) ? fromclient->info.name : "???",
-			message);
+		m.name = make_view((fromclient) ? fromclient->info.name : "???");
 	}
 	
+	chatmsg_encode(&cm, &m);
+	
 	if (to == -1)
 	{
 		for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
@@ -161,14 +453,14 @@ bool client_chat(int from, int to, const char *message)
 			if (!(e->state & Introduced))  // do not send broadcast to non-introduced clients
 				continue;
 			
-			send_msg(e->sock, msg);
+			chatmsg_send(&(*e), &cm);
 		}
 	}
 	else
 	{
 		clientcon* toclient = get_client_by_id(to);
 		if (toclient)
-			send_msg(toclient->sock, msg);
+			chatmsg_send(toclient, &cm);
 		else
 			return false;
 	}
@@ -179,14 +471,21 @@ bool client_chat(int from, int to, const char *message)
 // from game/table to client
 bool client_chat(int from_gid, int from_tid, int to, const char *message)
 {
-	char msg[256];
+	clientcon* toclient = get_client_by_id(to);
+	if (!toclient)
+		return true;
 	
-	snprintf(msg, sizeof(msg), "MSG %d:%d %s %s",
-		from_gid, from_tid, (from_tid == -1) ? "game" : "table", message);
+	chatmsg cm;
+	wire_msg m;
 	
-	clientcon* toclient = get_client_by_id(to);
-	if (toclient)
-		send_msg(toclient->sock, msg);
+	m.gid = from_gid;
+	m.tid = from_tid;
+	m.cid = -1;
+	m.name = make_view((from_tid == -1) ? "game" : "table");
+	m.text = make_view(message);
+	
+	chatmsg_encode(&cm, &m);
+	chatmsg_send(toclient, &cm);
 	
 	return true;
 }
@@ -194,41 +493,185 @@ bool client_chat(int from_gid, int from_tid, int to, const char *message)
 // from client to game/table
 bool table_chat(int from_cid, int to_gid, int to_tid, const char *message)
 {
-	char msg[256];
-	
 	clientcon* fromclient = get_client_by_id(from_cid);
 	
 	GameController *g = get_game_by_id(to_gid);
 	if (!g)
 		return false;
 	
+	chatmsg cm;
+	wire_msg m;
+	
+	m.gid = to_gid;
+	m.tid = to_tid;
+	m.cid = from_cid;
+	m.name = make_view((fromclient) ? fromclient->info.name : "???");
+	m.text = make_view(message);
+	
+	chatmsg_encode(&cm, &m);
+	
 	vector<int> client_list;
 	g->getListenerList(client_list);
 	
 	for (unsigned int i=0; i < client_list.size(); i++)
 	{
-		snprintf(msg, sizeof(msg), "MSG %d:%d:%d \"%s\" %s",
-			to_gid, to_tid, from_cid,
-			(fromclient) ? fromclient->info.name : "???",
-			message);
-		
 		clientcon* toclient = get_client_by_id(client_list[i]);
 		if (toclient)
-			send_msg(toclient->sock, msg);
+			chatmsg_send(toclient, &cm);
 	}
 	
 	return true;
 }
 
-bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *message)
+// binary encoding of the most recent snapshot; a snapshot is usually
+// sent to all listeners of a table in a row and is encoded only once
+static struct {
+	int gid, tid, sid;
+	char message[MSG_BUFFER_SIZE];
+	char frame[MSG_BUFFER_SIZE];
+	wire_writer w;
+} snapcache;
+
+static const wire_writer* snapshot_frame(int gid, int tid, int sid, const char *message)
 {
-	char buf[MSG_BUFFER_SIZE];
-	snprintf(buf, sizeof(buf), "SNAP %d:%d %d %s",
-		from_gid, from_tid, sid, message);
+	if (snapcache.w.data && snapcache.gid == gid && snapcache.tid == tid &&
+		snapcache.sid == sid && !strcmp(snapcache.message, message))
+	{
+		return &snapcache.w;
+	}
+	
+	snapcache.gid = gid;
+	snapcache.tid = tid;
+	snapcache.sid = sid;
+	snprintf(snapcache.message, sizeof(snapcache.message), "%s", message);
+	
+	wire_writer *w = &snapcache.w;
+	wire_writer_init(w, snapcache.frame, sizeof(snapcache.frame));
+	
+	const size_t frame = wire_frame_begin(w, WireSnap);
+	wire_put_var(w, gid);
+	wire_put_var(w, tid);
+	wire_put_u8(w, sid);
+	
+	wire_fields f;
+	if (!wire_parse_fields(message, strlen(message), &f))
+		w->overflow = 1;
+	wire_encode_fields(w, &f);
+	
+	wire_frame_end(w, frame);
+	
+	return w;
+}
+
+// binary encodings of the most recent table snapshot; listeners being in sync
+// with the base snapshot get the delta, all others the full snapshot
+static struct {
+	int gid, tid;
+	unsigned int seq;
+	unsigned int base_seq;
+	char frame[2][MSG_BUFFER_SIZE];
+	wire_writer w[2];
+	char text[MSG_BUFFER_SIZE];
+} tablecache;
+
+static void tablecache_select(int gid, int tid, unsigned int seq)
+{
+	if (tablecache.gid == gid && tablecache.tid == tid && tablecache.seq == seq)
+		return;
+	
+	tablecache.gid = gid;
+	tablecache.tid = tid;
+	tablecache.seq = seq;
+	tablecache.w[0].data = tablecache.w[1].data = NULL;
+	tablecache.text[0] = '\0';
+}
+
+static const wire_writer* table_snapshot_frame(int gid, int tid, unsigned int seq,
+	const wire_table_snap *ts, const wire_table_snap *base, unsigned int base_seq)
+{
+	tablecache_select(gid, tid, seq);
 	
+	// spectators may get a delta against an older snapshot than players
+	if (base && tablecache.base_seq != base_seq)
+	{
+		tablecache.w[1].data = NULL;
+		tablecache.base_seq = base_seq;
+	}
+	
+	wire_writer *w = &(tablecache.w[base ? 1 : 0]);
+	if (w->data)
+		return w;
+	
+	wire_writer_init(w, tablecache.frame[base ? 1 : 0], sizeof(tablecache.frame[0]));
+	
+	const size_t frame = wire_frame_begin(w, WireSnap);
+	wire_put_var(w, gid);
+	wire_put_var(w, tid);
+	wire_put_u8(w, SnapTable);
+	
+	// sequence number and the one the delta is based on (0 for full snapshot)
+	wire_put_uvar(w, seq);
+	
+	if (base)
+	{
+		wire_put_uvar(w, base_seq);
+		wire_encode_table_delta(w, base, ts);
+	}
+	else
+	{
+		wire_put_uvar(w, 0);
+		wire_encode_table_snap(w, ts);
+	}
+	
+	wire_frame_end(w, frame);
+	
+	return w;
+}
+
+bool client_snapshot_table(int from_gid, int from_tid, int to, unsigned int seq,
+	const wire_table_snap *ts, const wire_table_snap *base, unsigned int base_seq)
+{
+	clientcon* toclient = get_client_by_id(to);
+	if (!toclient || !(toclient->state & Introduced))
+		return false;
+	
+	if (toclient->wire_version)
+		send_frame(toclient, table_snapshot_frame(from_gid, from_tid, seq, ts, base, base_seq));
+	else
+	{
+		// text clients always get the full snapshot
+		tablecache_select(from_gid, from_tid, seq);
+		
+		if (!tablecache.text[0])
+		{
+			const int len = snprintf(tablecache.text, sizeof(tablecache.text), "SNAP %d:%d %d ",
+				from_gid, from_tid, SnapTable);
+			
+			wire_format_table_snap(ts, tablecache.text + len, sizeof(tablecache.text) - len);
+		}
+		
+		send_text(toclient, tablecache.text);
+	}
+	
+	return true;
+}
+
+bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *message)
+{
 	clientcon* toclient = get_client_by_id(to);
-	if (toclient && toclient->state & Introduced)
-		send_msg(toclient->sock, buf);
+	if (!toclient || !(toclient->state & Introduced))
+		return true;
+	
+	if (toclient->wire_version)
+		send_frame(toclient, snapshot_frame(from_gid, from_tid, sid, message));
+	else
+	{
+		char buf[MSG_BUFFER_SIZE];
+		snprintf(buf, sizeof(buf), "SNAP %d:%d %d %s",
+			from_gid, from_tid, sid, message);
+		
+		send_text(toclient, buf);
+	}
 	
 	return true;
 }
@@ -246,12 +689,140 @@ bool client_snapshot(int to, int sid, const char *message)
 	return true;
 }
 
+static void foyer_join(const clientcon *client)
+{
+	foyer_event ev;
+	ev.type = SnapFoyerJoin;
+	ev.cid = client->id;
+	snprintf(ev.name, sizeof(ev.name), "%s", client->info.name);
+	
+	foyer_events.push_back(ev);
+	foyer_arrivals.insert(client->id);
+}
+
+static void foyer_leave(const clientcon *client)
+{
+	// a join nobody has seen yet is simply dropped
+	if (foyer_arrivals.erase(client->id))
+	{
+		for (foyerevents_type::iterator e = foyer_events.begin(); e != foyer_events.end(); e++)
+		{
+			if (e->type == SnapFoyerJoin && e->cid == client->id)
+			{
+				foyer_events.erase(e);
+				return;
+			}
+		}
+	}
+	
+	foyer_event ev;
+	ev.type = SnapFoyerLeave;
+	ev.cid = client->id;
+	snprintf(ev.name, sizeof(ev.name), "%s", client->info.name);
+	
+	foyer_events.push_back(ev);
+}
+
+// format the events as SNAP messages with up to per_message events each;
+// appended to out as text lines or frames
+static void foyer_format(const foyerevents_type &events, unsigned int per_message,
+	bool binary, string &out)
+{
+	for (unsigned int i=0; i < events.size(); i += per_message)
+	{
+		string args;
+		for (unsigned int j=i; j < events.size() && j < i + per_message; j++)
+		{
+			snprintf(msg, sizeof(msg), "%s%d %d \"%s\"",
+				(j == i) ? "" : " ",
+				events[j].type, events[j].cid, events[j].name);
+			args += msg;
+		}
+		
+		if (binary)
+		{
+			const wire_writer *w = snapshot_frame(-1, -1, SnapFoyer, args.c_str());
+			if (!w->overflow)
+				out.append(w->data, w->len);
+		}
+		else
+		{
+			snprintf(msg, sizeof(msg), "SNAP %d:%d %d %s\r\n",
+				-1, -1, SnapFoyer, args.c_str());
+			out += msg;
+		}
+	}
+}
+
+// broadcast the foyer joins/leaves collected since the last run; clients
+// joined meanwhile get a snapshot of all present clients instead
+static void foyer_update()
+{
+	if (foyer_events.empty() && foyer_arrivals.empty())
+		return;
+	
+	const time_t now = time(NULL);
+	if ((unsigned int) difftime(now, last_foyer_update) < (unsigned int) config.getInt("foyer_interval"))
+		return;
+	
+	last_foyer_update = now;
+	
+	
+	// a binary snapshot carries at most WIRE_MAX_FIELDS fields
+	const unsigned int per_frame = WIRE_MAX_FIELDS / 3;
+	const unsigned int per_line = 256;
+	
+	string events_text, events_frames;
+	foyer_format(foyer_events, per_line, false, events_text);
+	foyer_format(foyer_events, per_frame, true, events_frames);
+	
+	string present_text, present_frames;
+	if (!foyer_arrivals.empty())
+	{
+		foyerevents_type present;
+		for (clients_type::const_iterator e = clients.begin(); e != clients.end(); e++)
+		{
+			if (!(e->state & SentInfo))
+				continue;
+			
+			foyer_event ev;
+			ev.type = SnapFoyerPresent;
+			ev.cid = e->id;
+			snprintf(ev.name, sizeof(ev.name), "%s", e->info.name);
+			present.push_back(ev);
+		}
+		
+		foyer_format(present, per_line, false, present_text);
+		foyer_format(present, per_frame, true, present_frames);
+	}
+	
+	for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
+	{
+		clientcon *client = &*e;
+		
+		if (!(client->state & Introduced))  // do not send broadcast to non-introduced clients
+			continue;
+		
+		const bool arrived = foyer_arrivals.count(client->id);
+		const string &out = arrived ?
+			(client->wire_version ? present_frames : present_text) :
+			(client->wire_version ? events_frames : events_text);
+		
+		if (out.length())
+			send_data(client, out.data(), out.length());
+	}
+	
+	foyer_events.clear();
+	foyer_arrivals.clear();
+}
+
 bool client_add(socktype sock, sockaddr_in *saddr)
 {
 	// drop client if maximum connection count is reached
 	if (clients.size() == SERVER_CLIENT_HARDLIMIT || clients.size() == (unsigned int) config.getInt("max_clients"))
 	{
-		send_response(sock, false, -1, ErrServerFull, "server full");
+		snprintf(msg, sizeof(msg), "ERR %d %s", ErrServerFull, "server full");
+		send_line(sock, msg);
 		socket_close(sock);
 		
 		return false;
@@ -270,7 +841,9 @@ bool client_add(socktype sock, sockaddr_in *saddr)
 			{
 				if (++connection_count == connection_max)
 				{
-					send_response(sock, false, -1, ErrMaxConnectionsPerIP, "connection limit per IP is reached");
+					snprintf(msg, sizeof(msg), "ERR %d %s",
+						ErrMaxConnectionsPerIP, "connection limit per IP is reached");
+					send_line(sock, msg);
 					socket_close(sock);
 					
 					return false;
@@ -286,13 +859,26 @@ bool client_add(socktype sock, sockaddr_in *saddr)
 	client.saddr = *saddr;
 	client.id = -1;
 	
-	// set initial state
-	client.state |= Connected;
-	
-	clients.push_back(client);
-	
+	// receive-buffer grows on demand up to the configured limit
+	unsigned int recvbuf_max = (unsigned int) config.getInt("max_recvbuf_size");
+	if (recvbuf_max < SERVER_RECVBUF_INITIAL || recvbuf_max > SERVER_RECVBUF_HARDLIMIT)
+		recvbuf_max = SERVER_RECVBUF_HARDLIMIT;
 	
-	// update stats
+	if (ringbuf_init(&client.rbuf, SERVER_RECVBUF_INITIAL, recvbuf_max))
+	{
+		log_error("clientsock", "(%d) error: cannot allocate receive-buffer", sock);
+		socket_close(sock);
+		
+		return false;
+	}
+	
+	// set initial state
+	client.state |= Connected;
+	
+	clients.push_back(client);
+	
+	
+	// update stats
 	stats.clients_connected++;
 	
 	return true;
@@ -304,9 +890,12 @@ bool client_remove(socktype sock)
 	{
 		if (client->sock == sock)
 		{
+			// send out queued messages, e.g. a final error response
+			client_flush(&*client);
+			client_handle_write(client->sock);
+			
 			socket_close(client->sock);
 			
-			bool send_msg = false;
 			if (client->state & SentInfo)
 			{
 				// remove player from unstarted games
@@ -314,15 +903,15 @@ bool client_remove(socktype sock)
 				{
 					GameController *g = e->second;
 					if (!g->isStarted() && g->isPlayer(client->id))
+					{
 						g->removePlayer(client->id);
+						journal_event(GameController::JournalUnregister, e->first, client->id);
+					}
 				}
 				
 				
-				snprintf(msg, sizeof(msg),
-					"%d %d \"%s\"",
-					SnapFoyerLeave, client->id, client->info.name);
-				
-				send_msg = true;
+				// announce to all remaining clients with the next foyer update
+				foyer_leave(&*client);
 				
 				// save client-con in archive
 				string uuid = client->uuid;
@@ -334,14 +923,16 @@ bool client_remove(socktype sock)
 				}
 			}
 			
-			log_msg("clientsock", "(%d) connection closed", client->sock);
+			log_info("clientsock", "(%d) connection closed", client->sock);
 			
+			ringbuf_free(&client->rbuf);
+			ringbuf_free(&client->wbuf);
+#ifndef NOZLIB
+			zstream_destroy(client->zout);
+			zstream_destroy(client->zin);
+#endif
 			clients.erase(client);
 			
-			// send foyer snapshot to all remaining clients
-			if (send_msg)
-				client_snapshot(-1, SnapFoyer, msg);
-			
 			break;
 		}
 	}
@@ -349,21 +940,34 @@ bool client_remove(socktype sock)
 	return true;
 }
 
-int client_cmd_pclient(clientcon *client, Tokenizer &t)
+int client_cmd_pclient(clientcon *client, ViewTokenizer &t)
 {
 	unsigned int version = t.getNextInt();
-	string uuid = t.getNext();
+	
+	// optional arguments: uuid, supported binary protocol version and compression
+	strview uuid = { "", 0 }, arg;
+	unsigned int wire_version = 0;
+	bool deflate = false;
+	
+	while (t.getNext(arg))
+	{
+		if (ViewTokenizer::equals(arg, "deflate"))
+			deflate = true;
+		else if (!wire_parse_version(arg, &wire_version) && !uuid.len)
+			uuid = arg;
+	}
 	
 	if (version < VERSION_COMPAT)
 	{
-		log_msg("client", "client %d version (%d) too old", client->sock, version);
+		log_info("client", "client %d version (%d) too old", client->sock, version);
 		send_err(client, ErrWrongVersion, "The client version is too old."
 			"Please update your HoldingNuts client to a more recent version.");
-		client_remove(client->sock);
-		
 		
 		// update stats
 		stats.clients_incompatible++;
+		
+		// let the caller drop the connection
+		return -1;
 	}
 	else
 	{
@@ -378,15 +982,15 @@ int client_cmd_pclient(clientcon *client, Tokenizer &t)
 		stats.clients_introduced++;
 		
 		
-		snprintf(client->uuid, sizeof(client->uuid), "%s", uuid.c_str());
+		snprintf(client->uuid, sizeof(client->uuid), "%.*s", (int) uuid.len, uuid.str);
 		
 		// re-assign cid if this client was previously connected (and cid isn't already connected)
 		bool use_prev_cid = false;
 		bool uuid_inuse = false;
 		
-		if (uuid.length())
+		if (*client->uuid)
 		{
-			clientconar_type::iterator it = con_archive.find(uuid);
+			clientconar_type::iterator it = con_archive.find(client->uuid);
 			
 			if (it != con_archive.end())
 			{
@@ -396,17 +1000,17 @@ int client_cmd_pclient(clientcon *client, Tokenizer &t)
 					client->id = it->second.id;
 					use_prev_cid = true;
 					
-					log_msg("uuid", "(%d) using previous cid (%d) for uuid '%s'", client->sock, client->id, client->uuid);
+					log_info("uuid", "(%d) using previous cid (%d) for uuid '%s'", client->sock, client->id, client->uuid);
 				}
 				else
 				{
-					log_msg("uuid", "(%d) uuid '%s' already connected; used by cid %d", client->sock, client->uuid, conc->id);
+					log_info("uuid", "(%d) uuid '%s' already connected; used by cid %d", client->sock, client->uuid, conc->id);
 					client->uuid[0] = '\0';    // client is not allowed to use this uuid
 					uuid_inuse = true;
 				}
 			}
 			else
-				log_msg("uuid", "(%d) reserving uuid '%s'", client->sock, client->uuid);
+				log_info("uuid", "(%d) reserving uuid '%s'", client->sock, client->uuid);
 		}
 		
 		if (!use_prev_cid)
@@ -417,13 +1021,45 @@ int client_cmd_pclient(clientcon *client, Tokenizer &t)
 		snprintf(client->info.name, sizeof(client->info.name), "client_%d", client->id);
 		*(client->info.location) = '\0';
 		
-		// send 'introduced response'
-		snprintf(msg, sizeof(msg), "PSERVER %d %d %d",
+		// use binary protocol from now on if both sides support it
+		if (wire_version && config.getBool("binary_protocol"))
+			client->wire_version = (wire_version < WIRE_PROTOCOL_VERSION) ? wire_version : WIRE_PROTOCOL_VERSION;
+		
+#ifndef NOZLIB
+		deflate = deflate && config.getBool("compression");
+#else
+		deflate = false;
+#endif
+		
+		// send 'introduced response'; always as uncompressed text line
+		int len = snprintf(msg, sizeof(msg), "PSERVER %d %d %d",
 			VERSION,
 			client->id,
 			(unsigned int) time(NULL));
+		
+		if (client->wire_version)
+			len += snprintf(msg + len, sizeof(msg) - len, " binary:%d", client->wire_version);
+		
+		if (deflate)
+			snprintf(msg + len, sizeof(msg) - len, " deflate");
+		
+		send_text(client, msg);
+		
+#ifndef NOZLIB
+		// everything following PSERVER is compressed (in both directions)
+		if (deflate)
+		{
+			client->zout = zstream_deflate_create(config.getInt("compression_level"),
+				config.getInt("compression_min_size"));
+			client->zin = zstream_inflate_create();
 			
-		send_msg(client->sock, msg);
+			if (!client->zout || !client->zin)
+			{
+				log_error("clientsock", "(%d) error: cannot initialize compression", client->sock);
+				return -1;
+			}
+		}
+#endif
 		
 		
 		// send warning if UUID is already in use
@@ -434,28 +1070,28 @@ int client_cmd_pclient(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_info(clientcon *client, Tokenizer &t)
+int client_cmd_info(clientcon *client, ViewTokenizer &t)
 {
-	string infostr;
-	Tokenizer it(":");
+	strview infostr;
+	ViewTokenizer it(":");
 	
 	while (t.getNext(infostr))
 	{
 		it.parse(infostr);
 		
-		string infotype, infoarg;
+		strview infotype, infoarg;
 		it.getNext(infotype);
 		
 		bool havearg = it.getNext(infoarg);
 		
-		if (infotype == "name" && havearg)
+		if (ViewTokenizer::equals(infotype, "name") && havearg)
 		{
 			// allow name-change only once per session
 			if (!(client->state & SentInfo))
-				snprintf(client->info.name, sizeof(client->info.name), "%s", infoarg.c_str());
+				snprintf(client->info.name, sizeof(client->info.name), "%.*s", (int) infoarg.len, infoarg.str);
 		}
-		else if (infotype == "location" && havearg)
-			snprintf(client->info.location, sizeof(client->info.location), "%s", infoarg.c_str());
+		else if (ViewTokenizer::equals(infotype, "location") && havearg)
+			snprintf(client->info.location, sizeof(client->info.location), "%.*s", (int) infoarg.len, infoarg.str);
 	}
 	
 	send_ok(client);
@@ -484,12 +1120,8 @@ int client_cmd_info(clientcon *client, Tokenizer &t)
 		}
 		
 		
-		// send foyer snapshot broadcast
-		snprintf(msg, sizeof(msg),
-			"%d %d \"%s\"",
-			SnapFoyerJoin, client->id, client->info.name);
-		
-		client_snapshot(-1, SnapFoyer, msg);
+		// announce with the next foyer update
+		foyer_join(client);
 	}
 	
 	client->state |= SentInfo;
@@ -497,7 +1129,7 @@ int client_cmd_info(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_chat(clientcon *client, Tokenizer &t)
+int client_cmd_chat(clientcon *client, ViewTokenizer &t)
 {
 	bool cmderr = false;
 	
@@ -525,7 +1157,7 @@ int client_cmd_chat(clientcon *client, Tokenizer &t)
 		// is client flooding?
 		if (++client->chat_count >= (unsigned int) config.getInt("flood_chat_per_interval"))
 		{
-			log_msg("flooding", "client (%d) caught flooding the chat", client->id);
+			log_warn("flooding", "client (%d) caught flooding the chat", client->id);
 			
 			// mute client for n-seconds
 			client->last_chat = time(NULL) + config.getInt("flood_chat_mute");
@@ -536,9 +1168,11 @@ int client_cmd_chat(clientcon *client, Tokenizer &t)
 		}
 		
 		
-		Tokenizer ct(":");
+		ViewTokenizer ct(":");
 		ct.parse(t.getNext());
-		string chatmsg = t.getTillEnd();
+		
+		// the text as separate tokens, quotes removed and joined by single blanks
+		const string chatmsg = t.getTokensTillEnd();
 		
 		if (ct.count() == 1) // cid
 		{
@@ -566,11 +1200,40 @@ int client_cmd_chat(clientcon *client, Tokenizer &t)
 }
 
 
-bool send_gameinfo(clientcon *client, int gid)
+// record a new game for replays (holdingnuts-replay)
+static void game_record(GameController *g)
 {
-	const GameController *g;
-	if (!(g = get_game_by_id(gid)))
-		return false;
+	if (!config.getBool("record_games"))
+		return;
+	
+	char filename[1024];
+	snprintf(filename, sizeof(filename), "%s/records", sys_config_path());
+	sys_mkdir(filename);
+	
+	snprintf(filename, sizeof(filename), "%s/records/game-%d-%ld.hnr",
+		sys_config_path(), g->getGameId(), (long) time(NULL));
+	
+	if (!g->recordTo(filename))
+		log_error("record", "error: cannot record game %d into %s", g->getGameId(), filename);
+}
+
+static int get_game_state(const GameController *g)
+{
+	if (g->isEnded())
+		return GameStateEnded;
+	else if (g->isStarted())
+		return GameStateStarted;
+	else
+		return GameStateWaiting;
+}
+
+// the cache is rebuilt only if the game info has changed since
+static const gameinfo_cache* get_gameinfo_cache(int gid, const GameController *g)
+{
+	gameinfo_cache &cache = gameinfo_caches[gid];
+	
+	if (cache.revision && cache.revision == g->getInfoRevision())
+		return &cache;
 	
 	int game_mode = 0;
 	switch ((int)g->getGameType())
@@ -586,57 +1249,197 @@ bool send_gameinfo(clientcon *client, int gid)
 		break;
 	}
 	
-	int state = 0;
-	if (g->isEnded())
-		state = GameStateEnded;
-	else if (g->isStarted())
-		state = GameStateStarted;
-	else
-		state = GameStateWaiting;
+	wire_gameinfo gi;
+	gi.gid = gid;
+	gi.type = GameTypeHoldem;
+	gi.mode = game_mode;
+	gi.state = get_game_state(g);
+	gi.flags = (g->hasPassword() ? GameInfoPassword : 0) |
+		(g->getRestart() ? GameInfoRestart : 0);
+	gi.players_max = g->getPlayerMax();
+	gi.players_count = g->getPlayerCount();
+	gi.timeout = g->getPlayerTimeout();
+	gi.stakes = g->getPlayerStakes();
+	gi.blinds_start = g->getBlindsStart();
+	gi.blinds_factor = g->getBlindsFactor();
+	gi.blinds_time = g->getBlindsTime();
+	gi.name.str = g->getName().c_str();
+	gi.name.len = g->getName().length();
+	
+	cache.revision = g->getInfoRevision();
+	cache.flags = gi.flags;
+	
+	int len = snprintf(msg, sizeof(msg), "GAMEINFO ");
+	wire_format_gameinfo_head(&gi, msg + len, sizeof(msg) - len);
+	cache.text_head = msg;
+	
+	wire_format_gameinfo_tail(&gi, msg, sizeof(msg));
+	cache.text_tail = msg;
+	
+	wire_writer w;
+	wire_writer_init(&w, msg, sizeof(msg));
+	wire_encode_gameinfo_head(&w, &gi);
+	cache.wire_head.assign(w.data, w.len);
+	
+	wire_writer_init(&w, msg, sizeof(msg));
+	wire_encode_gameinfo_tail(&w, &gi);
+	cache.wire_tail.assign(w.data, w.len);
+	
+	return &cache;
+}
+
+// append the game info message (text line or frame) to out; records of a
+// bulk response are appended without frame header
+static bool gameinfo_append(const clientcon *client, int gid, string &out, bool record = false)
+{
+	const GameController *g;
+	if (!(g = get_game_by_id(gid)))
+		return false;
 	
-	snprintf(msg, sizeof(msg),
-		"GAMEINFO %d %d:%d:%d:%d:%d:%d:%d:%d %d:%d:%d \"%s\"",
-		gid,
-		(int) GameTypeHoldem,
-		game_mode,
-		state,
+	const gameinfo_cache *cache = get_gameinfo_cache(gid, g);
+	
+	const unsigned int flags = cache->flags |
 		(g->isPlayer(client->id) ? GameInfoRegistered : 0) |
-			(g->isSpectator(client->id) ? GameInfoSubscribed : 0) |
-			(g->hasPassword() ? GameInfoPassword : 0) |
-			(g->getOwner() == client->id ? GameInfoOwner : 0) |
-			(g->getRestart() ? GameInfoRestart : 0),
-		g->getPlayerMax(),
-		g->getPlayerCount(),
-		g->getPlayerTimeout(),
-		g->getPlayerStakes(),
-		g->getBlindsStart(),
-		g->getBlindsFactor(),
-		g->getBlindsTime(),
-		g->getName().c_str());
-	
-	send_msg(client->sock, msg);
+		(g->isSpectator(client->id) ? GameInfoSubscribed : 0) |
+		(g->getOwner() == client->id ? GameInfoOwner : 0);
+	
+	if (client->wire_version)
+	{
+		wire_writer w;
+		wire_writer_init(&w, msg, sizeof(msg));
+		
+		const size_t frame = record ? 0 : wire_frame_begin(&w, WireGameinfo);
+		wire_put_bytes(&w, cache->wire_head.data(), cache->wire_head.length());
+		wire_put_uvar(&w, flags);
+		wire_put_bytes(&w, cache->wire_tail.data(), cache->wire_tail.length());
+		if (!record)
+			wire_frame_end(&w, frame);
+		
+		if (w.overflow)
+			return false;
+		
+		out.append(w.data, w.len);
+	}
+	else
+	{
+		char sflags[16];
+		snprintf(sflags, sizeof(sflags), "%d", flags);
+		
+		out += cache->text_head;
+		out += sflags;
+		out += cache->text_tail;
+		out += "\r\n";
+	}
+	
+	return true;
+}
+
+bool send_gameinfo(clientcon *client, int gid)
+{
+	string out;
+	if (!gameinfo_append(client, gid, out))
+		return false;
+	
+	send_data(client, out.data(), out.length());
+	
+	return true;
+}
+
+bool client_cmd_request_gameinfo(clientcon *client, ViewTokenizer &t)
+{
+	// all infos are collected and sent at once
+	string out;
+	
+	const unsigned int max_records = config.getInt("max_request_records");
+	
+	strview sgid;
+	for (unsigned int i=0; i < max_records && t.getNext(sgid); i++)
+	{
+		const int gid = ViewTokenizer::view2int(sgid);
+		gameinfo_append(client, gid, out);
+	}
+	
+	if (out.length())
+		send_data(client, out.data(), out.length());
 	
 	return true;
 }
 
-bool client_cmd_request_gameinfo(clientcon *client, Tokenizer &t)
+// append the client info record of a bulk response to out
+static bool clientinfo_append(const clientcon *client, int cid, string &out)
 {
-	string sgid;
-	while (t.getNext(sgid))   // FIXME: have maximum for count of requests
+	const clientcon *c;
+	if (!(c = get_client_by_id(cid)))
+		return false;
+	
+	wire_clientinfo ci;
+	ci.cid = cid;
+	ci.name = make_view(c->info.name);
+	ci.location = make_view(c->info.location);
+	
+	if (client->wire_version)
+	{
+		wire_writer w;
+		wire_writer_init(&w, msg, sizeof(msg));
+		wire_encode_clientinfo(&w, &ci);
+		
+		out.append(w.data, w.len);
+	}
+	else
 	{
-		const int gid = Tokenizer::string2int(sgid);
-		send_gameinfo(client, gid);
+		const int len = snprintf(msg, sizeof(msg), "CLIENTINFO ");
+		wire_format_clientinfo(&ci, msg + len, sizeof(msg) - len);
+		
+		out += msg;
+		out += "\r\n";
 	}
 	
 	return true;
 }
 
-bool client_cmd_request_clientinfo(clientcon *client, Tokenizer &t)
+// bulk response: 'RECORDS <type> <count> <omitted>' followed by the records
+// (text), or a single WireRecords frame (binary)
+static void send_records(clientcon *client, int type, unsigned int count,
+	unsigned int omitted, const string &records)
+{
+	if (client->wire_version)
+	{
+		vector<char> buf(records.length() + 32);
+		
+		wire_writer w;
+		wire_writer_init(&w, &buf[0], buf.size());
+		
+		const size_t frame = wire_frame_begin(&w, WireRecords);
+		wire_put_u8(&w, type);
+		wire_put_uvar(&w, count);
+		wire_put_uvar(&w, omitted);
+		wire_put_bytes(&w, records.data(), records.length());
+		wire_frame_end(&w, frame);
+		
+		send_frame(client, &w);
+	}
+	else
+	{
+		string out;
+		snprintf(msg, sizeof(msg), "RECORDS %s %d %d\r\n",
+			(type == WireGameinfo) ? "gameinfo" : "clientinfo",
+			count, omitted);
+		
+		out = msg;
+		out += records;
+		
+		send_data(client, out.data(), out.length());
+	}
+}
+
+bool client_cmd_request_clientinfo(clientcon *client, ViewTokenizer &t)
 {
-	string scid;
-	while (t.getNext(scid))   // FIXME: have maximum for count of requests
+	const unsigned int max_records = config.getInt("max_request_records");
+	
+	strview scid;
+	for (unsigned int i=0; i < max_records && t.getNext(scid); i++)
 	{
-		const socktype cid = Tokenizer::string2int(scid);
+		const socktype cid = ViewTokenizer::view2int(scid);
 		const clientcon *c;
 		if ((c = get_client_by_id(cid)))
 		{
@@ -645,14 +1448,96 @@ bool client_cmd_request_clientinfo(clientcon *client, Tokenizer &t)
 				cid,
 				c->info.name, c->info.location);
 			
-			send_msg(client->sock, msg);
+			send_msg(client, msg);
+		}
+	}
+	
+	return true;
+}
+
+// REQUEST clients <cid> [...]: client infos as one bulk response
+bool client_cmd_request_clients(clientcon *client, ViewTokenizer &t)
+{
+	const unsigned int max_records = config.getInt("max_request_records");
+	unsigned int count = 0, omitted = 0;
+	string records;
+	
+	strview scid;
+	while (t.getNext(scid))
+	{
+		const int cid = ViewTokenizer::view2int(scid);
+		
+		if (count == max_records)
+			omitted++;
+		else if (clientinfo_append(client, cid, records))
+			count++;
+	}
+	
+	send_records(client, WireClientinfo, count, omitted, records);
+	
+	return true;
+}
+
+// REQUEST games [<filter>:<value> ...]: infos of all matching games as one
+// bulk response; filters are state:<gamestate>, open:1, password:<0|1>
+// and registered:1
+bool client_cmd_request_games(clientcon *client, ViewTokenizer &t)
+{
+	int state = -1, password = -1;
+	bool open = false, registered = false;
+	
+	strview arg;
+	while (t.getNext(arg))
+	{
+		ViewTokenizer ft(":");
+		ft.parse(arg);
+		
+		if (ft.count() != 2)
+			return false;
+		
+		const strview key = ft.getNext();
+		const int value = ft.getNextInt();
+		
+		if (ViewTokenizer::equals(key, "state"))
+			state = value;
+		else if (ViewTokenizer::equals(key, "open"))
+			open = value;
+		else if (ViewTokenizer::equals(key, "password"))
+			password = value;
+		else if (ViewTokenizer::equals(key, "registered"))
+			registered = value;
+		else
+			return false;
+	}
+	
+	const unsigned int max_records = config.getInt("max_request_records");
+	unsigned int count = 0, omitted = 0;
+	string records;
+	
+	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
+	{
+		const GameController *g = e->second;
+		
+		if ((state != -1 && get_game_state(g) != state) ||
+			(open && (g->isStarted() || g->getPlayerCount() >= g->getPlayerMax())) ||
+			(password != -1 && g->hasPassword() != (bool) password) ||
+			(registered && !g->isPlayer(client->id)))
+		{
+			continue;
 		}
+		
+		if (count == max_records)
+			omitted++;
+		else if (gameinfo_append(client, e->first, records, true))
+			count++;
 	}
 	
+	send_records(client, WireGameinfo, count, omitted, records);
+	
 	return true;
 }
 
-bool client_cmd_request_gamelist(clientcon *client, Tokenizer &t)
+void send_gamelist(clientcon *client)
 {
 	string gamelist;
 	for (games_type::iterator e = games.begin(); e != games.end(); e++)
@@ -666,12 +1551,17 @@ bool client_cmd_request_gamelist(clientcon *client, Tokenizer &t)
 	snprintf(msg, sizeof(msg),
 		"GAMELIST %s", gamelist.c_str());
 	
-	send_msg(client->sock, msg);
+	send_msg(client, msg);
+}
+
+bool client_cmd_request_gamelist(clientcon *client, ViewTokenizer &t)
+{
+	send_gamelist(client);
 	
 	return true;
 }
 
-bool client_cmd_request_playerlist(clientcon *client, Tokenizer &t)
+bool client_cmd_request_playerlist(clientcon *client, ViewTokenizer &t)
 {
 	int gid;
 	t >> gid;
@@ -691,15 +1581,24 @@ bool client_cmd_request_playerlist(clientcon *client, Tokenizer &t)
 	}
 	
 	snprintf(msg, sizeof(msg), "PLAYERLIST %d %s", gid, slist.c_str());
-	send_msg(client->sock, msg);
+	send_msg(client, msg);
 	
 	return true;
 }
 
-bool client_cmd_request_serverinfo(clientcon *client, Tokenizer &t)
+void send_serverinfo(clientcon *client)
 {
+	ranking_stats rs;
+	memset(&rs, 0, sizeof(rs));
+#ifndef NOSQLITE
+	ranking_get_stats(&rs);
+#endif /* !NOSQLITE */
+	
 	snprintf(msg, sizeof(msg), "SERVERINFO "
-		"%d:%d %d:%d %d:%d %d:%d %d:%d %d:%d %d:%d %d:%d",
+		"%d:%d %d:%d %d:%d %d:%d %d:%d %d:%d %d:%d %d:%d "
+		"%d:%lu %d:%lu %d:%lu %d:%lu "
+		"%d:%d %d:%d %d:%d %d:%d %d:%d %d:%d "
+		"%d:%d %d:%lu %d:%lu",
 		StatsServerStarted,		(unsigned int) stats.server_started,
 		StatsClientsConnected,		(unsigned int) stats.clients_connected,
 		StatsClientsIntroduced,		(unsigned int) stats.clients_introduced,
@@ -707,14 +1606,59 @@ bool client_cmd_request_serverinfo(clientcon *client, Tokenizer &t)
 		StatsGamesCreated,		(unsigned int) stats.games_created,
 		StatsClientCount,		(unsigned int) clients.size(),
 		StatsGamesCount,		(unsigned int) games.size(),
-		StatsConarchiveCount,		(unsigned int) con_archive.size());
+		StatsConarchiveCount,		(unsigned int) con_archive.size(),
+		StatsBytesOutRaw,		stats.bytes_out_raw,
+		StatsBytesOutCompressed,	stats.bytes_out_compressed,
+		StatsBytesInRaw,		stats.bytes_in_raw,
+		StatsBytesInCompressed,		stats.bytes_in_compressed,
+		StatsPoolGamesUsed,		GameController::getGamePool().getUsed(),
+		StatsPoolGamesFree,		GameController::getGamePool().getFree(),
+		StatsPoolTablesUsed,		GameController::getTablePool().getUsed(),
+		StatsPoolTablesFree,		GameController::getTablePool().getFree(),
+		StatsPoolPlayersUsed,		GameController::getPlayerPool().getUsed(),
+		StatsPoolPlayersFree,		GameController::getPlayerPool().getFree(),
+		StatsRankingQueued,		rs.queued,
+		StatsRankingCommitTime,		rs.last_commit_ms,
+		StatsRankingCommitTimeMax,	rs.max_commit_ms);
+	
+	send_msg(client, msg);
+}
+
+bool client_cmd_request_serverinfo(clientcon *client, ViewTokenizer &t)
+{
+	send_serverinfo(client);
+	
+	return true;
+}
+
+// REQUEST lobby [<0|1>]: (un)subscribe to game-list updates
+bool client_cmd_request_lobby(clientcon *client, ViewTokenizer &t)
+{
+	strview arg;
+	if (t.getNext(arg) && !ViewTokenizer::view2int(arg))
+	{
+		client->state &= ~Lobby;
+		return true;
+	}
+	
+	client->state |= Lobby;
+	
+	// initial full list; changes are pushed from now on
+	send_gamelist(client);
+	
+	string infos;
+	for (games_type::iterator e = games.begin(); e != games.end(); e++)
+		gameinfo_append(client, e->first, infos);
+	
+	if (infos.length())
+		send_data(client, infos.data(), infos.length());
 	
-	send_msg(client->sock, msg);
+	send_serverinfo(client);
 	
 	return true;
 }
 
-bool client_cmd_request_gamestart(clientcon *client, Tokenizer &t)
+bool client_cmd_request_gamestart(clientcon *client, ViewTokenizer &t)
 {
 	int gid;
 	t >> gid;
@@ -731,7 +1675,7 @@ bool client_cmd_request_gamestart(clientcon *client, Tokenizer &t)
 	return true;
 }
 
-bool client_cmd_request_gamerestart(clientcon *client, Tokenizer &t)
+bool client_cmd_request_gamerestart(clientcon *client, ViewTokenizer &t)
 {
 	int gid, restart;
 	t >> gid >> restart;
@@ -744,12 +1688,122 @@ bool client_cmd_request_gamerestart(clientcon *client, Tokenizer &t)
 		return false;
 
 	g->setRestart(restart);
+	journal_game(g);
+
+	return true;
+}
+
+// client lost track of the table state (table deltas); resend a full snapshot
+bool client_cmd_request_snapshot(clientcon *client, ViewTokenizer &t)
+{
+	int gid, tid;
+	t >> gid >> tid;
+	
+	GameController *g = get_game_by_id(gid);
+	if (!g)
+		return false;
+	
+	return g->resendTableSnapshot(client->id, tid);
+}
+
+
+#ifndef NOSQLITE
+static void send_playerstats(clientcon *client, const ranking_player &p)
+{
+	snprintf(msg, sizeof(msg), "PLAYERSTATS "
+		"%d:%s \"%d:%s\" %d:%u %d:%d %d:%d",
+		PlayerStatsUUID,	p.uuid.c_str(),
+		PlayerStatsName,	p.name.c_str(),
+		PlayerStatsPosition,	p.position,
+		PlayerStatsRanking,	p.ranking,
+		PlayerStatsGameCount,	p.gamecount);
+	
+	send_msg(client, msg);
+}
+#endif /* !NOSQLITE */
+
+#ifndef NOSQLITE
+// unranked players get their uuid only
+static void send_playerstats(clientcon *client, const string &uuid)
+{
+	ranking_player p;
+	
+	if (ranking_get_player(uuid, &p))
+		send_playerstats(client, p);
+	else
+	{
+		snprintf(msg, sizeof(msg), "PLAYERSTATS %d:%s", PlayerStatsUUID, uuid.c_str());
+		send_msg(client, msg);
+	}
+}
+#endif /* !NOSQLITE */
+
+// REQUEST playerstats [<uuid> ...]: ranking of the players (default: own)
+bool client_cmd_request_playerstats(clientcon *client, ViewTokenizer &t)
+{
+#ifndef NOSQLITE
+	const unsigned int max_records = config.getInt("max_request_records");
+	
+	strview suuid;
+	if (!t.getNext(suuid))
+	{
+		if (!*client->uuid)
+			return false;
+		
+		send_playerstats(client, string(client->uuid));
+		return true;
+	}
+	
+	for (unsigned int i=0; i < max_records; i++)
+	{
+		send_playerstats(client, ViewTokenizer::view2string(suuid));
+		
+		if (!t.getNext(suuid))
+			break;
+	}
+	
+	return true;
+#else
+	return false;
+#endif /* !NOSQLITE */
+}
 
+// REQUEST leaderboard [<first> [<count>]]: players in ranking order from index first
+bool client_cmd_request_leaderboard(clientcon *client, ViewTokenizer &t)
+{
+#ifndef NOSQLITE
+	const unsigned int max_records = config.getInt("max_request_records");
+	unsigned int first = 0, count = 10;
+	
+	strview arg;
+	if (t.getNext(arg))
+	{
+		first = ViewTokenizer::view2int(arg);
+		
+		if (t.getNext(arg))
+			count = ViewTokenizer::view2int(arg);
+	}
+	
+	if (count > max_records)
+		count = max_records;
+	
+	vector<ranking_player> list;
+	const unsigned int total = ranking_get_leaderboard(first, count, list);
+	
+	snprintf(msg, sizeof(msg), "LEADERBOARD %u %u %u", first, (unsigned int) list.size(), total);
+	send_msg(client, msg);
+	
+	for (unsigned int i=0; i < list.size(); i++)
+		send_playerstats(client, list[i]);
+	
 	return true;
+#else
+	return false;
+#endif /* !NOSQLITE */
 }
 
 
-int client_cmd_request(clientcon *client, Tokenizer &t)
+int client_cmd_request(clientcon *client, ViewTokenizer &t)
 {
 	if (!t.count())
 	{
@@ -759,25 +1813,53 @@ int client_cmd_request(clientcon *client, Tokenizer &t)
 	
 	bool cmderr = false;
 	
-	string request;
+	strview request;
 	t >> request;
 	
-	if (request == "clientinfo")
+	switch (keyword_lookup(request_table, request, RequestUnknown))
+	{
+	case RequestClientinfo:
 		cmderr = !client_cmd_request_clientinfo(client, t);
-	else if (request == "gameinfo")
+		break;
+	case RequestGameinfo:
 		cmderr = !client_cmd_request_gameinfo(client, t);
-	else if (request == "gamelist")
+		break;
+	case RequestGamelist:
 		cmderr = !client_cmd_request_gamelist(client, t);
-	else if (request == "playerlist")
+		break;
+	case RequestPlayerlist:
 		cmderr = !client_cmd_request_playerlist(client, t);
-	else if (request == "serverinfo")
+		break;
+	case RequestServerinfo:
 		cmderr = !client_cmd_request_serverinfo(client, t);
-	else if (request == "start")
+		break;
+	case RequestStart:
 		cmderr = !client_cmd_request_gamestart(client, t);
-	else if (request == "restart")
+		break;
+	case RequestRestart:
 		cmderr = !client_cmd_request_gamerestart(client, t);
-	else
+		break;
+	case RequestClients:
+		cmderr = !client_cmd_request_clients(client, t);
+		break;
+	case RequestGames:
+		cmderr = !client_cmd_request_games(client, t);
+		break;
+	case RequestLobby:
+		cmderr = !client_cmd_request_lobby(client, t);
+		break;
+	case RequestSnapshot:
+		cmderr = !client_cmd_request_snapshot(client, t);
+		break;
+	case RequestPlayerstats:
+		cmderr = !client_cmd_request_playerstats(client, t);
+		break;
+	case RequestLeaderboard:
+		cmderr = !client_cmd_request_leaderboard(client, t);
+		break;
+	default:
 		cmderr = true;
+	}
 	
 	// FIXME: temporarily disabled for release 0.0.3
 #if 0
@@ -790,7 +1872,7 @@ int client_cmd_request(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_register(clientcon *client, Tokenizer &t)
+int client_cmd_register(clientcon *client, ViewTokenizer &t)
 {
 	if (!t.count())
 	{
@@ -803,7 +1885,7 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 	
 	string passwd = "";
 	if (t.count() >=2)
-		t >> passwd;
+		passwd = ViewTokenizer::view2string(t.getNext());
 	
 	GameController *g = get_game_by_id(gid);
 	if (!g)
@@ -854,8 +1936,10 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
+	journal_event(GameController::JournalRegister, gid, client->id, client->uuid);
+	
 	
-	log_msg("game", "%s (%d) joined game %d (%d/%d)",
+	log_info("game", "%s (%d) joined game %d (%d/%d)",
 		client->info.name, client->id, gid,
 		g->getPlayerCount(), g->getPlayerMax());
 	
@@ -865,7 +1949,7 @@ int client_cmd_register(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_unregister(clientcon *client, Tokenizer &t)
+int client_cmd_unregister(clientcon *client, ViewTokenizer &t)
 {
 	if (!t.count())
 	{
@@ -901,8 +1985,10 @@ int client_cmd_unregister(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
+	journal_event(GameController::JournalUnregister, gid, client->id);
 	
-	log_msg("game", "%s (%d) parted game %d (%d/%d)",
+	
+	log_info("game", "%s (%d) parted game %d (%d/%d)",
 		client->info.name, client->id, gid,
 		g->getPlayerCount(), g->getPlayerMax());
 	
@@ -912,7 +1998,7 @@ int client_cmd_unregister(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_subscribe(clientcon *client, Tokenizer &t)
+int client_cmd_subscribe(clientcon *client, ViewTokenizer &t)
 {
 	if (!t.count())
 	{
@@ -925,7 +2011,7 @@ int client_cmd_subscribe(clientcon *client, Tokenizer &t)
 	
 	string passwd = "";
 	if (t.count() >=2)
-		t >> passwd;
+		passwd = ViewTokenizer::view2string(t.getNext());
 	
 	GameController *g = get_game_by_id(gid);
 	if (!g)
@@ -964,6 +2050,13 @@ int client_cmd_subscribe(clientcon *client, Tokenizer &t)
 		return 1;
 	}
 	
+	// check for max-spectators limit of the game
+	if (g->getSpectatorMax() && g->getSpectatorCount() >= g->getSpectatorMax())
+	{
+		send_err(client, 0 /*FIXME*/, "spectator limit of the game is reached");
+		return 1;
+	}
+	
 	if (!g->addSpectator(client->id))
 	{
 		send_err(client, 0 /*FIXME*/, "unable to subscribe");
@@ -971,7 +2064,7 @@ int client_cmd_subscribe(clientcon *client, Tokenizer &t)
 	}
 	
 	
-	log_msg("game", "%s (%d) subscribed game %d",
+	log_info("game", "%s (%d) subscribed game %d",
 		client->info.name, client->id, gid);
 	
 	
@@ -980,7 +2073,7 @@ int client_cmd_subscribe(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_unsubscribe(clientcon *client, Tokenizer &t)
+int client_cmd_unsubscribe(clientcon *client, ViewTokenizer &t)
 {
 	if (!t.count())
 	{
@@ -1011,7 +2104,7 @@ int client_cmd_unsubscribe(clientcon *client, Tokenizer &t)
 	}
 	
 	
-	log_msg("game", "%s (%d) unsubscribed game %d",
+	log_info("game", "%s (%d) unsubscribed game %d",
 		client->info.name, client->id, gid);
 	
 	
@@ -1020,67 +2113,51 @@ int client_cmd_unsubscribe(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_action(clientcon *client, Tokenizer &t)
+int client_action(clientcon *client, int gid, Player::PlayerAction action, chips_type amount)
 {
-	if (t.count() < 2)
+	GameController *g = get_game_by_id(gid);
+	if (!g)
 	{
-		send_err(client, ErrParameters);
+		send_err(client, 0 /* FIXME */, "game does not exist");
 		return 1;
 	}
 	
-	int gid;
-	string action;
-	chips_type amount;
-	
-	t >> gid >> action;
-	amount = t.getNextInt();
-	
-	GameController *g = get_game_by_id(gid);
-	if (!g)
+	if (action == Player::None)
 	{
-		send_err(client, 0 /* FIXME */, "game does not exist");
+		send_err(client, ErrParameters);
 		return 1;
 	}
 	
-	Player::PlayerAction a = Player::None;
-	
-	if (action == "check")
-		a = Player::Check;
-	else if (action == "fold")
-		a = Player::Fold;
-	else if (action == "call")
-		a = Player::Call;
-	else if (action == "bet")
-		a = Player::Bet;
-	else if (action == "raise")
-		a = Player::Raise;
-	else if (action == "allin")
-		a = Player::Allin;
-	else if (action == "show")
-		a = Player::Show;
-	else if (action == "muck")
-		a = Player::Muck;
-	else if (action == "sitout")
-		a = Player::Sitout;
-	else if (action == "back")
-		a = Player::Back;
-	else if (action == "reset")
-		a = Player::ResetAction;
-	else
+	
+	g->setPlayerAction(client->id, action, amount);
+	
+	send_ok(client);
+	
+	return 0;
+}
+
+int client_cmd_action(clientcon *client, ViewTokenizer &t)
+{
+	if (t.count() < 2)
 	{
 		send_err(client, ErrParameters);
 		return 1;
 	}
 	
+	int gid;
+	strview action;
+	chips_type amount;
 	
-	g->setPlayerAction(client->id, a, amount);
+	t >> gid >> action;
+	amount = t.getNextInt();
 	
-	send_ok(client);
+	const Player::PlayerAction a = (Player::PlayerAction)
+		keyword_lookup(action_table, action, Player::None);
 	
-	return 0;
+	return client_action(client, gid, a, amount);
 }
 
-int client_cmd_create(clientcon *client, Tokenizer &t)
+int client_cmd_create(clientcon *client, ViewTokenizer &t)
 {
 	if (!config.getBool("perm_create_user") && !(client->state & Authed))
 	{
@@ -1142,21 +2219,24 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 	};
 	
 	
-	string infostr;
-	Tokenizer it(":");
+	strview infostr;
+	ViewTokenizer it(":");
 	
 	while (t.getNext(infostr))
 	{
 		it.parse(infostr);
 		
-		string infotype, infoarg;
-		it.getNext(infotype);
+		strview sinfotype, sinfoarg;
+		it.getNext(sinfotype);
 		
-		bool havearg = it.getNext(infoarg);
+		bool havearg = it.getNext(sinfoarg);
+		
+		const string infotype = ViewTokenizer::view2string(sinfotype);
+		string infoarg = ViewTokenizer::view2string(sinfoarg);
 		
 		if (infotype == "type" && havearg)
 		{
-			ginfo.type = Tokenizer::string2int(infoarg);
+			ginfo.type = ViewTokenizer::view2int(sinfoarg);
 			
 			// TODO: no other gamesmodes supported yet
 			if (ginfo.type != GameController::SNG)
@@ -1164,21 +2244,21 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		}
 		else if (infotype == "players" && havearg)
 		{
-			ginfo.max_players = Tokenizer::string2int(infoarg);
+			ginfo.max_players = ViewTokenizer::view2int(sinfoarg);
 			
-			if (ginfo.max_players < 2 || ginfo.max_players > 10)
+			if (ginfo.max_players < 2 || ginfo.max_players > (unsigned int) config.getInt("max_players_per_game"))
 				cmderr = true;
 		}
 		else if (infotype == "stake" && havearg)
 		{
-			ginfo.stake = Tokenizer::string2int(infoarg);
+			ginfo.stake = ViewTokenizer::view2int(sinfoarg);
 			
 			if (ginfo.stake < 10 || ginfo.stake > 1000000*100)
 				cmderr = true;
 		}
 		else if (infotype == "timeout" && havearg)
 		{
-			ginfo.timeout = Tokenizer::string2int(infoarg);
+			ginfo.timeout = ViewTokenizer::view2int(sinfoarg);
 			
 			if (ginfo.timeout < 5 || ginfo.timeout > 5*60)
 				cmderr = true;
@@ -1192,21 +2272,21 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		}
 		else if (infotype == "blinds_start" && havearg)
 		{
-			ginfo.blinds_start = Tokenizer::string2int(infoarg);
+			ginfo.blinds_start = ViewTokenizer::view2int(sinfoarg);
 			
 			if (ginfo.blinds_start < 5 || ginfo.blinds_start > 200*100)
 				cmderr = true;
 		}
 		else if (infotype == "blinds_factor" && havearg)
 		{
-			ginfo.blinds_factor = Tokenizer::string2int(infoarg);
+			ginfo.blinds_factor = ViewTokenizer::view2int(sinfoarg);
 			
 			if (ginfo.blinds_factor < 12 || ginfo.blinds_factor > 40)
 				cmderr = true;
 		}
 		else if (infotype == "blinds_time" && havearg)
 		{
-			ginfo.blinds_time = Tokenizer::string2int(infoarg);
+			ginfo.blinds_time = ViewTokenizer::view2int(sinfoarg);
 			
 			if (ginfo.blinds_time < 30 || ginfo.blinds_time > 30*60)
 				cmderr = true;
@@ -1221,7 +2301,7 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		else if (infotype == "restart" && havearg)
 		{
 			if (client->state & Authed)
-				ginfo.restart = Tokenizer::string2int(infoarg) ? 1 : 0;
+				ginfo.restart = ViewTokenizer::view2int(sinfoarg) ? 1 : 0;
 			else
 				cmderr = true;
 		}
@@ -1229,7 +2309,7 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 	
 	if (!cmderr)
 	{
-		GameController *g = new GameController();
+		GameController *g = GameController::create();
 		const int gid = ++gid_counter;
 		g->setGameId(gid);
 		g->setPlayerMax(ginfo.max_players);
@@ -1243,12 +2323,18 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		g->setBlindsTime(ginfo.blinds_time);
 		g->setPassword(ginfo.password);
 		g->setRestart(ginfo.restart);
+		g->setSpectatorRate(config.getInt("spectator_rate"));
+		g->setSpectatorDelay(config.getInt("spectator_delay"));
+		g->setSpectatorMax(config.getInt("max_spectators_per_game"));
 		games[gid] = g;
 		
+		game_record(g);
+		journal_game(g);
+		
 		send_ok(client);
 		
 		
-		log_msg("game", "%s (%d) created game %d",
+		log_info("game", "%s (%d) created game %d",
 			client->info.name, client->id, gid);
 		
 		
@@ -1256,12 +2342,18 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 		stats.games_created++;
 		
 		
+		const int creator = client->id;
+		
 		for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
 		{
 			clientcon *client = &(*e);
 			if (!(client->state & Introduced))  // do not send broadcast to non-introduced clients
 				continue;
 			
+			// lobby subscribers get it with the next lobby update
+			if ((client->state & Lobby) && client->id != creator)
+				continue;
+			
 			send_gameinfo(client, gid);
 		}
 	}
@@ -1271,14 +2363,14 @@ int client_cmd_create(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_auth(clientcon *client, Tokenizer &t)
+int client_cmd_auth(clientcon *client, ViewTokenizer &t)
 {
 	bool cmderr = true;
 	
 	if (t.count() >= 2 && config.get("auth_password").length())
 	{
 		const int type = t.getNextInt();
-		const string passwd = t.getNext();
+		const string passwd = ViewTokenizer::view2string(t.getNext());
 		
 		// -1 is server-auth
 		if (type == -1)
@@ -1294,7 +2386,7 @@ int client_cmd_auth(clientcon *client, Tokenizer &t)
 	
 	if (!cmderr)
 	{
-		log_msg("auth", "%s (%d) has been authed",
+		log_info("auth", "%s (%d) has been authed",
 			client->info.name, client->id);
 	
 		send_ok(client);
@@ -1305,14 +2397,14 @@ int client_cmd_auth(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_cmd_config(clientcon *client, Tokenizer &t)
+int client_cmd_config(clientcon *client, ViewTokenizer &t)
 {
 	bool cmderr = false;
 	
 	if (client->state & Authed)
 	{
-		const string action = t.getNext();
-		const string varname = t.getNext();
+		const string action = ViewTokenizer::view2string(t.getNext());
+		const string varname = ViewTokenizer::view2string(t.getNext());
 		
 		if (action == "get")
 		{
@@ -1327,14 +2419,62 @@ int client_cmd_config(clientcon *client, Tokenizer &t)
 		}
 		else if (action == "set")
 		{
-			const string varvalue = t.getNext();
+			const string varvalue = ViewTokenizer::view2string(t.getNext());
 			
 			config.set(varname, varvalue);
 			
-			log_msg("config", "%s (%d) set var '%s' to '%s'",
+			log_info("config", "%s (%d) set var '%s' to '%s'",
 				client->info.name, client->id,
 				varname.c_str(), varvalue.c_str());
 		}
+		else if (action == "log")
+		{
+			// without levels: list the categories
+			if (varname.empty())
+			{
+				// split into several messages; a chat line is cut at 256 bytes
+				int len = snprintf(msg, sizeof(msg), "Log:");
+				
+				for (log_category *cat = log_category_first(); cat; cat = cat->next)
+				{
+					if (len > 200)
+					{
+						client_chat(-1, client->id, msg);
+						len = snprintf(msg, sizeof(msg), "Log:");
+					}
+					
+					len += snprintf(msg + len, sizeof(msg) - len, " %s:%s",
+						cat->name, log_level_name(cat->level));
+				}
+				
+				client_chat(-1, client->id, msg);
+			}
+			else
+			{
+				string spec = varname;
+				strview sv;
+				while (t.getNext(sv))
+					spec += " " + ViewTokenizer::view2string(sv);
+				
+				// misspelled categories are rejected instead of created
+				const int rc = log_set_levels(spec.c_str(), 0);
+				if (rc < 0)
+					cmderr = true;
+				else
+				{
+					log_info("config", "%s (%d) set log levels '%s'",
+						client->info.name, client->id, spec.c_str());
+					
+					// debug messages are only compiled into debug builds
+					if (rc)
+					{
+						snprintf(msg, sizeof(msg), "Log: levels above %s are not compiled into this build and were lowered",
+							log_level_name(LOG_MIN_LEVEL));
+						client_chat(-1, client->id, msg);
+					}
+				}
+			}
+		}
 		else if (action == "save")
 		{
 			char cfgfile[1024];
@@ -1360,33 +2500,37 @@ int client_cmd_config(clientcon *client, Tokenizer &t)
 	return 0;
 }
 
-int client_execute(clientcon *client, const char *cmd)
+int client_execute(clientcon *client, const char *cmd, unsigned int len)
 {
-	Tokenizer t(" ");
-	t.parse(cmd);  // parse the command line
+	// tokens are views into the receive-buffer; no copies are made
+	ViewTokenizer t(" ");
+	t.parse(cmd, len);  // parse the command line
+	
+	strview command;
 	
 	// ignore blank command
-	if (!t.count())
+	if (!t.getNext(command))
 		return 0;
 	
 	//dbg_msg("clientsock", "(%d) executing '%s'", client->sock, cmd);
 	
-	// FIXME: could be done better...
 	// extract message-id if present
-	const char firstchar = t[0][0];
-	if (firstchar >= '0' && firstchar <= '9')
-		client->last_msgid = t.getNextInt();
+	if (command.str[0] >= '0' && command.str[0] <= '9')
+	{
+		client->last_msgid = ViewTokenizer::view2int(command);
+		
+		// get command argument
+		t.getNext(command);
+	}
 	else
 		client->last_msgid = -1;
 	
 	
-	// get command argument
-	const string command = t.getNext();
-	
+	const int cmdtype = keyword_lookup(command_table, command, CmdUnknown);
 	
 	if (!(client->state & Introduced))  // state: not introduced
 	{
-		if (command == "PCLIENT")
+		if (cmdtype == CmdPclient)
 			return client_cmd_pclient(client, t);
 		else
 		{
@@ -1395,121 +2539,245 @@ int client_execute(clientcon *client, const char *cmd)
 			return -1;
 		}
 	}
-	else if (command == "INFO")
+	
+	switch (cmdtype)
+	{
+	case CmdInfo:
 		return client_cmd_info(client, t);
-	else if (command == "CHAT")
+	case CmdChat:
 		return client_cmd_chat(client, t);
-	else if (command == "REQUEST")
+	case CmdRequest:
 		return client_cmd_request(client, t);
-	else if (command == "REGISTER")
+	case CmdRegister:
 		return client_cmd_register(client, t);
-	else if (command == "UNREGISTER")
+	case CmdUnregister:
 		return client_cmd_unregister(client, t);
-	else if (command == "SUBSCRIBE")
+	case CmdSubscribe:
 		return client_cmd_subscribe(client, t);
-	else if (command == "UNSUBSCRIBE")
+	case CmdUnsubscribe:
 		return client_cmd_unsubscribe(client, t);
-	else if (command == "ACTION")
+	case CmdAction:
 		return client_cmd_action(client, t);
-	else if (command == "CREATE")
+	case CmdCreate:
 		return client_cmd_create(client, t);
-	else if (command == "AUTH")
+	case CmdAuth:
 		return client_cmd_auth(client, t);
-	else if (command == "CONFIG")
+	case CmdConfig:
 		return client_cmd_config(client, t);
-	else if (command == "QUIT")
-	{
+	case CmdQuit:
 		send_ok(client);
 		return -1;
-	}
-	else
+	default:
 		send_err(client, ErrNotImplemented, "not implemented");
+	}
 	
 	return 0;
 }
 
-// returns zero if no cmd was found or no bytes remaining after exec
-int client_parsebuffer(clientcon *client)
+// execute a binary frame (payload without length field)
+int client_execute_frame(clientcon *client, char *payload, size_t len)
 {
-	//log_msg("clientsock", "(%d) parse (bufferlen=%d)", client->sock, client->buflen);
+	wire_reader r;
+	wire_reader_init(&r, payload, len);
 	
-	int found_nl = -1;
-	for (int i=0; i < client->buflen; i++)
+	switch (wire_get_u8(&r))
 	{
-		if (client->msgbuf[i] == '\r')
-			client->msgbuf[i] = ' ';  // space won't hurt
-		else if (client->msgbuf[i] == '\n')
-		{
-			found_nl = i;
+	case WireText:
+		// text protocol command; must be '\0'-terminated
+		if (len < 2 || payload[len - 1] != '\0')
 			break;
+		
+		return client_execute(client, payload + 1, len - 2);
+	
+	case WireAction:
+		{
+			wire_action a;
+			if (!wire_decode_action(&r, &a))
+				break;
+			
+			client->last_msgid = a.msgid;
+			
+			if (a.action < Player::ResetAction || a.action > Player::Back)
+				a.action = Player::None;
+			
+			return client_action(client, a.gid, (Player::PlayerAction) a.action, a.amount);
 		}
 	}
 	
-	int retval = 0;
+	send_err(client, ErrProtocol, "protocol error");
+	return -1;
+}
+
+// execute all complete commands in queue; they are handed out in-place
+// returns 1 if the client has been removed, -1 on error
+static int client_process(clientcon *client)
+{
+	ringbuffer *rb = &(client->rbuf);
+	const socktype sock = client->sock;
 	
-	// is there a command in queue?
-	if (found_nl != -1)
+	for (;;)
 	{
-		// extract command
-		char cmd[sizeof(client->msgbuf)];
-		memcpy(cmd, client->msgbuf, found_nl);
-		cmd[found_nl] = '\0';
+		int status;
 		
-		//log_msg("clientsock", "(%d) command: '%s' (len=%d)", client->sock, cmd, found_nl);
-		if (client_execute(client, cmd) != -1)  // client quitted ?
+		if (client->wire_version)
 		{
-			// move the rest to front
-			memmove(client->msgbuf, client->msgbuf + found_nl + 1, client->buflen - (found_nl + 1));
-			client->buflen -= found_nl + 1;
-			//log_msg("clientsock", "(%d) new buffer after cmd (bufferlen=%d)", client->sock, client->buflen);
+			char header[WIRE_HEADER_SIZE];
+			
+			if (ringbuf_peek(rb, header, sizeof(header)) < sizeof(header))
+				break;
+			
+			// a frame must fit into the receive-buffer
+			const size_t framelen = wire_frame_length(header);
+			if (!framelen || framelen > rb->max_size - WIRE_HEADER_SIZE)
+			{
+				log_error("clientsock", "(%d) error: invalid frame length (%d)", sock, (int) framelen);
+				send_err(client, ErrProtocol, "message too long");
+				errno = EMSGSIZE;
+				return -1;
+			}
+			
+			char *frame = ringbuf_getblock(rb, WIRE_HEADER_SIZE + framelen);
+			if (!frame)
+				break;
 			
-			retval = client->buflen;
+			status = client_execute_frame(client, frame + WIRE_HEADER_SIZE, framelen);
 		}
 		else
 		{
-			client_remove(client->sock);
-			retval = 0;
+			size_t cmdlen;
+			char *cmd = ringbuf_getline(rb, &cmdlen);
+			if (!cmd)
+				break;
+			
+			//log_info("clientsock", "(%d) command: '%s'", sock, cmd);
+			status = client_execute(client, cmd, cmdlen);
+		}
+		
+		if (status == -1)  // client quitted ?
+		{
+			client_remove(sock);
+			return 1;
 		}
 	}
-	else
-		retval = 0;
 	
-	return retval;
+	// a single command doesn't fit into the buffer; don't corrupt the stream
+	if (ringbuf_isfull(rb))
+	{
+		log_error("clientsock", "(%d) error: buffer size exceeded", sock);
+		send_err(client, ErrProtocol, "message too long");
+		errno = EMSGSIZE;
+		return -1;
+	}
+	
+	return 0;
 }
 
-int client_handle(socktype sock)
+#ifndef NOZLIB
+// input of compressing clients is inflated into the receive-buffer; a
+// small read may expand a lot, so commands are executed whenever it fills up
+static int client_handle_compressed(clientcon *client)
 {
-	char buf[1024];
+	ringbuffer *rb = &(client->rbuf);
+	char buf[4096];
 	int bytes;
 	
 	// return early on client close/error
-	if ((bytes = socket_read(sock, buf, sizeof(buf))) <= 0)
+	if ((bytes = socket_read(client->sock, buf, sizeof(buf))) <= 0)
 		return bytes;
 	
+	stats.bytes_in_compressed += bytes;
 	
-	//log_msg("clientsock", "(%d) DATA len=%d", sock, bytes);
+	zstream_input(client->zin, buf, bytes);
 	
+	for (;;)
+	{
+		if (!ringbuf_reserve(rb))
+		{
+			log_error("clientsock", "(%d) error: buffer size exceeded", client->sock);
+			send_err(client, ErrProtocol, "message too long");
+			errno = EMSGSIZE;
+			return -1;
+		}
+		
+		char *buf1, *buf2;
+		size_t len1, len2;
+		ringbuf_segments(rb, &buf1, &len1, &buf2, &len2);
+		
+		const int produced = zstream_inflate(client->zin, buf1, len1);
+		if (produced == -1)
+		{
+			log_error("clientsock", "(%d) error: corrupt compressed stream", client->sock);
+			send_err(client, ErrProtocol, "protocol error");
+			errno = EINVAL;
+			return -1;
+		}
+		
+		ringbuf_commit(rb, produced);
+		stats.bytes_in_raw += produced;
+		
+		const int status = client_process(client);
+		if (status)
+			return (status == -1) ? -1 : bytes;
+		
+		// all input consumed
+		if ((size_t) produced < len1)
+			break;
+	}
+	
+	return bytes;
+}
+#endif /* !NOZLIB */
+
+int client_handle(socktype sock)
+{
 	clientcon *client = get_client_by_sock(sock);
 	if (!client)
 	{
-		log_msg("clientsock", "(%d) error: no client associated", sock);
+		log_error("clientsock", "(%d) error: no client associated", sock);
 		return -1;
 	}
 	
-	if (client->buflen + bytes > (int)sizeof(client->msgbuf))
-	{
-		log_msg("clientsock", "(%d) error: buffer size exceeded", sock);
-		client->buflen = 0;
-	}
-	else
+#ifndef NOZLIB
+	if (client->zin)
+		return client_handle_compressed(client);
+#endif
+	
+	ringbuffer *rb = &(client->rbuf);
+	
+	// make room for incoming data; grows the buffer if needed
+	if (!ringbuf_reserve(rb))
 	{
-		memcpy(client->msgbuf + client->buflen, buf, bytes);
-		client->buflen += bytes;
-		
-		// parse and execute all commands in queue
-		while (client_parsebuffer(client));
+		log_error("clientsock", "(%d) error: buffer size exceeded", sock);
+		send_err(client, ErrProtocol, "message too long");
+		errno = EMSGSIZE;
+		return -1;
 	}
 	
+	// read directly into the free regions of the ring-buffer
+	socket_buffer bufs[2];
+	char *buf1, *buf2;
+	size_t len1, len2;
+	const int segments = ringbuf_segments(rb, &buf1, &len1, &buf2, &len2);
+	
+	bufs[0].buf = buf1;
+	bufs[0].len = len1;
+	bufs[1].buf = buf2;
+	bufs[1].len = len2;
+	
+	int bytes;
+	
+	// return early on client close/error
+	if ((bytes = socket_readv(sock, bufs, segments)) <= 0)
+		return bytes;
+	
+	
+	//log_info("clientsock", "(%d) DATA len=%d", sock, bytes);
+	
+	ringbuf_commit(rb, bytes);
+	
+	if (client_process(client) == -1)
+		return -1;
+	
 	return bytes;
 }
 
@@ -1536,12 +2804,560 @@ void remove_expired_conar_entries()
 	}
 }
 
+/* Server state handed over on an upgrade (see upgrade.cpp). Client sockets
+   are passed separately; the state refers to them by index in fds. */
+
+static void put_bytes(wire_writer *w, const char *buf, size_t len)
+{
+	wire_put_u32(w, len);
+	wire_put_bytes(w, buf, len);
+}
+
+static const char* get_bytes(wire_reader *r, size_t *len)
+{
+	const size_t count = wire_get_u32(r);
+	const char *p = wire_get_bytes(r, count);
+	
+	*len = p ? count : 0;
+	
+	return p ? p : "";
+}
+
+// the stored bytes of a ring buffer, in order
+static void put_ringbuf(wire_writer *w, const ringbuffer *rb)
+{
+	wire_put_u32(w, rb->len);
+	if (rb->head + rb->len <= rb->size)
+		wire_put_bytes(w, rb->data + rb->head, rb->len);
+	else
+	{
+		const size_t first = rb->size - rb->head;
+		wire_put_bytes(w, rb->data + rb->head, first);
+		wire_put_bytes(w, rb->data, rb->len - first);
+	}
+}
+
+#ifndef NOZLIB
+// 0: no stream; 1: not started; 2: resume (with dictionary); 3: can't be resumed
+static void put_zstream(wire_writer *w, const zstream *zs)
+{
+	static char dict[ZSTREAM_WINDOW_SIZE];
+	size_t dict_len = 0;
+	
+	if (!zs)
+	{
+		wire_put_u8(w, 0);
+		return;
+	}
+	
+	const int status = zstream_save(zs, dict, &dict_len);
+	
+	wire_put_u8(w, (status == -1) ? 3 : status + 1);
+	if (status == 1)
+		put_bytes(w, dict, dict_len);
+}
+
+static bool get_zstream(wire_reader *r, clientcon *client, bool deflating)
+{
+	const unsigned int type = wire_get_u8(r);
+	size_t dict_len = 0;
+	const char *dict = (type == 2) ? get_bytes(r, &dict_len) : NULL;
+	zstream *zs = NULL;
+	
+	switch (type)
+	{
+	case 0:
+		return true;
+	case 1:
+		zs = deflating ? zstream_deflate_create(config.getInt("compression_level"),
+				config.getInt("compression_min_size"))
+			: zstream_inflate_create();
+		break;
+	case 2:
+		zs = deflating ? zstream_deflate_resume(config.getInt("compression_level"),
+				config.getInt("compression_min_size"))
+			: zstream_inflate_resume(dict, dict_len);
+		break;
+	default:
+		return false;
+	}
+	
+	if (deflating)
+		client->zout = zs;
+	else
+		client->zin = zs;
+	
+	return zs != NULL;
+}
+#endif /* !NOZLIB */
+
+bool game_save_state(wire_writer *w, std::vector<socktype> &fds)
+{
+	// nothing may be left within a compressed batch
+	clients_flush();
+	
+	wire_put_u32(w, gid_counter);
+	wire_put_u32(w, cid_counter);
+	
+	wire_put_u32(w, (unsigned int) stats.server_started);
+	wire_put_u32(w, stats.clients_connected);
+	wire_put_u32(w, stats.clients_introduced);
+	wire_put_u32(w, stats.clients_incompatible);
+	wire_put_u32(w, stats.games_created);
+	wire_put_ulong(w, stats.bytes_out_raw);
+	wire_put_ulong(w, stats.bytes_out_compressed);
+	wire_put_ulong(w, stats.bytes_in_raw);
+	wire_put_ulong(w, stats.bytes_in_compressed);
+	
+	// clients
+	wire_put_uvar(w, clients.size());
+	for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
+	{
+		clientcon *client = &*e;
+		
+		wire_put_uvar(w, fds.size());
+		fds.push_back(client->sock);
+		
+		wire_put_i32(w, client->id);
+		wire_put_u32(w, client->saddr.sin_addr.s_addr);
+		wire_put_u16(w, client->saddr.sin_port);
+		wire_put_uvar(w, client->version);
+		wire_put_uvar(w, client->wire_version);
+		wire_put_string(w, client->uuid, strlen(client->uuid));
+		wire_put_i32(w, client->last_msgid);
+		wire_put_uvar(w, client->state);
+		wire_put_string(w, client->info.name, strlen(client->info.name));
+		wire_put_string(w, client->info.location, strlen(client->info.location));
+		wire_put_u32(w, (unsigned int) client->last_chat);
+		wire_put_uvar(w, client->chat_count);
+		
+		// received but not yet executed; sent but not yet written
+		put_ringbuf(w, &client->rbuf);
+		put_ringbuf(w, &client->wbuf);
+		
+#ifndef NOZLIB
+		put_zstream(w, client->zout);
+		put_zstream(w, client->zin);
+#else
+		wire_put_u8(w, 0);
+		wire_put_u8(w, 0);
+#endif
+	}
+	
+	wire_put_uvar(w, con_archive.size());
+	for (clientconar_type::const_iterator e = con_archive.begin(); e != con_archive.end(); e++)
+	{
+		wire_put_string(w, e->first.data(), e->first.length());
+		wire_put_i32(w, e->second.id);
+		wire_put_u32(w, (unsigned int) e->second.logout_time);
+	}
+	wire_put_u32(w, (unsigned int) last_conarchive_cleanup);
+	
+	// pending foyer and lobby updates
+	wire_put_uvar(w, foyer_events.size());
+	for (foyerevents_type::const_iterator e = foyer_events.begin(); e != foyer_events.end(); e++)
+	{
+		wire_put_i32(w, e->type);
+		wire_put_i32(w, e->cid);
+		wire_put_string(w, e->name, strlen(e->name));
+	}
+	
+	wire_put_uvar(w, foyer_arrivals.size());
+	for (set<int>::const_iterator e = foyer_arrivals.begin(); e != foyer_arrivals.end(); e++)
+		wire_put_i32(w, *e);
+	wire_put_u32(w, (unsigned int) last_foyer_update);
+	
+	wire_put_uvar(w, lobby_games.size());
+	for (lobbygames_type::const_iterator e = lobby_games.begin(); e != lobby_games.end(); e++)
+	{
+		wire_put_i32(w, e->first);
+		wire_put_uvar(w, e->second);
+	}
+	wire_put_u32(w, (unsigned int) last_lobby_update);
+	wire_put_u32(w, (unsigned int) last_lobby_stats);
+	wire_put_uvar(w, lobby_clients_count);
+	wire_put_uvar(w, lobby_games_count);
+	
+	// games
+	wire_put_uvar(w, games.size());
+	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
+	{
+		wire_put_i32(w, e->first);
+		e->second->saveState(w);
+	}
+	
+	return !w->overflow;
+}
+
+bool game_load_state(wire_reader *r, const std::vector<socktype> &fds)
+{
+	const char *str;
+	size_t len;
+	unsigned int count;
+	
+	// clients whose compressed stream can't be continued
+	vector<socktype> dropped;
+	
+	gid_counter = wire_get_u32(r);
+	cid_counter = wire_get_u32(r);
+	
+	stats.server_started = (time_t) wire_get_u32(r);
+	stats.clients_connected = wire_get_u32(r);
+	stats.clients_introduced = wire_get_u32(r);
+	stats.clients_incompatible = wire_get_u32(r);
+	stats.games_created = wire_get_u32(r);
+	stats.bytes_out_raw = wire_get_ulong(r);
+	stats.bytes_out_compressed = wire_get_ulong(r);
+	stats.bytes_in_raw = wire_get_ulong(r);
+	stats.bytes_in_compressed = wire_get_ulong(r);
+	
+	unsigned int recvbuf_max = (unsigned int) config.getInt("max_recvbuf_size");
+	if (recvbuf_max < SERVER_RECVBUF_INITIAL || recvbuf_max > SERVER_RECVBUF_HARDLIMIT)
+		recvbuf_max = SERVER_RECVBUF_HARDLIMIT;
+	
+	// clients
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		const unsigned int fd_index = wire_get_uvar(r);
+		if (fd_index >= fds.size())
+			return false;
+		
+		clientcon client;
+		memset(&client, 0, sizeof(client));
+		client.sock = fds[fd_index];
+		client.saddr.sin_family = AF_INET;
+		
+		client.id = wire_get_i32(r);
+		client.saddr.sin_addr.s_addr = wire_get_u32(r);
+		client.saddr.sin_port = wire_get_u16(r);
+		
+		client.version = wire_get_uvar(r);
+		client.wire_version = wire_get_uvar(r);
+		str = wire_get_string(r, &len);
+		snprintf(client.uuid, sizeof(client.uuid), "%.*s", (int) len, str);
+		client.last_msgid = wire_get_i32(r);
+		client.state = wire_get_uvar(r);
+		str = wire_get_string(r, &len);
+		snprintf(client.info.name, sizeof(client.info.name), "%.*s", (int) len, str);
+		str = wire_get_string(r, &len);
+		snprintf(client.info.location, sizeof(client.info.location), "%.*s", (int) len, str);
+		client.last_chat = (time_t) wire_get_u32(r);
+		client.chat_count = wire_get_uvar(r);
+		
+		str = get_bytes(r, &len);
+		if (ringbuf_init(&client.rbuf, (len > SERVER_RECVBUF_INITIAL) ? len : SERVER_RECVBUF_INITIAL, recvbuf_max) ||
+			ringbuf_write(&client.rbuf, str, len) != len)
+		{
+			log_error("upgrade", "(%d) error: cannot restore receive-buffer", client.sock);
+			return false;
+		}
+		
+		str = get_bytes(r, &len);
+		if (len && (ringbuf_init(&client.wbuf, (len > SERVER_SENDBUF_INITIAL) ? len : SERVER_SENDBUF_INITIAL, sendbuf_max()) ||
+			ringbuf_write(&client.wbuf, str, len) != len))
+			client.state |= Dropped;
+		
+#ifndef NOZLIB
+		if (!get_zstream(r, &client, true) || !get_zstream(r, &client, false))
+			client.state |= Dropped;
+#else
+		if (wire_get_u8(r) || wire_get_u8(r))
+			client.state |= Dropped;
+#endif
+		
+		if (client.state & Dropped)
+			dropped.push_back(client.sock);
+		
+		clients.push_back(client);
+	}
+	
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		str = wire_get_string(r, &len);
+		clientcon_archive &ar = con_archive[string(str, len)];
+		ar.id = wire_get_i32(r);
+		ar.logout_time = (time_t) wire_get_u32(r);
+	}
+	last_conarchive_cleanup = (time_t) wire_get_u32(r);
+	
+	// pending foyer and lobby updates
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		foyer_event ev;
+		ev.type = wire_get_i32(r);
+		ev.cid = wire_get_i32(r);
+		str = wire_get_string(r, &len);
+		snprintf(ev.name, sizeof(ev.name), "%.*s", (int) len, str);
+		
+		foyer_events.push_back(ev);
+	}
+	
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+		foyer_arrivals.insert(wire_get_i32(r));
+	last_foyer_update = (time_t) wire_get_u32(r);
+	
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		const int gid = wire_get_i32(r);
+		lobby_games[gid] = wire_get_uvar(r);
+	}
+	last_lobby_update = (time_t) wire_get_u32(r);
+	last_lobby_stats = (time_t) wire_get_u32(r);
+	lobby_clients_count = wire_get_uvar(r);
+	lobby_games_count = wire_get_uvar(r);
+	
+	// games
+	count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		const int gid = wire_get_i32(r);
+		
+		GameController *g = GameController::create();
+		games[gid] = g;
+		
+		if (!g->loadState(r))
+			return false;
+	}
+	
+	if (r->error)
+		return false;
+	
+	for (unsigned int i=0; i < dropped.size(); i++)
+	{
+		log_error("upgrade", "(%d) output stream can't be continued; dropping client", dropped[i]);
+		client_remove(dropped[i]);
+	}
+	
+	return true;
+}
+
+/* Event journal: a snapshot of the server and all games followed by the
+   events since (see GameJournal.cpp). Events are committed in groups by
+   the game loop; a checkpoint writes a new snapshot and drops the events
+   it covers. After a crash, the games are restored from the snapshot and
+   brought up to date by applying the events again. */
+
+static void journal_disable()
+{
+	log_error("journal", "error: writing journal failed, disabled");
+	
+	GameController::setJournal(NULL);
+	journal_close(game_journal);
+	game_journal = NULL;
+}
+
+static bool journal_checkpoint()
+{
+	const unsigned long start = sys_time_ms();
+	
+	if (journal_checkpoint_begin(game_journal) < 0)
+		return false;
+	
+	char buf[16];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	wire_put_u32(&w, gid_counter);
+	wire_put_u32(&w, cid_counter);
+	journal_append(game_journal, GameController::JournalServer, w.data, w.len);
+	
+	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
+		journal_game(e->second);
+	
+	if (journal_checkpoint_end(game_journal) < 0)
+		return false;
+	
+	last_journal_checkpoint = time(NULL);
+	
+	journal_stats js;
+	journal_get_stats(game_journal, &js);
+	log_info("journal", "checkpoint of %d games (%d bytes) in %lu ms; %lu records in %lu commits since start",
+		(int) games.size(), (int) journal_size(game_journal), sys_time_ms() - start,
+		js.records, js.commits);
+	
+	return true;
+}
+
+static bool journal_apply(unsigned int type, wire_reader *r)
+{
+	if (type == GameController::JournalServer)
+	{
+		const unsigned int gid_next = wire_get_u32(r);
+		const unsigned int cid_next = wire_get_u32(r);
+		
+		if (gid_next > gid_counter)
+			gid_counter = gid_next;
+		if (cid_next > cid_counter)
+			cid_counter = cid_next;
+		
+		return !r->error;
+	}
+	
+	const int gid = wire_get_i32(r);
+	GameController *g = get_game_by_id(gid);
+	
+	if (type == GameController::JournalGame)
+	{
+		if (g)
+			GameController::destroy(g);
+		
+		g = GameController::create();
+		games[gid] = g;
+		
+		// the record of the game ends with the crash
+		const bool loaded = g->loadState(r);
+		g->stopRecording();
+		
+		if (!loaded)
+		{
+			GameController::destroy(g);
+			games.erase(gid);
+			return false;
+		}
+		
+		return true;
+	}
+	
+	if (!g)
+		return false;
+	
+	switch (type)
+	{
+	case GameController::JournalRegister:
+	case GameController::JournalUnregister:
+		{
+			const int cid = wire_get_i32(r);
+			size_t len;
+			const char *uuid = wire_get_string(r, &len);
+			
+			if (r->error)
+				return false;
+			
+			if (type == GameController::JournalRegister)
+				return g->addPlayer(cid, string(uuid, len));
+			else
+				return g->removePlayer(cid);
+		}
+	case GameController::JournalFinished:
+		g->setFinished();
+		return true;
+	case GameController::JournalDelete:
+		gameinfo_caches.erase(gid);
+		GameController::destroy(g);
+		games.erase(gid);
+		return true;
+	default:
+		return g->recoverEvent(type, r);
+	}
+}
+
+// restore the games of a crashed server
+static void journal_recover(const char *filename)
+{
+	journal_reader jr;
+	if (journal_reader_open(&jr, filename))
+		return;
+	
+	const unsigned long start = sys_time_ms();
+	unsigned int records = 0;
+	set<int> diverged;
+	
+	unsigned int type;
+	const char *data;
+	size_t len;
+	
+	while (journal_read(&jr, &type, &data, &len) == 1)
+	{
+		wire_reader r;
+		wire_reader_init(&r, data, len);
+		
+		records++;
+		
+		if (!journal_apply(type, &r))
+		{
+			wire_reader_init(&r, data, len);
+			const int gid = (type != GameController::JournalServer) ? wire_get_i32(&r) : -1;
+			
+			if (diverged.insert(gid).second)
+				log_warn("journal", "warning: game %d differs from the journal (record %u, type %u)",
+					gid, records, type);
+		}
+	}
+	
+	if (jr.truncated)
+		log_warn("journal", "journal ends with an incomplete record at %u bytes; ignored", (unsigned int) jr.pos);
+	
+	journal_reader_close(&jr);
+	
+	// keep ids of games and players unique; returning players get their seats back
+	const time_t now = time(NULL);
+	
+	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
+	{
+		const GameController *g = e->second;
+		vector<int> players;
+		g->getPlayerList(players);
+		
+		if ((unsigned int) e->first > gid_counter)
+			gid_counter = e->first;
+		
+		for (vector<int>::const_iterator p = players.begin(); p != players.end(); p++)
+		{
+			if ((unsigned int) *p >= cid_counter)
+				cid_counter = *p + 1;
+			
+			const string &uuid = g->getPlayer(*p)->getPlayerUUID();
+			if (uuid.length() && uuid != "DEBUG")
+			{
+				con_archive[uuid].id = *p;
+				con_archive[uuid].logout_time = now;
+			}
+		}
+	}
+	
+	log_info("journal", "recovered %d games from %u records (%u bytes) in %lu ms",
+		(int) games.size(), records, (unsigned int) jr.pos, sys_time_ms() - start);
+}
+
+
+// (re)start the binary trace of game events
+void game_trace_open()
+{
+	char filename[1024];
+	snprintf(filename, sizeof(filename), "%s/trace.hnt", sys_config_path());
+	
+	if (trace_open(filename, (size_t) config.getInt("trace_file_size") * 1024 * 1024) == 0)
+		log_info("trace", "tracing game events into %s", filename);
+	else
+		log_error("trace", "error: cannot open trace file %s", filename);
+}
 
 int gameinit()
 {
-	// initialize server stats struct
-	memset(&stats, 0, sizeof(server_stats));
-	stats.server_started = time(NULL);
+	// a resumed server has its games already
+	const bool resumed = stats.server_started;
+	
+	// initialize server stats struct (unless resumed by an upgrade)
+	if (!stats.server_started)
+	{
+		memset(&stats, 0, sizeof(server_stats));
+		stats.server_started = time(NULL);
+	}
+	
+	
+#ifdef DEBUG
+	// the keyword tables are generated; catch stale ones early
+	if (!keyword_table_check(command_table) ||
+		!keyword_table_check(request_table) ||
+		!keyword_table_check(action_table))
+	{
+		log_error("game", "error: inconsistent keyword table");
+	}
+#endif
 	
 	
 #ifndef NOSQLITE
@@ -1549,13 +3365,67 @@ int gameinit()
 #endif /* NOSQLITE */
 	
 	
+	// journal of all events; restores the games of a crashed server
+	if (config.getBool("journal"))
+	{
+		char filename[1024];
+		snprintf(filename, sizeof(filename), "%s/journal.hnj", sys_config_path());
+		
+		if (!resumed)
+			journal_recover(filename);
+		
+		// start over with a snapshot of the restored games
+		game_journal = journal_open(filename, config.getBool("journal_sync"));
+		
+		if (game_journal && journal_checkpoint())
+		{
+			GameController::setJournal(game_journal);
+			log_info("journal", "journaling games into %s", filename);
+		}
+		else
+		{
+			log_error("journal", "error: cannot open journal %s", filename);
+			
+			if (game_journal)
+				journal_close(game_journal);
+			game_journal = NULL;
+		}
+	}
+	
+	
+	// hand-history; a resumed server continues with a new segment
+	if (config.getBool("hand_history"))
+	{
+		char dir[1024];
+		snprintf(dir, sizeof(dir), "%s/hands", sys_config_path());
+		sys_mkdir(dir);
+		
+		handlog = handlog_writer_open(dir,
+			(size_t) config.getInt("hand_history_segment_size") * 1024 * 1024,
+			64 * 1024);
+		
+		if (handlog)
+			log_info("handlog", "writing hand-history segment %u into %s",
+				handlog_writer_segment(handlog), dir);
+		else
+			log_error("handlog", "error: cannot open hand-history in %s", dir);
+		
+		GameController::setHandLog(handlog);
+	}
+	
+	
+	// binary trace of game events; the previous file is kept as .old
+	if (config.getBool("trace"))
+		game_trace_open();
+	
+	
 #ifdef DEBUG
 	// initially add games for debugging purpose
 	if (!games.size())
 	{
 		for (int i=0; i < config.getInt("dbg_testgame_games"); i++)
 		{
-			GameController *g = new GameController();
+			GameController *g = GameController::create();
 			const int gid = i;
 			g->setGameId(gid);
 			g->setName("test game");
@@ -1564,6 +3434,9 @@ int gameinit()
 			g->setPlayerMax(config.getInt("dbg_testgame_players"));
 			g->setPlayerTimeout(config.getInt("dbg_testgame_timeout"));
 			g->setPlayerStakes(config.getInt("dbg_testgame_stakes"));
+			g->setSpectatorRate(config.getInt("spectator_rate"));
+			g->setSpectatorDelay(config.getInt("spectator_delay"));
+			g->setSpectatorMax(config.getInt("max_spectators_per_game"));
 			
 			if (config.getBool("dbg_stresstest") && i > 10)
 			{
@@ -1573,6 +3446,9 @@ int gameinit()
 			
 			games[gid] = g;
 			
+			game_record(g);
+			journal_game(g);
+			
 			gid_counter++;
 		}
 	}
@@ -1581,6 +3457,112 @@ int gameinit()
 	return 0;
 }
 
+// find changes of the game-list since the last run and push them to all
+// lobby subscribers; changes within an interval are coalesced
+static void lobby_update()
+{
+	const time_t now = time(NULL);
+	
+	if ((unsigned int) difftime(now, last_lobby_update) < (unsigned int) config.getInt("lobby_interval"))
+		return;
+	
+	last_lobby_update = now;
+	
+	
+	vector<int> created, changed, removed;
+	
+	for (games_type::const_iterator e = games.begin(); e != games.end(); e++)
+	{
+		const unsigned int revision = e->second->getInfoRevision();
+		
+		lobbygames_type::iterator it = lobby_games.find(e->first);
+		if (it == lobby_games.end())
+		{
+			created.push_back(e->first);
+			lobby_games[e->first] = revision;
+		}
+		else if (it->second != revision)
+		{
+			changed.push_back(e->first);
+			it->second = revision;
+		}
+	}
+	
+	for (lobbygames_type::iterator e = lobby_games.begin(); e != lobby_games.end();)
+	{
+		if (!get_game_by_id(e->first))
+		{
+			removed.push_back(e->first);
+			lobby_games.erase(e++);
+		}
+		else
+			++e;
+	}
+	
+	
+	// server stats are sent less often and only if the counts have changed
+	bool stats_changed = false;
+	if ((unsigned int) difftime(now, last_lobby_stats) >= (unsigned int) config.getInt("lobby_stats_interval") &&
+		(clients.size() != lobby_clients_count || games.size() != lobby_games_count))
+	{
+		lobby_clients_count = clients.size();
+		lobby_games_count = games.size();
+		last_lobby_stats = now;
+		stats_changed = true;
+	}
+	
+	if (created.empty() && changed.empty() && removed.empty() && !stats_changed)
+		return;
+	
+	
+	string screated, sremoved;
+	for (unsigned int i=0; i < created.size(); i++)
+	{
+		snprintf(msg, sizeof(msg), " %d", created[i]);
+		screated += msg;
+	}
+	
+	for (unsigned int i=0; i < removed.size(); i++)
+	{
+		snprintf(msg, sizeof(msg), " %d", removed[i]);
+		sremoved += msg;
+	}
+	
+	for (clients_type::iterator e = clients.begin(); e != clients.end(); e++)
+	{
+		clientcon *client = &*e;
+		
+		if (!(client->state & Lobby))
+			continue;
+		
+		if (!created.empty())
+		{
+			snprintf(msg, sizeof(msg), "LOBBY created%s", screated.c_str());
+			send_msg(client, msg);
+		}
+		
+		// game info contains client specific flags
+		string infos;
+		for (unsigned int i=0; i < created.size(); i++)
+			gameinfo_append(client, created[i], infos);
+		
+		for (unsigned int i=0; i < changed.size(); i++)
+			gameinfo_append(client, changed[i], infos);
+		
+		if (infos.length())
+			send_data(client, infos.data(), infos.length());
+		
+		if (!removed.empty())
+		{
+			snprintf(msg, sizeof(msg), "LOBBY removed%s", sremoved.c_str());
+			send_msg(client, msg);
+		}
+		
+		if (stats_changed)
+			send_serverinfo(client);
+	}
+}
+
 int gameloop()
 {
 	// handle all games
@@ -1596,25 +3578,32 @@ int gameloop()
 			if (g->getRestart())
 			{
 				const int gid = ++gid_counter;
-				GameController *newgame = new GameController(*g);
+				GameController *newgame = GameController::create(*g);
 				
 				// set new ID
 				newgame->setGameId(gid);
 				
 				games[gid] = newgame;
 				
-				log_msg("game", "restarted game (old: %d, new: %d)",
+				game_record(newgame);
+				journal_game(newgame);
+				
+				log_info("game", "restarted game (old: %d, new: %d)",
 					g->getGameId(), newgame->getGameId());
 			}
 			else
-				log_msg("game", "deleting game %d", g->getGameId());
+				log_info("game", "deleting game %d", g->getGameId());
+			
+			gameinfo_caches.erase(e->first);
+			journal_event(GameController::JournalDelete, e->first);
 			
-			delete g;
+			GameController::destroy(g);
 			games.erase(e++);
 		}
 		else if (rc == 1 && !g->isFinished())  // game has ended (but not deleted)
 		{
 			g->setFinished();
+			journal_event(GameController::JournalFinished, e->first);
 			
 #ifndef NOSQLITE
 			ranking_update(g);
@@ -1627,6 +3616,13 @@ int gameloop()
 	}
 	
 	
+	// broadcast foyer joins/leaves
+	foyer_update();
+	
+	// push game-list changes to lobby subscribers
+	lobby_update();
+	
+	
 	// delete all expired archived connection-data (con_archive)
 	if ((unsigned int)difftime(time(NULL), last_conarchive_cleanup) > 5 * 60)
 	{
@@ -1635,5 +3631,86 @@ int gameloop()
 		last_conarchive_cleanup = time(NULL);
 	}
 	
+	
+	// hand the buffered hand-history over to the OS (no sync to disk)
+	if (handlog && (unsigned int)difftime(time(NULL), last_handlog_flush) >= (unsigned int) config.getInt("hand_history_flush_interval"))
+	{
+		if (handlog_writer_flush(handlog) < 0)
+		{
+			log_error("handlog", "error: writing hand-history failed, disabled");
+			
+			GameController::setHandLog(NULL);
+			handlog_writer_close(handlog);
+			handlog = NULL;
+		}
+		
+		last_handlog_flush = time(NULL);
+	}
+	
+	
+	// write the trace events of the game thread
+	if (trace_enabled && (unsigned int)difftime(time(NULL), last_trace_flush) >= (unsigned int) config.getInt("trace_flush_interval"))
+	{
+		trace_flush();
+		
+		last_trace_flush = time(NULL);
+	}
+	
+	
+	// group commit: the events of all games since the last commit
+	if (game_journal && journal_pending(game_journal) &&
+		sys_time_ms() - last_journal_commit >= (unsigned long) config.getInt("journal_commit_interval"))
+	{
+		if (journal_commit(game_journal) < 0)
+			journal_disable();
+		
+		last_journal_commit = sys_time_ms();
+	}
+	
+	// a new snapshot keeps the journal short
+	if (game_journal && (unsigned int)difftime(time(NULL), last_journal_checkpoint) >= (unsigned int) config.getInt("journal_checkpoint_interval"))
+	{
+		if (!journal_checkpoint())
+			journal_disable();
+	}
+	
+#ifndef NOSQLITE
+	// write-behind: the rankings changed since the last interval
+	if ((unsigned int)difftime(time(NULL), last_ranking_flush) >= (unsigned int) config.getInt("ranking_write_interval"))
+	{
+		ranking_flush();
+		
+		last_ranking_flush = time(NULL);
+	}
+#endif /* !NOSQLITE */
+	
 	return 0;
 }
+
+void gameshutdown()
+{
+#ifndef NOSQLITE
+	// write all changed rankings
+	ranking_shutdown();
+#endif /* !NOSQLITE */
+	
+	if (game_journal)
+	{
+		if (journal_commit(game_journal) < 0)
+			log_error("journal", "error: writing journal failed");
+		
+		GameController::setJournal(NULL);
+		journal_close(game_journal);
+		game_journal = NULL;
+	}
+	
+
+	if (handlog)
+	{
+		GameController::setHandLog(NULL);
+		handlog_writer_close(handlog);
+		handlog = NULL;
+	}
+	
+	trace_close();
+}
@@ -33,6 +33,9 @@
 #include "Platform.h"
 #include "Network.h"
 #include "Protocol.h"
+#include "RingBuffer.h"
+#include "WireProtocol.hpp"
+#include "ZStream.h"
 
 #include "GameController.hpp"
 
@@ -42,7 +45,9 @@ typedef enum {
 	Connected = 0x01,
 	Introduced = 0x02,
 	SentInfo = 0x04,
-	Authed = 0x08
+	Authed = 0x08,
+	Lobby = 0x10,  // subscribed to game-list updates
+	Dropped = 0x20 // output was lost; closed by clients_drop()
 } clientstate;
 
 //! \brief Client-connection information
@@ -56,13 +61,20 @@ typedef struct {
 	sockaddr_in	saddr;
 	//! \brief Client version
 	unsigned int	version;
+	//! \brief Version of binary protocol in use (0 for text protocol)
+	unsigned int	wire_version;
 	//! \brief Unique connection-identifier chosen by client
 	char uuid[37];  // 16*2 + 4 sep + \0 = 37
 	
 	//! \brief Receive-buffer for client messages
-	char	msgbuf[1024];
-	//! \brief Length of current buffer
-	int	buflen;
+	ringbuffer	rbuf;
+	
+	//! \brief Output the socket did not take yet (allocated on demand)
+	ringbuffer	wbuf;
+	
+	//! \brief Compression streams (NULL if compression isn't used)
+	zstream		*zout;
+	zstream		*zin;
 	
 	//! \brief Id of last received message
 	int	last_msgid;
@@ -92,6 +104,35 @@ typedef struct {
 //! \brief Type for list of games
 typedef std::map<int,GameController*>	games_type;
 
+//! \brief Foyer join/leave; broadcast batched
+typedef struct {
+	//! \brief snap_foyer_type
+	int	type;
+	int	cid;
+	char	name[20+1];
+} foyer_event;
+
+//! \brief Type for list of pending foyer events
+typedef std::vector<foyer_event>	foyerevents_type;
+
+//! \brief Type for list of games known to lobby subscribers (game info revision)
+typedef std::map<int,unsigned int>	lobbygames_type;
+
+//! \brief Serialized game info; only the flags depend on the requester
+typedef struct {
+	//! \brief Game info revision the cache has been built from
+	unsigned int	revision;
+	//! \brief Flags not depending on the requester
+	unsigned int	flags;
+	//! \brief Text message before and after the flags
+	std::string	text_head, text_tail;
+	//! \brief Binary payload before and after the flags
+	std::string	wire_head, wire_tail;
+} gameinfo_cache;
+
+//! \brief Type for list of cached game infos
+typedef std::map<int,gameinfo_cache>	gameinfocache_type;
+
 //! \brief Type for list of client connection information
 typedef std::vector<clientcon>	clients_type;
 
@@ -106,19 +147,35 @@ typedef struct {
 	unsigned int	clients_incompatible;
 	unsigned int	games_created;
 	
+	//! \brief Traffic of compressing clients; before and after compression
+	unsigned long	bytes_out_raw;
+	unsigned long	bytes_out_compressed;
+	unsigned long	bytes_in_raw;
+	unsigned long	bytes_in_compressed;
 } server_stats;
 
 // used by pserver.cpp
 int gameinit();
 int gameloop();
+void gameshutdown();
 clients_type& get_client_vector();
 bool client_add(socktype sock, sockaddr_in *saddr);
 bool client_remove(socktype sock);
 int client_handle(socktype sock);
+int client_handle_write(socktype sock);
+void clients_flush();
+void clients_drop();
+
+// used by upgrade.cpp
+bool game_save_state(wire_writer *w, std::vector<socktype> &fds);
+bool game_load_state(wire_reader *r, const std::vector<socktype> &fds);
+void game_trace_open();
 
 // used by GameController.cpp
 bool client_chat(int from_gid, int from_tid, int to, const char *message);
 bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *message);
+bool client_snapshot_table(int from_gid, int from_tid, int to, unsigned int seq,
+	const wire_table_snap *ts, const wire_table_snap *base, unsigned int base_seq);
 
 // used by ranking.cpp
 clientcon* get_client_by_id(int cid);
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <utility>
+
+#include "Config.h"
+#include "Platform.h"
+#include "Card.hpp"
+#include "Player.hpp"
+#include "HandLog.h"
+
+using namespace std;
+
+
+typedef pair<unsigned int,unsigned int> hand_key;   // game, hand
+
+static const char *type_names[HandlogTypeMax] = {
+	"", "start", "seat", "blind", "hole", "board", "action", "show", "payout", "bust", "end"
+};
+
+static const char *round_names[] = { "preflop", "flop", "turn", "river" };
+
+
+static const char* action_name(unsigned int action)
+{
+	switch (action)
+	{
+	case Player::Check: return "check";
+	case Player::Fold: return "fold";
+	case Player::Call: return "call";
+	case Player::Bet: return "bet";
+	case Player::Raise: return "raise";
+	case Player::Allin: return "allin";
+	default: return "?";
+	}
+}
+
+static int type_by_name(const char *name)
+{
+	for (int i=1; i < HandlogTypeMax; i++)
+	{
+		if (!strcmp(type_names[i], name))
+			return i;
+	}
+	
+	return -1;
+}
+
+static void print_cards(const handlog_record *rec)
+{
+	for (unsigned int i=0; i < rec->ncards && i < sizeof(rec->cards); i++)
+	{
+		const unsigned int code = rec->cards[i];
+		
+		if (code < 1 || code > 52)
+		{
+			printf(" ??");
+			continue;
+		}
+		
+		Card c((Card::Face) HANDLOG_CARD_FACE(code), (Card::Suit) HANDLOG_CARD_SUIT(code));
+		printf(" %s", c.getName());
+	}
+}
+
+static void print_record(const handlog_record *rec)
+{
+	printf("%u game %u hand %u table %u %-6s",
+		rec->time, rec->game, rec->hand, (unsigned int) rec->table,
+		(rec->type < HandlogTypeMax) ? type_names[rec->type] : "?");
+	
+	if (rec->seat != HANDLOG_NO_SEAT && rec->type != HandlogHandStart)
+		printf(" seat %u client %d", (unsigned int) rec->seat, rec->client);
+	
+	switch (rec->type)
+	{
+	case HandlogHandStart:
+		printf(" dealer %u blind %u", (unsigned int) rec->seat, rec->amount);
+		break;
+	case HandlogSeat:
+		printf(" stake %u", rec->amount);
+		break;
+	case HandlogBlind:
+		printf(" %s %u", rec->action ? "big" : "small", rec->amount);
+		break;
+	case HandlogHole:
+	case HandlogShow:
+		print_cards(rec);
+		break;
+	case HandlogBoard:
+		printf(" %s", (rec->round < 4) ? round_names[rec->round] : "?");
+		print_cards(rec);
+		break;
+	case HandlogAction:
+		printf(" %s", action_name(rec->action));
+		if (rec->amount)
+			printf(" %u", rec->amount);
+		if (rec->flags & HandlogFlagAuto)
+			printf(" (auto)");
+		break;
+	case HandlogPayout:
+		printf(" pot %u %u", (unsigned int) rec->action, rec->amount);
+		if (rec->flags & HandlogFlagOddChips)
+			printf(" (odd chips)");
+		break;
+	case HandlogBust:
+		printf(" position %u", rec->amount);
+		break;
+	case HandlogHandEnd:
+		printf(" players %u", rec->amount);
+		break;
+	}
+	
+	printf("\n");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] segment...\n"
+		"  -g <gid>    records of this game\n"
+		"  -n <hand>   records of this hand number\n"
+		"  -t <tid>    records of this table\n"
+		"  -c <cid>    hands the client took part in\n"
+		"  -r <type>   records of this type (may be repeated):\n"
+		"              start seat blind hole board action show payout bust end\n"
+		"  -s          print a summary instead of the records\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	handlog_filter filter;
+	handlog_filter_init(&filter);
+	
+	int client = -1;
+	bool summary = false;
+	int i;
+	
+	for (i=1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-s"))
+		{
+			summary = true;
+			continue;
+		}
+		
+		if (i + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		
+		const char *arg = argv[++i];
+		
+		switch (argv[i - 1][1])
+		{
+		case 'g':
+			filter.game = atoi(arg);
+			break;
+		case 'n':
+			filter.hand = atoi(arg);
+			break;
+		case 't':
+			filter.table = atoi(arg);
+			break;
+		case 'c':
+			client = atoi(arg);
+			break;
+		case 'r':
+		{
+			const int type = type_by_name(arg);
+			if (type < 0)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			filter.types |= 1u << type;
+			break;
+		}
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	
+	if (i >= argc)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	
+	const int first_segment = i;
+	
+	
+	// a hand may continue in the next segment; find the client's hands first
+	set<hand_key> hands;
+	
+	if (client != -1)
+	{
+		handlog_filter seats;
+		handlog_filter_init(&seats);
+		seats.game = filter.game;
+		seats.hand = filter.hand;
+		seats.client = client;
+		seats.types = 1u << HandlogSeat;
+		
+		for (i = first_segment; i < argc; i++)
+		{
+			handlog_segment seg;
+			if (handlog_segment_open(&seg, argv[i]) < 0)
+				continue;
+			
+			size_t pos = 0;
+			const handlog_record *rec;
+			while ((rec = handlog_next(&seg, &pos, &seats)))
+				hands.insert(hand_key(rec->game, rec->hand));
+			
+			handlog_segment_close(&seg);
+		}
+	}
+	
+	
+	unsigned long count_records = 0, count_hands = 0;
+	unsigned long count_types[HandlogTypeMax];
+	memset(count_types, 0, sizeof(count_types));
+	
+	int rc = 0;
+	
+	for (i = first_segment; i < argc; i++)
+	{
+		handlog_segment seg;
+		if (handlog_segment_open(&seg, argv[i]) < 0)
+		{
+			fprintf(stderr, "%s: not a hand-history segment\n", argv[i]);
+			rc = 1;
+			continue;
+		}
+		
+		size_t pos = 0;
+		const handlog_record *rec;
+		while ((rec = handlog_next(&seg, &pos, &filter)))
+		{
+			if (client != -1 && !hands.count(hand_key(rec->game, rec->hand)))
+				continue;
+			
+			count_records++;
+			
+			if (rec->type < HandlogTypeMax)
+				count_types[rec->type]++;
+			
+			if (rec->type == HandlogHandStart)
+				count_hands++;
+			
+			if (!summary)
+				print_record(rec);
+		}
+		
+		handlog_segment_close(&seg);
+	}
+	
+	if (summary)
+	{
+		printf("records %lu hands %lu\n", count_records, count_hands);
+		
+		for (int t=1; t < HandlogTypeMax; t++)
+			printf("  %-6s %lu\n", type_names[t], count_types[t]);
+	}
+	
+	return rc;
+}
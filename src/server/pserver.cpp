@@ -25,10 +25,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-
-#if !defined(PLATFORM_WINDOWS)
-# include <signal.h>
-#endif
+#include <csignal>
 
 #include <vector>
 
@@ -40,16 +37,38 @@
 #include "Platform.h"
 #include "Debug.h"
 #include "Logger.h"
+#include "AsyncLog.h"
 
 #include "Network.h"
 #include "SysAccess.h"
 #include "ConfigParser.hpp"
 #include "game.hpp"
+#include "upgrade.hpp"
 
 using namespace std;
 
 ConfigParser config;
 
+// command line; the upgraded server is started the same way
+static int main_argc;
+static char **main_argv;
+
+#if !defined(PLATFORM_WINDOWS)
+static volatile sig_atomic_t upgrade_requested = 0;
+
+static void upgrade_signal(int sig)
+{
+	upgrade_requested = 1;
+}
+#endif
+
+static volatile sig_atomic_t shutdown_requested = 0;
+
+static void shutdown_signal(int sig)
+{
+	shutdown_requested = 1;
+}
+
 #ifndef NOSQLITE
 Database *db;
 #endif /* !NOSQLITE */
@@ -72,7 +91,7 @@ int listensock_create(unsigned int port, int backlog)
 
 	if ((listenfd = socket_create(PF_INET, SOCK_STREAM, 0)) == -1)
 	{
-		log_msg("listensock", "socket() failed (%d: %s)", errno, strerror(errno));
+		log_error("listensock", "socket() failed (%d: %s)", errno, strerror(errno));
 		return -1;
 	}
 	
@@ -86,7 +105,7 @@ int listensock_create(unsigned int port, int backlog)
 	int reuse = 1;
 	if (socket_setopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
 	{
-		log_msg("listensock", "setsockopt:SO_REUSEADDR failed");
+		log_error("listensock", "setsockopt:SO_REUSEADDR failed");
 		return -4;
 	}
 	
@@ -94,35 +113,35 @@ int listensock_create(unsigned int port, int backlog)
 	
 	if (socket_bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
 	{
-		log_msg("listensock", "bind() failed: (%d: %s)", errno, strerror(errno));
+		log_error("listensock", "bind() failed: (%d: %s)", errno, strerror(errno));
 		return -2;
 	}
 	
 	if (socket_listen(sock, backlog) == -1)
 	{
-		log_msg("listensock", "listen() failed: (%d: %s)", errno, strerror(errno));
+		log_error("listensock", "listen() failed: (%d: %s)", errno, strerror(errno));
 		return -3;
 	}
 	
 	
-	log_msg("listensock", "listening (port: %d)", port);
+	log_info("listensock", "listening (port: %d)", port);
 	
 	return sock;
 }
 
-int mainloop()
+// listenfd is the socket taken over on an upgrade; -1 to create one
+int mainloop(int listenfd)
 {
-	int listenfd;
-	if ((listenfd = listensock_create(config.getInt("port"), SERVER_LISTEN_BACKLOG)) < 0)
+	if (listenfd < 0 && (listenfd = listensock_create(config.getInt("port"), SERVER_LISTEN_BACKLOG)) < 0)
 	{
-		log_msg("listensock", "(%d) error creating socket", listenfd);
+		log_error("listensock", "(%d) error creating socket", listenfd);
 		return 1;
 	}
 	
 	
 	socktype sock = listenfd;
 	socktype max;     /* highest socket number select() uses */
-	fd_set fds;
+	fd_set fds, wfds;
 	
 	
 	for (;;)
@@ -130,11 +149,34 @@ int mainloop()
 		// handle game
 		gameloop();
 		
+		// send out the queued output of compressing clients
+		clients_flush();
+		
+		// close the clients whose output could not be sent
+		clients_drop();
+		
+		if (shutdown_requested)
+		{
+			log_info("main", "shutting down");
+			return 0;
+		}
+		
+#if !defined(PLATFORM_WINDOWS)
+		if (upgrade_requested)
+		{
+			upgrade_requested = 0;
+			upgrade_start(main_argc, main_argv);
+		}
+		
+		const socktype upgrade_sock = upgrade_channel();
+#endif
+		
 		struct timeval timeout;  /* timeout for select */
 		timeout.tv_sec  = 0;
 		timeout.tv_usec = SERVER_SELECT_TIMEOUT_USEC;
 		
 		FD_ZERO(&fds);
+		FD_ZERO(&wfds);
 		
 		/* add listening socket to the fd-set */
 		FD_SET(sock, &fds);
@@ -147,14 +189,51 @@ int mainloop()
 			socktype client_sock = clientvec[i].sock;
 			FD_SET(client_sock, &fds);
 			
+			// wait for the socket to take the pending output
+			if (clientvec[i].wbuf.len)
+				FD_SET(client_sock, &wfds);
+			
 			if (client_sock > max)
 				max = client_sock;
 		}
 		
+#if !defined(PLATFORM_WINDOWS)
+		/* add channel to the upgraded server */
+		if (upgrade_sock != -1)
+		{
+			FD_SET(upgrade_sock, &fds);
+			
+			if (upgrade_sock > max)
+				max = upgrade_sock;
+		}
+#endif
+		
 		
-		// are there any modified descriptors?
-		if (select(max + 1, &fds, NULL, NULL, &timeout))
+		// are there any modified descriptors? (none if interrupted by a signal)
+		int ready = select(max + 1, &fds, &wfds, NULL, &timeout);
+		if (ready > 0)
 		{
+#if !defined(PLATFORM_WINDOWS)
+			// the upgraded server is ready to take over
+			if (upgrade_sock != -1 && FD_ISSET(upgrade_sock, &fds))
+			{
+				if (upgrade_handle(sock) == 1)
+					return 0;
+				
+				continue;
+			}
+#endif
+			
+			// write out the pending output; failing clients are dropped next iteration
+			for (unsigned int i=0; i < clientvec.size(); i++)
+			{
+				if (FD_ISSET(clientvec[i].sock, &wfds))
+				{
+					client_handle_write(clientvec[i].sock);
+					ready--;
+				}
+			}
+			
 			// listen socket
 			if (FD_ISSET(sock, &fds))
 			{
@@ -163,7 +242,7 @@ int mainloop()
 				memset(&saddr, 0, sizeof(sockaddr_in));
 				
 				socktype client_sock = socket_accept(sock, (struct sockaddr*) &saddr, &saddrlen);
-				log_msg("listensock", "(%d) accepted connection (%s)",
+				log_info("listensock", "(%d) accepted connection (%s)",
 					client_sock, inet_ntoa((struct in_addr) saddr.sin_addr));
 				
 				socket_setnonblocking(client_sock);
@@ -172,7 +251,7 @@ int mainloop()
 				
 				FD_CLR(sock, &fds);
 			}
-			else
+			else if (ready > 0)
 			{
 				// handle only one client-request per iteration
 				socktype sender = fdset_get_descriptor(&fds);
@@ -182,7 +261,7 @@ int mainloop()
 				{
 					if (!status)
 						errno = 0;
-					log_msg("clientsock", "(%d) socket closed (%d: %s)", sender, errno, strerror(errno));
+					log_info("clientsock", "(%d) socket closed (%d: %s)", sender, errno, strerror(errno));
 
 					client_remove(sender);
 					
@@ -214,11 +293,11 @@ bool config_load()
 	snprintf(cfgfile, sizeof(cfgfile), "%s/server.cfg", sys_config_path());
 	
 	if (config.load(cfgfile))
-		log_msg("config", "Loaded configuration from %s", cfgfile);
+		log_info("config", "Loaded configuration from %s", cfgfile);
 	else
 	{
 		if (config.save(cfgfile))
-			log_msg("config", "Saved initial configuration to %s", cfgfile);
+			log_info("config", "Saved initial configuration to %s", cfgfile);
 	}
 	
 	return true;
@@ -235,38 +314,69 @@ int database_init()
 	
 	if (db->open(dbfile))
 	{
-		log_msg("sqlite", "Error opening database");
+		log_error("sqlite", "Error opening database");
 		return 1;
 	}
 	
+	// tuning; SQLite may refuse a setting (e.g. WAL on some file systems)
+	char value[32];
+	db->setPragma("journal_mode", config.get("db_journal_mode").c_str());
+	db->setPragma("synchronous", config.get("db_synchronous").c_str());
+	snprintf(value, sizeof(value), "%d", -config.getInt("db_cache_size"));  // negative: KB
+	db->setPragma("cache_size", value);
+	snprintf(value, sizeof(value), "%ld", config.getInt("db_mmap_size") * 1024L * 1024L);
+	db->setPragma("mmap_size", value);
+	
+	log_info("sqlite", "journal_mode=%s synchronous=%s cache_size=%s mmap_size=%s",
+		db->getPragma("journal_mode").c_str(), db->getPragma("synchronous").c_str(),
+		db->getPragma("cache_size").c_str(), db->getPragma("mmap_size").c_str());
+	
 	return 0;
 }
 #endif /* !NOSQLITE */
 
 int main(int argc, char **argv)
 {
+	main_argc = argc;
+	main_argv = argv;
+	
 	log_set(stdout, 0);
 	
-	log_msg("main", "HoldingNuts pserver (version %d.%d.%d; svn %s)",
+	log_info("main", "HoldingNuts pserver (version %d.%d.%d; svn %s)",
 		VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION,
 		VERSIONSTR_SVN);
 	
 #if !defined(PLATFORM_WINDOWS)
 	// ignore broken-pipe signal eventually caused by sockets
 	signal(SIGPIPE, SIG_IGN);
+	
+	// SIGUSR2 upgrades to the (new) server binary without downtime
+	signal(SIGUSR2, upgrade_signal);
 #endif
 	
+	// finish pending work (e.g. rankings) before exiting
+	signal(SIGINT, shutdown_signal);
+	signal(SIGTERM, shutdown_signal);
+	
 	// init PRNG
 	srand((unsigned) time(NULL));
 	
 	
-	// use config-directory set on command-line
-	if (argc >= 3 && (argv[1][0] == '-' && argv[1][1] == 'c'))
+	int upgrade_fd = -1;
+	
+	for (int i=1; i + 1 < argc; i += 2)
 	{
-		const char *path = argv[2];
-		
-		sys_set_config_path(path);
-		log_msg("config", "Using manual config-directory '%s'", path);
+		// use config-directory set on command-line
+		if (!strcmp(argv[i], "-c"))
+		{
+			const char *path = argv[i + 1];
+			
+			sys_set_config_path(path);
+			log_info("config", "Using manual config-directory '%s'", path);
+		}
+		// started by the running server to take over (upgrade)
+		else if (!strcmp(argv[i], "-u"))
+			upgrade_fd = atoi(argv[i + 1]);
 	}
 	
 	
@@ -281,7 +391,7 @@ int main(int argc, char **argv)
 	{
 		char logfile[1024];
 		snprintf(logfile, sizeof(logfile), "%s/server.log", sys_config_path());
-		fplog = file_open(logfile, config.getBool("log_append")
+		fplog = file_open(logfile, (config.getBool("log_append") || upgrade_fd != -1)
 				  ? mode_append
 				  : mode_write);
 		
@@ -293,20 +403,64 @@ int main(int argc, char **argv)
 			log_use_timestamp(1);
 	}
 	
+	// categories are registered when they log first; register those of
+	// the server up front, so 'CONFIG log' accepts them from the start
+	static const char *server_log_categories[] = {
+		"auth", "client", "clientar", "clientsock", "config", "finish",
+		"flooding", "game", "handlog", "journal", "listensock", "log",
+		"main", "record", "score", "sqlite", "trace", "update_scores",
+		"upgrade", "uuid", "winlist"
+	};
+	for (unsigned int i=0; i < sizeof(server_log_categories) / sizeof(server_log_categories[0]); i++)
+		log_category_get(server_log_categories[i]);
+	
+	// levels of the log categories
+	const int log_level = log_level_by_name(config.get("log_level").c_str());
+	if (log_level == -1)
+		log_warn("log", "unknown log_level '%s'", config.get("log_level").c_str());
+	else if (log_set_level("*", log_level))
+		log_warn("log", "log_level '%s' is not compiled in; using '%s'",
+			config.get("log_level").c_str(), log_level_name(LOG_MIN_LEVEL));
+	
+	// categories of other builds or versions may be named; create them
+	const int rc = log_set_levels(config.get("log_categories").c_str(), 1);
+	if (rc < 0)
+		log_warn("log", "invalid entry in log_categories '%s'", config.get("log_categories").c_str());
+	else if (rc)
+		log_warn("log", "levels above '%s' in log_categories are not compiled in", log_level_name(LOG_MIN_LEVEL));
+	
+	// write the log by a thread of its own
+	if (config.getBool("log_async") &&
+		log_async_start(config.getInt("log_buffer"),
+			(config.get("log_overflow") == "drop") ? log_overflow_drop : log_overflow_block) < 0)
+	{
+		log_error("log", "error: cannot start asynchronous logging");
+	}
+	
 	
 	network_init();
 
 #ifndef NOSQLITE
 	if (database_init())
 	{
-		log_msg("sqlite", "Error initializing database handle");
+		log_error("sqlite", "Error initializing database handle");
 		return 1;
 	}
 #endif /* !NOSQLITE */
 	
+	int listenfd = -1;
+	
+#if !defined(PLATFORM_WINDOWS)
+	// continue with the state of the running server
+	if (upgrade_fd != -1 && upgrade_resume(upgrade_fd, &listenfd))
+		return 1;
+#endif
+	
 	gameinit();
 	
-	mainloop();
+	mainloop(listenfd);
+	
+	gameshutdown();
 	
 #ifndef NOSQLITE
 	delete db;
@@ -315,6 +469,14 @@ int main(int argc, char **argv)
 	network_shutdown();
 	
 	
+	log_async_stats ls;
+	log_async_get_stats(&ls);
+	if (ls.batches)
+		log_info("log", "%lu lines written in %lu batches so far (%lu dropped)", ls.lines, ls.batches, ls.dropped);
+	
+	// write all pending lines before closing the log-file
+	log_async_stop();
+	
 	// close log-file
 	if (fplog)
 		file_close(fplog);
@@ -22,12 +22,17 @@
 
 
 #include <cmath>
+#include <deque>
 
 #include "Config.h"
 #include "Platform.h"
 #include "Debug.h"
 #include "Logger.h"
+#include "SysAccess.h"
+#include "Thread.h"
+#include "ConfigParser.hpp"
 #include "Database.hpp"
+#include "RankingStore.hpp"
 
 #include "game.hpp"
 #include "Player.hpp"
@@ -36,8 +41,44 @@
 
 
 #ifndef NOSQLITE
+extern ConfigParser config;
 extern Database *db;
 
+/* The rankings of all players are kept in memory and written behind: the
+   game loop updates the store and collects the changed players once per
+   ranking_write_interval into a batch. Batches are written by a thread of
+   their own so the disk I/O does not hold up the game loop; the writer
+   takes all queued batches at once and writes them in one transaction. */
+
+// highest score of calc_score()
+static const int ranking_max_score = 1000;
+
+static RankingStore store(ranking_max_score);
+
+struct ranking_row
+{
+	std::string uuid;
+	std::string name;
+	int gamecount;
+	int ranking;
+};
+
+typedef std::vector<ranking_row> ranking_batch;
+
+static std::deque<ranking_batch*> ranking_queue;
+static sys_mutex ranking_mutex;
+static sys_cond ranking_cond;
+static sys_cond ranking_idle;		// all queued rankings written
+static sys_thread ranking_thread;
+static bool ranking_running = false;
+static bool ranking_stop = false;
+
+// WAL checkpoints of the writer; 0: SQLite checkpoints after commits
+static unsigned long checkpoint_interval = 0;	// ms
+
+// guarded by ranking_mutex
+static ranking_stats rstats;
+
 /*
 Example:
 - Score is 500 (max=1000, min=1)
@@ -91,7 +132,7 @@ new_score=667
 static unsigned int calc_score(unsigned int score, unsigned int num_players, unsigned int place)
 {
 	const unsigned int min_score = 1;
-	const unsigned int max_score = 1000;
+	const unsigned int max_score = ranking_max_score;
 	
 	const float diff_ratio = 1 / 8.0f;
 	
@@ -162,14 +203,167 @@ static unsigned int calc_score(unsigned int score, unsigned int num_players, uns
 }
 
 
+static int ranking_write_batch(const ranking_batch *batch)
+{
+	for (unsigned int i=0; i < batch->size(); i++)
+	{
+		const ranking_row &row = (*batch)[i];
+		
+		Statement write(db, "INSERT OR REPLACE INTO players "
+			"(uuid,name,t_lastgame,gamecount,ranking) VALUES(?1,?2,datetime('now'),?3,?4);");
+		write.bind(1, row.uuid);
+		write.bind(2, row.name);
+		write.bind(3, row.gamecount);
+		write.bind(4, row.ranking);
+		
+		int rc = write.execute();
+		if (rc)
+			return rc;
+	}
+	
+	return SQLITE_OK;
+}
+
+// write batches in one transaction; returns the number of players written
+static unsigned int ranking_write(const std::vector<ranking_batch*> &batches)
+{
+	Transaction transaction(db);
+	bool query_error = false;
+	unsigned int rows = 0;
+	
+	for (unsigned int i=0; i < batches.size() && !query_error; i++)
+	{
+		query_error = (ranking_write_batch(batches[i]) != SQLITE_OK);
+		rows += batches[i]->size();
+	}
+	
+	if (!query_error && transaction.commit() == SQLITE_OK)
+		return rows;
+	
+	transaction.rollback();
+	log_error("update_scores", "There was an error during transaction. Rolling back.");
+	
+	if (batches.size() == 1)
+	{
+		log_error("update_scores", "error: rankings of %d players not written", (int) rows);
+		return 0;
+	}
+	
+	// do not let a single batch take the others with it
+	unsigned int written = 0;
+	
+	for (unsigned int i=0; i < batches.size(); i++)
+	{
+		Transaction single(db);
+		
+		if (ranking_write_batch(batches[i]) == SQLITE_OK && single.commit() == SQLITE_OK)
+			written += batches[i]->size();
+		else
+			log_error("update_scores", "error: rankings of %d players not written", (int) batches[i]->size());
+	}
+	
+	return written;
+}
+
+// copy the write-ahead log back into the database without blocking anybody
+static void ranking_checkpoint()
+{
+	int log_frames, checkpointed;
+	
+	if (db->checkpoint(&log_frames, &checkpointed) != SQLITE_OK)
+	{
+		log_error("sqlite", "error: checkpoint failed");
+		return;
+	}
+	
+	sys_mutex_lock(&ranking_mutex);
+	rstats.checkpoints++;
+	rstats.checkpoint_frames += checkpointed;
+	sys_mutex_unlock(&ranking_mutex);
+}
+
+static void ranking_writer(void *arg)
+{
+	unsigned long last_checkpoint = sys_time_ms();
+	bool written_since = false;
+	
+	sys_mutex_lock(&ranking_mutex);
+	
+	for (;;)
+	{
+		while (ranking_queue.empty() && !ranking_stop)
+		{
+			if (!checkpoint_interval || !written_since)
+			{
+				sys_cond_wait(&ranking_cond, &ranking_mutex);
+				continue;
+			}
+			
+			const unsigned long since = sys_time_ms() - last_checkpoint;
+			
+			if (since < checkpoint_interval)
+			{
+				sys_cond_timedwait(&ranking_cond, &ranking_mutex, checkpoint_interval - since);
+				continue;
+			}
+			
+			sys_mutex_unlock(&ranking_mutex);
+			ranking_checkpoint();
+			sys_mutex_lock(&ranking_mutex);
+			
+			last_checkpoint = sys_time_ms();
+			written_since = false;
+		}
+		
+		// stopped and drained
+		if (ranking_queue.empty())
+			break;
+		
+		std::vector<ranking_batch*> batches(ranking_queue.begin(), ranking_queue.end());
+		ranking_queue.clear();
+		
+		sys_mutex_unlock(&ranking_mutex);
+		
+		unsigned int rows = 0;
+		for (unsigned int i=0; i < batches.size(); i++)
+			rows += batches[i]->size();
+		
+		const unsigned long start = sys_time_ms();
+		const unsigned int written = ranking_write(batches);
+		const unsigned long elapsed = sys_time_ms() - start;
+		
+		for (unsigned int i=0; i < batches.size(); i++)
+			delete batches[i];
+		
+		written_since = true;
+		
+		sys_mutex_lock(&ranking_mutex);
+		
+		rstats.queued -= rows;
+		rstats.players += written;
+		rstats.errors += rows - written;
+		rstats.transactions++;
+		rstats.last_commit_ms = elapsed;
+		if (elapsed > rstats.max_commit_ms)
+			rstats.max_commit_ms = elapsed;
+		
+		if (!rstats.queued)
+			sys_cond_broadcast(&ranking_idle);
+	}
+	
+	sys_mutex_unlock(&ranking_mutex);
+	
+	// leave no log behind to be replayed on the next start
+	if (checkpoint_interval && written_since)
+		ranking_checkpoint();
+}
+
+
 void ranking_update(const GameController *g)
 {
 	std::vector<Player*> player_list;
 	g->getFinishList(player_list);
 	
-	bool query_error = false;
-	int rc = db->query("BEGIN TRANSACTION;");
-	
 	for (unsigned int u=0; u < player_list.size(); u++)
 	{
 		const Player* player = player_list[u];
@@ -183,81 +377,67 @@ void ranking_update(const GameController *g)
 		if (!uuid.length())
 			continue;
 		
-		QueryResult *result;
-		rc = db->query(&result, "SELECT ranking FROM players WHERE uuid = '%q' LIMIT 1;", uuid.c_str());
+		const clientcon *client = get_client_by_id(player->getClientId());
+		const int idx = store.find(uuid);
 		
-		if (rc)
+		if (idx == -1)	// new player
 		{
-			query_error = true;
-			db->freeQueryResult(&result);
-			break;
+			const int initial_score = 500;
+			const int score = calc_score(initial_score, g->getPlayerCount(), place);
+			
+			// use either current or placeholder player name
+			store.insert(uuid, client ? client->info.name : "__unknown__", score, 1, true);
 		}
 		else
 		{
-			const clientcon *client = get_client_by_id(player->getClientId());
-			std::string player_name = "__unknown__";
-			
-			// use either stored or current player name
-			if (client)
-				player_name = client->info.name;
+			const RankingStore::Entry &e = store.get(idx);
+			const int new_score = calc_score(e.ranking, g->getPlayerCount(), place);
 			
+			dbg_msg("RATING", "uuid=%s  old_score=%d  new_score=%d",
+				uuid.c_str(), e.ranking, new_score);
 			
-			if (!result->numRows())	// insert new row
-			{
-				dbg_msg("SQL", "no rows, inserting...");
-				
-				const int initial_score = 500;
-				rc = db->query("INSERT INTO players "
-					"(uuid,name,t_lastgame,gamecount,ranking) VALUES('%q','%q',datetime('now'),%d,%d);",
-						uuid.c_str(), player_name.c_str(),
-						1, calc_score(initial_score, g->getPlayerCount(), place));
-				
-				if (rc)
-				{
-					query_error = true;
-					db->freeQueryResult(&result);
-					break;
-				}
-			}
-			else		// update row
-			{
-				const int old_score = atoi(result->getRow(0,0));
-				const int new_score = calc_score(old_score, g->getPlayerCount(), place);
-				
-				dbg_msg("RATING", "uuid=%s  old_score=%d  new_score=%d",
-					uuid.c_str(), old_score, new_score);
-				
-				// update player name only if client is connected
-				char *q_setname = 0;	// Note: mingw32 compiler warning if not set to 0
-				if (client)
-					q_setname = db->createQueryString("name = '%q',", player_name.c_str());
-				
-				rc = db->query("UPDATE players "
-					"SET %s t_lastgame = datetime('now'), gamecount = gamecount + 1, ranking = %d "
-					"WHERE uuid = '%q';", (client) ? q_setname : "", new_score, uuid.c_str());
-				
-				if (client)
-					db->freeQueryString(q_setname);
-				
-				if (rc)
-				{
-					query_error = true;
-					db->freeQueryResult(&result);
-					break;
-				}
-			}
+			// update player name only if client is connected
+			store.update(idx, client ? std::string(client->info.name) : e.name,
+				new_score, e.gamecount + 1);
 		}
+	}
+}
+
+void ranking_flush()
+{
+	if (!store.countDirty())
+		return;
+	
+	std::vector<int> changed;
+	store.takeDirty(changed);
+	
+	ranking_batch *batch = new ranking_batch(changed.size());
+	
+	for (unsigned int i=0; i < changed.size(); i++)
+	{
+		const RankingStore::Entry &e = store.get(changed[i]);
+		ranking_row &row = (*batch)[i];
 		
-		db->freeQueryResult(&result);
+		row.uuid = e.uuid;
+		row.name = e.name;
+		row.gamecount = e.gamecount;
+		row.ranking = e.ranking;
 	}
 	
-	if (!query_error)
-		rc = db->query("COMMIT;");
-	else
+	// without a writer thread, rankings are written by the game loop
+	if (!ranking_running)
 	{
-		rc = db->query("ROLLBACK;");
-		log_msg("update_scores", "There was an error during transaction. Rolling back.");
+		std::vector<ranking_batch*> batches(1, batch);
+		rstats.players += ranking_write(batches);
+		delete batch;
+		return;
 	}
+	
+	sys_mutex_lock(&ranking_mutex);
+	ranking_queue.push_back(batch);
+	rstats.queued += changed.size();
+	sys_cond_signal(&ranking_cond);
+	sys_mutex_unlock(&ranking_mutex);
 }
 
 
@@ -267,6 +447,134 @@ void ranking_setup()
 	db->query("CREATE TABLE IF NOT EXISTS players "
 		"(uuid varchar(50) NOT NULL PRIMARY KEY, name varchar(50), "
 		"t_lastgame DATE NOT NULL, gamecount INT NOT NULL, ranking INT NOT NULL);");
+	
+	// load all players into the store
+	const unsigned long start = sys_time_ms();
+	
+	store.clear();
+	
+	Statement load(db, "SELECT uuid, name, gamecount, ranking FROM players;");
+	while (load.step() == SQLITE_ROW)
+		store.insert(load.getText(0), load.getText(1), load.getInt(3), load.getInt(2));
+	
+	log_info("update_scores", "loaded rankings of %u players in %lu ms",
+		store.size(), sys_time_ms() - start);
+	
+	sys_mutex_init(&ranking_mutex);
+	sys_cond_init(&ranking_cond);
+	sys_cond_init(&ranking_idle);
+	
+	// checkpoints by the writer instead of inline with its commits
+	checkpoint_interval = 0;
+	
+	if (db->getPragma("journal_mode") == "wal" && config.getInt("db_checkpoint_interval") > 0 &&
+		db->setAutoCheckpoint(false) == SQLITE_OK)
+	{
+		checkpoint_interval = config.getInt("db_checkpoint_interval") * 1000;
+	}
+	
+	ranking_stop = false;
+	ranking_running = (sys_thread_create(&ranking_thread, ranking_writer, NULL) == 0);
+	
+	if (!ranking_running)
+		log_error("update_scores", "error: cannot start writer thread");
+}
+
+// write all changed rankings and wait until they are committed
+void ranking_sync()
+{
+	ranking_flush();
+	
+	if (!ranking_running)
+		return;
+	
+	sys_mutex_lock(&ranking_mutex);
+	while (rstats.queued)
+		sys_cond_wait(&ranking_idle, &ranking_mutex);
+	sys_mutex_unlock(&ranking_mutex);
+}
+
+void ranking_shutdown()
+{
+	ranking_flush();
+	
+	if (!ranking_running)
+		return;
+	
+	sys_mutex_lock(&ranking_mutex);
+	
+	if (rstats.queued)
+		log_info("update_scores", "writing rankings of %u players", rstats.queued);
+	
+	ranking_stop = true;
+	sys_cond_signal(&ranking_cond);
+	sys_mutex_unlock(&ranking_mutex);
+	
+	sys_thread_join(&ranking_thread);
+	ranking_running = false;
+	
+	log_info("update_scores", "wrote rankings of %lu players in %lu transactions (%lu failed, max. %lu ms)",
+		rstats.players, rstats.transactions, rstats.errors, rstats.max_commit_ms);
+	
+	if (checkpoint_interval)
+		log_info("sqlite", "%lu checkpoints copied %lu pages", rstats.checkpoints, rstats.checkpoint_frames);
+	
+	sys_cond_destroy(&ranking_cond);
+	sys_cond_destroy(&ranking_idle);
+	sys_mutex_destroy(&ranking_mutex);
+}
+
+void ranking_get_stats(ranking_stats *st)
+{
+	if (!ranking_running)
+		*st = rstats;
+	else
+	{
+		sys_mutex_lock(&ranking_mutex);
+		*st = rstats;
+		sys_mutex_unlock(&ranking_mutex);
+	}
+	
+	// changed but not yet handed to the writer
+	st->queued += store.countDirty();
+}
+
+static void ranking_fill(int idx, ranking_player *p)
+{
+	const RankingStore::Entry &e = store.get(idx);
+	
+	p->uuid = e.uuid;
+	p->name = e.name;
+	p->position = store.getPosition(idx);
+	p->ranking = e.ranking;
+	p->gamecount = e.gamecount;
+}
+
+bool ranking_get_player(const std::string &uuid, ranking_player *p)
+{
+	const int idx = store.find(uuid);
+	if (idx == -1)
+		return false;
+	
+	ranking_fill(idx, p);
+	
+	return true;
+}
+
+unsigned int ranking_get_leaderboard(unsigned int first, unsigned int count, std::vector<ranking_player> &list)
+{
+	for (unsigned int i=first; i < first + count; i++)
+	{
+		const int idx = store.getAt(i);
+		if (idx == -1)
+			break;
+		
+		ranking_player p;
+		ranking_fill(idx, &p);
+		list.push_back(p);
+	}
+	
+	return store.size();
 }
 
 #endif /* !NOSQLITE */
@@ -21,8 +21,41 @@
  */
 
 
+#include <string>
+#include <vector>
+
 #include "GameController.hpp"
 
+//! \brief Counters of the ranking writer
+typedef struct {
+	unsigned int	queued;		// changed players not yet written
+	unsigned long	players;
+	unsigned long	transactions;
+	unsigned long	errors;
+	unsigned long	last_commit_ms;
+	unsigned long	max_commit_ms;
+	unsigned long	checkpoints;
+	unsigned long	checkpoint_frames;
+} ranking_stats;
+
+//! \brief Ranking of a player
+typedef struct {
+	std::string	uuid;
+	std::string	name;
+	unsigned int	position;
+	int		ranking;
+	int		gamecount;
+} ranking_player;
+
 void ranking_update(const GameController *g);
+void ranking_flush();
 void ranking_setup();
+void ranking_shutdown();
+//! \brief Write all changed rankings and wait for the writer (e.g. before a handover)
+void ranking_sync();
+void ranking_get_stats(ranking_stats *st);
+
+bool ranking_get_player(const std::string &uuid, ranking_player *p);
+//! \brief Players at leaderboard indices first..first+count-1; returns the number of players
+unsigned int ranking_get_leaderboard(unsigned int first, unsigned int count, std::vector<ranking_player> &list);
 
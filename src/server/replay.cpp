@@ -0,0 +1,587 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Platform.h"
+#include "Logger.h"
+#include "SysAccess.h"
+#include "WireFormat.h"
+#include "WireProtocol.hpp"
+#include "GameController.hpp"
+
+using namespace std;
+
+/* Plays recorded games (see GameRecord.cpp) again: the recorded players
+   are seated with the recorded seed, the recorded actions and the seeds
+   of the hands are fed in between the same ticks and the clock is virtual, so a replay runs as
+   fast as the game logic. Every frame the game produces is compared with
+   the recorded one; the first difference fails the replay. */
+
+
+// the outputs are compared through the record sink
+bool client_chat(int from_gid, int from_tid, int to, const char *msg)
+{
+	return true;
+}
+
+bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *msg)
+{
+	return true;
+}
+
+bool client_snapshot_table(int from_gid, int from_tid, int to, unsigned int seq,
+	const wire_table_snap *ts, const wire_table_snap *base, unsigned int base_seq)
+{
+	return true;
+}
+
+
+static time_t virtual_clock = 0;
+
+// journal written while replaying (-J); committed after every tick
+static journal *bench_journal = NULL;
+
+static time_t replay_clock()
+{
+	return virtual_clock;
+}
+
+
+//! \brief A frame of a record
+typedef struct {
+	size_t offset;   // of the frame header
+	size_t length;   // including the header
+	unsigned int type;
+	unsigned int ticks;
+} record_frame;
+
+//! \brief Comparison of produced frames with the recorded ones
+typedef struct {
+	const string *data;
+	const vector<record_frame> *frames;
+	size_t next;      // index of the next expected frame
+	bool failed;
+	string error;
+} replay_check;
+
+
+static string describe_frame(const char *buf, size_t len)
+{
+	wire_reader r;
+	wire_reader_init(&r, buf + WIRE_HEADER_SIZE, len - WIRE_HEADER_SIZE);
+	
+	const unsigned int type = wire_get_u8(&r);
+	const unsigned int ticks = wire_get_uvar(&r);
+	
+	char desc[1200];
+	size_t slen;
+	const char *str;
+	
+	switch (type)
+	{
+	case GameController::RecordStart:
+		wire_get_u16(&r);
+		snprintf(desc, sizeof(desc), "start (game %d)", wire_get_i32(&r));
+		break;
+	case GameController::RecordClock:
+		snprintf(desc, sizeof(desc), "clock %lu", wire_get_ulong(&r));
+		break;
+	case GameController::RecordAction:
+	{
+		const int cid = wire_get_i32(&r);
+		const unsigned int action = wire_get_u8(&r);
+		snprintf(desc, sizeof(desc), "action cid=%d action=%u amount=%u",
+			cid, action, wire_get_uvar(&r));
+		break;
+	}
+	case GameController::RecordSnap:
+	{
+		const int tid = wire_get_var(&r);
+		const int cid = wire_get_var(&r);
+		const unsigned int sid = wire_get_uvar(&r);
+		str = wire_get_string(&r, &slen);
+		snprintf(desc, sizeof(desc), "snap tid=%d cid=%d sid=%u \"%.*s\"",
+			tid, cid, sid, str ? (int) slen : 0, str ? str : "");
+		break;
+	}
+	case GameController::RecordChat:
+	{
+		const int tid = wire_get_var(&r);
+		const int cid = wire_get_var(&r);
+		str = wire_get_string(&r, &slen);
+		snprintf(desc, sizeof(desc), "chat tid=%d cid=%d \"%.*s\"",
+			tid, cid, str ? (int) slen : 0, str ? str : "");
+		break;
+	}
+	case GameController::RecordTable:
+	{
+		const int tid = wire_get_var(&r);
+		const unsigned int seq = wire_get_uvar(&r);
+		
+		wire_table_snap ts;
+		char text[1024] = "";
+		if (wire_decode_table_snap(&r, &ts))
+			wire_format_table_snap(&ts, text, sizeof(text));
+		
+		snprintf(desc, sizeof(desc), "table tid=%d seq=%u \"%s\"", tid, seq, text);
+		break;
+	}
+	case GameController::RecordEnd:
+		snprintf(desc, sizeof(desc), "end");
+		break;
+	case GameController::RecordSeed:
+		snprintf(desc, sizeof(desc), "seed tid=%d", wire_get_var(&r));
+		break;
+	default:
+		snprintf(desc, sizeof(desc), "unknown frame %u", type);
+	}
+	
+	char prefix[32];
+	snprintf(prefix, sizeof(prefix), "tick %u: ", ticks);
+	
+	return string(prefix) + desc;
+}
+
+static int replay_sink(void *arg, const char *buf, size_t len)
+{
+	replay_check *rc = (replay_check*) arg;
+	
+	// the record may end in the middle of the game
+	if (rc->failed || rc->next == rc->frames->size())
+		return len;
+	
+	const record_frame &f = (*rc->frames)[rc->next];
+	const char *expected = rc->data->data() + f.offset;
+	
+	if (f.length != len || memcmp(expected, buf, len))
+	{
+		size_t diff = 0;
+		while (diff < len && diff < f.length && expected[diff] == buf[diff])
+			diff++;
+		
+		char pos[64];
+		snprintf(pos, sizeof(pos), "frame %lu (byte %lu)",
+			(unsigned long) rc->next, (unsigned long) diff);
+		
+		rc->failed = true;
+		rc->error = string(pos) + "\n  expected " + describe_frame(expected, f.length) +
+			"\n  produced " + describe_frame(buf, len);
+	}
+	else
+		rc->next++;
+	
+	return len;
+}
+
+static bool read_record(const char *filename, string &data, vector<record_frame> &frames)
+{
+	FILE *fp = fopen(filename, "rb");
+	if (!fp)
+		return false;
+	
+	char buf[64 * 1024];
+	size_t count;
+	while ((count = fread(buf, 1, sizeof(buf), fp)) > 0)
+		data.append(buf, count);
+	
+	fclose(fp);
+	
+	// complete frames only; a record of a crashed server may be cut off
+	size_t pos = 0;
+	while (pos + WIRE_HEADER_SIZE + 1 <= data.length())
+	{
+		const size_t length = WIRE_HEADER_SIZE + wire_frame_length(data.data() + pos);
+		if (pos + length > data.length())
+			break;
+		
+		wire_reader r;
+		wire_reader_init(&r, data.data() + pos + WIRE_HEADER_SIZE, length - WIRE_HEADER_SIZE);
+		
+		record_frame f;
+		f.offset = pos;
+		f.length = length;
+		f.type = wire_get_u8(&r);
+		f.ticks = wire_get_uvar(&r);
+		
+		if (r.error)
+			break;
+		
+		frames.push_back(f);
+		pos += length;
+	}
+	
+	return true;
+}
+
+//! \brief Set up the game of a start frame; NULL if the record doesn't fit
+static GameController* replay_setup(wire_reader *r)
+{
+	wire_get_u8(r);   // frame type
+	wire_get_uvar(r);   // ticks
+	
+	if (wire_get_u16(r) != GAME_RECORD_VERSION)
+		return NULL;
+	
+	GameController *g = GameController::create();
+	
+	g->setGameId(wire_get_i32(r));
+	wire_get_u8(r);   // game type, limit and blind rule; compared by the start frame
+	wire_get_u8(r);
+	wire_get_u8(r);
+	g->setPlayerMax(wire_get_uvar(r));
+	g->setPlayerStakes(wire_get_uvar(r));
+	g->setPlayerTimeout(wire_get_uvar(r));
+	g->setBlindsStart(wire_get_uvar(r));
+	g->setBlindsFactor(wire_get_uvar(r));
+	g->setBlindsTime(wire_get_uvar(r));
+	
+	size_t len;
+	const char *str = wire_get_string(r, &len);
+	g->setName(string(str ? str : "", str ? len : 0));
+	
+	g->setSeed(GameController::readSeed(r));
+	virtual_clock = (time_t) wire_get_ulong(r);
+	
+	const unsigned int count = wire_get_uvar(r);
+	for (unsigned int i=0; i < count && !r->error; i++)
+	{
+		const int cid = wire_get_i32(r);
+		str = wire_get_string(r, &len);
+		const bool sitout = wire_get_u8(r);
+		const bool valid = wire_get_u8(r);
+		const Player::PlayerAction action = (Player::PlayerAction) wire_get_u8(r);
+		const chips_type amount = wire_get_uvar(r);
+		
+		g->addPlayer(cid, string(str ? str : "", str ? len : 0));
+		
+		if (sitout)
+			g->setPlayerAction(cid, Player::Sitout, 0);
+		if (valid)
+			g->setPlayerAction(cid, action, amount);
+	}
+	
+	if (r->error)
+	{
+		GameController::destroy(g);
+		return NULL;
+	}
+	
+	return g;
+}
+
+//! \brief Tick the game until it has done <ticks> ticks; false if it ended before
+static bool replay_ticks(GameController *g, const replay_check *rc, unsigned int ticks)
+{
+	while (g->getTicks() < ticks && !rc->failed)
+	{
+		if (g->isEnded())
+			return false;
+		
+		g->tick();
+		
+		if (bench_journal && journal_pending(bench_journal) && journal_commit(bench_journal) < 0)
+		{
+			fprintf(stderr, "error: writing journal failed\n");
+			GameController::setJournal(NULL);
+			journal_close(bench_journal);
+			bench_journal = NULL;
+		}
+	}
+	
+	return true;
+}
+
+static bool replay(const char *filename)
+{
+	const unsigned long time_start = sys_time_ms();
+	
+	string data;
+	vector<record_frame> frames;
+	
+	if (!read_record(filename, data, frames))
+	{
+		printf("%s: cannot read record\n", filename);
+		return false;
+	}
+	
+	if (!frames.size() || frames[0].type != GameController::RecordStart)
+	{
+		printf("%s: not a game record\n", filename);
+		return false;
+	}
+	
+	wire_reader r;
+	wire_reader_init(&r, data.data() + WIRE_HEADER_SIZE, frames[0].length - WIRE_HEADER_SIZE);
+	
+	GameController *g = replay_setup(&r);
+	if (!g)
+	{
+		printf("%s: unsupported record\n", filename);
+		return false;
+	}
+	
+	const time_t clock_start = virtual_clock;
+	
+	replay_check rc;
+	rc.data = &data;
+	rc.frames = &frames;
+	rc.next = 0;
+	rc.failed = false;
+	
+	g->recordTo(replay_sink, &rc);
+	g->start();
+	
+	// feed the inputs; outputs are checked as they are produced
+	for (size_t i=1; i < frames.size() && !rc.failed; i++)
+	{
+		const record_frame &f = frames[i];
+		
+		if (f.type != GameController::RecordClock && f.type != GameController::RecordAction &&
+			f.type != GameController::RecordSeed)
+			continue;
+		
+		if (!replay_ticks(g, &rc, f.ticks))
+			break;
+		
+		wire_reader_init(&r, data.data() + f.offset + WIRE_HEADER_SIZE, f.length - WIRE_HEADER_SIZE);
+		wire_get_u8(&r);
+		wire_get_uvar(&r);
+		
+		if (f.type == GameController::RecordClock)
+			virtual_clock = (time_t) wire_get_ulong(&r);
+		else if (f.type == GameController::RecordSeed)
+		{
+			// dealt by the following tick
+			wire_get_var(&r);
+			g->feedHandSeed(GameController::readSeed(&r));
+		}
+		else
+		{
+			const int cid = wire_get_i32(&r);
+			const Player::PlayerAction action = (Player::PlayerAction) wire_get_u8(&r);
+			g->setPlayerAction(cid, action, wire_get_uvar(&r));
+		}
+	}
+	
+	// outputs after the last input
+	if (!rc.failed && frames.size())
+		replay_ticks(g, &rc, frames.back().ticks + 1);
+	
+	const unsigned int ticks = g->getTicks();
+	GameController::destroy(g);
+	
+	if (!rc.failed && rc.next < frames.size())
+	{
+		char pos[64];
+		snprintf(pos, sizeof(pos), "frame %lu", (unsigned long) rc.next);
+		
+		rc.failed = true;
+		rc.error = string(pos) + "\n  expected " +
+			describe_frame(data.data() + frames[rc.next].offset, frames[rc.next].length) +
+			"\n  produced nothing";
+	}
+	
+	if (rc.failed)
+		printf("%s: FAILED at %s\n", filename, rc.error.c_str());
+	else
+		printf("%s: OK %lu frames, %u ticks, %ld s played in %lu ms\n",
+			filename, (unsigned long) frames.size(), ticks,
+			(long) (virtual_clock - clock_start), sys_time_ms() - time_start);
+	
+	fflush(stdout);
+	
+	return !rc.failed;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-j <jobs>] [-J <journal> [-n]] [-v] record...\n"
+		"  -j <jobs>      replay in this many processes\n"
+		"  -J <journal>   journal the events of the games (one commit per tick)\n"
+		"  -n             do not sync the journal commits\n"
+		"  -v             show the log of the games\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int jobs = 1;
+	int worker = -1;
+	bool verbose = false;
+	const char *journal_file = NULL;
+	bool journal_sync = true;
+	int i;
+	
+	for (i=1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-v"))
+			verbose = true;
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			jobs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-J") && i + 1 < argc)
+			journal_file = argv[++i];
+		else if (!strcmp(argv[i], "-n"))
+			journal_sync = false;
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc)   // internal: worker <n> of -j
+			worker = atoi(argv[++i]);
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	
+	const int first_record = i;
+	
+	if (first_record >= argc || jobs < 1)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	
+	
+	// the games log into the void unless asked for
+	if (!verbose)
+	{
+#if defined(PLATFORM_WINDOWS)
+		FILE *null_log = fopen("NUL", "w");
+#else
+		FILE *null_log = fopen("/dev/null", "w");
+#endif
+		if (null_log)
+			log_set(null_log, 0);
+	}
+	
+	
+	GameController::setClock(replay_clock);
+	
+	// a single journal; no workers
+	if (journal_file)
+	{
+		remove(journal_file);
+		
+		if (!(bench_journal = journal_open(journal_file, journal_sync)))
+		{
+			fprintf(stderr, "cannot open journal %s\n", journal_file);
+			return 1;
+		}
+		
+		GameController::setJournal(bench_journal);
+		jobs = 1;
+	}
+	
+	
+	const unsigned long time_start = sys_time_ms();
+	const unsigned int records = argc - first_record;
+	unsigned int failed = 0;
+	
+#if !defined(PLATFORM_WINDOWS)
+	// distribute the records over worker processes
+	if (worker == -1 && jobs > 1)
+	{
+		vector<int> pids;
+		
+		for (unsigned int w=0; w < jobs; w++)
+		{
+			char wstr[16], jstr[16];
+			snprintf(wstr, sizeof(wstr), "%u", w);
+			snprintf(jstr, sizeof(jstr), "%u", jobs);
+			
+			vector<char*> args;
+			args.push_back(argv[0]);
+			args.push_back((char*) "-j");
+			args.push_back(jstr);
+			args.push_back((char*) "-w");
+			args.push_back(wstr);
+			if (verbose)
+				args.push_back((char*) "-v");
+			for (i = first_record; i < argc; i++)
+				args.push_back(argv[i]);
+			args.push_back(NULL);
+			
+			const int pid = sys_spawn(&args[0], -1);
+			if (pid == -1)
+			{
+				fprintf(stderr, "cannot start worker %u\n", w);
+				return 1;
+			}
+			
+			pids.push_back(pid);
+		}
+		
+		for (unsigned int w=0; w < pids.size(); w++)
+		{
+			const int rc = sys_wait(pids[w]);
+			
+			// a crashed worker fails all of its records
+			if (rc < 0 || rc >= 100)
+				failed += (records + jobs - 1 - w) / jobs;
+			else
+				failed += rc;
+		}
+	}
+	else
+#endif
+	{
+		for (i = first_record; i < argc; i++)
+		{
+			if (worker != -1 && (unsigned int) (i - first_record) % jobs != (unsigned int) worker)
+				continue;
+			
+			if (!replay(argv[i]))
+				failed++;
+		}
+		
+		// a worker reports the count of failed replays
+		if (worker != -1)
+			return (failed < 100) ? failed : 99;
+	}
+	
+	
+	const unsigned long elapsed = sys_time_ms() - time_start;
+	
+	printf("%u records replayed in %lu ms, %u failed\n",
+		records, elapsed, failed);
+	
+	if (bench_journal)
+	{
+		journal_stats js;
+		journal_get_stats(bench_journal, &js);
+		journal_close(bench_journal);
+		
+		const double secs = elapsed ? elapsed / 1000.0 : 0.001;
+		printf("journal: %lu events in %lu commits (%lu bytes, %lu synced); %.0f events/s, %.0f commits/s\n",
+			js.records, js.commits, js.bytes, js.syncs,
+			js.records / secs, js.commits / secs);
+	}
+	
+	return failed ? 1 : 0;
+}
@@ -28,9 +28,23 @@ config.set("max_connections_per_ip",	3);			// limit for connections per IP
 config.set("max_register_per_player",	2);			// limit for register per player
 config.set("max_subscribe_per_player",	2);			// limit for subscribe per player
 config.set("max_create_per_player",	2);			// limit for create per player
+config.set("max_players_per_game",	100);			// limit for players per game (more than 10 play at several tables)
+config.set("max_spectators_per_game",	50);			// limit for spectators per game (0: no limit)
+config.set("max_recvbuf_size",		16 * 1024);		// limit for receive-buffer per client (bytes)
+config.set("max_sendbuf_size",		256 * 1024);		// output a slow client may fall behind before it is dropped (bytes)
+config.set("max_request_records",	50);			// limit for records returned by a single request
+config.set("binary_protocol",		true);			// allow binary protocol for clients supporting it
+config.set("compression",		true);			// allow deflate compression for clients supporting it
+config.set("compression_level",		6);			// deflate level (1: fastest ... 9: best)
+config.set("compression_min_size",	64);			// batches smaller than this are sent uncompressed (bytes)
 config.set("log",			true);			// log into file
 config.set("log_append",		false);			// append to log file instead of overwriting
 config.set("log_timestamp",		true);			// log with timestamp
+config.set("log_level",			"info");		// level of all log categories (error, warn, info, debug)
+config.set("log_categories",		"");			// levels of single categories, e.g. "clientsock:debug sqlite:warn"
+config.set("log_async",			true);			// write the log by a background thread
+config.set("log_buffer",		4096);			// lines buffered for the background thread
+config.set("log_overflow",		"block");		// on a full buffer: block or drop (and count) lines
 config.set("auth_password",		"");			// server authentication password
 config.set("perm_create_user",		true);			// allow regular user to create games
 config.set("conarchive_expire",		30 * 60);		// stored connection data expiration (seconds)
@@ -38,6 +52,29 @@ config.set("flood_chat_interval",	10);			// flood-protect: interval for measurei
 config.set("flood_chat_per_interval",	5);			// flood-protect: count of messages allowed in interval
 config.set("flood_chat_mute",		60);			// flood-protect: mute time (seconds)
 config.set("welcome_message",		"");			// welcome message sent on state info
+config.set("foyer_interval",		1);			// broadcast foyer joins/leaves batched (seconds)
+config.set("lobby_interval",		2);			// push game-list changes to lobby subscribers (seconds)
+config.set("lobby_stats_interval",	30);			// push server stats to lobby subscribers (seconds)
+config.set("spectator_rate",		4);			// table updates per second for spectators (0: unthrottled)
+config.set("spectator_delay",		0);			// delay table updates for spectators (seconds)
+config.set("upgrade_binary",		"");			// server binary taking over on SIGUSR2 (empty: the running one)
+config.set("hand_history",		false);			// record all hands into <config>/hands
+config.set("hand_history_segment_size",	64);			// start a new hand-history segment at this size (MB)
+config.set("hand_history_flush_interval",	1);		// hand buffered hand-history over to the OS (seconds)
+config.set("trace",			true);			// trace game events into <config>/trace.hnt
+config.set("trace_file_size",		64);			// keep the trace file below this size (MB)
+config.set("trace_flush_interval",	1);			// write the buffered game events (seconds)
+config.set("record_games",		false);			// record games into <config>/records for replays
+config.set("journal",			false);			// journal all games; restores them after a crash
+config.set("journal_sync",		true);			// sync each journal commit to disk
+config.set("journal_commit_interval",	50);			// commit journaled events together at most every X ms
+config.set("journal_checkpoint_interval",	300);		// snapshot all games and truncate the journal (seconds)
+config.set("ranking_write_interval",	5);			// write changed rankings to the database together (seconds)
+config.set("db_journal_mode",		"wal");			// SQLite journal mode (wal, delete, truncate, persist, memory, off)
+config.set("db_synchronous",		"normal");		// SQLite sync to disk (off, normal, full)
+config.set("db_cache_size",		2048);			// SQLite page cache (KB)
+config.set("db_mmap_size",		0);			// SQLite memory-mapped I/O (MB; 0: off)
+config.set("db_checkpoint_interval",	10);			// copy the WAL into the database in the background (seconds; 0: after commits)
 
 
 #ifdef DEBUG
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "Config.h"
+#include "Platform.h"
+#include "Trace.h"
+
+using namespace std;
+
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options] file...\n"
+		"  -c <category>   events of this category (may be repeated)\n"
+		"  -t <thread>     events of this thread\n"
+		"  -s              print a summary instead of the events\n"
+		"files are read in the given order, e.g. trace.hnt.old trace.hnt\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	set<string> categories;
+	unsigned int thread = 0;
+	bool summary = false;
+	int i;
+	
+	for (i=1; i < argc && argv[i][0] == '-'; i++)
+	{
+		if (!strcmp(argv[i], "-s"))
+		{
+			summary = true;
+			continue;
+		}
+		
+		if (i + 1 >= argc)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		
+		const char *arg = argv[++i];
+		
+		switch (argv[i - 1][1])
+		{
+		case 'c':
+			categories.insert(arg);
+			break;
+		case 't':
+			thread = atoi(arg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	
+	if (i >= argc)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	
+	unsigned long count_events = 0;
+	int rc = 0;
+	
+	for (; i < argc; i++)
+	{
+		trace_reader *tr = trace_reader_open(argv[i]);
+		if (!tr)
+		{
+			fprintf(stderr, "%s: not a trace file\n", argv[i]);
+			rc = 1;
+			continue;
+		}
+		
+		trace_entry e;
+		while (trace_read(tr, &e))
+		{
+			if (thread && e.thread != thread)
+				continue;
+			
+			if (!categories.empty() && !categories.count(e.category))
+				continue;
+			
+			count_events++;
+			
+			if (!summary)
+				printf("%lu.%06lu %u %-10s %s\n",
+					e.time_sec, e.time_usec, e.thread, e.category, e.text);
+		}
+		
+		// a file being written may end with a partial chunk
+		if (trace_reader_error(tr))
+		{
+			fprintf(stderr, "%s: damaged or cut short\n", argv[i]);
+			rc = 1;
+		}
+		
+		trace_reader_close(tr);
+	}
+	
+	if (summary)
+		printf("events %lu\n", count_events);
+	
+	return rc;
+}
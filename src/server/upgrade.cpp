@@ -0,0 +1,358 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+
+#include "Config.h"
+#include "Platform.h"
+#include "Logger.h"
+#include "Network.h"
+#include "SysAccess.h"
+#include "WireFormat.h"
+#include "Trace.h"
+#include "ConfigParser.hpp"
+
+#include "game.hpp"
+#include "upgrade.hpp"
+#include "ranking.hpp"
+
+#if !defined(PLATFORM_WINDOWS)
+
+using namespace std;
+
+extern ConfigParser config;
+
+/* Handover protocol on the channel (a local socket pair):
+   new -> old:  hello (magic, state version)
+   old -> new:  header (magic, state length, descriptor count), the
+                descriptors (SCM_RIGHTS; the listening socket first)
+                and the state
+   new -> old:  acknowledge (1: taken over, 0: failed) */
+
+#define UPGRADE_MAGIC  0x484e5550   /* "HNUP" */
+
+//! \brief Seconds the new server may take to restore the state
+#define UPGRADE_ACK_TIMEOUT  10
+
+//! \brief Channel to the new server (-1 if no upgrade is in progress)
+static socktype channel = -1;
+//! \brief New server not yet collected (-1 if none)
+static int child_pid = -1;
+//! \brief Time the new server said hello; the handover starts
+static unsigned long handover_start;
+//! \brief The trace was closed for the handover
+static bool trace_paused = false;
+
+
+static bool read_all(socktype sock, void *buf, size_t count)
+{
+	char *p = (char*) buf;
+	
+	while (count)
+	{
+		const int bytes = socket_read(sock, p, count);
+		if (bytes <= 0)
+			return false;
+		
+		p += bytes;
+		count -= bytes;
+	}
+	
+	return true;
+}
+
+static bool write_all(socktype sock, const void *buf, size_t count)
+{
+	const char *p = (const char*) buf;
+	
+	while (count)
+	{
+		const int bytes = socket_write(sock, p, count);
+		if (bytes <= 0)
+			return false;
+		
+		p += bytes;
+		count -= bytes;
+	}
+	
+	return true;
+}
+
+static void upgrade_abort(const char *reason)
+{
+	log_warn("upgrade", "upgrade aborted: %s", reason);
+	
+	// the new server exits as soon as the channel is closed
+	socket_close(channel);
+	channel = -1;
+	
+	// continue tracing (the handed over file is kept as .old)
+	if (trace_paused)
+	{
+		trace_paused = false;
+		game_trace_open();
+	}
+}
+
+// start the new binary; it connects back through the inherited channel
+bool upgrade_start(int argc, char **argv)
+{
+	if (channel != -1 || child_pid != -1)
+	{
+		log_info("upgrade", "upgrade already in progress");
+		return false;
+	}
+	
+	socktype sv[2];
+	if (socket_pair(sv) == -1)
+	{
+		log_error("upgrade", "error creating channel (%d: %s)", errno, strerror(errno));
+		return false;
+	}
+	
+	// same command line, pointed at the channel
+	string binary = config.get("upgrade_binary");
+	if (!binary.length())
+		binary = argv[0];
+	
+	char fdstr[16];
+	snprintf(fdstr, sizeof(fdstr), "%d", sv[1]);
+	
+	vector<char*> args;
+	args.push_back((char*) binary.c_str());
+	for (int i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-u") && i + 1 < argc)
+			i++;
+		else
+			args.push_back(argv[i]);
+	}
+	args.push_back((char*) "-u");
+	args.push_back(fdstr);
+	args.push_back(NULL);
+	
+	const int pid = sys_spawn(&args[0], sv[1]);
+	socket_close(sv[1]);
+	
+	if (pid == -1)
+	{
+		log_error("upgrade", "error starting '%s' (%d: %s)", binary.c_str(), errno, strerror(errno));
+		socket_close(sv[0]);
+		return false;
+	}
+	
+	log_info("upgrade", "started new server '%s' (pid %d)", binary.c_str(), pid);
+	
+	channel = sv[0];
+	child_pid = pid;
+	
+	return true;
+}
+
+// channel to select() on; also collects a new server that has gone away
+socktype upgrade_channel()
+{
+	int status;
+	
+	if (child_pid != -1 && channel == -1 && sys_reap(child_pid, &status))
+		child_pid = -1;
+	
+	return channel;
+}
+
+// the new server is ready (or gone); returns 1 if it has taken over
+int upgrade_handle(socktype listenfd)
+{
+	char hello[8];
+	if (!read_all(channel, hello, sizeof(hello)))
+	{
+		upgrade_abort("new server exited");
+		return -1;
+	}
+	
+	handover_start = sys_time_ms();
+	
+	wire_reader r;
+	wire_reader_init(&r, hello, sizeof(hello));
+	
+	const unsigned int magic = wire_get_u32(&r);
+	const unsigned int version = wire_get_u32(&r);
+	if (magic != UPGRADE_MAGIC || version != UPGRADE_STATE_VERSION)
+	{
+		log_error("upgrade", "new server uses state format %d (expected %d)",
+			version, UPGRADE_STATE_VERSION);
+		upgrade_abort("incompatible state format");
+		return -1;
+	}
+	
+#ifndef NOSQLITE
+	// the new server loads the rankings from the database once it has the state
+	ranking_sync();
+#endif
+	
+	// the new server moves the trace file aside; stop writing to it before
+	if (trace_enabled)
+	{
+		trace_close();
+		trace_paused = true;
+	}
+	
+	// serialize the state; retry with a larger buffer if it doesn't fit
+	vector<char> state(64 * 1024);
+	vector<socktype> fds;
+	wire_writer w;
+	
+	for (;;)
+	{
+		fds.clear();
+		fds.push_back(listenfd);
+		
+		wire_writer_init(&w, &state[0], state.size());
+		if (game_save_state(&w, fds))
+			break;
+		
+		state.resize(state.size() * 2);
+	}
+	
+	char header[12];
+	wire_writer hw;
+	wire_writer_init(&hw, header, sizeof(header));
+	wire_put_u32(&hw, UPGRADE_MAGIC);
+	wire_put_u32(&hw, w.len);
+	wire_put_u32(&hw, fds.size());
+	
+	bool sent = write_all(channel, header, sizeof(header));
+	
+	for (unsigned int i=0; sent && i < fds.size(); i += SOCKET_MAX_FDS)
+	{
+		const unsigned int count = (fds.size() - i < SOCKET_MAX_FDS) ? fds.size() - i : SOCKET_MAX_FDS;
+		sent = (socket_send_fds(channel, "F", 1, &fds[i], count) == 1);
+	}
+	
+	if (!sent || !write_all(channel, &state[0], w.len))
+	{
+		upgrade_abort("error sending state");
+		return -1;
+	}
+	
+	// the new server acknowledges once it has restored everything
+	fd_set rfds;
+	FD_ZERO(&rfds);
+	FD_SET(channel, &rfds);
+	
+	struct timeval timeout;
+	timeout.tv_sec = UPGRADE_ACK_TIMEOUT;
+	timeout.tv_usec = 0;
+	
+	char ack = 0;
+	if (select(channel + 1, &rfds, NULL, NULL, &timeout) <= 0 ||
+		!read_all(channel, &ack, 1) || ack != 1)
+	{
+		upgrade_abort("new server failed to restore the state");
+		return -1;
+	}
+	
+	log_info("upgrade", "handed over %d bytes of state and %d sockets in %lu ms",
+		(int) w.len, (int) fds.size(), sys_time_ms() - handover_start);
+	
+	socket_close(channel);
+	channel = -1;
+	
+	return 1;
+}
+
+// take over from the running server; returns 0 on success
+int upgrade_resume(socktype chan, socktype *listenfd)
+{
+	char buf[12];
+	wire_writer w;
+	wire_writer_init(&w, buf, sizeof(buf));
+	wire_put_u32(&w, UPGRADE_MAGIC);
+	wire_put_u32(&w, UPGRADE_STATE_VERSION);
+	
+	if (!write_all(chan, buf, w.len) || !read_all(chan, buf, sizeof(buf)))
+	{
+		log_error("upgrade", "error: no state received");
+		socket_close(chan);
+		return -1;
+	}
+	
+	const unsigned long start = sys_time_ms();
+	
+	wire_reader r;
+	wire_reader_init(&r, buf, sizeof(buf));
+	const unsigned int magic = wire_get_u32(&r);
+	const unsigned int state_len = wire_get_u32(&r);
+	const unsigned int fd_count = wire_get_u32(&r);
+	
+	vector<socktype> fds(fd_count);
+	unsigned int received = 0;
+	
+	while (magic == UPGRADE_MAGIC && received < fd_count)
+	{
+		char c;
+		unsigned int count = fd_count - received;
+		if (count > SOCKET_MAX_FDS)
+			count = SOCKET_MAX_FDS;
+		
+		if (socket_recv_fds(chan, &c, 1, &fds[received], &count) != 1 || !count)
+			break;
+		
+		received += count;
+	}
+	
+	vector<char> state(state_len + 1);
+	bool ok = (magic == UPGRADE_MAGIC && fd_count && received == fd_count &&
+		read_all(chan, &state[0], state_len));
+	
+	if (ok)
+	{
+		wire_reader_init(&r, &state[0], state_len);
+		ok = game_load_state(&r, fds);
+	}
+	
+	const char ack = ok ? 1 : 0;
+	if (!write_all(chan, &ack, 1))
+		ok = false;
+	
+	socket_close(chan);
+	
+	if (!ok)
+	{
+		log_error("upgrade", "error: cannot restore the state of the running server");
+		return -1;
+	}
+	
+	*listenfd = fds[0];
+	
+	log_info("upgrade", "took over %d sockets (%d bytes of state restored in %lu ms)",
+		(int) fd_count, (int) state_len, sys_time_ms() - start);
+	
+	return 0;
+}
+
+#endif /* !PLATFORM_WINDOWS */
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _UPGRADE_H
+#define _UPGRADE_H
+
+#include "Network.h"
+
+/* Zero-downtime upgrade: the running server starts the new binary, hands
+   over its state and the sockets (listening and clients) and exits as soon
+   as the new server has taken over. If anything fails before, the running
+   server simply continues. */
+
+//! \brief Format of the handed over state; both servers must agree on it
+#define UPGRADE_STATE_VERSION  3
+
+#if !defined(PLATFORM_WINDOWS)
+// used by the running server
+bool upgrade_start(int argc, char **argv);
+socktype upgrade_channel();
+int upgrade_handle(socktype listenfd);
+
+// used by the new server
+int upgrade_resume(socktype channel, socktype *listenfd);
+#endif /* !PLATFORM_WINDOWS */
+
+#endif /* _UPGRADE_H */
@@ -0,0 +1,441 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include "Platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#if !defined(PLATFORM_WINDOWS)
+# include <unistd.h>
+#else
+# include <io.h>
+#endif
+
+#include "Logger.h"
+#include "Thread.h"
+#include "AsyncLog.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+#if defined(PLATFORM_WINDOWS)
+# define write_fd(fd, buf, len)		_write(fd, buf, len)
+# define stream_fd(fp)			_fileno(fp)
+#else
+# define write_fd(fd, buf, len)		write(fd, buf, len)
+# define stream_fd(fp)			fileno(fp)
+#endif
+
+#if defined(__GNUC__)
+# define atomic_load(p)			__atomic_load_n(p, __ATOMIC_ACQUIRE)
+# define atomic_store(p, v)		__atomic_store_n(p, v, __ATOMIC_RELEASE)
+# define atomic_cas(p, old, new)	__atomic_compare_exchange_n(p, &(old), new, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+# define atomic_inc(p)			__atomic_add_fetch(p, 1, __ATOMIC_RELAXED)
+# define atomic_fence()			__atomic_thread_fence(__ATOMIC_SEQ_CST)
+typedef unsigned long			log_seq;
+#else	/* MSVC: volatile accesses have acquire/release semantics */
+# define atomic_load(p)			(*(p))
+# define atomic_store(p, v)		(*(p) = (v))
+# define atomic_cas(p, old, new)	(InterlockedCompareExchange((p), (new), (old)) == (old))
+# define atomic_inc(p)			InterlockedIncrement(p)
+# define atomic_fence()			MemoryBarrier()
+typedef volatile LONG			log_seq;
+#endif
+
+// largest batch handed to write()
+#define LOG_BATCH_SIZE		(64 * 1024)
+
+// the writer wakes up at least this often (ms)
+#define LOG_FLUSH_INTERVAL	100
+
+// the crash handler waits this many rounds for the batch being written
+#define LOG_CRASH_SPIN		100000000
+
+/* Bounded multi-producer queue with a sequence number per record (after
+   D. Vyukov): a record is free for the producer of position pos if its
+   sequence is pos and ready for the consumer if it is pos + 1. */
+typedef struct {
+	log_seq		seq;
+	unsigned int	len;
+	char		line[LOG_LINE_MAX];
+} log_record;
+
+static log_record *ring = NULL;
+static unsigned long ring_mask;
+static log_seq enqueue_pos, dequeue_pos;
+static int overflow_policy;
+
+static log_seq lines_dropped;
+static unsigned long lines_written, batches_written;
+static unsigned long dropped_reported;
+
+static int fds[2];
+
+static sys_thread flusher;
+static sys_mutex flusher_mutex;
+static sys_cond flusher_cond;
+static volatile int flusher_stop;
+static int running = 0;
+static int exit_registered = 0;
+
+// batch being written by the flusher; written again by the crash handler
+// if the flusher does not finish it
+static char batch[LOG_BATCH_SIZE];
+static volatile unsigned int batch_pending;
+
+/* Handshake with the crash handler: the flusher is busy while it takes
+   records from the ring and writes them, and does not start again once
+   crashing is set. The handler waits for the busy flusher and so writes
+   the remaining lines neither twice nor out of order. */
+static volatile int flusher_busy;
+static volatile int crashing;
+
+static const int fatal_signals[] = {
+	SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#if !defined(PLATFORM_WINDOWS)
+	SIGBUS,
+#endif
+};
+
+
+static int ring_put(const char *line, unsigned int len)
+{
+	log_seq pos = atomic_load(&enqueue_pos);
+	log_record *rec;
+	long dif;
+	
+	for (;;)
+	{
+		rec = &ring[pos & ring_mask];
+		dif = (long) (atomic_load(&rec->seq) - pos);
+		
+		if (dif == 0)
+		{
+			if (atomic_cas(&enqueue_pos, pos, pos + 1))
+				break;
+		}
+		else if (dif < 0)
+			return -1;	// full
+		else
+			pos = atomic_load(&enqueue_pos);
+	}
+	
+	memcpy(rec->line, line, len);
+	rec->len = len;
+	atomic_store(&rec->seq, pos + 1);
+	
+	return 0;
+}
+
+// take the next record; there may be several consumers (flusher, crash handler)
+static log_record* ring_get(log_seq *taken)
+{
+	log_seq pos = atomic_load(&dequeue_pos);
+	log_record *rec;
+	long dif;
+	
+	for (;;)
+	{
+		rec = &ring[pos & ring_mask];
+		dif = (long) (atomic_load(&rec->seq) - (pos + 1));
+		
+		if (dif == 0)
+		{
+			if (atomic_cas(&dequeue_pos, pos, pos + 1))
+				break;
+		}
+		else if (dif < 0)
+			return NULL;	// empty
+		else
+			pos = atomic_load(&dequeue_pos);
+	}
+	
+	*taken = pos;
+	return rec;
+}
+
+// make the record free for the producer one round later
+static void ring_release(log_record *rec, log_seq pos)
+{
+	atomic_store(&rec->seq, pos + ring_mask + 1);
+}
+
+static void write_all(const char *buf, unsigned int len)
+{
+	unsigned int i;
+	
+	for (i=0; i < 2; i++)
+	{
+		const char *p = buf;
+		unsigned int left = len;
+		
+		while (fds[i] != -1 && left)
+		{
+			const int written = write_fd(fds[i], p, left);
+			if (written <= 0)
+				break;
+			
+			p += written;
+			left -= written;
+		}
+	}
+}
+
+static void log_enqueue(const char *line, unsigned int len)
+{
+	while (ring_put(line, len) < 0)
+	{
+		if (overflow_policy == log_overflow_drop)
+		{
+			atomic_inc(&lines_dropped);
+			return;
+		}
+		
+		sys_cond_signal(&flusher_cond);
+		sys_sleep_ms(1);
+	}
+	
+	// wake the writer early when the ring fills up
+	if (((atomic_load(&enqueue_pos) - atomic_load(&dequeue_pos)) & ring_mask) > ring_mask / 2)
+		sys_cond_signal(&flusher_cond);
+}
+
+// collect records into the batch; returns the number of records
+static unsigned int fill_batch()
+{
+	unsigned int count = 0, len = 0;
+	log_record *rec;
+	log_seq pos;
+	
+	while (len + LOG_LINE_MAX <= sizeof(batch) && (rec = ring_get(&pos)))
+	{
+		memcpy(batch + len, rec->line, rec->len);
+		len += rec->len;
+		batch_pending = len;	// before the record can be reused
+		ring_release(rec, pos);
+		count++;
+	}
+	
+	return count;
+}
+
+static void report_dropped()
+{
+	const unsigned long dropped = atomic_load(&lines_dropped);
+	char line[128];
+	int len;
+	
+	if (dropped == dropped_reported)
+		return;
+	
+	len = snprintf(line, sizeof(line), "[%10s]  %lu lines dropped (log buffer full)\n",
+		"log", dropped - dropped_reported);
+	
+	write_all(line, len);
+	dropped_reported = dropped;
+}
+
+static void log_flusher(void *arg)
+{
+	for (;;)
+	{
+		unsigned int count;
+		
+		flusher_busy = 1;
+		atomic_fence();
+		
+		// the crash handler writes the rest
+		if (crashing)
+		{
+			flusher_busy = 0;
+			for (;;)
+				sys_sleep_ms(1000);
+		}
+		
+		if ((count = fill_batch()))
+			write_all(batch, batch_pending);
+		
+		batch_pending = 0;
+		flusher_busy = 0;
+		
+		if (count)
+		{
+			sys_mutex_lock(&flusher_mutex);
+			lines_written += count;
+			batches_written++;
+			sys_mutex_unlock(&flusher_mutex);
+			continue;
+		}
+		
+		report_dropped();
+		
+		if (flusher_stop)
+			break;
+		
+		sys_mutex_lock(&flusher_mutex);
+		if (!flusher_stop)
+			sys_cond_timedwait(&flusher_cond, &flusher_mutex, LOG_FLUSH_INTERVAL);
+		sys_mutex_unlock(&flusher_mutex);
+	}
+}
+
+// async-signal-safe: only memory of the ring and write()
+static void log_crash(int sig)
+{
+	log_record *rec;
+	log_seq pos;
+	unsigned long spin;
+	
+	crashing = 1;
+	atomic_fence();
+	
+	for (spin=0; flusher_busy && spin < LOG_CRASH_SPIN; spin++)
+		;
+	
+	// the flusher is stuck (or crashed) with a batch written partly
+	if (flusher_busy && batch_pending)
+		write_all(batch, batch_pending);
+	
+	while ((rec = ring_get(&pos)))
+	{
+		write_all(rec->line, rec->len);
+		ring_release(rec, pos);
+	}
+	
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+int log_async_start(unsigned int capacity, int overflow)
+{
+	filetype *streams[2];
+	unsigned int size = 2, i;
+	
+	if (running)
+		return 0;
+	
+	while (size < capacity)
+		size *= 2;
+	
+	ring = (log_record*) malloc(size * sizeof(log_record));
+	if (!ring)
+		return -1;
+	
+	for (i=0; i < size; i++)
+		ring[i].seq = i;
+	
+	ring_mask = size - 1;
+	enqueue_pos = dequeue_pos = 0;
+	overflow_policy = overflow;
+	lines_dropped = dropped_reported = 0;
+	lines_written = batches_written = 0;
+	batch_pending = 0;
+	flusher_busy = crashing = 0;
+	
+	// lines written so far go first
+	log_get(&streams[0], &streams[1]);
+	for (i=0; i < 2; i++)
+	{
+		if (streams[i])
+			fflush(streams[i]);
+		
+		fds[i] = streams[i] ? stream_fd(streams[i]) : -1;
+	}
+	
+	sys_mutex_init(&flusher_mutex);
+	sys_cond_init(&flusher_cond);
+	flusher_stop = 0;
+	
+	if (sys_thread_create(&flusher, log_flusher, NULL) != 0)
+	{
+		sys_cond_destroy(&flusher_cond);
+		sys_mutex_destroy(&flusher_mutex);
+		free(ring);
+		ring = NULL;
+		return -1;
+	}
+	
+	for (i=0; i < sizeof(fatal_signals) / sizeof(fatal_signals[0]); i++)
+		signal(fatal_signals[i], log_crash);
+	
+	// pending lines are written on a regular exit, too
+	if (!exit_registered)
+		exit_registered = !atexit(log_async_stop);
+	
+	running = 1;
+	log_set_writer(log_enqueue);
+	
+	return 0;
+}
+
+void log_async_stop(void)
+{
+	unsigned int i;
+	
+	if (!running)
+		return;
+	
+	log_set_writer(NULL);
+	
+	sys_mutex_lock(&flusher_mutex);
+	flusher_stop = 1;
+	sys_cond_signal(&flusher_cond);
+	sys_mutex_unlock(&flusher_mutex);
+	
+	sys_thread_join(&flusher);
+	
+	for (i=0; i < sizeof(fatal_signals) / sizeof(fatal_signals[0]); i++)
+		signal(fatal_signals[i], SIG_DFL);
+	
+	sys_cond_destroy(&flusher_cond);
+	sys_mutex_destroy(&flusher_mutex);
+	
+	free(ring);
+	ring = NULL;
+	running = 0;
+}
+
+void log_async_get_stats(log_async_stats *st)
+{
+	if (!running)
+	{
+		memset(st, 0, sizeof(*st));
+		return;
+	}
+	
+	sys_mutex_lock(&flusher_mutex);
+	st->lines = lines_written;
+	st->batches = batches_written;
+	sys_mutex_unlock(&flusher_mutex);
+	
+	st->dropped = atomic_load(&lines_dropped);
+}
+
+#if defined __cplusplus
+    }
+#endif
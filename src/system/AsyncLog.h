@@ -0,0 +1,62 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _ASYNCLOG_H
+#define _ASYNCLOG_H
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* Asynchronous backend of log_msg(): lines are put into a lock-free ring of
+   fixed-size records by any thread and written to the log streams in
+   batches by a thread of its own. On a fatal signal the records still in
+   the ring are written out by the signal handler before the process dies. */
+
+//! \brief What log_msg() does when the ring is full
+typedef enum {
+	log_overflow_drop	= 0,	// discard the line and count it
+	log_overflow_block	= 1	// wait for the writer
+} log_overflow;
+
+//! \brief Counters since the backend has been started
+typedef struct {
+	unsigned long	lines;
+	unsigned long	dropped;
+	unsigned long	batches;
+} log_async_stats;
+
+//! \brief Divert log_msg() to the backend; capacity is rounded up to a power of 2
+int log_async_start(unsigned int capacity, int overflow);
+//! \brief Write all pending lines and return to synchronous logging
+void log_async_stop(void);
+void log_async_get_stats(log_async_stats *st);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _ASYNCLOG_H */
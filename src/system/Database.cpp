@@ -35,11 +35,14 @@ Database::Database()
 
 Database::Database(const char *filename)
 {
+	db = 0;
 	open(filename);
 }
 
 Database::~Database()
 {
+	clearStatementCache();
+	
 	if (db)
 		sqlite3_close(db);
 }
@@ -48,6 +51,11 @@ int Database::open(const char *filename)
 {
 	int rc;
 	
+	clearStatementCache();
+	
+	if (db)
+		sqlite3_close(db);
+	
 	/* open sqlite database */
 	rc = sqlite3_open(filename, &db);
 	if (rc)
@@ -130,11 +138,11 @@ int Database::query(QueryResult **qr, const char *q, ...)
 
 void Database::freeQueryResult(QueryResult **qr)
 {
-	if (qr)
+	if (!qr || !*qr)
 		return;
 	
-	delete qr;
-	qr = 0;
+	delete *qr;
+	*qr = 0;
 }
 
 char* Database::createQueryString(const char *q, ...)
@@ -154,6 +162,252 @@ void Database::freeQueryString(char *q)
 	sqlite3_free(q);
 }
 
+int Database::setPragma(const char *name, const char *value)
+{
+	// pragmas take no bound parameters
+	return query("PRAGMA %s = '%q';", name, value);
+}
+
+std::string Database::getPragma(const char *name)
+{
+	std::string value;
+	
+	char *q = createQueryString("PRAGMA %s;", name);
+	Statement st(this, q);
+	freeQueryString(q);
+	
+	if (st.step() == SQLITE_ROW)
+		value = st.getText(0);
+	
+	return value;
+}
+
+int Database::checkpoint(int *log_frames, int *checkpointed)
+{
+	if (!db)
+		return SQLITE_ERROR;
+	
+	int rc = sqlite3_wal_checkpoint_v2(db, NULL, SQLITE_CHECKPOINT_PASSIVE, log_frames, checkpointed);
+	
+	if (rc != SQLITE_OK)
+		dbg_msg("sqlite", "Error: %s", sqlite3_errmsg(db));
+	
+	return rc;
+}
+
+int Database::setAutoCheckpoint(bool enable)
+{
+	if (!db)
+		return SQLITE_ERROR;
+	
+	// 1000 pages is the default of SQLite
+	return sqlite3_wal_autocheckpoint(db, enable ? 1000 : 0);
+}
+
+sqlite3_stmt* Database::acquireStatement(const char *sql, CachedStatement **entry)
+{
+	sqlite3_stmt *stmt = 0;
+	
+	*entry = 0;
+	
+	if (!db)
+		return 0;
+	
+	stmt_cache_type::iterator it = stmt_cache.find(sql);
+	if (it != stmt_cache.end() && !it->second.in_use)
+	{
+		it->second.in_use = true;
+		*entry = &it->second;
+		return it->second.stmt;
+	}
+	
+	dbg_msg("sqlite", "prepare= %s", sql);
+	
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK)
+	{
+		dbg_msg("sqlite", "Error: %s", sqlite3_errmsg(db));
+		sqlite3_finalize(stmt);
+		return 0;
+	}
+	
+	// while the cached statement is in use by another handle, this one is private
+	if (it == stmt_cache.end())
+	{
+		CachedStatement &cs = stmt_cache[sql];
+		cs.stmt = stmt;
+		cs.in_use = true;
+		*entry = &cs;
+	}
+	
+	return stmt;
+}
+
+void Database::releaseStatement(sqlite3_stmt *stmt, CachedStatement *entry)
+{
+	if (!entry)
+	{
+		sqlite3_finalize(stmt);
+		return;
+	}
+	
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	entry->in_use = false;
+}
+
+void Database::clearStatementCache()
+{
+	for (stmt_cache_type::iterator it = stmt_cache.begin(); it != stmt_cache.end(); it++)
+		sqlite3_finalize(it->second.stmt);
+	
+	stmt_cache.clear();
+}
+
+
+Statement::Statement(Database *db, const char *sql)
+{
+	this->db = db;
+	stmt = db->acquireStatement(sql, &entry);
+}
+
+Statement::~Statement()
+{
+	if (stmt)
+		db->releaseStatement(stmt, entry);
+}
+
+int Statement::bind(int idx, int value)
+{
+	return stmt ? sqlite3_bind_int(stmt, idx, value) : SQLITE_MISUSE;
+}
+
+int Statement::bind(int idx, sqlite3_int64 value)
+{
+	return stmt ? sqlite3_bind_int64(stmt, idx, value) : SQLITE_MISUSE;
+}
+
+int Statement::bind(int idx, double value)
+{
+	return stmt ? sqlite3_bind_double(stmt, idx, value) : SQLITE_MISUSE;
+}
+
+int Statement::bind(int idx, const char *value)
+{
+	return stmt ? sqlite3_bind_text(stmt, idx, value, -1, SQLITE_TRANSIENT) : SQLITE_MISUSE;
+}
+
+int Statement::bind(int idx, const std::string &value)
+{
+	return stmt ? sqlite3_bind_text(stmt, idx, value.data(), (int)value.length(), SQLITE_TRANSIENT) : SQLITE_MISUSE;
+}
+
+int Statement::bindNull(int idx)
+{
+	return stmt ? sqlite3_bind_null(stmt, idx) : SQLITE_MISUSE;
+}
+
+int Statement::step()
+{
+	if (!stmt)
+		return SQLITE_MISUSE;
+	
+	int rc = sqlite3_step(stmt);
+	
+	if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+		dbg_msg("sqlite", "Error: %s", sqlite3_errmsg(db->db));
+	
+	return rc;
+}
+
+int Statement::execute()
+{
+	int rc;
+	
+	while ((rc = step()) == SQLITE_ROW);
+	
+	reset();
+	
+	return (rc == SQLITE_DONE) ? SQLITE_OK : rc;
+}
+
+void Statement::reset()
+{
+	if (stmt)
+		sqlite3_reset(stmt);
+}
+
+int Statement::numCols() const
+{
+	return stmt ? sqlite3_column_count(stmt) : 0;
+}
+
+bool Statement::isNull(int col) const
+{
+	return sqlite3_column_type(stmt, col) == SQLITE_NULL;
+}
+
+int Statement::getInt(int col) const
+{
+	return sqlite3_column_int(stmt, col);
+}
+
+sqlite3_int64 Statement::getInt64(int col) const
+{
+	return sqlite3_column_int64(stmt, col);
+}
+
+double Statement::getDouble(int col) const
+{
+	return sqlite3_column_double(stmt, col);
+}
+
+const char* Statement::getText(int col) const
+{
+	const unsigned char *text = sqlite3_column_text(stmt, col);
+	return text ? (const char*) text : "";
+}
+
+
+Transaction::Transaction(Database *db)
+{
+	this->db = db;
+	
+	Statement st(db, "BEGIN TRANSACTION;");
+	active = (st.execute() == SQLITE_OK);
+}
+
+Transaction::~Transaction()
+{
+	if (active)
+		rollback();
+}
+
+int Transaction::commit()
+{
+	if (!active)
+		return SQLITE_MISUSE;
+	
+	Statement st(db, "COMMIT;");
+	int rc = st.execute();
+	
+	if (rc == SQLITE_OK)
+		active = false;
+	
+	return rc;
+}
+
+int Transaction::rollback()
+{
+	if (!active)
+		return SQLITE_MISUSE;
+	
+	Statement st(db, "ROLLBACK;");
+	active = false;
+	
+	return st.execute();
+}
+
+
 QueryResult::QueryResult(char **result, int nrow, int ncol)
 {
 	this->result = result;
@@ -48,6 +48,8 @@ private:
 
 class Database
 {
+friend class Statement;
+
 public:
 	Database();
 	Database(const char *filename);
@@ -62,9 +64,90 @@ public:
 	char* createQueryString(const char *q, ...);
 	void freeQueryString(char *q);
 	
+	int setPragma(const char *name, const char *value);
+	//! \brief Current value of a pragma (empty on error)
+	std::string getPragma(const char *name);
+	
+	//! \brief Passive checkpoint of the write-ahead log (WAL journal mode)
+	int checkpoint(int *log_frames, int *checkpointed);
+	//! \brief Let SQLite checkpoint after commits (default) or leave it to checkpoint()
+	int setAutoCheckpoint(bool enable);
+	
 private:
+	struct CachedStatement
+	{
+		sqlite3_stmt *stmt;
+		bool in_use;
+	};
+	
+	typedef std::map<std::string,CachedStatement>	stmt_cache_type;
+	
+	sqlite3_stmt* acquireStatement(const char *sql, CachedStatement **entry);
+	void releaseStatement(sqlite3_stmt *stmt, CachedStatement *entry);
+	void clearStatementCache();
+	
 	sqlite3 *db;
+	stmt_cache_type stmt_cache;
+};
+
+//! \brief Prepared statement taken from the statement cache of a database
+/*! The statement is compiled on first use of its SQL text and kept by the
+    database; the handle resets it and gives it back when going out of scope.
+    Parameters are numbered from 1, result columns from 0. */
+class Statement
+{
+public:
+	Statement(Database *db, const char *sql);
+	~Statement();
+	
+	bool isValid() const { return stmt != 0; };
+	
+	int bind(int idx, int value);
+	int bind(int idx, sqlite3_int64 value);
+	int bind(int idx, double value);
+	int bind(int idx, const char *value);
+	int bind(int idx, const std::string &value);
+	int bindNull(int idx);
+	
+	//! \brief Fetch the next row; returns SQLITE_ROW, SQLITE_DONE or an error
+	int step();
+	//! \brief Run a statement without result rows; returns SQLITE_OK or an error
+	int execute();
+	//! \brief Make the statement ready for new bindings
+	void reset();
+	
+	int numCols() const;
+	bool isNull(int col) const;
+	int getInt(int col) const;
+	sqlite3_int64 getInt64(int col) const;
+	double getDouble(int col) const;
+	const char* getText(int col) const;
+	
+private:
+	Statement(const Statement&);
+	Statement& operator=(const Statement&);
+	
+	Database *db;
+	sqlite3_stmt *stmt;
+	Database::CachedStatement *entry;
+};
+
+//! \brief Transaction which is rolled back unless committed
+class Transaction
+{
+public:
+	Transaction(Database *db);
+	~Transaction();
+	
+	int commit();
+	int rollback();
+	
+private:
+	Transaction(const Transaction&);
+	Transaction& operator=(const Transaction&);
 	
+	Database *db;
+	bool active;
 };
 
 #endif /* DATABASE_H */
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include "Platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#if !defined(PLATFORM_WINDOWS)
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+#endif
+
+#include "HandLog.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* compile-time check of the on-disk layout */
+typedef char handlog_record_size_check[sizeof(handlog_record) == HANDLOG_RECORD_SIZE ? 1 : -1];
+typedef char handlog_header_size_check[sizeof(handlog_header) == HANDLOG_HEADER_SIZE ? 1 : -1];
+
+struct handlog_writer {
+	char		dir[1024];
+	FILE		*fp;
+	char		*buffer;
+	size_t		buffer_size;
+	size_t		segment_size;
+	size_t		written;
+	unsigned int	segment;
+};
+
+
+int handlog_segment_name(char *buf, size_t size, const char *dir, unsigned int segment)
+{
+	int len = snprintf(buf, size, "%s/hands-%08u.hnh", dir, segment);
+	
+	return (len < 0 || (size_t)len >= size) ? -1 : 0;
+}
+
+static unsigned int find_last_segment(const char *dir)
+{
+	DIR *d;
+	struct dirent *de;
+	unsigned int last = 0, segment;
+	
+	if (!(d = opendir(dir)))
+		return 0;
+	
+	while ((de = readdir(d)))
+	{
+		if (sscanf(de->d_name, "hands-%u.hnh", &segment) == 1 && segment > last)
+			last = segment;
+	}
+	
+	closedir(d);
+	
+	return last;
+}
+
+static int open_segment(handlog_writer *hw, unsigned int segment)
+{
+	char filename[1100];
+	handlog_header hdr;
+	
+	if (handlog_segment_name(filename, sizeof(filename), hw->dir, segment) < 0)
+		return -1;
+	
+	// never append to an existing segment, its tail may be incomplete
+	if (!(hw->fp = fopen(filename, "wb")))
+		return -1;
+	
+	setvbuf(hw->fp, hw->buffer, _IOFBF, hw->buffer_size);
+	
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, HANDLOG_MAGIC, sizeof(hdr.magic));
+	hdr.version = HANDLOG_VERSION;
+	hdr.record_size = HANDLOG_RECORD_SIZE;
+	hdr.byte_order = HANDLOG_BYTE_ORDER;
+	hdr.segment = segment;
+	hdr.created = (unsigned int) time(NULL);
+	
+	if (fwrite(&hdr, sizeof(hdr), 1, hw->fp) != 1)
+	{
+		fclose(hw->fp);
+		hw->fp = NULL;
+		return -1;
+	}
+	
+	hw->segment = segment;
+	hw->written = sizeof(hdr);
+	
+	return 0;
+}
+
+handlog_writer* handlog_writer_open(const char *dir, size_t segment_size, size_t buffer_size)
+{
+	handlog_writer *hw;
+	
+	if (strlen(dir) >= sizeof(hw->dir))
+		return NULL;
+	
+	if (!(hw = (handlog_writer*) calloc(1, sizeof(handlog_writer))))
+		return NULL;
+	
+	strcpy(hw->dir, dir);
+	hw->segment_size = segment_size;
+	hw->buffer_size = buffer_size;
+	
+	if (!(hw->buffer = (char*) malloc(buffer_size)) ||
+		open_segment(hw, find_last_segment(dir) + 1) < 0)
+	{
+		free(hw->buffer);
+		free(hw);
+		return NULL;
+	}
+	
+	return hw;
+}
+
+int handlog_append(handlog_writer *hw, const handlog_record *rec)
+{
+	if (!hw->fp)
+		return -1;
+	
+	// roll over to the next segment
+	if (hw->written + sizeof(*rec) > hw->segment_size && hw->written > HANDLOG_HEADER_SIZE)
+	{
+		fclose(hw->fp);
+		hw->fp = NULL;
+		
+		if (open_segment(hw, hw->segment + 1) < 0)
+			return -1;
+	}
+	
+	// data only goes to the buffer here, a full buffer is handed to the OS
+	// with a plain write; nothing is synced to disk
+	if (fwrite(rec, sizeof(*rec), 1, hw->fp) != 1)
+		return -1;
+	
+	hw->written += sizeof(*rec);
+	
+	return 0;
+}
+
+int handlog_writer_flush(handlog_writer *hw)
+{
+	if (!hw->fp || fflush(hw->fp) != 0 || ferror(hw->fp))
+		return -1;
+	
+	return 0;
+}
+
+void handlog_writer_close(handlog_writer *hw)
+{
+	if (hw->fp)
+		fclose(hw->fp);
+	
+	free(hw->buffer);
+	free(hw);
+}
+
+unsigned int handlog_writer_segment(const handlog_writer *hw)
+{
+	return hw->segment;
+}
+
+
+static int valid_type(unsigned int type)
+{
+	return type >= HandlogHandStart && type < HandlogTypeMax;
+}
+
+int handlog_segment_open(handlog_segment *seg, const char *filename)
+{
+	const handlog_header *hdr;
+#if !defined(PLATFORM_WINDOWS)
+	struct stat sb;
+	int fd;
+#else
+	FILE *fp;
+	long len;
+#endif
+	
+	memset(seg, 0, sizeof(*seg));
+	
+#if !defined(PLATFORM_WINDOWS)
+	if ((fd = open(filename, O_RDONLY)) == -1)
+		return -1;
+	
+	if (fstat(fd, &sb) == -1 || (size_t)sb.st_size < HANDLOG_HEADER_SIZE)
+	{
+		close(fd);
+		return -1;
+	}
+	
+	seg->size = (size_t) sb.st_size;
+	seg->data = mmap(NULL, seg->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	
+	if (seg->data == MAP_FAILED)
+	{
+		seg->data = NULL;
+		return -1;
+	}
+	
+	seg->mapped = 1;
+	madvise(seg->data, seg->size, MADV_SEQUENTIAL);
+#else
+	if (!(fp = fopen(filename, "rb")))
+		return -1;
+	
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	
+	if (len < HANDLOG_HEADER_SIZE || !(seg->data = malloc(len)) ||
+		fread(seg->data, len, 1, fp) != 1)
+	{
+		free(seg->data);
+		seg->data = NULL;
+		fclose(fp);
+		return -1;
+	}
+	
+	fclose(fp);
+	seg->size = (size_t) len;
+#endif
+	
+	hdr = (const handlog_header*) seg->data;
+	
+	if (memcmp(hdr->magic, HANDLOG_MAGIC, sizeof(hdr->magic)) ||
+		hdr->version != HANDLOG_VERSION ||
+		hdr->record_size != HANDLOG_RECORD_SIZE ||
+		hdr->byte_order != HANDLOG_BYTE_ORDER)
+	{
+		handlog_segment_close(seg);
+		return -1;
+	}
+	
+	seg->header = hdr;
+	seg->records = (const handlog_record*) ((const char*) seg->data + HANDLOG_HEADER_SIZE);
+	seg->count = (seg->size - HANDLOG_HEADER_SIZE) / HANDLOG_RECORD_SIZE;
+	
+	// the tail of a crashed writer: a partial record is cut off above, and
+	// a record the file has grown by before its data was written reads as
+	// zeros (no valid type)
+	while (seg->count && !valid_type(seg->records[seg->count - 1].type))
+		seg->count--;
+	
+	return 0;
+}
+
+void handlog_segment_close(handlog_segment *seg)
+{
+	if (seg->data)
+	{
+#if !defined(PLATFORM_WINDOWS)
+		if (seg->mapped)
+			munmap(seg->data, seg->size);
+		else
+#endif
+			free(seg->data);
+	}
+	
+	memset(seg, 0, sizeof(*seg));
+}
+
+
+void handlog_filter_init(handlog_filter *f)
+{
+	f->game = -1;
+	f->hand = -1;
+	f->table = -1;
+	f->client = -1;
+	f->types = 0;
+}
+
+int handlog_match(const handlog_record *rec, const handlog_filter *f)
+{
+	// the type comes from the file; it may be damaged
+	if (!valid_type(rec->type))
+		return 0;
+	
+	if (f->game >= 0 && rec->game != (unsigned int) f->game)
+		return 0;
+	
+	if (f->hand >= 0 && rec->hand != (unsigned int) f->hand)
+		return 0;
+	
+	if (f->table >= 0 && rec->table != (unsigned int) f->table)
+		return 0;
+	
+	if (f->client >= 0 && rec->client != f->client)
+		return 0;
+	
+	if (f->types && !(f->types & (1u << rec->type)))
+		return 0;
+	
+	return 1;
+}
+
+const handlog_record* handlog_next(const handlog_segment *seg, size_t *pos, const handlog_filter *f)
+{
+	size_t i;
+	
+	for (i = *pos; i < seg->count; i++)
+	{
+		if (!f || handlog_match(&seg->records[i], f))
+		{
+			*pos = i + 1;
+			return &seg->records[i];
+		}
+	}
+	
+	*pos = seg->count;
+	
+	return NULL;
+}
+
+#if defined __cplusplus
+    }
+#endif
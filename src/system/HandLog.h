@@ -0,0 +1,146 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _HANDLOG_H
+#define _HANDLOG_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* The hand-history is a sequence of append-only segment files. Each segment
+   starts with a header followed by fixed-size records in host byte order,
+   so a reader can map a segment and index the records directly. A record
+   cut short or not yet written by a crash at the end of a segment is
+   ignored. */
+#define HANDLOG_MAGIC        "HNHL"
+#define HANDLOG_VERSION      1
+#define HANDLOG_HEADER_SIZE  32
+#define HANDLOG_RECORD_SIZE  32
+#define HANDLOG_BYTE_ORDER   0x01020304
+
+//! \brief Encode a card (face 2..14, suit 1..4) as 1..52; 0 means no card
+#define HANDLOG_CARD(face, suit)  ((unsigned char) (((face) - 2) * 4 + (suit)))
+#define HANDLOG_CARD_FACE(code)   (((code) - 1) / 4 + 2)
+#define HANDLOG_CARD_SUIT(code)   (((code) - 1) % 4 + 1)
+
+//! \brief No seat (record not bound to a seat)
+#define HANDLOG_NO_SEAT  0xff
+
+typedef enum {
+	HandlogHandStart = 1,	// seat: dealer; amount: big blind
+	HandlogSeat,		// amount: stake at start of hand
+	HandlogBlind,		// action: 0=small, 1=big; amount: posted
+	HandlogHole,		// cards: hole-cards
+	HandlogBoard,		// round: new betting round; cards: dealt cards
+	HandlogAction,		// action: Player::PlayerAction; amount: chips moved
+	HandlogShow,		// cards: shown hole-cards
+	HandlogPayout,		// action: pot index; amount: chips won
+	HandlogBust,		// amount: finish position
+	HandlogHandEnd,		// amount: count of players left in game
+	HandlogTypeMax
+} handlog_type;
+
+typedef enum {
+	HandlogFlagAuto		= 0x01,	// action was taken on timeout
+	HandlogFlagOddChips	= 0x02	// payout of odd chips
+} handlog_flag;
+
+//! \brief Fixed-layout hand-history record
+typedef struct {
+	unsigned char	type;
+	unsigned char	seat;
+	unsigned char	round;
+	unsigned char	action;
+	unsigned int	game;
+	unsigned int	hand;
+	unsigned short	table;
+	unsigned char	flags;
+	unsigned char	ncards;
+	int		client;
+	unsigned int	amount;
+	unsigned int	time;
+	unsigned char	cards[4];
+} handlog_record;
+
+//! \brief Segment file header
+typedef struct {
+	char		magic[4];
+	unsigned int	version;
+	unsigned int	record_size;
+	unsigned int	byte_order;
+	unsigned int	segment;
+	unsigned int	created;
+	unsigned int	reserved[2];
+} handlog_header;
+
+//! \brief Appending writer rolling over to a new segment by size (opaque)
+typedef struct handlog_writer handlog_writer;
+
+handlog_writer* handlog_writer_open(const char *dir, size_t segment_size, size_t buffer_size);
+int handlog_append(handlog_writer *hw, const handlog_record *rec);
+int handlog_writer_flush(handlog_writer *hw);
+void handlog_writer_close(handlog_writer *hw);
+unsigned int handlog_writer_segment(const handlog_writer *hw);
+
+int handlog_segment_name(char *buf, size_t size, const char *dir, unsigned int segment);
+
+//! \brief Read-only view of a segment file
+typedef struct {
+	const handlog_header	*header;
+	const handlog_record	*records;
+	//! \brief Count of complete records
+	size_t			count;
+	//! \brief Mapped (or read) file content
+	void			*data;
+	size_t			size;
+	int			mapped;
+} handlog_segment;
+
+int handlog_segment_open(handlog_segment *seg, const char *filename);
+void handlog_segment_close(handlog_segment *seg);
+
+//! \brief Record filter; negative values and a zero type-mask match all records of a valid type
+typedef struct {
+	int		game;
+	int		hand;
+	int		table;
+	int		client;
+	unsigned int	types;
+} handlog_filter;
+
+void handlog_filter_init(handlog_filter *f);
+int handlog_match(const handlog_record *rec, const handlog_filter *f);
+const handlog_record* handlog_next(const handlog_segment *seg, size_t *pos, const handlog_filter *f);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _HANDLOG_H */
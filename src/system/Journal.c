@@ -0,0 +1,476 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+
+#include "Platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#if !defined(PLATFORM_WINDOWS)
+# include <unistd.h>
+#else
+# include <io.h>
+#endif
+
+#include "Journal.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+#if defined(PLATFORM_WINDOWS)
+# define O_APPEND_FLAGS		(O_WRONLY | O_APPEND | O_BINARY)
+# define O_CREATE_FLAGS		(O_WRONLY | O_CREAT | O_TRUNC | O_BINARY)
+# define sync_fd(fd)		_commit(fd)
+# define truncate_fd(fd, len)	_chsize(fd, len)
+#elif defined(__linux__)
+# define O_APPEND_FLAGS		(O_WRONLY | O_APPEND)
+# define O_CREATE_FLAGS		(O_WRONLY | O_CREAT | O_TRUNC)
+# define sync_fd(fd)		fdatasync(fd)
+# define truncate_fd(fd, len)	ftruncate(fd, len)
+#else
+# define O_APPEND_FLAGS		(O_WRONLY | O_APPEND)
+# define O_CREATE_FLAGS		(O_WRONLY | O_CREAT | O_TRUNC)
+# define sync_fd(fd)		fsync(fd)
+# define truncate_fd(fd, len)	ftruncate(fd, len)
+#endif
+
+//! \brief Record header: payload length and checksum; followed by the type
+#define RECORD_HEADER_SIZE  9
+
+struct journal {
+	char		filename[1024];
+	int		fd;
+	int		sync;
+	//! \brief Records not yet committed (or the new journal while checkpointing)
+	char		*buffer;
+	size_t		buffer_len;
+	size_t		buffer_size;
+	size_t		pending;
+	//! \brief Committed size of the file
+	size_t		size;
+	int		checkpoint;
+	journal_stats	stats;
+};
+
+
+static unsigned int crc_table[256];
+
+static void crc_init()
+{
+	unsigned int i, k, c;
+	
+	if (crc_table[1])
+		return;
+	
+	for (i=0; i < 256; i++)
+	{
+		c = i;
+		for (k=0; k < 8; k++)
+			c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crc_table[i] = c;
+	}
+}
+
+static unsigned int checksum(const unsigned char *buf, size_t len)
+{
+	unsigned int c = 0xffffffffu;
+	size_t i;
+	
+	for (i=0; i < len; i++)
+		c = crc_table[(c ^ buf[i]) & 0xff] ^ (c >> 8);
+	
+	return c ^ 0xffffffffu;
+}
+
+static void put_u32(unsigned char *p, unsigned int v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+static unsigned int get_u32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void make_header(unsigned char *hdr)
+{
+	memset(hdr, 0, JOURNAL_HEADER_SIZE);
+	memcpy(hdr, JOURNAL_MAGIC, 4);
+	put_u32(hdr + 4, JOURNAL_VERSION);
+	put_u32(hdr + 8, (unsigned int) time(NULL));
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+	while (len)
+	{
+		const int bytes = write(fd, buf, len);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes <= 0)
+			return -1;
+		
+		buf += bytes;
+		len -= bytes;
+	}
+	
+	return 0;
+}
+
+// a new file only containing the header
+static int create_file(const char *filename, int sync)
+{
+	unsigned char hdr[JOURNAL_HEADER_SIZE];
+	int fd;
+	
+	if ((fd = open(filename, O_CREATE_FLAGS, 0600)) == -1)
+		return -1;
+	
+	make_header(hdr);
+	
+	if (write_all(fd, (const char*) hdr, sizeof(hdr)) < 0 || (sync && sync_fd(fd) < 0))
+	{
+		close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+#if !defined(PLATFORM_WINDOWS)
+// make a rename within the directory durable
+static void sync_dir(const char *filename)
+{
+	char dir[1024];
+	char *sep;
+	int fd;
+	
+	snprintf(dir, sizeof(dir), "%s", filename);
+	if ((sep = strrchr(dir, '/')))
+		*sep = '\0';
+	else
+		strcpy(dir, ".");
+	
+	if ((fd = open(dir, O_RDONLY)) != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+}
+#endif
+
+
+journal* journal_open(const char *filename, int sync)
+{
+	journal *j;
+	journal_reader r;
+	FILE *fp;
+	
+	if (strlen(filename) >= sizeof(j->filename))
+		return NULL;
+	
+	if (!(j = (journal*) calloc(1, sizeof(journal))))
+		return NULL;
+	
+	strcpy(j->filename, filename);
+	j->sync = sync;
+	j->fd = -1;
+	
+	crc_init();
+	
+	if ((fp = fopen(filename, "rb")))
+	{
+		// continue behind the last intact record
+		unsigned int type;
+		const char *data;
+		size_t len;
+		
+		fclose(fp);
+		
+		if (!journal_reader_open(&r, filename))
+		{
+			while (journal_read(&r, &type, &data, &len) == 1)
+				;
+			
+			journal_reader_close(&r);
+			
+			if ((j->fd = open(filename, O_APPEND_FLAGS)) != -1 &&
+				r.truncated && truncate_fd(j->fd, r.pos) != 0)
+			{
+				close(j->fd);
+				j->fd = -1;
+			}
+			
+			j->size = r.pos;
+		}
+	}
+	else
+	{
+		j->fd = create_file(filename, sync);
+		j->size = JOURNAL_HEADER_SIZE;
+	}
+	
+	if (j->fd == -1)
+	{
+		free(j);
+		return NULL;
+	}
+	
+	return j;
+}
+
+void journal_close(journal *j)
+{
+	if (j->fd != -1)
+		close(j->fd);
+	
+	free(j->buffer);
+	free(j);
+}
+
+int journal_append(journal *j, unsigned int type, const char *data, size_t len)
+{
+	unsigned char *p;
+	const size_t need = j->buffer_len + RECORD_HEADER_SIZE + len;
+	
+	if (len > JOURNAL_RECORD_MAX || j->fd == -1)
+		return -1;
+	
+	if (need > j->buffer_size)
+	{
+		size_t size = j->buffer_size ? j->buffer_size : 64 * 1024;
+		char *buffer;
+		
+		while (size < need)
+			size *= 2;
+		
+		if (!(buffer = (char*) realloc(j->buffer, size)))
+			return -1;
+		
+		j->buffer = buffer;
+		j->buffer_size = size;
+	}
+	
+	p = (unsigned char*) j->buffer + j->buffer_len;
+	p[8] = (unsigned char) type;
+	memcpy(p + RECORD_HEADER_SIZE, data, len);
+	put_u32(p, len);
+	put_u32(p + 4, checksum(p + 8, len + 1));
+	
+	j->buffer_len = need;
+	j->pending++;
+	
+	return 0;
+}
+
+int journal_commit(journal *j)
+{
+	if (j->checkpoint || j->fd == -1)
+		return -1;
+	
+	if (!j->pending)
+		return 0;
+	
+	// one write and one sync for all records appended since the last commit
+	if (write_all(j->fd, j->buffer, j->buffer_len) < 0 ||
+		(j->sync && sync_fd(j->fd) < 0))
+	{
+		close(j->fd);
+		j->fd = -1;
+		return -1;
+	}
+	
+	j->stats.records += j->pending;
+	j->stats.commits++;
+	j->stats.bytes += j->buffer_len;
+	if (j->sync)
+		j->stats.syncs++;
+	
+	j->size += j->buffer_len;
+	j->buffer_len = 0;
+	j->pending = 0;
+	
+	return 0;
+}
+
+size_t journal_pending(const journal *j)
+{
+	return j->pending;
+}
+
+size_t journal_size(const journal *j)
+{
+	return j->size;
+}
+
+// records appended until journal_checkpoint_end() start the new journal
+int journal_checkpoint_begin(journal *j)
+{
+	if (journal_commit(j) < 0)
+		return -1;
+	
+	j->checkpoint = 1;
+	
+	return 0;
+}
+
+int journal_checkpoint_end(journal *j)
+{
+	char tmpname[1100];
+	int fd;
+	
+	j->checkpoint = 0;
+	
+	snprintf(tmpname, sizeof(tmpname), "%s.tmp", j->filename);
+	
+	// the new journal has to be complete on disk before replacing the old one
+	if ((fd = create_file(tmpname, 0)) == -1)
+		return -1;
+	
+	if (write_all(fd, j->buffer, j->buffer_len) < 0 || sync_fd(fd) < 0)
+	{
+		close(fd);
+		remove(tmpname);
+		return -1;
+	}
+	
+	close(fd);
+	
+#if defined(PLATFORM_WINDOWS)
+	remove(j->filename);
+#endif
+	
+	if (rename(tmpname, j->filename) != 0)
+	{
+		remove(tmpname);
+		return -1;
+	}
+	
+#if !defined(PLATFORM_WINDOWS)
+	sync_dir(j->filename);
+#endif
+	
+	close(j->fd);
+	j->fd = open(j->filename, O_APPEND_FLAGS);
+	
+	j->stats.records += j->pending;
+	j->stats.bytes += j->buffer_len;
+	j->stats.checkpoints++;
+	
+	j->size = JOURNAL_HEADER_SIZE + j->buffer_len;
+	j->buffer_len = 0;
+	j->pending = 0;
+	
+	return (j->fd == -1) ? -1 : 0;
+}
+
+void journal_get_stats(const journal *j, journal_stats *stats)
+{
+	*stats = j->stats;
+}
+
+
+int journal_reader_open(journal_reader *r, const char *filename)
+{
+	FILE *fp;
+	long len;
+	
+	memset(r, 0, sizeof(*r));
+	
+	crc_init();
+	
+	if (!(fp = fopen(filename, "rb")))
+		return -1;
+	
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	
+	if (len < JOURNAL_HEADER_SIZE || !(r->data = (char*) malloc(len)) ||
+		fread(r->data, len, 1, fp) != 1 ||
+		memcmp(r->data, JOURNAL_MAGIC, 4) ||
+		get_u32((const unsigned char*) r->data + 4) != JOURNAL_VERSION)
+	{
+		free(r->data);
+		r->data = NULL;
+		fclose(fp);
+		return -1;
+	}
+	
+	fclose(fp);
+	
+	r->size = (size_t) len;
+	r->pos = JOURNAL_HEADER_SIZE;
+	
+	return 0;
+}
+
+// returns 1 for a record, 0 at the end of the journal
+int journal_read(journal_reader *r, unsigned int *type, const char **data, size_t *len)
+{
+	const unsigned char *p = (const unsigned char*) r->data + r->pos;
+	size_t length;
+	
+	if (r->truncated || r->pos == r->size)
+		return 0;
+	
+	if (r->size - r->pos < RECORD_HEADER_SIZE ||
+		(length = get_u32(p)) > r->size - r->pos - RECORD_HEADER_SIZE ||
+		checksum(p + 8, length + 1) != get_u32(p + 4))
+	{
+		r->truncated = 1;
+		return 0;
+	}
+	
+	*type = p[8];
+	*data = (const char*) p + RECORD_HEADER_SIZE;
+	*len = length;
+	
+	r->pos += RECORD_HEADER_SIZE + length;
+	
+	return 1;
+}
+
+void journal_reader_close(journal_reader *r)
+{
+	free(r->data);
+	r->data = NULL;
+}
+
+#if defined __cplusplus
+    }
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* A journal is an append-only file of checksummed records. Appended records
+   are collected in memory and written together by a commit, which costs a
+   single write and (optionally) a single sync however many records it
+   carries (group commit). A checkpoint replaces the journal atomically by
+   a new one starting with the records appended in between (a snapshot).
+   A record cut short or damaged by a crash ends the journal. */
+#define JOURNAL_MAGIC        "HNJL"
+#define JOURNAL_VERSION      1
+#define JOURNAL_HEADER_SIZE  16
+
+//! \brief Largest payload of a record
+#define JOURNAL_RECORD_MAX   (16 * 1024 * 1024)
+
+//! \brief Appending writer (opaque)
+typedef struct journal journal;
+
+//! \brief Counters of a writer since it has been opened
+typedef struct {
+	unsigned long	records;
+	unsigned long	commits;
+	unsigned long	syncs;
+	unsigned long	bytes;
+	unsigned long	checkpoints;
+} journal_stats;
+
+journal* journal_open(const char *filename, int sync);
+void journal_close(journal *j);
+
+int journal_append(journal *j, unsigned int type, const char *data, size_t len);
+int journal_commit(journal *j);
+size_t journal_pending(const journal *j);
+size_t journal_size(const journal *j);
+
+int journal_checkpoint_begin(journal *j);
+int journal_checkpoint_end(journal *j);
+
+void journal_get_stats(const journal *j, journal_stats *stats);
+
+//! \brief Sequential reader of a journal file
+typedef struct {
+	char		*data;
+	size_t		size;
+	size_t		pos;
+	//! \brief Set if reading stopped at a damaged or incomplete record
+	int		truncated;
+} journal_reader;
+
+int journal_reader_open(journal_reader *r, const char *filename);
+int journal_read(journal_reader *r, unsigned int *type, const char **data, size_t *len);
+void journal_reader_close(journal_reader *r);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _JOURNAL_H */
@@ -25,6 +25,11 @@
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
+#include <stdlib.h>
+
+#if defined(PLATFORM_WINDOWS)
+# include <windows.h>
+#endif
 
 #include "Logger.h"
 
@@ -33,18 +38,56 @@
         extern "C" {
 #endif
 
+#if defined(_MSC_VER)
+# define lock_categories()	while (InterlockedExchange(&categories_lock, 1)) ;
+# define unlock_categories()	InterlockedExchange(&categories_lock, 0)
+static volatile LONG categories_lock = 0;
+#else
+# define lock_categories()	while (__sync_lock_test_and_set(&categories_lock, 1)) ;
+# define unlock_categories()	__sync_lock_release(&categories_lock)
+static volatile int categories_lock = 0;
+#endif
+
 static filetype *logger[2] = { 0, 0 };
 static int log_timestamp = 0;
+static log_writer log_receiver = 0;
 
-void log_msg(const char *level, const char *format, ...)
+log_category log_unresolved = { "", LOG_DEBUG, 0 };
+
+static log_category *categories = 0;
+static int default_level = LOG_MIN_LEVEL;
+
+static const char *level_names[] = { "error", "warn", "info", "debug" };
+
+
+static void log_vwrite(const char *level, const char *format, va_list args)
 {
-	va_list args;
 	char msg[1024];
+	char line[LOG_LINE_MAX];
+	int len;
 	unsigned int i;
 	
-	va_start(args, format);
 	vsnprintf(msg, sizeof(msg), format, args);
-	va_end(args);
+	
+	if (log_timestamp)
+		len = snprintf(line, sizeof(line), "[%ld %10s]  %s\n", time(0), level, msg);
+	else
+		len = snprintf(line, sizeof(line), "[%10s]  %s\n", level, msg);
+	
+	// keep the line-feed of a cut line
+	if (len < 0)
+		return;
+	else if (len >= (int) sizeof(line))
+	{
+		len = sizeof(line) - 1;
+		line[len - 1] = '\n';
+	}
+	
+	if (log_receiver)
+	{
+		log_receiver(line, len);
+		return;
+	}
 	
 	// if there was no log target specified with log_set()
 	if (!logger[0])
@@ -55,21 +98,214 @@ void log_msg(const char *level, const char *format, ...)
 		if (!logger[i])
 			continue;
 		
-		if (log_timestamp)
-			fprintf(logger[i], "[%ld %10s]  %s\n", time(0), level, msg);
-		else
-			fprintf(logger[i], "[%10s]  %s\n", level, msg);
-		
+		fwrite(line, 1, len, logger[i]);
 		fflush(logger[i]);
 	}
 }
 
+// first call of a call site; returns whether the level is logged
+int log_resolve(log_category **cache, const char *category, int level)
+{
+	*cache = log_category_get(category);
+	
+	return level <= (*cache)->level;
+}
+
+void log_write(const log_category *category, const char *format, ...)
+{
+	va_list args;
+	
+	va_start(args, format);
+	log_vwrite(category->name, format, args);
+	va_end(args);
+}
+
+void log_msg(const char *level, const char *format, ...)
+{
+	va_list args;
+	
+	if (LOG_INFO > log_category_get(level)->level)
+		return;
+	
+	va_start(args, format);
+	log_vwrite(level, format, args);
+	va_end(args);
+}
+
+log_category* log_category_get(const char *name)
+{
+	log_category **p, *cat;
+	int cmp = 1;
+	
+	lock_categories();
+	
+	// the list is sorted by name
+	for (p = &categories; *p && (cmp = strcmp((*p)->name, name)) < 0; p = &(*p)->next)
+		;
+	
+	if (*p && cmp == 0)
+		cat = *p;
+	else if ((cat = (log_category*) malloc(sizeof(log_category))) &&
+		(cat->name = strdup(name)))
+	{
+		cat->level = default_level;
+		cat->next = *p;
+		*p = cat;
+	}
+	else
+	{
+		free(cat);
+		cat = &log_unresolved;	// log everything
+	}
+	
+	unlock_categories();
+	
+	return cat;
+}
+
+log_category* log_category_first()
+{
+	return categories;
+}
+
+int log_set_level(const char *name, int level)
+{
+	log_category *cat;
+	int lowered = 0;
+	
+	// messages above LOG_MIN_LEVEL are not compiled in
+	if (level > LOG_MIN_LEVEL)
+	{
+		level = LOG_MIN_LEVEL;
+		lowered = 1;
+	}
+	
+	if (strcmp(name, "*"))
+	{
+		log_category_get(name)->level = level;
+		return lowered;
+	}
+	
+	lock_categories();
+	
+	default_level = level;
+	for (cat = categories; cat; cat = cat->next)
+		cat->level = level;
+	
+	unlock_categories();
+	
+	return lowered;
+}
+
+log_category* log_category_find(const char *name)
+{
+	log_category *cat;
+	
+	lock_categories();
+	
+	for (cat = categories; cat && strcmp(cat->name, name); cat = cat->next)
+		;
+	
+	unlock_categories();
+	
+	return cat;
+}
+
+// split the entry of length len at p into name and level; returns -1 if
+// it is malformed or names an unknown category (unless create is set)
+static int parse_level_entry(const char *p, size_t len, int create, char *entry, size_t size)
+{
+	char *colon;
+	int level;
+	
+	if (len >= size)
+		return -1;
+	
+	memcpy(entry, p, len);
+	entry[len] = '\0';
+	
+	if (!(colon = strchr(entry, ':')) || colon == entry ||
+		(level = log_level_by_name(colon + 1)) == -1)
+	{
+		return -1;
+	}
+	
+	*colon = '\0';
+	if (!create && strcmp(entry, "*") && !log_category_find(entry))
+		return -1;
+	
+	return level;
+}
+
+int log_set_levels(const char *spec, int create)
+{
+	char entry[128];
+	const char *p;
+	int pass, rc = 0;
+	
+	// entries are separated by blanks or commas; the whole spec is
+	// validated before any level is changed
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (p = spec; *p; )
+		{
+			const size_t len = strcspn(p, " ,");
+			
+			if (len)
+			{
+				const int level = parse_level_entry(p, len, create, entry, sizeof(entry));
+				
+				if (level == -1)
+					return -1;
+				
+				if (pass && log_set_level(entry, level))
+					rc = 1;
+			}
+			
+			p += len;
+			if (*p)
+				p++;
+		}
+	}
+	
+	return rc;
+}
+
+int log_level_by_name(const char *name)
+{
+	int i;
+	
+	for (i=0; i < (int) (sizeof(level_names) / sizeof(level_names[0])); i++)
+	{
+		if (!strcmp(level_names[i], name))
+			return i;
+	}
+	
+	return -1;
+}
+
+const char* log_level_name(int level)
+{
+	return (level >= LOG_ERROR && level <= LOG_DEBUG) ? level_names[level] : "?";
+}
+
 void log_set(filetype *stream1, filetype *stream2)
 {
 	logger[0] = stream1;
 	logger[1] = stream2;
 }
 
+void log_get(filetype **stream1, filetype **stream2)
+{
+	*stream1 = logger[0] ? logger[0] : stderr;
+	*stream2 = logger[1];
+}
+
+void log_set_writer(log_writer writer)
+{
+	log_receiver = writer;
+}
+
 void log_use_timestamp(int use_timestamp)
 {
 	log_timestamp = use_timestamp;
@@ -34,8 +34,84 @@
 #endif
 
 
+//! \brief Longest log line including the line-feed (longer ones are cut)
+#define LOG_LINE_MAX	1088
+
+//! \brief Log levels; a category logs the messages up to its level
+#define LOG_ERROR	0
+#define LOG_WARN	1
+#define LOG_INFO	2
+#define LOG_DEBUG	3
+
+//! \brief Least severe level compiled in; calls above it are removed by the compiler
+#ifndef LOG_MIN_LEVEL
+# ifdef DEBUG
+#  define LOG_MIN_LEVEL	LOG_DEBUG
+# else
+#  define LOG_MIN_LEVEL	LOG_INFO
+# endif
+#endif
+
+//! \brief Receiver of formatted log lines instead of the streams
+typedef void (*log_writer)(const char *line, unsigned int len);
+
+//! \brief Named category of log messages with its current level
+typedef struct log_category {
+	const char		*name;
+	volatile int		level;
+	struct log_category	*next;
+} log_category;
+
+/* Each call site caches its category in a static pointer. It starts at
+   log_unresolved, which lets any level through to log_resolve() on the
+   first call; later calls test the level with a single branch before any
+   argument is evaluated. */
+extern log_category log_unresolved;
+
+#ifndef _MSC_VER
+# define log_at(lvl, category, format, args...) \
+	do { static log_category *lc_ = &log_unresolved; \
+		if ((lvl) <= LOG_MIN_LEVEL && (lvl) <= lc_->level && \
+			(lc_ != &log_unresolved || log_resolve(&lc_, category, lvl))) log_write(lc_, format, ##args); } while(0)
+# define log_error(category, format, args...)	log_at(LOG_ERROR, category, format, ##args)
+# define log_warn(category, format, args...)	log_at(LOG_WARN, category, format, ##args)
+# define log_info(category, format, args...)	log_at(LOG_INFO, category, format, ##args)
+# define log_debug(category, format, args...)	log_at(LOG_DEBUG, category, format, ##args)
+#else /* _MSC_VER */
+# define log_at(lvl, category, format, ...) \
+	do { static log_category *lc_ = &log_unresolved; \
+		if ((lvl) <= LOG_MIN_LEVEL && (lvl) <= lc_->level && \
+			(lc_ != &log_unresolved || log_resolve(&lc_, category, lvl))) log_write(lc_, format, __VA_ARGS__); } while(0)
+# define log_error(category, format, ...)	log_at(LOG_ERROR, category, format, __VA_ARGS__)
+# define log_warn(category, format, ...)	log_at(LOG_WARN, category, format, __VA_ARGS__)
+# define log_info(category, format, ...)	log_at(LOG_INFO, category, format, __VA_ARGS__)
+# define log_debug(category, format, ...)	log_at(LOG_DEBUG, category, format, __VA_ARGS__)
+#endif /* _MSC_VER */
+
+int log_resolve(log_category **cache, const char *category, int level);
+void log_write(const log_category *category, const char *format, ...);
+//! \brief Log at info level without a cached category (looked up by name each call)
 void log_msg(const char *level, const char *format, ...);
+
+//! \brief Find or create a category; new ones get the default level
+log_category* log_category_get(const char *name);
+//! \brief Find a category without creating it; returns NULL if unknown
+log_category* log_category_find(const char *name);
+//! \brief First of all known categories (ordered by name; see log_category::next)
+log_category* log_category_first();
+//! \brief Set the level of a category; "*" sets the default and all categories.
+//! Levels above LOG_MIN_LEVEL are lowered to it; returns 1 if so
+int log_set_level(const char *name, int level);
+//! \brief Set levels from a list like "game:debug sqlite:warn *:info"; unknown categories are
+//! created if create is set. Returns -1 on a bad entry (nothing is changed), 1 if a level was lowered
+int log_set_levels(const char *spec, int create);
+//! \brief Parse "debug", "info", "warn" or "error"; returns -1 for others
+int log_level_by_name(const char *name);
+const char* log_level_name(int level);
+
 void log_set(filetype *stream1, filetype *stream2);
+void log_get(filetype **stream1, filetype **stream2);
+void log_set_writer(log_writer writer);
 void log_use_timestamp(int use_timestamp);
 
 #if defined __cplusplus
@@ -21,6 +21,8 @@
  */
 
 
+#include <string.h>
+
 #include "Network.h"
 
 /*
@@ -85,6 +87,44 @@ int socket_read(socktype fd, void *buf, size_t count)
 #endif
 }
 
+// scatter read into (at most 2) buffers with only one syscall
+int socket_readv(socktype fd, socket_buffer *bufs, int count)
+{
+#if defined(PLATFORM_WINDOWS)
+	WSABUF wsabufs[2];
+	DWORD bytes = 0, flags = 0;
+	int i;
+	
+	if (count > 2)
+		count = 2;
+	
+	for (i=0; i < count; i++)
+	{
+		wsabufs[i].buf = (char*) bufs[i].buf;
+		wsabufs[i].len = bufs[i].len;
+	}
+	
+	if (WSARecv(fd, wsabufs, count, &bytes, &flags, NULL, NULL) == SOCKET_ERROR)
+		return -1;
+	
+	return (int) bytes;
+#else
+	struct iovec iov[2];
+	int i;
+	
+	if (count > 2)
+		count = 2;
+	
+	for (i=0; i < count; i++)
+	{
+		iov[i].iov_base = bufs[i].buf;
+		iov[i].iov_len = bufs[i].len;
+	}
+	
+	return readv(fd, iov, count);
+#endif
+}
+
 int socket_write(socktype fd, const void *buf, size_t count)
 {
 #if defined(PLATFORM_WINDOWS)
@@ -134,6 +174,94 @@ int network_isinprogress()
 #endif
 }
 
+#if !defined(PLATFORM_WINDOWS)
+// connected local stream sockets; used to pass descriptors to another process
+int socket_pair(socktype sv[2])
+{
+	return socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+}
+
+// send data along with descriptors (SCM_RIGHTS); at most SOCKET_MAX_FDS at once
+int socket_send_fds(socktype sock, const void *buf, size_t count, const socktype *fds, unsigned int fd_count)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	char control[CMSG_SPACE(sizeof(socktype) * SOCKET_MAX_FDS)];
+	
+	if (!count || fd_count > SOCKET_MAX_FDS)
+		return -1;
+	
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = (void*) buf;
+	iov.iov_len = count;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	
+	if (fd_count)
+	{
+		struct cmsghdr *cmsg;
+		
+		memset(control, 0, sizeof(control));
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(socktype) * fd_count);
+		
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(socktype) * fd_count);
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(socktype) * fd_count);
+	}
+	
+	return sendmsg(sock, &msg, 0);
+}
+
+// receive data and the descriptors sent along; fd_count is in/out
+int socket_recv_fds(socktype sock, void *buf, size_t count, socktype *fds, unsigned int *fd_count)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char control[CMSG_SPACE(sizeof(socktype) * SOCKET_MAX_FDS)];
+	unsigned int received = 0;
+	int bytes;
+	
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	
+	if ((bytes = recvmsg(sock, &msg, 0)) < 0)
+		return -1;
+	
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		{
+			const unsigned int n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(socktype);
+			unsigned int i;
+			
+			for (i=0; i < n; i++)
+			{
+				socktype fd;
+				memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(socktype), sizeof(socktype));
+				
+				if (received < *fd_count)
+					fds[received++] = fd;
+				else
+					close(fd);
+			}
+		}
+	}
+	
+	*fd_count = received;
+	
+	return (msg.msg_flags & MSG_CTRUNC) ? -1 : bytes;
+}
+#endif /* !PLATFORM_WINDOWS */
+
 int network_init()
 {
 #if defined(PLATFORM_WINDOWS)
@@ -38,6 +38,7 @@
 # include <sys/param.h>
 # include <errno.h>
 # include <fcntl.h>
+# include <sys/uio.h>
 #include <arpa/inet.h>
 #endif
 
@@ -52,6 +53,12 @@ typedef SOCKET socktype;
 typedef int socktype;
 #endif
 
+//! \brief Buffer segment for scatter reads
+typedef struct {
+	void	*buf;
+	size_t	len;
+} socket_buffer;
+
 int socket_create(int domain, int type, int protocol);
 int socket_bind(socktype sockfd, const struct sockaddr *addr, unsigned int addrlen);
 int socket_listen(socktype sockfd, int backlog);
@@ -61,12 +68,22 @@ int socket_close(socktype fd);
 
 int socket_read(socktype fd, void *buf, size_t count);
 int socket_write(socktype fd, const void *buf, size_t count);
+int socket_readv(socktype fd, socket_buffer *bufs, int count);
 
 int socket_setopt(socktype s, int level, int optname, const void *optval, int optlen);
 int socket_setnonblocking(socktype sock);
 
 int network_isinprogress();
 
+#if !defined(PLATFORM_WINDOWS)
+//! \brief Max count of descriptors passed with one socket_send_fds()
+#define SOCKET_MAX_FDS  64
+
+int socket_pair(socktype sv[2]);
+int socket_send_fds(socktype sock, const void *buf, size_t count, const socktype *fds, unsigned int fd_count);
+int socket_recv_fds(socktype sock, void *buf, size_t count, socktype *fds, unsigned int *fd_count);
+#endif
+
 int network_init();
 int network_shutdown();
 
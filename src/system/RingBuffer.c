@@ -0,0 +1,288 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "RingBuffer.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+int ringbuf_init(ringbuffer *rb, size_t initial_size, size_t max_size)
+{
+	if (initial_size > max_size)
+		initial_size = max_size;
+	
+	memset(rb, 0, sizeof(ringbuffer));
+	
+	if (!(rb->data = (char*) malloc(initial_size)))
+		return -1;
+	
+	rb->size = initial_size;
+	rb->max_size = max_size;
+	
+	return 0;
+}
+
+void ringbuf_free(ringbuffer *rb)
+{
+	free(rb->data);
+	memset(rb, 0, sizeof(ringbuffer));
+}
+
+static void ringbuf_reverse(char *p, size_t count)
+{
+	size_t i, j;
+	
+	if (!count)
+		return;
+	
+	for (i=0, j=count-1; i < j; i++, j--)
+	{
+		const char tmp = p[i];
+		p[i] = p[j];
+		p[j] = tmp;
+	}
+}
+
+// move stored bytes to the front of the buffer (in-place, no allocation)
+static void ringbuf_linearize(ringbuffer *rb)
+{
+	if (!rb->head)
+		return;
+	
+	if (rb->head + rb->len <= rb->size)
+		memmove(rb->data, rb->data + rb->head, rb->len);
+	else
+	{
+		// data wraps around; rotate the whole buffer left by 'head'
+		ringbuf_reverse(rb->data, rb->head);
+		ringbuf_reverse(rb->data + rb->head, rb->size - rb->head);
+		ringbuf_reverse(rb->data, rb->size);
+	}
+	
+	rb->head = 0;
+}
+
+// returns free space; buffer is grown (up to max_size) if it is full
+size_t ringbuf_reserve(ringbuffer *rb)
+{
+	if (rb->len == rb->size && rb->size < rb->max_size)
+	{
+		size_t newsize = rb->size ? rb->size * 2 : 256;
+		char *newdata;
+		
+		if (newsize > rb->max_size)
+			newsize = rb->max_size;
+		
+		ringbuf_linearize(rb);
+		
+		if ((newdata = (char*) realloc(rb->data, newsize)))
+		{
+			rb->data = newdata;
+			rb->size = newsize;
+		}
+	}
+	
+	return rb->size - rb->len;
+}
+
+// get the free regions of the buffer; returns count of usable segments
+int ringbuf_segments(ringbuffer *rb, char **buf1, size_t *len1, char **buf2, size_t *len2)
+{
+	size_t end = rb->head + rb->len;
+	
+	if (end < rb->size)
+	{
+		*buf1 = rb->data + end;
+		*len1 = rb->size - end;
+		*buf2 = rb->data;
+		*len2 = rb->head;
+	}
+	else
+	{
+		end -= rb->size;
+		*buf1 = rb->data + end;
+		*len1 = rb->head - end;
+		*buf2 = NULL;
+		*len2 = 0;
+	}
+	
+	return *len2 ? 2 : (*len1 ? 1 : 0);
+}
+
+// mark 'count' bytes of the free segments as filled
+void ringbuf_commit(ringbuffer *rb, size_t count)
+{
+	rb->len += count;
+}
+
+size_t ringbuf_write(ringbuffer *rb, const void *buf, size_t count)
+{
+	const char *src = (const char*) buf;
+	size_t written = 0;
+	
+	while (written < count && ringbuf_reserve(rb))
+	{
+		char *buf1, *buf2;
+		size_t len1, len2, n;
+		
+		ringbuf_segments(rb, &buf1, &len1, &buf2, &len2);
+		
+		n = (len1 < count - written) ? len1 : count - written;
+		memcpy(buf1, src + written, n);
+		written += n;
+		
+		if (written < count && len2)
+		{
+			const size_t n2 = (len2 < count - written) ? len2 : count - written;
+			memcpy(buf2, src + written, n2);
+			written += n2;
+			n += n2;
+		}
+		
+		ringbuf_commit(rb, n);
+	}
+	
+	return written;
+}
+
+/* Extract the next complete line. The line-feed (and a preceding CR) is
+   replaced by '\0' and a pointer into the buffer is returned; the line
+   is consumed and the pointer stays valid until the buffer is modified. */
+char* ringbuf_getline(ringbuffer *rb, size_t *linelen)
+{
+	// bytes stored contiguously behind head
+	const size_t first = (rb->head + rb->len <= rb->size) ? rb->len : rb->size - rb->head;
+	char *nl = NULL;
+	char *line;
+	size_t pos = 0, len;
+	
+	if (rb->scanned < first)
+	{
+		nl = (char*) memchr(rb->data + rb->head + rb->scanned, '\n', first - rb->scanned);
+		if (nl)
+			pos = nl - (rb->data + rb->head);
+	}
+	
+	if (!nl && rb->len > first)
+	{
+		const size_t off = (rb->scanned > first) ? rb->scanned - first : 0;
+		
+		nl = (char*) memchr(rb->data + off, '\n', rb->len - first - off);
+		if (nl)
+			pos = first + (nl - rb->data);
+	}
+	
+	if (!nl)
+	{
+		rb->scanned = rb->len;
+		return NULL;
+	}
+	
+	// line wraps around the buffer end; make it contiguous (rare)
+	if (pos >= first)
+		ringbuf_linearize(rb);
+	
+	line = rb->data + rb->head;
+	line[pos] = '\0';
+	
+	len = pos;
+	if (len && line[len - 1] == '\r')
+		line[--len] = '\0';
+	
+	ringbuf_consume(rb, pos + 1);
+	
+	if (linelen)
+		*linelen = len;
+	
+	return line;
+}
+
+// copy up to 'count' bytes from the front without consuming them
+size_t ringbuf_peek(const ringbuffer *rb, void *buf, size_t count)
+{
+	const size_t first = (rb->head + rb->len <= rb->size) ? rb->len : rb->size - rb->head;
+	char *dst = (char*) buf;
+	
+	if (count > rb->len)
+		count = rb->len;
+	
+	if (count <= first)
+		memcpy(dst, rb->data + rb->head, count);
+	else
+	{
+		memcpy(dst, rb->data + rb->head, first);
+		memcpy(dst + first, rb->data, count - first);
+	}
+	
+	return count;
+}
+
+/* Extract a block of exactly 'count' bytes (e.g. a length-prefixed frame).
+   Returns NULL if not enough bytes are stored yet; otherwise the block is
+   consumed and the pointer stays valid until the buffer is modified. */
+char* ringbuf_getblock(ringbuffer *rb, size_t count)
+{
+	char *block;
+	
+	if (!count || count > rb->len)
+		return NULL;
+	
+	// block wraps around the buffer end; make it contiguous (rare)
+	if (rb->head + count > rb->size)
+		ringbuf_linearize(rb);
+	
+	block = rb->data + rb->head;
+	ringbuf_consume(rb, count);
+	
+	return block;
+}
+
+void ringbuf_consume(ringbuffer *rb, size_t count)
+{
+	if (count > rb->len)
+		count = rb->len;
+	
+	rb->len -= count;
+	rb->scanned = (rb->scanned > count) ? rb->scanned - count : 0;
+	
+	// reset position if empty; next read is contiguous again
+	if (!rb->len)
+		rb->head = 0;
+	else
+		rb->head = (rb->head + count) % rb->size;
+}
+
+// buffer reached its limit and cannot take more data
+int ringbuf_isfull(const ringbuffer *rb)
+{
+	return (rb->len == rb->max_size);
+}
+
+#if defined __cplusplus
+    }
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _RINGBUFFER_H
+#define _RINGBUFFER_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+//! \brief Growable receive ring-buffer with in-place line and block framing
+typedef struct {
+	//! \brief Buffer memory (size bytes)
+	char	*data;
+	//! \brief Currently allocated size
+	size_t	size;
+	//! \brief Hard limit the buffer may grow to
+	size_t	max_size;
+	//! \brief Read position of first stored byte
+	size_t	head;
+	//! \brief Count of stored bytes
+	size_t	len;
+	//! \brief Count of bytes (from head) known to contain no line-feed
+	size_t	scanned;
+} ringbuffer;
+
+int ringbuf_init(ringbuffer *rb, size_t initial_size, size_t max_size);
+void ringbuf_free(ringbuffer *rb);
+
+size_t ringbuf_reserve(ringbuffer *rb);
+int ringbuf_segments(ringbuffer *rb, char **buf1, size_t *len1, char **buf2, size_t *len2);
+void ringbuf_commit(ringbuffer *rb, size_t count);
+size_t ringbuf_write(ringbuffer *rb, const void *buf, size_t count);
+
+char* ringbuf_getline(ringbuffer *rb, size_t *linelen);
+char* ringbuf_getblock(ringbuffer *rb, size_t count);
+size_t ringbuf_peek(const ringbuffer *rb, void *buf, size_t count);
+void ringbuf_consume(ringbuffer *rb, size_t count);
+
+int ringbuf_isfull(const ringbuffer *rb);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _RINGBUFFER_H */
@@ -26,11 +26,15 @@
 
 #if defined(PLATFORM_WINDOWS)
 # include <windows.h>
+# include <wincrypt.h>
 # include <dirent.h>
 # include <io.h>
 # include <tchar.h>
 #else
 # include <unistd.h>
+# include <fcntl.h>
+# include <time.h>
+# include <sys/wait.h>
 #endif
 
 #include <sys/stat.h>
@@ -291,3 +295,95 @@ const char* sys_username()
 #endif
 	return username;
 }
+
+unsigned long sys_time_ms()
+{
+#if defined(PLATFORM_WINDOWS)
+	return GetTickCount();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+/* fill buf with random bytes of the operating system (unpredictable, unlike
+   rand()); returns 0 or -1 if there is no such source */
+int sys_random(void *buf, size_t len)
+{
+#if defined(PLATFORM_WINDOWS)
+	HCRYPTPROV prov;
+	int rc = -1;
+	
+	if (!CryptAcquireContext(&prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT))
+		return -1;
+	
+	if (CryptGenRandom(prov, (DWORD) len, (BYTE*) buf))
+		rc = 0;
+	
+	CryptReleaseContext(prov, 0);
+	return rc;
+#else
+	static int fd = -1;
+	char *p = (char*) buf;
+	
+	// opened once, kept for the following calls
+	if (fd == -1 && (fd = open("/dev/urandom", O_RDONLY)) == -1)
+		return -1;
+	
+	while (len)
+	{
+		const ssize_t bytes = read(fd, p, len);
+		
+		if (bytes <= 0)
+		{
+			if (bytes < 0 && errno == EINTR)
+				continue;
+			return -1;
+		}
+		
+		p += bytes;
+		len -= bytes;
+	}
+	
+	return 0;
+#endif
+}
+
+#if !defined(PLATFORM_WINDOWS)
+/* start the program argv[0] as child process; it inherits the standard
+   descriptors and keep_fd only. Returns the pid or -1 on failure. */
+int sys_spawn(char *const argv[], int keep_fd)
+{
+	const pid_t pid = fork();
+	
+	if (pid != 0)
+		return (int) pid;
+	
+	const long max_fd = sysconf(_SC_OPEN_MAX);
+	for (long fd = 3; fd < max_fd; fd++)
+		if (fd != keep_fd)
+			close(fd);
+	
+	execvp(argv[0], argv);
+	_exit(127);
+}
+
+// collect a terminated child; returns 1 if it has exited, 0 if it's still running
+int sys_reap(int pid, int *status)
+{
+	return waitpid((pid_t) pid, status, WNOHANG) == (pid_t) pid;
+}
+
+// wait for a child to terminate; returns its exit code or -1 if it was killed
+int sys_wait(int pid)
+{
+	int status;
+	
+	if (waitpid((pid_t) pid, &status, 0) != (pid_t) pid || !WIFEXITED(status))
+		return -1;
+	
+	return WEXITSTATUS(status);
+}
+#endif /* !PLATFORM_WINDOWS */
@@ -73,6 +73,18 @@ const char* sys_config_path();
 const char* sys_data_path();
 const char* sys_username();
 
+//! \brief Monotonic clock in milliseconds (arbitrary epoch)
+unsigned long sys_time_ms();
+
+//! \brief Random bytes of the operating system (/dev/urandom, CryptGenRandom); returns 0 or -1
+int sys_random(void *buf, size_t len);
+
+#if !defined(PLATFORM_WINDOWS)
+int sys_spawn(char *const argv[], int keep_fd);
+int sys_reap(int pid, int *status);
+int sys_wait(int pid);
+#endif
+
 #if defined __cplusplus
     }
 #endif
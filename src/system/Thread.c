@@ -0,0 +1,172 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
+#include "Thread.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+typedef struct {
+	void (*func)(void*);
+	void *arg;
+} thread_start;
+
+#if defined(PLATFORM_WINDOWS)
+
+static DWORD WINAPI thread_main(LPVOID p)
+{
+	thread_start start = *(thread_start*) p;
+	free(p);
+	start.func(start.arg);
+	return 0;
+}
+
+int sys_thread_create(sys_thread *t, void (*func)(void*), void *arg)
+{
+	thread_start *start = (thread_start*) malloc(sizeof(thread_start));
+	if (!start)
+		return -1;
+	
+	start->func = func;
+	start->arg = arg;
+	
+	*t = CreateThread(NULL, 0, thread_main, start, 0, NULL);
+	if (!*t)
+	{
+		free(start);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int sys_thread_join(sys_thread *t)
+{
+	if (WaitForSingleObject(*t, INFINITE) != WAIT_OBJECT_0)
+		return -1;
+	
+	CloseHandle(*t);
+	return 0;
+}
+
+void sys_sleep_ms(unsigned long ms)
+{
+	Sleep(ms);
+}
+
+void sys_mutex_init(sys_mutex *m)	{ InitializeCriticalSection(m); }
+void sys_mutex_destroy(sys_mutex *m)	{ DeleteCriticalSection(m); }
+void sys_mutex_lock(sys_mutex *m)	{ EnterCriticalSection(m); }
+void sys_mutex_unlock(sys_mutex *m)	{ LeaveCriticalSection(m); }
+
+void sys_cond_init(sys_cond *c)		{ InitializeConditionVariable(c); }
+void sys_cond_destroy(sys_cond *c)	{ }
+void sys_cond_wait(sys_cond *c, sys_mutex *m)	{ SleepConditionVariableCS(c, m, INFINITE); }
+
+int sys_cond_timedwait(sys_cond *c, sys_mutex *m, unsigned long ms)
+{
+	return SleepConditionVariableCS(c, m, ms) ? 0 : -1;
+}
+void sys_cond_signal(sys_cond *c)	{ WakeConditionVariable(c); }
+void sys_cond_broadcast(sys_cond *c)	{ WakeAllConditionVariable(c); }
+
+#else /* PLATFORM_WINDOWS */
+
+static void* thread_main(void *p)
+{
+	thread_start start = *(thread_start*) p;
+	free(p);
+	start.func(start.arg);
+	return NULL;
+}
+
+int sys_thread_create(sys_thread *t, void (*func)(void*), void *arg)
+{
+	thread_start *start = (thread_start*) malloc(sizeof(thread_start));
+	if (!start)
+		return -1;
+	
+	start->func = func;
+	start->arg = arg;
+	
+	if (pthread_create(t, NULL, thread_main, start) != 0)
+	{
+		free(start);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int sys_thread_join(sys_thread *t)
+{
+	return pthread_join(*t, NULL) ? -1 : 0;
+}
+
+void sys_sleep_ms(unsigned long ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+	
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void sys_mutex_init(sys_mutex *m)	{ pthread_mutex_init(m, NULL); }
+void sys_mutex_destroy(sys_mutex *m)	{ pthread_mutex_destroy(m); }
+void sys_mutex_lock(sys_mutex *m)	{ pthread_mutex_lock(m); }
+void sys_mutex_unlock(sys_mutex *m)	{ pthread_mutex_unlock(m); }
+
+void sys_cond_init(sys_cond *c)		{ pthread_cond_init(c, NULL); }
+void sys_cond_destroy(sys_cond *c)	{ pthread_cond_destroy(c); }
+void sys_cond_wait(sys_cond *c, sys_mutex *m)	{ pthread_cond_wait(c, m); }
+
+int sys_cond_timedwait(sys_cond *c, sys_mutex *m, unsigned long ms)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	
+	return pthread_cond_timedwait(c, m, &ts) ? -1 : 0;
+}
+void sys_cond_signal(sys_cond *c)	{ pthread_cond_signal(c); }
+void sys_cond_broadcast(sys_cond *c)	{ pthread_cond_broadcast(c); }
+
+#endif /* PLATFORM_WINDOWS */
+
+#if defined __cplusplus
+    }
+#endif
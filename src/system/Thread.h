@@ -0,0 +1,79 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _THREAD_H
+#define _THREAD_H
+
+#include "Platform.h"
+
+#if defined(PLATFORM_WINDOWS)
+# include <windows.h>
+#else
+# include <pthread.h>
+#endif
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* Minimal threads for work kept off the game loop: a thread, a mutex and
+   a condition variable to hand work over. */
+
+#if defined(PLATFORM_WINDOWS)
+typedef HANDLE			sys_thread;
+typedef CRITICAL_SECTION	sys_mutex;
+typedef CONDITION_VARIABLE	sys_cond;
+#else
+typedef pthread_t		sys_thread;
+typedef pthread_mutex_t		sys_mutex;
+typedef pthread_cond_t		sys_cond;
+#endif
+
+//! \brief Start a thread running func(arg); returns 0 on success
+int sys_thread_create(sys_thread *t, void (*func)(void*), void *arg);
+//! \brief Wait for a thread to return
+int sys_thread_join(sys_thread *t);
+
+//! \brief Let the calling thread sleep
+void sys_sleep_ms(unsigned long ms);
+
+void sys_mutex_init(sys_mutex *m);
+void sys_mutex_destroy(sys_mutex *m);
+void sys_mutex_lock(sys_mutex *m);
+void sys_mutex_unlock(sys_mutex *m);
+
+void sys_cond_init(sys_cond *c);
+void sys_cond_destroy(sys_cond *c);
+//! \brief Release the locked mutex, wait for a signal and lock it again
+void sys_cond_wait(sys_cond *c, sys_mutex *m);
+//! \brief Like sys_cond_wait() but give up after ms milliseconds; returns 0 if signaled
+int sys_cond_timedwait(sys_cond *c, sys_mutex *m, unsigned long ms);
+void sys_cond_signal(sys_cond *c);
+void sys_cond_broadcast(sys_cond *c);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _THREAD_H */
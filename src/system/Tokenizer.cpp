@@ -184,6 +184,18 @@ bool Tokenizer::popFirst()
 	return true;
 }
 
+void Tokenizer::clear()
+{
+	tokens.clear();
+	index = 0;
+}
+
+// append an already separated token
+void Tokenizer::add(const string &token)
+{
+	tokens.push_back(token);
+}
+
 string Tokenizer::operator[](const unsigned int i) const
 {
 	if (i < count())
@@ -41,6 +41,9 @@ public:
 	
 	bool popFirst();
 	
+	void clear();
+	void add(const std::string &token);
+	
 	unsigned int count() const { return tokens.size(); };
 	std::string operator[](const unsigned int i) const;
 	
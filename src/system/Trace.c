@@ -0,0 +1,787 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include "Platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#if defined(PLATFORM_WINDOWS)
+# include <windows.h>
+#else
+# include <time.h>
+# include <sys/time.h>
+#endif
+
+#include "WireFormat.h"
+#include "Thread.h"
+#include "Logger.h"
+#include "Trace.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+#if defined(_MSC_VER)
+# define TRACE_TLS	__declspec(thread)
+#else
+# define TRACE_TLS	__thread
+#endif
+
+// events of a thread collected before they are written as one chunk
+#define TRACE_BUFFER_SIZE	(64 * 1024)
+
+// a longer pause between two events starts a new chunk (seconds)
+#define TRACE_MAX_DELTA		4000
+
+// the largest trace point id (and count of trace points)
+#define TRACE_MAX_POINTS	1024
+
+// id of a trace point that is not registered again
+#define TRACE_REJECTED		(~0U)
+
+// registered with an id of the current file
+#define TRACE_VALID(tp)		((tp)->id - 1 < TRACE_MAX_POINTS)
+
+typedef enum {
+	ArgInt = 1,
+	ArgLong,
+	ArgDouble,
+	ArgString
+} trace_argtype;
+
+typedef struct {
+	unsigned long	sec;
+	unsigned long	usec;
+} trace_time;
+
+typedef struct {
+	char		data[TRACE_BUFFER_SIZE];
+	wire_writer	w;
+	size_t		frame_start;
+	size_t		events_start;
+	unsigned int	thread;
+	trace_time	last;
+} trace_buffer;
+
+int trace_enabled = 0;
+
+static FILE *trace_file = NULL;
+static char *trace_filename = NULL;
+static size_t trace_max_size;
+static size_t trace_size;
+static trace_time trace_base;		// monotonic time at opening
+
+static sys_mutex trace_mutex;
+static int trace_mutex_ready = 0;
+static trace_point *points[TRACE_MAX_POINTS];
+static unsigned int point_count = 0;
+static unsigned int thread_count = 0;
+
+static TRACE_TLS trace_buffer *tbuf = NULL;
+
+
+static void time_now(trace_time *t)
+{
+#if defined(PLATFORM_WINDOWS)
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	t->sec = (unsigned long) (count.QuadPart / freq.QuadPart);
+	t->usec = (unsigned long) ((count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t->sec = ts.tv_sec;
+	t->usec = ts.tv_nsec / 1000;
+#endif
+}
+
+static void time_wall(trace_time *t)
+{
+#if defined(PLATFORM_WINDOWS)
+	FILETIME ft;
+	ULARGE_INTEGER u;
+	GetSystemTimeAsFileTime(&ft);
+	u.LowPart = ft.dwLowDateTime;
+	u.HighPart = ft.dwHighDateTime;
+	u.QuadPart = u.QuadPart / 10 - 11644473600000000ULL;	// since 1970 in us
+	t->sec = (unsigned long) (u.QuadPart / 1000000);
+	t->usec = (unsigned long) (u.QuadPart % 1000000);
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	t->sec = tv.tv_sec;
+	t->usec = tv.tv_usec;
+#endif
+}
+
+// parse the conversions of a format; returns the count of arguments or -1
+static int parse_format(const char *format, unsigned char *argtypes)
+{
+	const char *p = format;
+	int nargs = 0;
+	
+	while ((p = strchr(p, '%')))
+	{
+		int is_long = 0;
+		
+		p++;
+		
+		if (*p == '%')
+		{
+			p++;
+			continue;
+		}
+		
+		// flags, width, precision
+		while (*p && strchr("-+ #0123456789.", *p))
+			p++;
+		
+		if (*p == 'l')
+		{
+			is_long = 1;
+			p++;
+		}
+		
+		if (nargs == TRACE_MAX_ARGS)
+			return -1;
+		
+		switch (*p)
+		{
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'c':
+			argtypes[nargs++] = is_long ? ArgLong : ArgInt;
+			break;
+		case 'f': case 'e': case 'g':
+			argtypes[nargs++] = ArgDouble;
+			break;
+		case 's':
+			argtypes[nargs++] = ArgString;
+			break;
+		default:
+			return -1;
+		}
+		
+		p++;
+	}
+	
+	return nargs;
+}
+
+static int write_chunk(const char *data, size_t len)
+{
+	if (fwrite(data, 1, len, trace_file) != len)
+		return -1;
+	
+	trace_size += len;
+	return 0;
+}
+
+static int write_header()
+{
+	char buf[TRACE_HEADER_SIZE];
+	trace_time wall;
+	wire_writer w;
+	
+	time_wall(&wall);
+	
+	wire_writer_init(&w, buf, sizeof(buf));
+	wire_put_bytes(&w, TRACE_MAGIC, 4);
+	wire_put_u32(&w, TRACE_VERSION);
+	wire_put_u32(&w, wall.sec);
+	wire_put_u32(&w, wall.usec);
+	wire_put_u32(&w, trace_base.sec);
+	wire_put_u32(&w, trace_base.usec);
+	
+	trace_size = 0;
+	return write_chunk(buf, w.len);
+}
+
+static int write_point(const trace_point *tp)
+{
+	char buf[2048];
+	wire_writer w;
+	size_t frame;
+	
+	wire_writer_init(&w, buf, sizeof(buf));
+	frame = wire_frame_begin(&w, TraceChunkPoint);
+	wire_put_uvar(&w, tp->id);
+	wire_put_string(&w, tp->category, strlen(tp->category));
+	wire_put_string(&w, tp->format, strlen(tp->format));
+	wire_frame_end(&w, frame);
+	
+	return w.overflow ? -1 : write_chunk(buf, w.len);
+}
+
+// start a new file once the current one is full; the old one is kept
+static int rotate()
+{
+	char old_name[1024];
+	unsigned int i;
+	
+	snprintf(old_name, sizeof(old_name), "%s.old", trace_filename);
+	
+	fclose(trace_file);
+	remove(old_name);
+	rename(trace_filename, old_name);
+	
+	if (!(trace_file = fopen(trace_filename, "wb")) || write_header() < 0)
+		return -1;
+	
+	// events refer to the trace points written before them
+	for (i=1; i <= point_count; i++)
+	{
+		if (write_point(points[i - 1]) < 0)
+			return -1;
+	}
+	
+	return 0;
+}
+
+static void disable()
+{
+	trace_enabled = 0;
+	
+	if (trace_file)
+		fclose(trace_file);
+	trace_file = NULL;
+}
+
+static void register_point(trace_point *tp)
+{
+	sys_mutex_lock(&trace_mutex);
+	
+	if (!tp->id && trace_file)
+	{
+		const int nargs = parse_format(tp->format, tp->argtypes);
+		
+		if (nargs >= 0 && point_count < TRACE_MAX_POINTS)
+		{
+			tp->nargs = nargs;
+			points[point_count] = tp;
+			tp->id = ++point_count;
+			
+			if (write_point(tp) < 0)
+				disable();
+		}
+		else
+		{
+			// not retried on every event
+			tp->id = TRACE_REJECTED;
+			
+			if (nargs < 0)
+				log_warn("trace", "format of %s trace point not supported: \"%s\"", tp->category, tp->format);
+			else
+				log_warn("trace", "too many trace points; ignoring %s: \"%s\"", tp->category, tp->format);
+		}
+	}
+	
+	sys_mutex_unlock(&trace_mutex);
+}
+
+static void buffer_begin(trace_buffer *b)
+{
+	trace_time base;
+	
+	time_now(&base);
+	
+	wire_writer_init(&b->w, b->data, sizeof(b->data));
+	b->frame_start = wire_frame_begin(&b->w, TraceChunkEvents);
+	wire_put_uvar(&b->w, b->thread);
+	wire_put_u32(&b->w, base.sec - trace_base.sec);
+	wire_put_u32(&b->w, base.usec);
+	
+	b->events_start = b->w.len;
+	b->last = base;
+}
+
+static void buffer_write(trace_buffer *b)
+{
+	wire_frame_end(&b->w, b->frame_start);
+	
+	sys_mutex_lock(&trace_mutex);
+	
+	if (trace_file)
+	{
+		if (write_chunk(b->data, b->w.len) < 0 ||
+			(trace_size >= trace_max_size && rotate() < 0))
+		{
+			disable();
+		}
+	}
+	
+	sys_mutex_unlock(&trace_mutex);
+}
+
+void trace_event(trace_point *tp, ...)
+{
+	trace_buffer *b = tbuf;
+	trace_time now;
+	unsigned long delta;
+	unsigned int i;
+	va_list args;
+	
+	if (!TRACE_VALID(tp))
+	{
+		if (!tp->id)
+			register_point(tp);
+		
+		// not traceable
+		if (!TRACE_VALID(tp))
+			return;
+	}
+	
+	if (!b)
+	{
+		if (!(b = (trace_buffer*) malloc(sizeof(trace_buffer))))
+			return;
+		
+		sys_mutex_lock(&trace_mutex);
+		b->thread = ++thread_count;
+		sys_mutex_unlock(&trace_mutex);
+		
+		buffer_begin(b);
+		tbuf = b;
+	}
+	
+	time_now(&now);
+	
+	// room for the largest event (or a long pause)
+	if (b->w.len + 16 + tp->nargs * (TRACE_STRING_MAX + 3) > sizeof(b->data) ||
+		now.sec - b->last.sec > TRACE_MAX_DELTA)
+	{
+		buffer_write(b);
+		buffer_begin(b);
+	}
+	
+	delta = (now.sec - b->last.sec) * 1000000 + now.usec - b->last.usec;
+	b->last = now;
+	
+	wire_put_uvar(&b->w, tp->id);
+	wire_put_uvar(&b->w, delta);
+	
+	va_start(args, tp);
+	for (i=0; i < tp->nargs; i++)
+	{
+		switch (tp->argtypes[i])
+		{
+		case ArgInt:
+			wire_put_var(&b->w, va_arg(args, int));
+			break;
+		case ArgLong:
+			wire_put_ulong(&b->w, va_arg(args, unsigned long));
+			break;
+		case ArgDouble:
+		{
+			const double d = va_arg(args, double);
+			wire_put_bytes(&b->w, &d, sizeof(d));	// host byte order
+			break;
+		}
+		case ArgString:
+		{
+			const char *s = va_arg(args, const char*);
+			size_t len = s ? strlen(s) : 0;
+			if (len > TRACE_STRING_MAX)
+				len = TRACE_STRING_MAX;
+			wire_put_string(&b->w, s ? s : "", len);
+			break;
+		}
+		}
+	}
+	va_end(args);
+}
+
+void trace_flush()
+{
+	trace_buffer *b = tbuf;
+	
+	if (!b || !trace_enabled)
+		return;
+	
+	if (b->w.len > b->events_start)
+	{
+		buffer_write(b);
+		buffer_begin(b);
+	}
+	
+	sys_mutex_lock(&trace_mutex);
+	if (trace_file)
+		fflush(trace_file);
+	sys_mutex_unlock(&trace_mutex);
+}
+
+int trace_open(const char *filename, size_t max_size)
+{
+	char old_name[1024];
+	unsigned int i;
+	
+	if (!trace_mutex_ready)
+	{
+		sys_mutex_init(&trace_mutex);
+		trace_mutex_ready = 1;
+	}
+	
+	if (trace_file)
+		return -1;
+	
+	// ids are assigned anew for the file
+	for (i=0; i < point_count; i++)
+		points[i]->id = 0;
+	point_count = 0;
+	
+	time_now(&trace_base);
+	
+	free(trace_filename);
+	trace_filename = strdup(filename);
+	trace_max_size = max_size;
+	
+	// keep the trace of the last run
+	snprintf(old_name, sizeof(old_name), "%s.old", filename);
+	remove(old_name);
+	rename(filename, old_name);
+	
+	if (!(trace_file = fopen(filename, "wb")) || write_header() < 0)
+	{
+		disable();
+		return -1;
+	}
+	
+	// buffers of an earlier file start over
+	if (tbuf)
+		buffer_begin(tbuf);
+	
+	trace_enabled = 1;
+	return 0;
+}
+
+void trace_close()
+{
+	trace_flush();
+	
+	sys_mutex_lock(&trace_mutex);
+	disable();
+	sys_mutex_unlock(&trace_mutex);
+}
+
+
+struct trace_reader {
+	FILE		*fp;
+	char		*chunk;
+	size_t		chunk_size;
+	wire_reader	r;		// events of the current chunk
+	unsigned int	thread;
+	trace_time	wall, base, last;
+	char		**categories;
+	char		**formats;
+	unsigned int	npoints;
+	int		error;
+};
+
+trace_reader* trace_reader_open(const char *filename)
+{
+	char header[TRACE_HEADER_SIZE];
+	wire_reader r;
+	trace_reader *tr;
+	FILE *fp;
+	
+	if (!(fp = fopen(filename, "rb")))
+		return NULL;
+	
+	wire_reader_init(&r, header, sizeof(header));
+	
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header) ||
+		memcmp(wire_get_bytes(&r, 4), TRACE_MAGIC, 4) != 0 ||
+		wire_get_u32(&r) != TRACE_VERSION)
+	{
+		fclose(fp);
+		return NULL;
+	}
+	
+	tr = (trace_reader*) calloc(1, sizeof(trace_reader));
+	if (!tr)
+	{
+		fclose(fp);
+		return NULL;
+	}
+	
+	tr->fp = fp;
+	tr->wall.sec = wire_get_u32(&r);
+	tr->wall.usec = wire_get_u32(&r);
+	tr->base.sec = wire_get_u32(&r);
+	tr->base.usec = wire_get_u32(&r);
+	tr->categories = (char**) calloc(TRACE_MAX_POINTS + 1, sizeof(char*));
+	tr->formats = (char**) calloc(TRACE_MAX_POINTS + 1, sizeof(char*));
+	wire_reader_init(&tr->r, NULL, 0);
+	
+	return tr;
+}
+
+void trace_reader_close(trace_reader *tr)
+{
+	unsigned int i;
+	
+	for (i=0; i <= TRACE_MAX_POINTS; i++)
+	{
+		free(tr->categories[i]);
+		free(tr->formats[i]);
+	}
+	
+	free(tr->categories);
+	free(tr->formats);
+	free(tr->chunk);
+	fclose(tr->fp);
+	free(tr);
+}
+
+int trace_reader_error(const trace_reader *tr)
+{
+	return tr->error;
+}
+
+static char* copy_string(wire_reader *r)
+{
+	size_t len;
+	const char *s = wire_get_string(r, &len);
+	char *copy = (char*) malloc(len + 1);
+	
+	if (copy)
+	{
+		memcpy(copy, s ? s : "", s ? len : 0);
+		copy[s ? len : 0] = '\0';
+	}
+	
+	return copy;
+}
+
+// read chunks until one with events; returns 0 at the end
+static int next_chunk(trace_reader *tr)
+{
+	char header[WIRE_HEADER_SIZE + 1];
+	size_t n, len;
+	
+	for (;;)
+	{
+		if ((n = fread(header, 1, sizeof(header), tr->fp)) == 0)
+			return 0;
+		
+		len = (n == sizeof(header)) ? wire_frame_length(header) : 0;
+		if (!len || len > 16 * 1024 * 1024)
+		{
+			tr->error = 1;
+			return 0;
+		}
+		
+		if (len - 1 > tr->chunk_size)
+		{
+			free(tr->chunk);
+			tr->chunk_size = len - 1;
+			if (!(tr->chunk = (char*) malloc(tr->chunk_size)))
+			{
+				tr->chunk_size = 0;
+				tr->error = 1;
+				return 0;
+			}
+		}
+		
+		if (fread(tr->chunk, 1, len - 1, tr->fp) != len - 1)
+		{
+			tr->error = 1;	// cut short
+			return 0;
+		}
+		
+		wire_reader_init(&tr->r, tr->chunk, len - 1);
+		
+		if (header[WIRE_HEADER_SIZE] == TraceChunkPoint)
+		{
+			unsigned int id = wire_get_uvar(&tr->r);
+			
+			if (!id || id > TRACE_MAX_POINTS || tr->r.error)
+			{
+				tr->error = 1;
+				return 0;
+			}
+			
+			free(tr->categories[id]);
+			free(tr->formats[id]);
+			tr->categories[id] = copy_string(&tr->r);
+			tr->formats[id] = copy_string(&tr->r);
+			wire_reader_init(&tr->r, NULL, 0);
+		}
+		else if (header[WIRE_HEADER_SIZE] == TraceChunkEvents)
+		{
+			tr->thread = wire_get_uvar(&tr->r);
+			tr->last.sec = tr->base.sec + wire_get_u32(&tr->r);
+			tr->last.usec = wire_get_u32(&tr->r);
+			return 1;
+		}
+		else
+			wire_reader_init(&tr->r, NULL, 0);	// unknown chunk
+	}
+}
+
+// render the arguments of an event into text the way printf() would
+static int render(trace_reader *tr, const char *format, char *text, size_t size)
+{
+	unsigned char argtypes[TRACE_MAX_ARGS];
+	const char *p = format;
+	size_t len = 0;
+	int arg = 0;
+	
+	if (parse_format(format, argtypes) < 0)
+		return -1;
+	
+	while (*p && len + 1 < size)
+	{
+		const char *spec = p;
+		char conv[32];
+		int n = 0;
+		
+		if (*p != '%')
+		{
+			text[len++] = *p++;
+			continue;
+		}
+		
+		if (p[1] == '%')
+		{
+			text[len++] = '%';
+			p += 2;
+			continue;
+		}
+		
+		// copy the conversion specification
+		p++;
+		while (*p && strchr("-+ #0123456789.l", *p))
+			p++;
+		p++;
+		
+		if ((size_t) (p - spec) >= sizeof(conv))
+			return -1;
+		
+		memcpy(conv, spec, p - spec);
+		conv[p - spec] = '\0';
+		
+		switch (argtypes[arg++])
+		{
+		case ArgInt:
+			n = snprintf(text + len, size - len, conv, wire_get_var(&tr->r));
+			break;
+		case ArgLong:
+			n = snprintf(text + len, size - len, conv, (long) wire_get_ulong(&tr->r));
+			break;
+		case ArgDouble:
+		{
+			double d = 0;
+			const char *raw = wire_get_bytes(&tr->r, sizeof(d));
+			if (raw)
+				memcpy(&d, raw, sizeof(d));
+			n = snprintf(text + len, size - len, conv, d);
+			break;
+		}
+		case ArgString:
+		{
+			char s[TRACE_STRING_MAX + 1];
+			size_t slen;
+			const char *str = wire_get_string(&tr->r, &slen);
+			if (!str)
+				slen = 0;
+			else if (slen > TRACE_STRING_MAX)
+				slen = TRACE_STRING_MAX;
+			memcpy(s, str ? str : "", slen);
+			s[slen] = '\0';
+			n = snprintf(text + len, size - len, conv, s);
+			break;
+		}
+		}
+		
+		if (n < 0)
+			return -1;
+		
+		len += n;
+		if (len >= size)
+			len = size - 1;
+	}
+	
+	text[len] = '\0';
+	
+	return tr->r.error ? -1 : 0;
+}
+
+int trace_read(trace_reader *tr, trace_entry *e)
+{
+	unsigned long delta;
+	unsigned int id;
+	
+	while (tr->r.pos >= tr->r.len)
+	{
+		if (!next_chunk(tr))
+			return 0;
+	}
+	
+	id = wire_get_uvar(&tr->r);
+	delta = wire_get_uvar(&tr->r);
+	
+	if (tr->r.error || !id || id > TRACE_MAX_POINTS || !tr->formats[id])
+	{
+		tr->error = 1;
+		return 0;
+	}
+	
+	tr->last.usec += delta;
+	tr->last.sec += tr->last.usec / 1000000;
+	tr->last.usec %= 1000000;
+	
+	if (render(tr, tr->formats[id], e->text, sizeof(e->text)) < 0)
+	{
+		tr->error = 1;
+		return 0;
+	}
+	
+	// wall-clock time: since opening plus the wall-clock time at opening
+	{
+		unsigned long usec = tr->wall.usec + tr->last.usec;
+		unsigned long sec = tr->wall.sec + (tr->last.sec - tr->base.sec);
+		
+		if (tr->last.usec < tr->base.usec)
+		{
+			sec--;
+			usec += 1000000;
+		}
+		usec -= tr->base.usec;
+		
+		e->time_sec = sec + usec / 1000000;
+		e->time_usec = usec % 1000000;
+	}
+	
+	e->thread = tr->thread;
+	e->category = tr->categories[id];
+	
+	return 1;
+}
+
+#if defined __cplusplus
+    }
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* Binary trace log with deferred formatting. A trace point is a static
+   descriptor (category and printf format) registered on its first event;
+   an event only stores the id of its trace point, a timestamp and the raw
+   arguments into a buffer of the calling thread. Buffers are written to
+   the trace file as chunks when full or on trace_flush(); the text is
+   rendered later by a reader (holdingnuts-trace).
+
+   Formats may use the conversions d, i, u, x, X, c (int), ld, lu, lx
+   (long), f, e, g (double) and s (string; cut at TRACE_STRING_MAX) with
+   flags, width and precision, but no '*'. */
+#define TRACE_MAGIC		"HNTR"
+#define TRACE_VERSION		1
+#define TRACE_HEADER_SIZE	24
+#define TRACE_MAX_ARGS		12
+#define TRACE_STRING_MAX	255
+
+//! \brief Chunk types of a trace file
+typedef enum {
+	TraceChunkPoint		= 1,	// id, category, format
+	TraceChunkEvents	= 2	// thread, base time, events
+} trace_chunk_type;
+
+//! \brief Static description of a trace point
+typedef struct {
+	const char	*category;
+	const char	*format;
+	unsigned int	id;	// 0 until registered; ~0 if it can't be
+	unsigned int	nargs;
+	unsigned char	argtypes[TRACE_MAX_ARGS];
+} trace_point;
+
+//! \brief Set while a trace file is open; checked by trace()
+extern int trace_enabled;
+
+#ifndef _MSC_VER
+# define trace(category, fmt, args...) \
+	do { static trace_point tp_ = { category, fmt, 0, 0, { 0 } }; if (trace_enabled) trace_event(&tp_, ##args); } while(0)
+#else
+# define trace(category, fmt, ...) \
+	do { static trace_point tp_ = { category, fmt, 0, 0, { 0 } }; if (trace_enabled) trace_event(&tp_, __VA_ARGS__); } while(0)
+#endif
+
+//! \brief Start tracing into a file; an existing or full (max_size bytes) file is moved to <filename>.old
+int trace_open(const char *filename, size_t max_size);
+//! \brief Flush the calling thread and stop tracing
+void trace_close();
+
+void trace_event(trace_point *tp, ...);
+//! \brief Write the buffer of the calling thread
+void trace_flush();
+
+
+//! \brief A rendered event of a trace file
+typedef struct {
+	unsigned long	time_sec;	// wall-clock time
+	unsigned long	time_usec;
+	unsigned int	thread;
+	const char	*category;
+	char		text[1024];
+} trace_entry;
+
+//! \brief Reader of a trace file (see trace_reader_open())
+typedef struct trace_reader trace_reader;
+
+trace_reader* trace_reader_open(const char *filename);
+//! \brief Render the next event; returns 1 or 0 at the end
+int trace_read(trace_reader *r, trace_entry *e);
+//! \brief Set if the file is damaged or cut short
+int trace_reader_error(const trace_reader *r);
+void trace_reader_close(trace_reader *r);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _TRACE_H */
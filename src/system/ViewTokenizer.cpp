@@ -0,0 +1,228 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstring>
+#include <climits>
+
+#include "ViewTokenizer.hpp"
+
+using namespace std;
+
+ViewTokenizer::ViewTokenizer(const char *sep)
+{
+	this->sep = sep;
+	this->str = "";
+	this->len = 0;
+	this->pos = 0;
+	this->token_count = 0;
+}
+
+bool ViewTokenizer::isSep(char ch) const
+{
+	for (const char *s = sep; *s; s++)
+	{
+		if (*s == ch)
+			return true;
+	}
+	
+	return false;
+}
+
+bool ViewTokenizer::parse(const char *str, unsigned int len)
+{
+	this->str = str;
+	this->len = len;
+	this->pos = 0;
+	this->token_count = -1;
+	
+	return true;
+}
+
+bool ViewTokenizer::parse(const char *str)
+{
+	return parse(str, strlen(str));
+}
+
+// find the token starting at or behind 'pos'; quoted tokens are returned without quotes
+bool ViewTokenizer::scan(unsigned int &pos, strview &sv) const
+{
+	// skip separators
+	while (pos < len && isSep(str[pos]))
+		pos++;
+	
+	if (pos == len)
+		return false;
+	
+	if (str[pos] == '\"')
+	{
+		const unsigned int start = ++pos;
+		
+		// find closing quote which is not escaped
+		while (pos < len && !(str[pos] == '\"' && str[pos - 1] != '\\'))
+			pos++;
+		
+		sv.str = str + start;
+		sv.len = pos - start;
+		
+		// skip closing quote
+		if (pos < len)
+			pos++;
+	}
+	else
+	{
+		const unsigned int start = pos;
+		
+		while (pos < len && !isSep(str[pos]))
+			pos++;
+		
+		sv.str = str + start;
+		sv.len = pos - start;
+	}
+	
+	return true;
+}
+
+bool ViewTokenizer::getNext(strview &sv)
+{
+	if (!scan(pos, sv))
+	{
+		sv.str = str + len;
+		sv.len = 0;
+		return false;
+	}
+	
+	return true;
+}
+
+strview ViewTokenizer::getNext()
+{
+	strview sv;
+	getNext(sv);
+	return sv;
+}
+
+// the remaining (unparsed) part of the string; '\0'-terminated if the parsed string is
+strview ViewTokenizer::getTillEnd()
+{
+	while (pos < len && isSep(str[pos]))
+		pos++;
+	
+	strview sv;
+	sv.str = str + pos;
+	sv.len = len - pos;
+	
+	pos = len;
+	
+	return sv;
+}
+
+// the remaining tokens joined by sep (quotes removed, like Tokenizer::getTillEnd())
+string ViewTokenizer::getTokensTillEnd(char sep)
+{
+	string joined;
+	strview sv;
+	
+	while (getNext(sv))
+	{
+		if (!joined.empty())
+			joined += sep;
+		joined.append(sv.str, sv.len);
+	}
+	
+	return joined;
+}
+
+int ViewTokenizer::getNextInt()
+{
+	return view2int(getNext());
+}
+
+bool ViewTokenizer::hasNext()
+{
+	strview sv;
+	unsigned int p = pos;
+	
+	return scan(p, sv);
+}
+
+// count of all tokens in the string (like Tokenizer::count())
+unsigned int ViewTokenizer::count()
+{
+	if (token_count == -1)
+	{
+		strview sv;
+		unsigned int p = 0;
+		
+		token_count = 0;
+		while (scan(p, sv))
+			token_count++;
+	}
+	
+	return token_count;
+}
+
+// parse a decimal integer directly from the view; clamped to INT_MIN/INT_MAX like strtol()
+int ViewTokenizer::view2int(const strview &sv)
+{
+	unsigned int i = 0;
+	bool negative = false;
+	unsigned int value = 0;
+	
+	if (i < sv.len && (sv.str[i] == '-' || sv.str[i] == '+'))
+		negative = (sv.str[i++] == '-');
+	
+	const unsigned int limit = negative ? (unsigned int) INT_MAX + 1 : (unsigned int) INT_MAX;
+	
+	for (; i < sv.len && sv.str[i] >= '0' && sv.str[i] <= '9'; i++)
+	{
+		const unsigned int digit = sv.str[i] - '0';
+		
+		// the remaining digits are skipped once the limit is reached
+		if (value > (limit - digit) / 10)
+			value = limit;
+		else
+			value = value * 10 + digit;
+	}
+	
+	if (!negative)
+		return (int) value;
+	
+	return (value == (unsigned int) INT_MAX + 1) ? INT_MIN : -(int) value;
+}
+
+bool ViewTokenizer::equals(const strview &sv, const char *str)
+{
+	return (!strncmp(sv.str, str, sv.len) && str[sv.len] == '\0');
+}
+
+ViewTokenizer& operator>>(ViewTokenizer& t, int& i)
+{
+	i = t.getNextInt();
+	return t;
+}
+
+ViewTokenizer& operator>>(ViewTokenizer& t, strview& sv)
+{
+	sv = t.getNext();
+	return t;
+}
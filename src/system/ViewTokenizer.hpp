@@ -0,0 +1,76 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _VIEWTOKENIZER_H
+#define _VIEWTOKENIZER_H
+
+#include <cstddef>
+#include <string>
+
+//! \brief Non-owning view into a character sequence (not necessarily '\0'-terminated)
+typedef struct {
+	const char	*str;
+	unsigned int	len;
+} strview;
+
+
+//! \brief Tokenizer yielding views into the parsed string without allocating or copying
+class ViewTokenizer
+{
+public:
+	ViewTokenizer(const char *sep = " ");
+	
+	bool parse(const char *str, unsigned int len);
+	bool parse(const char *str);
+	bool parse(const strview &sv) { return parse(sv.str, sv.len); };
+	
+	bool getNext(strview &sv);
+	strview getNext();
+	strview getTillEnd();
+	std::string getTokensTillEnd(char sep = ' ');
+	int getNextInt();
+	
+	unsigned int count();
+	bool hasNext();
+	
+	static int view2int(const strview &sv);
+	static bool equals(const strview &sv, const char *str);
+	static std::string view2string(const strview &sv) { return std::string(sv.str, sv.len); };
+	
+	friend ViewTokenizer& operator>>(ViewTokenizer& left, int& i);
+	friend ViewTokenizer& operator>>(ViewTokenizer& left, strview& sv);
+	
+private:
+	bool isSep(char ch) const;
+	bool scan(unsigned int &pos, strview &sv) const;
+	
+	const char *str;
+	unsigned int len;
+	unsigned int pos;
+	
+	int token_count;   // -1 if not yet counted
+	
+	const char *sep;
+};
+
+#endif /* _VIEWTOKENIZER_H */
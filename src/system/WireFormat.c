@@ -0,0 +1,293 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <string.h>
+
+#include "WireFormat.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+void wire_writer_init(wire_writer *w, char *buf, size_t size)
+{
+	w->data = buf;
+	w->size = size;
+	w->len = 0;
+	w->overflow = 0;
+}
+
+// reserve 'count' bytes; returns NULL and flags the writer if they don't fit
+static unsigned char* wire_reserve(wire_writer *w, size_t count)
+{
+	unsigned char *p;
+	
+	if (w->overflow || w->len + count > w->size)
+	{
+		w->overflow = 1;
+		return NULL;
+	}
+	
+	p = (unsigned char*) w->data + w->len;
+	w->len += count;
+	
+	return p;
+}
+
+void wire_put_u8(wire_writer *w, unsigned int value)
+{
+	unsigned char *p = wire_reserve(w, 1);
+	
+	if (p)
+		p[0] = value & 0xff;
+}
+
+void wire_put_i8(wire_writer *w, int value)
+{
+	wire_put_u8(w, (unsigned int) value);
+}
+
+void wire_put_u16(wire_writer *w, unsigned int value)
+{
+	unsigned char *p = wire_reserve(w, 2);
+	
+	if (p)
+	{
+		p[0] = (value >> 8) & 0xff;
+		p[1] = value & 0xff;
+	}
+}
+
+void wire_put_u32(wire_writer *w, unsigned int value)
+{
+	unsigned char *p = wire_reserve(w, 4);
+	
+	if (p)
+	{
+		p[0] = (value >> 24) & 0xff;
+		p[1] = (value >> 16) & 0xff;
+		p[2] = (value >> 8) & 0xff;
+		p[3] = value & 0xff;
+	}
+}
+
+void wire_put_i32(wire_writer *w, int value)
+{
+	wire_put_u32(w, (unsigned int) value);
+}
+
+// 64 bits, regardless of the size of long on this platform
+void wire_put_ulong(wire_writer *w, unsigned long value)
+{
+	wire_put_u32(w, (unsigned int) ((value >> 16) >> 16));
+	wire_put_u32(w, (unsigned int) (value & 0xffffffffUL));
+}
+
+// variable length: 7 bits per byte, high bit set if more bytes follow
+void wire_put_uvar(wire_writer *w, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		wire_put_u8(w, (value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	
+	wire_put_u8(w, value);
+}
+
+// signed values are zigzag-mapped (0, -1, 1, -2, ...) to keep them short
+void wire_put_var(wire_writer *w, int value)
+{
+	wire_put_uvar(w, ((unsigned int) value << 1) ^ (unsigned int) (value >> 31));
+}
+
+void wire_put_bytes(wire_writer *w, const void *buf, size_t count)
+{
+	unsigned char *p = wire_reserve(w, count);
+	
+	if (p && count)
+		memcpy(p, buf, count);
+}
+
+// strings are sent with a 2-byte length prefix and without terminator
+void wire_put_string(wire_writer *w, const char *str, size_t len)
+{
+	if (len > 0xffff)
+		len = 0xffff;
+	
+	wire_put_u16(w, len);
+	wire_put_bytes(w, str, len);
+}
+
+// start a frame; the length is filled in by wire_frame_end()
+size_t wire_frame_begin(wire_writer *w, unsigned int type)
+{
+	const size_t frame_start = w->len;
+	
+	wire_put_u32(w, 0);
+	wire_put_u8(w, type);
+	
+	return frame_start;
+}
+
+void wire_frame_end(wire_writer *w, size_t frame_start)
+{
+	unsigned char *p;
+	size_t len;
+	
+	if (w->overflow)
+		return;
+	
+	p = (unsigned char*) w->data + frame_start;
+	len = w->len - frame_start - WIRE_HEADER_SIZE;
+	
+	p[0] = (len >> 24) & 0xff;
+	p[1] = (len >> 16) & 0xff;
+	p[2] = (len >> 8) & 0xff;
+	p[3] = len & 0xff;
+}
+
+void wire_reader_init(wire_reader *r, const char *buf, size_t len)
+{
+	r->data = buf;
+	r->len = len;
+	r->pos = 0;
+	r->error = 0;
+}
+
+// returns NULL and flags the reader if less than 'count' bytes are left
+static const unsigned char* wire_consume(wire_reader *r, size_t count)
+{
+	const unsigned char *p;
+	
+	if (r->error || r->pos + count > r->len)
+	{
+		r->error = 1;
+		return NULL;
+	}
+	
+	p = (const unsigned char*) r->data + r->pos;
+	r->pos += count;
+	
+	return p;
+}
+
+unsigned int wire_get_u8(wire_reader *r)
+{
+	const unsigned char *p = wire_consume(r, 1);
+	
+	return p ? p[0] : 0;
+}
+
+int wire_get_i8(wire_reader *r)
+{
+	return (signed char) wire_get_u8(r);
+}
+
+unsigned int wire_get_u16(wire_reader *r)
+{
+	const unsigned char *p = wire_consume(r, 2);
+	
+	return p ? (p[0] << 8) | p[1] : 0;
+}
+
+unsigned int wire_get_u32(wire_reader *r)
+{
+	const unsigned char *p = wire_consume(r, 4);
+	
+	if (!p)
+		return 0;
+	
+	return ((unsigned int) p[0] << 24) | ((unsigned int) p[1] << 16) |
+		((unsigned int) p[2] << 8) | (unsigned int) p[3];
+}
+
+int wire_get_i32(wire_reader *r)
+{
+	return (int) wire_get_u32(r);
+}
+
+unsigned long wire_get_ulong(wire_reader *r)
+{
+	const unsigned long hi = wire_get_u32(r);
+	
+	return ((hi << 16) << 16) | wire_get_u32(r);
+}
+
+unsigned int wire_get_uvar(wire_reader *r)
+{
+	unsigned int value = 0;
+	unsigned int shift;
+	
+	for (shift = 0; shift < 35; shift += 7)
+	{
+		const unsigned int b = wire_get_u8(r);
+		
+		value |= (b & 0x7f) << shift;
+		
+		if (!(b & 0x80))
+			return value;
+	}
+	
+	// more than 5 bytes; malformed
+	r->error = 1;
+	return 0;
+}
+
+int wire_get_var(wire_reader *r)
+{
+	const unsigned int value = wire_get_uvar(r);
+	
+	return (int) (value >> 1) ^ -(int) (value & 1);
+}
+
+// returns a pointer into the payload (not '\0'-terminated)
+const char* wire_get_string(wire_reader *r, size_t *len)
+{
+	const size_t slen = wire_get_u16(r);
+	const unsigned char *p = wire_consume(r, slen);
+	
+	*len = p ? slen : 0;
+	
+	return p ? (const char*) p : "";
+}
+
+// raw bytes; NULL if there are less than count left
+const char* wire_get_bytes(wire_reader *r, size_t count)
+{
+	return (const char*) wire_consume(r, count);
+}
+
+// decode the length field of a frame header (WIRE_HEADER_SIZE bytes)
+size_t wire_frame_length(const char *header)
+{
+	const unsigned char *p = (const unsigned char*) header;
+	
+	return ((size_t) p[0] << 24) | ((size_t) p[1] << 16) |
+		((size_t) p[2] << 8) | (size_t) p[3];
+}
+
+#if defined __cplusplus
+    }
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _WIREFORMAT_H
+#define _WIREFORMAT_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* A frame consists of a 4-byte length (network byte order) counting the
+   bytes that follow it, a 1-byte frame type and the payload. */
+#define WIRE_HEADER_SIZE  4
+
+//! \brief Serializer for building frames into a caller-provided buffer
+typedef struct {
+	//! \brief Target buffer
+	char	*data;
+	//! \brief Size of target buffer
+	size_t	size;
+	//! \brief Count of bytes written
+	size_t	len;
+	//! \brief Set if a value didn't fit into the buffer
+	int	overflow;
+} wire_writer;
+
+//! \brief Deserializer reading values from a received payload
+typedef struct {
+	//! \brief Source buffer
+	const char	*data;
+	//! \brief Size of source buffer
+	size_t		len;
+	//! \brief Current read position
+	size_t		pos;
+	//! \brief Set if a read went past the end of the payload
+	int		error;
+} wire_reader;
+
+void wire_writer_init(wire_writer *w, char *buf, size_t size);
+void wire_put_u8(wire_writer *w, unsigned int value);
+void wire_put_i8(wire_writer *w, int value);
+void wire_put_u16(wire_writer *w, unsigned int value);
+void wire_put_u32(wire_writer *w, unsigned int value);
+void wire_put_i32(wire_writer *w, int value);
+void wire_put_ulong(wire_writer *w, unsigned long value);
+void wire_put_uvar(wire_writer *w, unsigned int value);
+void wire_put_var(wire_writer *w, int value);
+void wire_put_bytes(wire_writer *w, const void *buf, size_t count);
+void wire_put_string(wire_writer *w, const char *str, size_t len);
+
+size_t wire_frame_begin(wire_writer *w, unsigned int type);
+void wire_frame_end(wire_writer *w, size_t frame_start);
+
+void wire_reader_init(wire_reader *r, const char *buf, size_t len);
+unsigned int wire_get_u8(wire_reader *r);
+int wire_get_i8(wire_reader *r);
+unsigned int wire_get_u16(wire_reader *r);
+unsigned int wire_get_u32(wire_reader *r);
+int wire_get_i32(wire_reader *r);
+unsigned long wire_get_ulong(wire_reader *r);
+unsigned int wire_get_uvar(wire_reader *r);
+int wire_get_var(wire_reader *r);
+const char* wire_get_string(wire_reader *r, size_t *len);
+const char* wire_get_bytes(wire_reader *r, size_t count);
+
+size_t wire_frame_length(const char *header);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _WIREFORMAT_H */
@@ -0,0 +1,1002 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+
+#include "WireProtocol.hpp"
+
+
+static const char face_symbols[] = "23456789TJQKA";
+static const char suit_symbols[] = "cdhs";
+
+
+static bool is_card(const char *str, unsigned int len)
+{
+	return (len == 2 && str[0] && str[1] &&
+		strchr(face_symbols, str[0]) && strchr(suit_symbols, str[1]));
+}
+
+// cards are sent as single byte: face-index * 4 + suit-index
+static unsigned int card2byte(const char *name)
+{
+	if (!is_card(name, strlen(name)))
+		return 0xff;
+	
+	return (strchr(face_symbols, name[0]) - face_symbols) * 4 +
+		(strchr(suit_symbols, name[1]) - suit_symbols);
+}
+
+static bool byte2card(unsigned int b, char *name)
+{
+	if (b >= 52)
+		return false;
+	
+	name[0] = face_symbols[b / 4];
+	name[1] = suit_symbols[b % 4];
+	name[2] = '\0';
+	
+	return true;
+}
+
+static void view2card(const strview &sv, char *name)
+{
+	const unsigned int len = (sv.len < 2) ? sv.len : 2;
+	
+	memcpy(name, sv.str, len);
+	name[len] = '\0';
+}
+
+static bool is_number(const strview &sv)
+{
+	unsigned int i = (sv.len && sv.str[0] == '-') ? 1 : 0;
+	
+	if (i == sv.len)
+		return false;
+	
+	for (; i < sv.len; i++)
+		if (sv.str[i] < '0' || sv.str[i] > '9')
+			return false;
+	
+	return true;
+}
+
+// append formatted text to buf; 'len' is advanced but never beyond 'size'
+static void append(char *buf, size_t size, size_t &len, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+	
+	if (len >= size)
+		return;
+	
+	va_start(args, fmt);
+	n = vsnprintf(buf + len, size - len, fmt, args);
+	va_end(args);
+	
+	if (n < 0 || (size_t) n >= size - len)
+		len = size;
+	else
+		len += n;
+}
+
+// returns the length of the formatted text, -1 if it was truncated
+static int append_result(size_t size, size_t len)
+{
+	return (len >= size) ? -1 : (int) len;
+}
+
+
+int wire_format_table_snap(const wire_table_snap *ts, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	// <state>:<betting-round>
+	append(buf, size, len, "%d:%d ", ts->state, ts->betround);
+	
+	// <dealer>:<SB>:<BB>:<current>:<last-bet>
+	if (ts->has_turn)
+		append(buf, size, len, "%d:%d:%d:%d:%d ",
+			ts->s_dealer, ts->s_sb, ts->s_bb, ts->s_cur, ts->s_lastbet);
+	else
+		append(buf, size, len, "-1 ");
+	
+	// <community-cards>
+	append(buf, size, len, "cc:");
+	for (unsigned int i=0; i < ts->cc_count; i++)
+		append(buf, size, len, "%s%s", i ? ":" : "", ts->cc[i]);
+	
+	// seats
+	for (unsigned int i=0; i < ts->seat_count; i++)
+	{
+		const wire_seat *s = &(ts->seats[i]);
+		
+		append(buf, size, len, " s%d:%d:%d:%d:%d:%d:",
+			s->seat_no, s->client_id, s->pstate,
+			s->stake, s->bet, s->action);
+		
+		if (s->hole_count)
+		{
+			for (unsigned int c=0; c < s->hole_count; c++)
+				append(buf, size, len, "%s", s->hole[c]);
+		}
+		else
+			append(buf, size, len, "-");
+	}
+	
+	// pots
+	for (unsigned int i=0; i < ts->pot_count; i++)
+		append(buf, size, len, " p%d:%d", i, ts->pots[i]);
+	
+	// minimum bet
+	append(buf, size, len, " %d", ts->minimum_bet);
+	
+	return append_result(size, len);
+}
+
+bool wire_parse_table_snap(const char *args, unsigned int len, wire_table_snap *ts)
+{
+	ViewTokenizer t(" "), st(":");
+	strview tok;
+	
+	memset(ts, 0, sizeof(wire_table_snap));
+	t.parse(args, len);
+	
+	// <state>:<betting-round>
+	if (!t.getNext(tok))
+		return false;
+	
+	st.parse(tok);
+	ts->state = st.getNextInt();
+	ts->betround = st.getNextInt();
+	
+	// <dealer>:<SB>:<BB>:<current>:<last-bet> or -1
+	if (!t.getNext(tok))
+		return false;
+	
+	st.parse(tok);
+	ts->has_turn = (st.count() == 5);
+	ts->s_dealer = st.getNextInt();
+	ts->s_sb = st.getNextInt();
+	ts->s_bb = st.getNextInt();
+	ts->s_cur = st.getNextInt();
+	ts->s_lastbet = st.getNextInt();
+	
+	// cc:<community-cards>
+	if (!t.getNext(tok) || tok.len < 3)
+		return false;
+	
+	st.parse(tok.str + 3, tok.len - 3);
+	while (ts->cc_count < 5 && st.getNext(tok))
+		view2card(tok, ts->cc[ts->cc_count++]);
+	
+	// seats, pots and minimum bet
+	while (t.getNext(tok))
+	{
+		if (tok.len && tok.str[0] == 's')
+		{
+			if (ts->seat_count == WIRE_MAX_SEATS)
+				return false;
+			
+			wire_seat *s = &(ts->seats[ts->seat_count++]);
+			
+			st.parse(tok.str + 1, tok.len - 1);
+			s->seat_no = st.getNextInt();
+			s->client_id = st.getNextInt();
+			s->pstate = st.getNextInt();
+			s->stake = st.getNextInt();
+			s->bet = st.getNextInt();
+			s->action = st.getNextInt();
+			
+			const strview hole = st.getNext();
+			if (hole.len == 4)
+			{
+				const strview h1 = { hole.str, 2 };
+				const strview h2 = { hole.str + 2, 2 };
+				
+				view2card(h1, s->hole[0]);
+				view2card(h2, s->hole[1]);
+				s->hole_count = 2;
+			}
+		}
+		else if (tok.len && tok.str[0] == 'p')
+		{
+			if (ts->pot_count == WIRE_MAX_POTS)
+				return false;
+			
+			st.parse(tok.str + 1, tok.len - 1);
+			st.getNext();   // pot-no; implied by order
+			ts->pots[ts->pot_count++] = st.getNextInt();
+		}
+		else
+			ts->minimum_bet = ViewTokenizer::view2int(tok);
+	}
+	
+	return true;
+}
+
+// parts of a table snapshot; each part is encoded as a whole
+static void encode_turn(wire_writer *w, const wire_table_snap *ts)
+{
+	wire_put_u8(w, ts->has_turn ? 1 : 0);
+	if (ts->has_turn)
+	{
+		wire_put_i8(w, ts->s_dealer);
+		wire_put_i8(w, ts->s_sb);
+		wire_put_i8(w, ts->s_bb);
+		wire_put_i8(w, ts->s_cur);
+		wire_put_i8(w, ts->s_lastbet);
+	}
+}
+
+static void decode_turn(wire_reader *r, wire_table_snap *ts)
+{
+	ts->has_turn = wire_get_u8(r);
+	if (ts->has_turn)
+	{
+		ts->s_dealer = wire_get_i8(r);
+		ts->s_sb = wire_get_i8(r);
+		ts->s_bb = wire_get_i8(r);
+		ts->s_cur = wire_get_i8(r);
+		ts->s_lastbet = wire_get_i8(r);
+	}
+	else
+	{
+		ts->s_dealer = -1;
+		ts->s_sb = ts->s_bb = ts->s_cur = ts->s_lastbet = 0;
+	}
+}
+
+static void encode_cards(wire_writer *w, const wire_table_snap *ts)
+{
+	wire_put_u8(w, ts->cc_count);
+	for (unsigned int i=0; i < ts->cc_count; i++)
+		wire_put_u8(w, card2byte(ts->cc[i]));
+}
+
+static bool decode_cards(wire_reader *r, wire_table_snap *ts)
+{
+	memset(ts->cc, 0, sizeof(ts->cc));
+	
+	ts->cc_count = wire_get_u8(r);
+	if (ts->cc_count > 5)
+		return false;
+	
+	for (unsigned int i=0; i < ts->cc_count; i++)
+		if (!byte2card(wire_get_u8(r), ts->cc[i]))
+			return false;
+	
+	return true;
+}
+
+static void encode_pots(wire_writer *w, const wire_table_snap *ts)
+{
+	wire_put_u8(w, ts->pot_count);
+	for (unsigned int i=0; i < ts->pot_count; i++)
+		wire_put_uvar(w, ts->pots[i]);
+}
+
+static bool decode_pots(wire_reader *r, wire_table_snap *ts)
+{
+	memset(ts->pots, 0, sizeof(ts->pots));
+	
+	ts->pot_count = wire_get_u8(r);
+	if (ts->pot_count > WIRE_MAX_POTS)
+		return false;
+	
+	for (unsigned int i=0; i < ts->pot_count; i++)
+		ts->pots[i] = wire_get_uvar(r);
+	
+	return true;
+}
+
+static bool same_turn(const wire_table_snap *a, const wire_table_snap *b)
+{
+	if (a->has_turn != b->has_turn)
+		return false;
+	
+	return !a->has_turn || (a->s_dealer == b->s_dealer && a->s_sb == b->s_sb &&
+		a->s_bb == b->s_bb && a->s_cur == b->s_cur && a->s_lastbet == b->s_lastbet);
+}
+
+static bool same_cards(const wire_table_snap *a, const wire_table_snap *b)
+{
+	return a->cc_count == b->cc_count && !memcmp(a->cc, b->cc, a->cc_count * sizeof(a->cc[0]));
+}
+
+static bool same_pots(const wire_table_snap *a, const wire_table_snap *b)
+{
+	return a->pot_count == b->pot_count && !memcmp(a->pots, b->pots, a->pot_count * sizeof(a->pots[0]));
+}
+
+// fields of a seat which differ from the previous state of the seat
+static unsigned int seat_changes(const wire_seat *prev, const wire_seat *s)
+{
+	if (!prev)
+		return WireSeatAll;
+	
+	unsigned int changes = 0;
+	
+	if (prev->client_id != s->client_id)
+		changes |= WireSeatClient;
+	if (prev->pstate != s->pstate)
+		changes |= WireSeatState;
+	if (prev->stake != s->stake)
+		changes |= WireSeatStake;
+	if (prev->bet != s->bet)
+		changes |= WireSeatBet;
+	if (prev->action != s->action)
+		changes |= WireSeatAction;
+	if (prev->hole_count != s->hole_count ||
+		memcmp(prev->hole, s->hole, s->hole_count * sizeof(s->hole[0])))
+	{
+		changes |= WireSeatHole;
+	}
+	
+	return changes;
+}
+
+static void encode_seat(wire_writer *w, const wire_seat *s, unsigned int fields)
+{
+	if (fields & WireSeatClient)
+		wire_put_var(w, s->client_id);
+	if (fields & WireSeatState)
+		wire_put_u8(w, s->pstate);
+	if (fields & WireSeatStake)
+		wire_put_uvar(w, s->stake);
+	if (fields & WireSeatBet)
+		wire_put_uvar(w, s->bet);
+	if (fields & WireSeatAction)
+		wire_put_u8(w, s->action);
+	
+	if (fields & WireSeatHole)
+	{
+		wire_put_u8(w, s->hole_count);
+		for (unsigned int c=0; c < s->hole_count; c++)
+			wire_put_u8(w, card2byte(s->hole[c]));
+	}
+}
+
+static bool decode_seat(wire_reader *r, wire_seat *s, unsigned int fields)
+{
+	if (fields & WireSeatClient)
+		s->client_id = wire_get_var(r);
+	if (fields & WireSeatState)
+		s->pstate = wire_get_u8(r);
+	if (fields & WireSeatStake)
+		s->stake = wire_get_uvar(r);
+	if (fields & WireSeatBet)
+		s->bet = wire_get_uvar(r);
+	if (fields & WireSeatAction)
+		s->action = wire_get_u8(r);
+	
+	if (fields & WireSeatHole)
+	{
+		memset(s->hole, 0, sizeof(s->hole));
+		
+		s->hole_count = wire_get_u8(r);
+		if (s->hole_count > 2)
+			return false;
+		
+		for (unsigned int c=0; c < s->hole_count; c++)
+			if (!byte2card(wire_get_u8(r), s->hole[c]))
+				return false;
+	}
+	
+	return true;
+}
+
+static const wire_seat* find_seat(const wire_table_snap *ts, int seat_no)
+{
+	for (unsigned int i=0; i < ts->seat_count; i++)
+		if (ts->seats[i].seat_no == seat_no)
+			return &(ts->seats[i]);
+	
+	return NULL;
+}
+
+void wire_encode_table_snap(wire_writer *w, const wire_table_snap *ts)
+{
+	wire_put_i8(w, ts->state);
+	wire_put_i8(w, ts->betround);
+	
+	encode_turn(w, ts);
+	encode_cards(w, ts);
+	
+	wire_put_u8(w, ts->seat_count);
+	for (unsigned int i=0; i < ts->seat_count; i++)
+	{
+		wire_put_u8(w, ts->seats[i].seat_no);
+		encode_seat(w, &(ts->seats[i]), WireSeatAll);
+	}
+	
+	encode_pots(w, ts);
+	
+	wire_put_uvar(w, ts->minimum_bet);
+}
+
+bool wire_decode_table_snap(wire_reader *r, wire_table_snap *ts)
+{
+	memset(ts, 0, sizeof(wire_table_snap));
+	
+	ts->state = wire_get_i8(r);
+	ts->betround = wire_get_i8(r);
+	
+	decode_turn(r, ts);
+	
+	if (!decode_cards(r, ts))
+		return false;
+	
+	ts->seat_count = wire_get_u8(r);
+	if (ts->seat_count > WIRE_MAX_SEATS)
+		return false;
+	
+	for (unsigned int i=0; i < ts->seat_count; i++)
+	{
+		wire_seat *s = &(ts->seats[i]);
+		
+		s->seat_no = wire_get_u8(r);
+		if (!decode_seat(r, s, WireSeatAll))
+			return false;
+	}
+	
+	if (!decode_pots(r, ts))
+		return false;
+	
+	ts->minimum_bet = wire_get_uvar(r);
+	
+	return !r->error;
+}
+
+void wire_encode_table_delta(wire_writer *w, const wire_table_snap *base, const wire_table_snap *ts)
+{
+	// seats present in the snapshot and seats which changed since base
+	unsigned int seats_present = 0, seats_changed = 0;
+	unsigned int changes[WIRE_MAX_SEATS];
+	
+	for (unsigned int i=0; i < ts->seat_count; i++)
+	{
+		const wire_seat *s = &(ts->seats[i]);
+		
+		seats_present |= 1 << s->seat_no;
+		
+		changes[i] = seat_changes(find_seat(base, s->seat_no), s);
+		if (changes[i])
+			seats_changed |= 1 << s->seat_no;
+	}
+	
+	unsigned int parts = 0;
+	
+	if (ts->state != base->state || ts->betround != base->betround)
+		parts |= WireDeltaState;
+	if (!same_turn(base, ts))
+		parts |= WireDeltaTurn;
+	if (!same_cards(base, ts))
+		parts |= WireDeltaCards;
+	if (seats_changed || ts->seat_count != base->seat_count)
+		parts |= WireDeltaSeats;
+	if (!same_pots(base, ts))
+		parts |= WireDeltaPots;
+	if (ts->minimum_bet != base->minimum_bet)
+		parts |= WireDeltaMinimumBet;
+	
+	
+	wire_put_u8(w, parts);
+	
+	if (parts & WireDeltaState)
+	{
+		wire_put_i8(w, ts->state);
+		wire_put_i8(w, ts->betround);
+	}
+	
+	if (parts & WireDeltaTurn)
+		encode_turn(w, ts);
+	
+	if (parts & WireDeltaCards)
+		encode_cards(w, ts);
+	
+	if (parts & WireDeltaSeats)
+	{
+		wire_put_uvar(w, seats_present);
+		wire_put_uvar(w, seats_changed);
+		
+		for (unsigned int i=0; i < ts->seat_count; i++)
+		{
+			if (!changes[i])
+				continue;
+			
+			wire_put_u8(w, changes[i]);
+			encode_seat(w, &(ts->seats[i]), changes[i]);
+		}
+	}
+	
+	if (parts & WireDeltaPots)
+		encode_pots(w, ts);
+	
+	if (parts & WireDeltaMinimumBet)
+		wire_put_uvar(w, ts->minimum_bet);
+}
+
+bool wire_decode_table_delta(wire_reader *r, wire_table_snap *ts)
+{
+	const unsigned int parts = wire_get_u8(r);
+	
+	if (parts & WireDeltaState)
+	{
+		ts->state = wire_get_i8(r);
+		ts->betround = wire_get_i8(r);
+	}
+	
+	if (parts & WireDeltaTurn)
+		decode_turn(r, ts);
+	
+	if ((parts & WireDeltaCards) && !decode_cards(r, ts))
+		return false;
+	
+	if (parts & WireDeltaSeats)
+	{
+		const unsigned int seats_present = wire_get_uvar(r);
+		const unsigned int seats_changed = wire_get_uvar(r);
+		
+		if (seats_present >> WIRE_MAX_SEATS || seats_changed & ~seats_present)
+			return false;
+		
+		// rebuild the seat list ordered by seat number
+		const wire_table_snap base = *ts;
+		memset(ts->seats, 0, sizeof(ts->seats));
+		ts->seat_count = 0;
+		
+		for (int seat_no=0; seat_no < WIRE_MAX_SEATS; seat_no++)
+		{
+			if (!(seats_present & (1 << seat_no)))
+				continue;
+			
+			wire_seat *s = &(ts->seats[ts->seat_count++]);
+			const wire_seat *prev = find_seat(&base, seat_no);
+			
+			if (prev)
+				*s = *prev;
+			else
+			{
+				// a new seat must be sent completely
+				memset(s, 0, sizeof(wire_seat));
+				s->seat_no = seat_no;
+			}
+			
+			if (seats_changed & (1 << seat_no))
+			{
+				const unsigned int fields = wire_get_u8(r);
+				
+				if ((!prev && fields != WireSeatAll) || !decode_seat(r, s, fields))
+					return false;
+			}
+			else if (!prev)
+				return false;
+		}
+	}
+	
+	if ((parts & WireDeltaPots) && !decode_pots(r, ts))
+		return false;
+	
+	if (parts & WireDeltaMinimumBet)
+		ts->minimum_bet = wire_get_uvar(r);
+	
+	return !r->error;
+}
+
+
+int wire_format_gameinfo(const wire_gameinfo *gi, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	append(buf, size, len, "%d %d:%d:%d:%d:%d:%d:%d:%d %d:%d:%d \"%.*s\"",
+		gi->gid,
+		gi->type, gi->mode, gi->state, gi->flags,
+		gi->players_max, gi->players_count,
+		gi->timeout, gi->stakes,
+		gi->blinds_start, gi->blinds_factor, gi->blinds_time,
+		(int) gi->name.len, gi->name.str);
+	
+	return append_result(size, len);
+}
+
+// the parts before and after the flags; head + flags + tail is the same
+// as wire_format_gameinfo
+int wire_format_gameinfo_head(const wire_gameinfo *gi, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	append(buf, size, len, "%d %d:%d:%d:",
+		gi->gid,
+		gi->type, gi->mode, gi->state);
+	
+	return append_result(size, len);
+}
+
+int wire_format_gameinfo_tail(const wire_gameinfo *gi, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	append(buf, size, len, ":%d:%d:%d:%d %d:%d:%d \"%.*s\"",
+		gi->players_max, gi->players_count,
+		gi->timeout, gi->stakes,
+		gi->blinds_start, gi->blinds_factor, gi->blinds_time,
+		(int) gi->name.len, gi->name.str);
+	
+	return append_result(size, len);
+}
+
+bool wire_parse_gameinfo(const char *args, unsigned int len, wire_gameinfo *gi)
+{
+	ViewTokenizer t(" "), it(":");
+	
+	memset(gi, 0, sizeof(wire_gameinfo));
+	
+	t.parse(args, len);
+	if (t.count() < 4)
+		return false;
+	
+	gi->gid = t.getNextInt();
+	
+	it.parse(t.getNext());
+	gi->type = it.getNextInt();
+	gi->mode = it.getNextInt();
+	gi->state = it.getNextInt();
+	gi->flags = it.getNextInt();
+	gi->players_max = it.getNextInt();
+	gi->players_count = it.getNextInt();
+	gi->timeout = it.getNextInt();
+	gi->stakes = it.getNextInt();
+	
+	it.parse(t.getNext());
+	gi->blinds_start = it.getNextInt();
+	gi->blinds_factor = it.getNextInt();
+	gi->blinds_time = it.getNextInt();
+	
+	gi->name = t.getNext();
+	
+	return true;
+}
+
+void wire_encode_gameinfo(wire_writer *w, const wire_gameinfo *gi)
+{
+	wire_encode_gameinfo_head(w, gi);
+	wire_put_uvar(w, gi->flags);
+	wire_encode_gameinfo_tail(w, gi);
+}
+
+void wire_encode_gameinfo_head(wire_writer *w, const wire_gameinfo *gi)
+{
+	wire_put_var(w, gi->gid);
+	wire_put_u8(w, gi->type);
+	wire_put_u8(w, gi->mode);
+	wire_put_u8(w, gi->state);
+}
+
+void wire_encode_gameinfo_tail(wire_writer *w, const wire_gameinfo *gi)
+{
+	wire_put_uvar(w, gi->players_max);
+	wire_put_uvar(w, gi->players_count);
+	wire_put_uvar(w, gi->timeout);
+	wire_put_uvar(w, gi->stakes);
+	wire_put_uvar(w, gi->blinds_start);
+	wire_put_uvar(w, gi->blinds_factor);
+	wire_put_uvar(w, gi->blinds_time);
+	wire_put_string(w, gi->name.str, gi->name.len);
+}
+
+bool wire_decode_gameinfo(wire_reader *r, wire_gameinfo *gi)
+{
+	size_t len;
+	
+	gi->gid = wire_get_var(r);
+	gi->type = wire_get_u8(r);
+	gi->mode = wire_get_u8(r);
+	gi->state = wire_get_u8(r);
+	gi->flags = wire_get_uvar(r);
+	gi->players_max = wire_get_uvar(r);
+	gi->players_count = wire_get_uvar(r);
+	gi->timeout = wire_get_uvar(r);
+	gi->stakes = wire_get_uvar(r);
+	gi->blinds_start = wire_get_uvar(r);
+	gi->blinds_factor = wire_get_uvar(r);
+	gi->blinds_time = wire_get_uvar(r);
+	gi->name.str = wire_get_string(r, &len);
+	gi->name.len = len;
+	
+	return !r->error;
+}
+
+
+int wire_format_msg(const wire_msg *m, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	if (m->gid == -1)
+		append(buf, size, len, "%d ", m->cid);
+	else if (m->cid == -1)
+		append(buf, size, len, "%d:%d ", m->gid, m->tid);
+	else
+		append(buf, size, len, "%d:%d:%d ", m->gid, m->tid, m->cid);
+	
+	// names of clients are quoted; server names (foyer, game, table) aren't
+	if (m->cid != -1)
+		append(buf, size, len, "\"%.*s\" ", (int) m->name.len, m->name.str);
+	else
+		append(buf, size, len, "%.*s ", (int) m->name.len, m->name.str);
+	
+	append(buf, size, len, "%.*s", (int) m->text.len, m->text.str);
+	
+	return append_result(size, len);
+}
+
+int wire_format_clientinfo(const wire_clientinfo *ci, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	append(buf, size, len, "%d \"name:%.*s\" \"location:%.*s\"",
+		ci->cid,
+		(int) ci->name.len, ci->name.str,
+		(int) ci->location.len, ci->location.str);
+	
+	return append_result(size, len);
+}
+
+bool wire_parse_msg(const char *args, unsigned int len, wire_msg *m)
+{
+	ViewTokenizer t(" "), ft(":");
+	
+	t.parse(args, len);
+	if (t.count() < 2)
+		return false;
+	
+	ft.parse(t.getNext());
+	
+	m->gid = -1;
+	m->tid = -1;
+	m->cid = -1;
+	
+	if (ft.count() == 2)   // message from game/table
+	{
+		m->gid = ft.getNextInt();
+		m->tid = ft.getNextInt();
+	}
+	else if (ft.count() == 3)   // client message from table
+	{
+		m->gid = ft.getNextInt();
+		m->tid = ft.getNextInt();
+		m->cid = ft.getNextInt();
+	}
+	else   // message from foyer or client
+		m->cid = ft.getNextInt();
+	
+	m->name = t.getNext();
+	m->text = t.getTillEnd();
+	
+	return true;
+}
+
+void wire_encode_msg(wire_writer *w, const wire_msg *m)
+{
+	wire_put_var(w, m->gid);
+	wire_put_var(w, m->tid);
+	wire_put_var(w, m->cid);
+	wire_put_string(w, m->name.str, m->name.len);
+	wire_put_string(w, m->text.str, m->text.len);
+}
+
+bool wire_decode_msg(wire_reader *r, wire_msg *m)
+{
+	size_t len;
+	
+	m->gid = wire_get_var(r);
+	m->tid = wire_get_var(r);
+	m->cid = wire_get_var(r);
+	m->name.str = wire_get_string(r, &len);
+	m->name.len = len;
+	m->text.str = wire_get_string(r, &len);
+	m->text.len = len;
+	
+	return !r->error;
+}
+
+
+void wire_encode_clientinfo(wire_writer *w, const wire_clientinfo *ci)
+{
+	wire_put_var(w, ci->cid);
+	wire_put_string(w, ci->name.str, ci->name.len);
+	wire_put_string(w, ci->location.str, ci->location.len);
+}
+
+bool wire_decode_clientinfo(wire_reader *r, wire_clientinfo *ci)
+{
+	size_t len;
+	
+	ci->cid = wire_get_var(r);
+	ci->name.str = wire_get_string(r, &len);
+	ci->name.len = len;
+	ci->location.str = wire_get_string(r, &len);
+	ci->location.len = len;
+	
+	return !r->error;
+}
+
+
+void wire_encode_action(wire_writer *w, const wire_action *a)
+{
+	wire_put_var(w, a->msgid);
+	wire_put_var(w, a->gid);
+	wire_put_u8(w, a->action);
+	wire_put_uvar(w, a->amount);
+}
+
+bool wire_decode_action(wire_reader *r, wire_action *a)
+{
+	a->msgid = wire_get_var(r);
+	a->gid = wire_get_var(r);
+	a->action = wire_get_u8(r);
+	a->amount = wire_get_uvar(r);
+	
+	return !r->error;
+}
+
+
+int wire_format_fields(const wire_fields *f, char *buf, size_t size)
+{
+	size_t len = 0;
+	
+	for (unsigned int i=0; i < f->count; i++)
+	{
+		const wire_field *field = &(f->fields[i]);
+		const char *sep = i ? " " : "";
+		
+		switch (field->type)
+		{
+		case WireFieldInt:
+			append(buf, size, len, "%s%d", sep, field->value);
+			break;
+		case WireFieldCard:
+			append(buf, size, len, "%s%s", sep, field->card);
+			break;
+		case WireFieldString:
+			append(buf, size, len, "%s\"%.*s\"", sep, (int) field->str.len, field->str.str);
+			break;
+		}
+	}
+	
+	if (!f->count && size)
+		*buf = '\0';
+	
+	return append_result(size, len);
+}
+
+bool wire_parse_fields(const char *args, unsigned int len, wire_fields *f)
+{
+	ViewTokenizer t(" ");
+	strview tok;
+	
+	f->count = 0;
+	t.parse(args, len);
+	
+	while (t.getNext(tok))
+	{
+		if (f->count == WIRE_MAX_FIELDS)
+			return false;
+		
+		wire_field *field = &(f->fields[f->count++]);
+		
+		if (is_number(tok))
+		{
+			field->type = WireFieldInt;
+			field->value = ViewTokenizer::view2int(tok);
+		}
+		else if (is_card(tok.str, tok.len))
+		{
+			field->type = WireFieldCard;
+			view2card(tok, field->card);
+		}
+		else
+		{
+			field->type = WireFieldString;
+			field->str = tok;
+		}
+	}
+	
+	return true;
+}
+
+void wire_encode_fields(wire_writer *w, const wire_fields *f)
+{
+	wire_put_u8(w, f->count);
+	
+	for (unsigned int i=0; i < f->count; i++)
+	{
+		const wire_field *field = &(f->fields[i]);
+		
+		wire_put_u8(w, field->type);
+		
+		switch (field->type)
+		{
+		case WireFieldInt:
+			wire_put_var(w, field->value);
+			break;
+		case WireFieldCard:
+			wire_put_u8(w, card2byte(field->card));
+			break;
+		case WireFieldString:
+			wire_put_string(w, field->str.str, field->str.len);
+			break;
+		}
+	}
+}
+
+bool wire_decode_fields(wire_reader *r, wire_fields *f)
+{
+	f->count = wire_get_u8(r);
+	if (f->count > WIRE_MAX_FIELDS)
+		return false;
+	
+	for (unsigned int i=0; i < f->count; i++)
+	{
+		wire_field *field = &(f->fields[i]);
+		size_t len;
+		
+		field->type = wire_get_u8(r);
+		
+		switch (field->type)
+		{
+		case WireFieldInt:
+			field->value = wire_get_var(r);
+			break;
+		case WireFieldCard:
+			if (!byte2card(wire_get_u8(r), field->card))
+				return false;
+			break;
+		case WireFieldString:
+			field->str.str = wire_get_string(r, &len);
+			field->str.len = len;
+			break;
+		default:
+			return false;
+		}
+	}
+	
+	return !r->error;
+}
+
+
+// parse the 'binary:<version>' token of PCLIENT/PSERVER
+bool wire_parse_version(const strview &sv, unsigned int *version)
+{
+	static const char prefix[] = "binary:";
+	const unsigned int plen = sizeof(prefix) - 1;
+	
+	if (sv.len <= plen || strncmp(sv.str, prefix, plen))
+		return false;
+	
+	const strview sversion = { sv.str + plen, sv.len - plen };
+	*version = ViewTokenizer::view2int(sversion);
+	
+	return true;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+#ifndef _WIREPROTOCOL_H
+#define _WIREPROTOCOL_H
+
+#include <cstddef>
+
+#include "Protocol.h"
+#include "WireFormat.h"
+#include "ViewTokenizer.hpp"
+
+/* version of the binary protocol; announced as 'binary:<version>' in
+   PCLIENT and acknowledged the same way in PSERVER */
+#define WIRE_PROTOCOL_VERSION  1
+
+#define WIRE_MAX_SEATS   10
+#define WIRE_MAX_POTS    10
+#define WIRE_MAX_CARDS   7
+#define WIRE_MAX_FIELDS  16
+
+
+//! \brief Seat of a table snapshot
+typedef struct {
+	int		seat_no;
+	int		client_id;
+	//! \brief Combination of playerstate
+	int		pstate;
+	unsigned int	stake;
+	unsigned int	bet;
+	//! \brief Last action (Player::PlayerAction)
+	int		action;
+	//! \brief Count of shown hole-cards (0 if hidden)
+	unsigned int	hole_count;
+	char		hole[2][3];
+} wire_seat;
+
+//! \brief Typed contents of a SnapTable snapshot
+typedef struct {
+	int		state;
+	//! \brief Betting round; -1 if not betting
+	int		betround;
+	//! \brief Whether the dealer/blinds/current seats are set
+	bool		has_turn;
+	int		s_dealer;
+	int		s_sb;
+	int		s_bb;
+	int		s_cur;
+	int		s_lastbet;
+	unsigned int	cc_count;
+	char		cc[5][3];
+	unsigned int	seat_count;
+	wire_seat	seats[WIRE_MAX_SEATS];
+	unsigned int	pot_count;
+	unsigned int	pots[WIRE_MAX_POTS];
+	unsigned int	minimum_bet;
+} wire_table_snap;
+
+//! \brief Typed contents of a GAMEINFO message
+typedef struct {
+	int		gid;
+	int		type;
+	int		mode;
+	int		state;
+	//! \brief Combination of gameinfo_flags
+	unsigned int	flags;
+	unsigned int	players_max;
+	unsigned int	players_count;
+	unsigned int	timeout;
+	unsigned int	stakes;
+	unsigned int	blinds_start;
+	//! \brief Blinds factor multiplied by 10
+	unsigned int	blinds_factor;
+	unsigned int	blinds_time;
+	strview		name;
+} wire_gameinfo;
+
+//! \brief Typed contents of a CLIENTINFO message
+typedef struct {
+	int		cid;
+	strview		name;
+	strview		location;
+} wire_clientinfo;
+
+//! \brief Typed contents of a MSG message
+typedef struct {
+	//! \brief Source game; -1 if from foyer/server
+	int		gid;
+	int		tid;
+	//! \brief Source client; -1 if from server/game/table
+	int		cid;
+	strview		name;
+	strview		text;
+} wire_msg;
+
+//! \brief Typed contents of an ACTION message
+typedef struct {
+	int		msgid;
+	int		gid;
+	//! \brief Player::PlayerAction
+	int		action;
+	unsigned int	amount;
+} wire_action;
+
+//! \brief Parts of a table snapshot present in a delta
+typedef enum {
+	WireDeltaState = 0x01,
+	WireDeltaTurn = 0x02,
+	WireDeltaCards = 0x04,
+	WireDeltaSeats = 0x08,
+	WireDeltaPots = 0x10,
+	WireDeltaMinimumBet = 0x20
+} wiredelta_type;
+
+//! \brief Fields of a seat present in a delta
+typedef enum {
+	WireSeatClient = 0x01,
+	WireSeatState = 0x02,
+	WireSeatStake = 0x04,
+	WireSeatBet = 0x08,
+	WireSeatAction = 0x10,
+	WireSeatHole = 0x20,
+	WireSeatAll = 0x3f
+} wireseat_type;
+
+//! \brief Single field of a generic snapshot
+typedef struct {
+	//! \brief wirefield_type
+	int		type;
+	int		value;
+	char		card[3];
+	strview		str;
+} wire_field;
+
+//! \brief Fields of a snapshot which has no dedicated typed layout
+typedef struct {
+	unsigned int	count;
+	wire_field	fields[WIRE_MAX_FIELDS];
+} wire_fields;
+
+
+// text encoding; arguments only (without message name)
+int wire_format_table_snap(const wire_table_snap *ts, char *buf, size_t size);
+int wire_format_gameinfo(const wire_gameinfo *gi, char *buf, size_t size);
+int wire_format_gameinfo_head(const wire_gameinfo *gi, char *buf, size_t size);
+int wire_format_gameinfo_tail(const wire_gameinfo *gi, char *buf, size_t size);
+int wire_format_msg(const wire_msg *m, char *buf, size_t size);
+int wire_format_clientinfo(const wire_clientinfo *ci, char *buf, size_t size);
+int wire_format_fields(const wire_fields *f, char *buf, size_t size);
+
+bool wire_parse_table_snap(const char *args, unsigned int len, wire_table_snap *ts);
+bool wire_parse_gameinfo(const char *args, unsigned int len, wire_gameinfo *gi);
+bool wire_parse_msg(const char *args, unsigned int len, wire_msg *m);
+bool wire_parse_fields(const char *args, unsigned int len, wire_fields *f);
+
+// binary encoding; payload only (without frame header)
+void wire_encode_table_snap(wire_writer *w, const wire_table_snap *ts);
+void wire_encode_table_delta(wire_writer *w, const wire_table_snap *base, const wire_table_snap *ts);
+void wire_encode_gameinfo(wire_writer *w, const wire_gameinfo *gi);
+void wire_encode_gameinfo_head(wire_writer *w, const wire_gameinfo *gi);
+void wire_encode_gameinfo_tail(wire_writer *w, const wire_gameinfo *gi);
+void wire_encode_msg(wire_writer *w, const wire_msg *m);
+void wire_encode_clientinfo(wire_writer *w, const wire_clientinfo *ci);
+void wire_encode_action(wire_writer *w, const wire_action *a);
+void wire_encode_fields(wire_writer *w, const wire_fields *f);
+
+bool wire_decode_table_snap(wire_reader *r, wire_table_snap *ts);
+bool wire_decode_table_delta(wire_reader *r, wire_table_snap *ts);
+bool wire_decode_gameinfo(wire_reader *r, wire_gameinfo *gi);
+bool wire_decode_msg(wire_reader *r, wire_msg *m);
+bool wire_decode_clientinfo(wire_reader *r, wire_clientinfo *ci);
+bool wire_decode_action(wire_reader *r, wire_action *a);
+bool wire_decode_fields(wire_reader *r, wire_fields *f);
+
+bool wire_parse_version(const strview &sv, unsigned int *version);
+
+#endif /* _WIREPROTOCOL_H */
@@ -0,0 +1,300 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "ZStream.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+#define ZSTREAM_CHUNK  4096
+
+struct zstream {
+	z_stream	strm;
+	int		deflating;
+	
+	//! \brief Configured level; batches smaller than min_size are stored only
+	int		level;
+	size_t		min_size;
+	//! \brief Level the stream currently is set to
+	int		cur_level;
+	
+	//! \brief Queued uncompressed output of the current batch
+	char		*pending;
+	size_t		pending_len;
+	size_t		pending_size;
+};
+
+zstream* zstream_deflate_create(int level, size_t min_size)
+{
+	zstream *zs = (zstream*) calloc(1, sizeof(zstream));
+	if (!zs)
+		return NULL;
+	
+	if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION)
+		level = Z_DEFAULT_COMPRESSION;
+	
+	if (deflateInit(&zs->strm, level) != Z_OK)
+	{
+		free(zs);
+		return NULL;
+	}
+	
+	zs->deflating = 1;
+	zs->level = zs->cur_level = level;
+	zs->min_size = min_size;
+	
+	return zs;
+}
+
+zstream* zstream_inflate_create(void)
+{
+	zstream *zs = (zstream*) calloc(1, sizeof(zstream));
+	if (!zs)
+		return NULL;
+	
+	if (inflateInit(&zs->strm) != Z_OK)
+	{
+		free(zs);
+		return NULL;
+	}
+	
+	return zs;
+}
+
+void zstream_destroy(zstream *zs)
+{
+	if (!zs)
+		return;
+	
+	if (zs->deflating)
+		deflateEnd(&zs->strm);
+	else
+		inflateEnd(&zs->strm);
+	
+	free(zs->pending);
+	free(zs);
+}
+
+int zstream_append(zstream *zs, const void *buf, size_t len)
+{
+	if (zs->pending_len + len > zs->pending_size)
+	{
+		size_t size = zs->pending_size ? zs->pending_size : ZSTREAM_CHUNK;
+		while (size < zs->pending_len + len)
+			size *= 2;
+		
+		char *data = (char*) realloc(zs->pending, size);
+		if (!data)
+			return -1;
+		
+		zs->pending = data;
+		zs->pending_size = size;
+	}
+	
+	memcpy(zs->pending + zs->pending_len, buf, len);
+	zs->pending_len += len;
+	
+	return 0;
+}
+
+size_t zstream_pending(const zstream *zs)
+{
+	return zs->pending_len;
+}
+
+/* compress the queued batch and terminate it with a sync-flush;
+   returns the count of compressed bytes handed to sink or -1 on error */
+int zstream_flush(zstream *zs, zstream_sink sink, void *arg)
+{
+	if (!zs->pending_len)
+		return 0;
+	
+	char out[ZSTREAM_CHUNK];
+	int total = 0;
+	
+	zs->strm.next_out = (Bytef*) out;
+	zs->strm.avail_out = sizeof(out);
+	
+	// small batches aren't worth the CPU time; store them uncompressed
+	const int level = (zs->pending_len < zs->min_size) ? Z_NO_COMPRESSION : zs->level;
+	if (level != zs->cur_level)
+	{
+		if (deflateParams(&zs->strm, level, Z_DEFAULT_STRATEGY) != Z_OK)
+			return -1;
+		
+		zs->cur_level = level;
+	}
+	
+	zs->strm.next_in = (Bytef*) zs->pending;
+	zs->strm.avail_in = zs->pending_len;
+	
+	for (;;)
+	{
+		if (deflate(&zs->strm, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+			return -1;
+		
+		const size_t have = sizeof(out) - zs->strm.avail_out;
+		if (have)
+		{
+			if (sink(arg, out, have) == -1)
+				total = -1;
+			else if (total != -1)
+				total += have;
+		}
+		
+		if (zs->strm.avail_out)
+			break;
+		
+		zs->strm.next_out = (Bytef*) out;
+		zs->strm.avail_out = sizeof(out);
+	}
+	
+	zs->pending_len = 0;
+	
+	return total;
+}
+
+void zstream_input(zstream *zs, const void *buf, size_t len)
+{
+	zs->strm.next_in = (Bytef*) buf;
+	zs->strm.avail_in = len;
+}
+
+/* decompress input previously passed with zstream_input(); returns the
+   count of bytes written to out, which is less than size only if all
+   input has been consumed, or -1 on a corrupt stream */
+int zstream_inflate(zstream *zs, void *out, size_t size)
+{
+	zs->strm.next_out = (Bytef*) out;
+	zs->strm.avail_out = size;
+	
+	const int status = inflate(&zs->strm, Z_SYNC_FLUSH);
+	if (status != Z_OK && status != Z_BUF_ERROR)
+		return -1;
+	
+	return size - zs->strm.avail_out;
+}
+
+unsigned long zstream_total_raw(const zstream *zs)
+{
+	return zs->deflating ? zs->strm.total_in : zs->strm.total_out;
+}
+
+unsigned long zstream_total_compressed(const zstream *zs)
+{
+	return zs->deflating ? zs->strm.total_out : zs->strm.total_in;
+}
+
+/* state needed to resume the stream in another process; returns 0 if the
+   stream hasn't started yet (resume with a new stream), 1 if it has and -1
+   if it can't be handed over now (data within a batch). The dictionary
+   (ZSTREAM_WINDOW_SIZE bytes) is filled for inflate streams only. */
+int zstream_save(const zstream *zs, char *dict, size_t *dict_len)
+{
+	*dict_len = 0;
+	
+	if (zs->deflating)
+	{
+		if (zs->pending_len)
+			return -1;
+		
+		return zs->strm.total_out ? 1 : 0;
+	}
+	
+	if (!zs->strm.total_in)
+		return 0;
+	
+	// only right after a block (with everything consumed) nothing else is kept
+	if (!(zs->strm.data_type & 128) || zs->strm.avail_in)
+		return -1;
+	
+#if ZLIB_VERNUM >= 0x1271
+	uInt len = ZSTREAM_WINDOW_SIZE;
+	if (inflateGetDictionary((z_streamp) &zs->strm, (Bytef*) dict, &len) != Z_OK)
+		return -1;
+	
+	*dict_len = len;
+	
+	return 1;
+#else
+	return -1;
+#endif
+}
+
+// continue a deflate stream saved with zstream_save()
+zstream* zstream_deflate_resume(int level, size_t min_size)
+{
+	zstream *zs = (zstream*) calloc(1, sizeof(zstream));
+	if (!zs)
+		return NULL;
+	
+	if (level < Z_BEST_SPEED || level > Z_BEST_COMPRESSION)
+		level = Z_DEFAULT_COMPRESSION;
+	
+	// the header has been sent by the old stream; no trailer is ever sent
+	if (deflateInit2(&zs->strm, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		free(zs);
+		return NULL;
+	}
+	
+	zs->deflating = 1;
+	zs->level = zs->cur_level = level;
+	zs->min_size = min_size;
+	
+	return zs;
+}
+
+// continue an inflate stream saved with zstream_save()
+zstream* zstream_inflate_resume(const char *dict, size_t dict_len)
+{
+	zstream *zs = (zstream*) calloc(1, sizeof(zstream));
+	if (!zs)
+		return NULL;
+	
+	if (inflateInit2(&zs->strm, -MAX_WBITS) != Z_OK)
+	{
+		free(zs);
+		return NULL;
+	}
+	
+	if (dict_len && inflateSetDictionary(&zs->strm, (const Bytef*) dict, dict_len) != Z_OK)
+	{
+		zstream_destroy(zs);
+		return NULL;
+	}
+	
+	return zs;
+}
+
+#if defined __cplusplus
+    }
+#endif
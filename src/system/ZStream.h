@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008, 2009, Dominik Geyer
+ *
+ * This file is part of HoldingNuts.
+ *
+ * HoldingNuts is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HoldingNuts is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HoldingNuts.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authors:
+ *     Dominik Geyer <dominik.geyer@holdingnuts.net>
+ */
+
+
+
+#ifndef _ZSTREAM_H
+#define _ZSTREAM_H
+
+#include <stddef.h>
+
+#include "Platform.h"
+
+
+#if defined __cplusplus
+        extern "C" {
+#endif
+
+/* A compressed connection uses one persistent deflate stream per direction.
+   Outgoing data is queued and compressed batch-wise; each batch ends with a
+   sync-flush so the receiver can decode everything sent so far. */
+
+//! \brief Persistent deflate or inflate stream (opaque)
+typedef struct zstream zstream;
+
+//! \brief Receives compressed output; returns count of bytes taken or -1
+typedef int (*zstream_sink)(void *arg, const char *buf, size_t len);
+
+zstream* zstream_deflate_create(int level, size_t min_size);
+zstream* zstream_inflate_create(void);
+void zstream_destroy(zstream *zs);
+
+int zstream_append(zstream *zs, const void *buf, size_t len);
+size_t zstream_pending(const zstream *zs);
+int zstream_flush(zstream *zs, zstream_sink sink, void *arg);
+
+void zstream_input(zstream *zs, const void *buf, size_t len);
+int zstream_inflate(zstream *zs, void *out, size_t size);
+
+unsigned long zstream_total_raw(const zstream *zs);
+unsigned long zstream_total_compressed(const zstream *zs);
+
+/* A stream can be handed over to another process (server upgrade) between
+   two batches. The deflate side continues as a headerless stream, the
+   inflate side with the window of the old stream as dictionary. */
+#define ZSTREAM_WINDOW_SIZE  32768
+
+int zstream_save(const zstream *zs, char *dict, size_t *dict_len);
+zstream* zstream_deflate_resume(int level, size_t min_size);
+zstream* zstream_inflate_resume(const char *dict, size_t dict_len);
+
+#if defined __cplusplus
+    }
+#endif
+
+#endif /* _ZSTREAM_H */
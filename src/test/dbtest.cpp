@@ -23,13 +23,168 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include "Database.hpp"
+#include "SysAccess.h"
 
 
 using namespace std;
 
 
+static const int bench_players = 1000;
+static const int bench_games = 2000;
+static const int bench_per_game = 10;
+
+static const char* bench_uuid(char *buf, size_t size, int i)
+{
+	snprintf(buf, size, "uuid-%08d", i % bench_players);
+	return buf;
+}
+
+// update rankings like ranking.cpp did: formatted queries and string tables
+static void bench_formatted(Database &db)
+{
+	char uuid[32];
+	
+	for (int game=0; game < bench_games; game++)
+	{
+		db.query("BEGIN TRANSACTION;");
+		
+		for (int i=0; i < bench_per_game; i++)
+		{
+			bench_uuid(uuid, sizeof(uuid), game * 7 + i);
+			
+			QueryResult *result;
+			if (db.query(&result, "SELECT ranking FROM players WHERE uuid = '%q' LIMIT 1;", uuid))
+				continue;
+			
+			if (!result->numRows())
+				db.query("INSERT INTO players (uuid,name,t_lastgame,gamecount,ranking) "
+					"VALUES('%q','%q',datetime('now'),%d,%d);", uuid, "name", 1, 500);
+			else
+				db.query("UPDATE players SET name = '%q', t_lastgame = datetime('now'), "
+					"gamecount = gamecount + 1, ranking = %d WHERE uuid = '%q';",
+					"name", atoi(result->getRow(0,0)) % 1000 + 1, uuid);
+			
+			db.freeQueryResult(&result);
+		}
+		
+		db.query("COMMIT;");
+	}
+}
+
+// the same with cached prepared statements
+static void bench_prepared(Database &db)
+{
+	char uuid[32];
+	
+	for (int game=0; game < bench_games; game++)
+	{
+		Transaction transaction(&db);
+		
+		for (int i=0; i < bench_per_game; i++)
+		{
+			bench_uuid(uuid, sizeof(uuid), game * 7 + i);
+			
+			Statement select(&db, "SELECT ranking FROM players WHERE uuid = ?1 LIMIT 1;");
+			select.bind(1, uuid);
+			const int rc = select.step();
+			
+			if (rc == SQLITE_DONE)
+			{
+				Statement insert(&db, "INSERT INTO players (uuid,name,t_lastgame,gamecount,ranking) "
+					"VALUES(?1,?2,datetime('now'),1,?3);");
+				insert.bind(1, uuid);
+				insert.bind(2, "name");
+				insert.bind(3, 500);
+				insert.execute();
+			}
+			else if (rc == SQLITE_ROW)
+			{
+				Statement update(&db, "UPDATE players SET name = COALESCE(?2, name), "
+					"t_lastgame = datetime('now'), gamecount = gamecount + 1, ranking = ?3 WHERE uuid = ?1;");
+				update.bind(1, uuid);
+				update.bind(2, "name");
+				update.bind(3, select.getInt(0) % 1000 + 1);
+				update.execute();
+			}
+		}
+		
+		transaction.commit();
+	}
+}
+
+// SQLite settings as offered by the server config (db_*)
+typedef struct {
+	const char *journal_mode;
+	const char *synchronous;
+	const char *mmap_size;
+	bool auto_checkpoint;	// otherwise one checkpoint at the end, as the ranking writer does
+} bench_config;
+
+static const bench_config bench_configs[] = {
+	{ "delete",	"full",		"0",		true },		// SQLite defaults
+	{ "delete",	"normal",	"0",		true },
+	{ "wal",	"full",		"0",		true },
+	{ "wal",	"normal",	"0",		true },
+	{ "wal",	"normal",	"0",		false },	// server defaults
+	{ "wal",	"normal",	"67108864",	false },
+};
+
+static int bench(const char *filename, const char *label, void (*run)(Database&),
+	const bench_config *cfg = NULL)
+{
+	std::string wal_file = std::string(filename) + "-wal";
+	remove(filename);
+	remove(wal_file.c_str());
+	
+	Database db(filename);
+	
+	if (cfg)
+	{
+		db.setPragma("journal_mode", cfg->journal_mode);
+		db.setPragma("synchronous", cfg->synchronous);
+		db.setPragma("mmap_size", cfg->mmap_size);
+		db.setAutoCheckpoint(cfg->auto_checkpoint);
+	}
+	
+	if (db.query("CREATE TABLE players "
+		"(uuid varchar(50) NOT NULL PRIMARY KEY, name varchar(50), "
+		"t_lastgame DATE NOT NULL, gamecount INT NOT NULL, ranking INT NOT NULL);"))
+		return 1;
+	
+	unsigned long start = sys_time_ms();
+	run(db);
+	const unsigned long elapsed = sys_time_ms() - start;
+	
+	int log_frames = 0, checkpointed = 0;
+	unsigned long checkpoint_time = 0;
+	
+	if (cfg && !cfg->auto_checkpoint)
+	{
+		start = sys_time_ms();
+		db.checkpoint(&log_frames, &checkpointed);
+		checkpoint_time = sys_time_ms() - start;
+	}
+	
+	const int updates = bench_games * bench_per_game;
+	
+	Statement count(&db, "SELECT SUM(gamecount) FROM players;");
+	const int counted = (count.step() == SQLITE_ROW) ? count.getInt(0) : -1;
+	
+	printf("%-24s %d games, %d player updates in %lu ms (%.0f updates/s)%s\n",
+		label, bench_games, updates, elapsed,
+		updates * 1000.0 / (elapsed ? elapsed : 1),
+		(counted == updates) ? "" : " MISMATCH");
+	
+	if (checkpoint_time || checkpointed)
+		printf("%-24s checkpoint of %d pages in %lu ms\n", "", checkpointed, checkpoint_time);
+	
+	return (counted == updates) ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
 	printf("Database test\n");
@@ -54,5 +209,27 @@ int main(int argc, char **argv)
 	
 	db.freeQueryResult(&result);
 	
-	return 0;
+	// ranking update throughput; an optional argument names the database file
+	const char *bench_file = (argc > 1) ? argv[1] : "bench.db";
+	int failed = 0;
+	
+	printf("Ranking update benchmark (%s)\n", bench_file);
+	failed |= bench(bench_file, "formatted", bench_formatted);
+	failed |= bench(bench_file, "prepared", bench_prepared);
+	
+	// a game is a transaction here; its sync dominates on disk
+	printf("SQLite settings (prepared)\n");
+	for (unsigned int i=0; i < sizeof(bench_configs) / sizeof(bench_configs[0]); i++)
+	{
+		const bench_config *cfg = &bench_configs[i];
+		char label[64];
+		snprintf(label, sizeof(label), "%s/%s%s%s",
+			cfg->journal_mode, cfg->synchronous,
+			strcmp(cfg->mmap_size, "0") ? "/mmap" : "",
+			cfg->auto_checkpoint ? "" : "/ckpt");
+		
+		failed |= bench(bench_file, label, bench_prepared, cfg);
+	}
+	
+	return failed;
 }
@@ -48,6 +48,7 @@
 
 #include "GameController.hpp"
 #include "Protocol.h"
+#include "WireProtocol.hpp"
 
 #include "TestCase.hpp"
 
@@ -85,6 +86,7 @@ protected:
 	int getDealerSeat() const { return game->tables.begin()->second->dealer; };
 	int getSbSeat() const { return game->tables.begin()->second->sb; };
 	int getBbSeat() const { return game->tables.begin()->second->bb; };
+	int getPlayerSeat(int cid) const;
 	
 	HoleCards getPlayerHoleCards(int cid) const { return game->findPlayer(cid)->holecards; };
 	Table::State getTableState() const { return game->tables.begin()->second->state; };
@@ -104,6 +106,19 @@ TestCaseGameController::~TestCaseGameController()
 	delete game;
 }
 
+int TestCaseGameController::getPlayerSeat(int cid) const
+{
+	const Table *t = game->tables.begin()->second;
+	
+	for (unsigned int i=0; i < 10; i++)
+	{
+		if (t->seats[i].occupied && t->seats[i].player->client_id == cid)
+			return i;
+	}
+	
+	return -1;
+}
+
 void TestCaseGameController::tick(unsigned int ticks)
 {
 	for (unsigned int i=0; i < ticks; i++)
@@ -214,6 +229,8 @@ bool TestHeadsup::run()
 	tick(1);  // FIXME: this may change
 	
 	
+	// the players expected on the button and blinds; they are placed in
+	// order (not shuffled in SERVER_TESTING builds), but not at seats 0 and 1
 	int expected_dealer = 0;
 	int expected_sb = 0;
 	int expected_bb = 1;
@@ -221,7 +238,7 @@ bool TestHeadsup::run()
 	if (m_dealer) // switch dealer button (0=normal, 1=switched)
 	{
 		log_msg("info", "switch dealer button");
-		setDealerSeat(1);	// test with switched dealer_button
+		setDealerSeat(getPlayerSeat(players[1].id));	// test with switched dealer_button
 		
 		expected_dealer = 1;
 		expected_sb = 1;
@@ -233,11 +250,11 @@ bool TestHeadsup::run()
 	test(getTableState() == Table::Blinds, "state after 1 tick: before blinds");
 	
 	//test(getPlayerStake(players[0].id) == players[0].stake, "player1 stake");
-	test(getDealerSeat() == expected_dealer, "expected dealer seat");  // assume table seats _aren't_ shuffled
+	test(getDealerSeat() == getPlayerSeat(players[expected_dealer].id), "expected dealer seat");
 	
 	// headsup-rule test
-	test(getSbSeat() == expected_sb, "expected sb seat");
-	test(getBbSeat() == expected_bb, "expected bb seat");
+	test(getSbSeat() == getPlayerSeat(players[expected_sb].id), "expected sb seat");
+	test(getBbSeat() == getPlayerSeat(players[expected_bb].id), "expected bb seat");
 
 
 	
@@ -340,6 +357,15 @@ bool client_snapshot(int from_gid, int from_tid, int to, int sid, const char *ms
 	return true;
 }
 
+bool client_snapshot_table(int from_gid, int from_tid, int to, unsigned int seq,
+	const wire_table_snap *ts, const wire_table_snap *base, unsigned int base_seq)
+{
+	char buf[1024];
+	wire_format_table_snap(ts, buf, sizeof(buf));
+	
+	return client_snapshot(from_gid, from_tid, to, SnapTable, buf);
+}
+
 
 int main(void)
 {
@@ -27,8 +27,22 @@
 #include "Logger.h"
 #include "Debug.h"
 #include "Tokenizer.hpp"
+#include "ViewTokenizer.hpp"
 #include "ConfigParser.hpp"
 #include "SysAccess.h"
+#include "RingBuffer.h"
+#include "WireProtocol.hpp"
+#include "ZStream.h"
+#include "HandLog.h"
+#include "Journal.h"
+#include "AsyncLog.h"
+#include "Trace.h"
+#include "Thread.h"
+
+#if !defined(PLATFORM_WINDOWS)
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -90,6 +104,54 @@ int test_tokenizer()
 	return 0;
 }
 
+int test_viewtokenizer()
+{
+	const struct {
+		const char *str;
+		int value;
+	} ints[] = {
+		{ "42", 42 },
+		{ "-17", -17 },
+		{ "+5x", 5 },
+		{ "2147483647", 2147483647 },
+		{ "2147483648", 2147483647 },
+		{ "-2147483648", -2147483647 - 1 },
+		{ "99999999999999999999", 2147483647 },
+		{ "-99999999999999999999", -2147483647 - 1 },
+		{ "abc", 0 }
+	};
+	int failed = 0;
+	
+	// clamped like strtol() instead of overflowing
+	for (unsigned int i=0; i < sizeof(ints) / sizeof(ints[0]); i++)
+	{
+		const strview sv = { ints[i].str, (unsigned int) strlen(ints[i].str) };
+		
+		if (ViewTokenizer::view2int(sv) != ints[i].value)
+		{
+			log_msg("viewtok", "view2int(%s) = %d", ints[i].str, ViewTokenizer::view2int(sv));
+			failed = 1;
+		}
+	}
+	
+	// the raw remainder or the remaining tokens
+	ViewTokenizer t;
+	t.parse("CHAT -1  \"hello   world\"  again ");
+	t.getNext();
+	t.getNext();
+	
+	ViewTokenizer t2 = t;
+	const strview rest = t.getTillEnd();
+	
+	if (ViewTokenizer::view2string(rest) != "\"hello   world\"  again " ||
+		t2.getTokensTillEnd() != "hello   world again")
+		failed = 1;
+	
+	log_msg("viewtok", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
 int test_sysaccess()
 {
 	filetype *fp;
@@ -142,14 +204,908 @@ int test_configparser()
 	return 0;
 }
 
+int test_ringbuffer()
+{
+	ringbuffer rb;
+	ringbuf_init(&rb, 16, 64);
+	
+	// feed lines in odd-sized chunks so they wrap around the buffer end
+	const char *input = "PCLIENT 1 abc\r\nINFO \"name:test\"\nCHAT -1 hello world\nREQUEST gamelist\n";
+	const size_t input_len = strlen(input);
+	const char *expected[] = {
+		"PCLIENT 1 abc",
+		"INFO \"name:test\"",
+		"CHAT -1 hello world",
+		"REQUEST gamelist"
+	};
+	const unsigned int expected_count = sizeof(expected) / sizeof(expected[0]);
+	
+	unsigned int found = 0;
+	int failed = 0;
+	
+	for (size_t pos = 0; pos < input_len; pos += 7)
+	{
+		const size_t chunk = (input_len - pos < 7) ? input_len - pos : 7;
+		ringbuf_write(&rb, input + pos, chunk);
+		
+		char *line;
+		while ((line = ringbuf_getline(&rb, NULL)))
+		{
+			if (found >= expected_count || strcmp(line, expected[found]))
+				failed = 1;
+			
+			log_msg("ringbuf", "line: _%s_ (size=%d)", line, (int) rb.size);
+			found++;
+		}
+	}
+	
+	// a line exceeding the limit must be detected
+	char garbage[100];
+	memset(garbage, 'x', sizeof(garbage));
+	ringbuf_write(&rb, garbage, sizeof(garbage));
+	
+	if (ringbuf_getline(&rb, NULL) || !ringbuf_isfull(&rb))
+		failed = 1;
+	
+	ringbuf_free(&rb);
+	
+	if (found != expected_count)
+		failed = 1;
+	
+	log_msg("ringbuf", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+static bool view_equals(const strview &a, const strview &b)
+{
+	return (a.len == b.len && !memcmp(a.str, b.str, a.len));
+}
+
+static strview view_of(const char *str)
+{
+	const strview sv = { str, (unsigned int) strlen(str) };
+	return sv;
+}
+
+int test_wireprotocol()
+{
+	// messages in the form the server sends them
+	const char *snaps[] = {
+		"1:-1 -1 cc: s0:3:1:1500:0:0:- s4:7:3:1500:0:0:- p0:0 0",
+		"3:2 4:0:4:0:4 cc:Ah:Kd:2c:Ts s0:3:1:1480:20:5:- s4:7:1:1460:40:6:- p0:40 60",
+		"6:-1 0:4:0:4:0 cc:Ah:Kd:2c:Ts:9h s0:3:1:0:0:7:QcQs s4:7:1:1200:0:4:7d2c p0:600 p1:140 0",
+		"2:-1 4:0:4:0:4 cc: s4:7:1:1800:0:0:- s7:9:3:1500:0:0:- p0:0 0",
+		"4:0 4:0:4:4:4 cc: s4:7:1:1790:10:5:- s7:9:3:1480:20:5:- p0:0 40"
+	};
+	const char *gameinfos[] = {
+		"1 1:3:1:9:3:1:30:1500 20:20:180 \"my game\"",
+		"12 1:1:2:0:10:10:60:5000 50:15:300 \"\""
+	};
+	const char *msgs[] = {
+		"-1 foyer Welcome to the server",
+		"5 \"alice\" hi there  \\\"quoted\\\"",
+		"2:-1 game Game ended",
+		"2:0:5 \"bob\" nh"
+	};
+	const char *fields[] = {
+		"4 12",
+		"1 Ah Kd",
+		"7 \"carol\" 1",
+		"3 As Ks Qs Js Ts 9c 8d"
+	};
+	
+	char text[1024], frame[1024];
+	wire_writer w;
+	wire_reader r;
+	int failed = 0;
+	
+	for (unsigned int i=0; i < sizeof(snaps) / sizeof(snaps[0]); i++)
+	{
+		wire_table_snap a, b, c;
+		
+		bool ok = wire_parse_table_snap(snaps[i], strlen(snaps[i]), &a);
+		ok = ok && wire_format_table_snap(&a, text, sizeof(text)) > 0;
+		ok = ok && wire_parse_table_snap(text, strlen(text), &b);
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_table_snap(&w, &a);
+		wire_reader_init(&r, frame, w.len);
+		ok = ok && !w.overflow && wire_decode_table_snap(&r, &c) && r.pos == w.len;
+		
+		if (!ok || memcmp(&a, &b, sizeof(a)) || memcmp(&a, &c, sizeof(a)))
+			failed = 1;
+		
+		log_msg("wire", "table: text=%d binary=%d _%s_", (int) strlen(text), (int) w.len, text);
+	}
+	
+	// deltas between consecutive snapshots (seats leaving and joining included)
+	const unsigned int snap_count = sizeof(snaps) / sizeof(snaps[0]);
+	for (unsigned int i=0; i < snap_count; i++)
+	{
+		const char *from = snaps[i], *to = snaps[(i + 1) % snap_count];
+		wire_table_snap base, ts, c;
+		
+		bool ok = wire_parse_table_snap(from, strlen(from), &base);
+		ok = ok && wire_parse_table_snap(to, strlen(to), &ts);
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_table_delta(&w, &base, &ts);
+		wire_reader_init(&r, frame, w.len);
+		
+		c = base;
+		ok = ok && !w.overflow && wire_decode_table_delta(&r, &c) && r.pos == w.len;
+		
+		if (!ok || memcmp(&ts, &c, sizeof(ts)))
+			failed = 1;
+		
+		log_msg("wire", "table delta %d->%d: binary=%d", i, (i + 1) % snap_count, (int) w.len);
+	}
+	
+	for (unsigned int i=0; i < sizeof(gameinfos) / sizeof(gameinfos[0]); i++)
+	{
+		wire_gameinfo a, b, c;
+		
+		bool ok = wire_parse_gameinfo(gameinfos[i], strlen(gameinfos[i]), &a);
+		ok = ok && wire_format_gameinfo(&a, text, sizeof(text)) > 0;
+		ok = ok && wire_parse_gameinfo(text, strlen(text), &b);
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_gameinfo(&w, &a);
+		wire_reader_init(&r, frame, w.len);
+		ok = ok && !w.overflow && wire_decode_gameinfo(&r, &c) && r.pos == w.len;
+		
+		// cached form: the flags are patched in between head and tail
+		char head[64], tail[256], patched[512];
+		ok = ok && wire_format_gameinfo_head(&a, head, sizeof(head)) > 0;
+		ok = ok && wire_format_gameinfo_tail(&a, tail, sizeof(tail)) > 0;
+		snprintf(patched, sizeof(patched), "%s%d%s", head, a.flags, tail);
+		ok = ok && !strcmp(patched, text);
+		
+		ok = ok && view_equals(a.name, b.name) && view_equals(a.name, c.name);
+		a.name = b.name = c.name = strview();
+		
+		if (!ok || memcmp(&a, &b, sizeof(a)) || memcmp(&a, &c, sizeof(a)))
+			failed = 1;
+		
+		log_msg("wire", "gameinfo: text=%d binary=%d _%s_", (int) strlen(text), (int) w.len, text);
+	}
+	
+	{
+		wire_clientinfo a, b;
+		a.cid = 17;
+		a.name = view_of("alice");
+		a.location = view_of("");
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_clientinfo(&w, &a);
+		wire_reader_init(&r, frame, w.len);
+		
+		bool ok = !w.overflow && wire_decode_clientinfo(&r, &b) && r.pos == w.len;
+		ok = ok && a.cid == b.cid && view_equals(a.name, b.name) && view_equals(a.location, b.location);
+		ok = ok && wire_format_clientinfo(&a, text, sizeof(text)) > 0 &&
+			!strcmp(text, "17 \"name:alice\" \"location:\"");
+		
+		if (!ok)
+			failed = 1;
+		
+		log_msg("wire", "clientinfo: text=%d binary=%d", (int) strlen(text), (int) w.len);
+	}
+	
+	for (unsigned int i=0; i < sizeof(msgs) / sizeof(msgs[0]); i++)
+	{
+		wire_msg a, b, c;
+		
+		bool ok = wire_parse_msg(msgs[i], strlen(msgs[i]), &a);
+		ok = ok && wire_format_msg(&a, text, sizeof(text)) > 0;
+		ok = ok && wire_parse_msg(text, strlen(text), &b);
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_msg(&w, &a);
+		wire_reader_init(&r, frame, w.len);
+		ok = ok && !w.overflow && wire_decode_msg(&r, &c) && r.pos == w.len;
+		
+		ok = ok && !strcmp(text, msgs[i]);
+		ok = ok && view_equals(a.name, b.name) && view_equals(a.name, c.name);
+		ok = ok && view_equals(a.text, b.text) && view_equals(a.text, c.text);
+		ok = ok && a.gid == c.gid && a.tid == c.tid && a.cid == c.cid;
+		ok = ok && b.gid == c.gid && b.tid == c.tid && b.cid == c.cid;
+		
+		if (!ok)
+			failed = 1;
+		
+		log_msg("wire", "msg: text=%d binary=%d _%s_", (int) strlen(text), (int) w.len, text);
+	}
+	
+	for (unsigned int i=0; i < sizeof(fields) / sizeof(fields[0]); i++)
+	{
+		wire_fields a, b, c;
+		
+		bool ok = wire_parse_fields(fields[i], strlen(fields[i]), &a);
+		ok = ok && wire_format_fields(&a, text, sizeof(text)) >= 0;
+		ok = ok && wire_parse_fields(text, strlen(text), &b);
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		wire_encode_fields(&w, &a);
+		wire_reader_init(&r, frame, w.len);
+		ok = ok && !w.overflow && wire_decode_fields(&r, &c) && r.pos == w.len;
+		
+		ok = ok && a.count == b.count && a.count == c.count;
+		for (unsigned int j=0; ok && j < a.count; j++)
+		{
+			const wire_field *fa = &(a.fields[j]), *fb = &(b.fields[j]), *fc = &(c.fields[j]);
+			
+			ok = (fa->type == fb->type && fa->type == fc->type);
+			if (ok && fa->type == WireFieldInt)
+				ok = (fa->value == fb->value && fa->value == fc->value);
+			else if (ok && fa->type == WireFieldCard)
+				ok = (!strcmp(fa->card, fb->card) && !strcmp(fa->card, fc->card));
+			else if (ok)
+				ok = (view_equals(fa->str, fb->str) && view_equals(fa->str, fc->str));
+		}
+		
+		if (!ok)
+			failed = 1;
+		
+		log_msg("wire", "fields: text=%d binary=%d _%s_", (int) strlen(text), (int) w.len, text);
+	}
+	
+	// frames split across the end of the receive-buffer
+	ringbuffer rb;
+	ringbuf_init(&rb, 32, 32);
+	
+	for (unsigned int i=0; i < 10; i++)
+	{
+		wire_action a, b;
+		a.msgid = i;
+		a.gid = 100 + i;
+		a.action = i % 4;
+		a.amount = 1000 * i;
+		
+		wire_writer_init(&w, frame, sizeof(frame));
+		const size_t start = wire_frame_begin(&w, WireAction);
+		wire_encode_action(&w, &a);
+		wire_frame_end(&w, start);
+		
+		ringbuf_write(&rb, frame, w.len);
+		
+		char header[WIRE_HEADER_SIZE];
+		ringbuf_peek(&rb, header, sizeof(header));
+		
+		const size_t len = wire_frame_length(header);
+		char *payload = ringbuf_getblock(&rb, WIRE_HEADER_SIZE + len);
+		
+		if (!payload)
+		{
+			failed = 1;
+			break;
+		}
+		
+		wire_reader_init(&r, payload + WIRE_HEADER_SIZE, len);
+		
+		if (wire_get_u8(&r) != WireAction || !wire_decode_action(&r, &b) ||
+			memcmp(&a, &b, sizeof(a)))
+		{
+			failed = 1;
+		}
+	}
+	
+	ringbuf_free(&rb);
+	
+	log_msg("wire", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+#ifndef NOZLIB
+static int zstream_test_sink(void *arg, const char *buf, size_t len)
+{
+	string *out = (string*) arg;
+	out->append(buf, len);
+	
+	return len;
+}
+
+int test_zstream()
+{
+	const char *batches[] = {
+		"SNAP 1:0 2 3:2 4:0:4:0:4 cc:Ah:Kd:2c:Ts s0:3:1:1480:20:5:- s4:7:1:1460:40:6:- p0:40 60\r\n",
+		"SNAP 1:0 2 3:2 4:0:4:4:4 cc:Ah:Kd:2c:Ts s0:3:1:1480:20:5:- s4:7:1:1440:60:6:- p0:40 80\r\n"
+		"MSG 1:0:3 \"alice\" nice hand\r\n",
+		"OK\r\n",
+		"SNAP 1:0 2 3:2 4:0:4:0:4 cc:Ah:Kd:2c:Ts s0:3:1:1460:40:6:- s4:7:1:1440:60:6:- p0:40 100\r\n"
+	};
+	
+	zstream *zout = zstream_deflate_create(6, 16);
+	zstream *zin = zstream_inflate_create();
+	int failed = (!zout || !zin);
+	
+	for (unsigned int i=0; !failed && i < sizeof(batches) / sizeof(batches[0]); i++)
+	{
+		// each batch must be decodable as soon as it has been flushed
+		string compressed;
+		zstream_append(zout, batches[i], strlen(batches[i]));
+		
+		if (zstream_flush(zout, zstream_test_sink, &compressed) != (int) compressed.length())
+			failed = 1;
+		
+		// inflate into a small buffer to exercise partial output
+		string raw;
+		char out[32];
+		int produced;
+		
+		zstream_input(zin, compressed.data(), compressed.length());
+		do {
+			if ((produced = zstream_inflate(zin, out, sizeof(out))) == -1)
+				break;
+			raw.append(out, produced);
+		} while (produced == (int) sizeof(out));
+		
+		if (produced == -1 || raw != batches[i])
+			failed = 1;
+		
+		log_msg("zstream", "batch %d: raw=%d compressed=%d", i,
+			(int) strlen(batches[i]), (int) compressed.length());
+	}
+	
+	if (!failed)
+		log_msg("zstream", "total: raw=%lu compressed=%lu",
+			zstream_total_raw(zout), zstream_total_compressed(zout));
+	
+	zstream_destroy(zout);
+	zstream_destroy(zin);
+	
+	log_msg("zstream", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+#endif /* !NOZLIB */
+
+int test_handlog()
+{
+	const char *dir = "handlog_test";
+	const unsigned int record_count = 25;
+	const unsigned int per_segment = 10;
+	
+	sys_mkdir(dir);
+	
+	handlog_writer *hw = handlog_writer_open(dir,
+		HANDLOG_HEADER_SIZE + per_segment * HANDLOG_RECORD_SIZE, 256);
+	int failed = !hw;
+	
+	const unsigned int first = hw ? handlog_writer_segment(hw) : 0;
+	
+	for (unsigned int i=0; !failed && i < record_count; i++)
+	{
+		handlog_record rec;
+		memset(&rec, 0, sizeof(rec));
+		rec.type = (i % 5) ? HandlogAction : HandlogHandStart;
+		rec.game = 1;
+		rec.hand = i / 5 + 1;
+		rec.client = i % 3;
+		rec.amount = i;
+		rec.ncards = 1;
+		rec.cards[0] = HANDLOG_CARD(14, 4);   // As
+		
+		if (handlog_append(hw, &rec) < 0)
+			failed = 1;
+	}
+	
+	const unsigned int last = hw ? handlog_writer_segment(hw) : 0;
+	
+	if (hw)
+		handlog_writer_close(hw);
+	
+	if (last - first + 1 != (record_count + per_segment - 1) / per_segment)
+		failed = 1;
+	
+	// read back all records, and filtered by client
+	unsigned int count = 0, matched = 0, amount = 0;
+	handlog_filter filter;
+	handlog_filter_init(&filter);
+	filter.client = 1;
+	
+	for (unsigned int s = first; !failed && s <= last; s++)
+	{
+		char filename[256];
+		handlog_segment seg;
+		handlog_segment_name(filename, sizeof(filename), dir, s);
+		
+		if (handlog_segment_open(&seg, filename) < 0)
+		{
+			failed = 1;
+			break;
+		}
+		
+		for (size_t i=0; i < seg.count; i++, count++)
+		{
+			if (seg.records[i].amount != amount++ ||
+				HANDLOG_CARD_FACE(seg.records[i].cards[0]) != 14 ||
+				HANDLOG_CARD_SUIT(seg.records[i].cards[0]) != 4)
+				failed = 1;
+		}
+		
+		size_t pos = 0;
+		while (handlog_next(&seg, &pos, &filter))
+			matched++;
+		
+		handlog_segment_close(&seg);
+		remove(filename);
+	}
+	
+	if (count != record_count || matched != record_count / 3)
+		failed = 1;
+	
+	// a damaged type is not matched; the torn tail of a crash is not counted
+	if (!failed && (hw = handlog_writer_open(dir, 4096, 256)))
+	{
+		char filename[256];
+		handlog_segment_name(filename, sizeof(filename), dir, handlog_writer_segment(hw));
+		
+		handlog_record rec;
+		memset(&rec, 0, sizeof(rec));
+		for (unsigned int i=0; i < 3; i++)
+		{
+			rec.type = (i == 1) ? 200 : HandlogAction;
+			handlog_append(hw, &rec);
+		}
+		
+		handlog_writer_close(hw);
+		
+		FILE *fp = fopen(filename, "ab");
+		if (fp)
+		{
+			memset(&rec, 0, sizeof(rec));
+			fwrite(&rec, sizeof(rec), 1, fp);
+			fwrite(&rec, 10, 1, fp);
+			fclose(fp);
+		}
+		
+		handlog_segment seg;
+		handlog_filter_init(&filter);
+		size_t pos = 0, torn_matched = 0;
+		
+		if (!fp || handlog_segment_open(&seg, filename) < 0)
+			failed = 1;
+		else
+		{
+			while (handlog_next(&seg, &pos, &filter))
+				torn_matched++;
+			
+			if (seg.count != 3 || torn_matched != 2)
+				failed = 1;
+			
+			handlog_segment_close(&seg);
+		}
+		
+		remove(filename);
+	}
+	else
+		failed = 1;
+	
+	log_msg("handlog", "segments=%u records=%u matched=%u", last - first + 1, count, matched);
+	log_msg("handlog", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+static unsigned int journal_count(const char *filename, unsigned int *sum, int *truncated)
+{
+	journal_reader r;
+	unsigned int type, count = 0;
+	const char *data;
+	size_t len;
+	
+	*sum = 0;
+	if (journal_reader_open(&r, filename))
+		return 0;
+	
+	while (journal_read(&r, &type, &data, &len) == 1)
+	{
+		count++;
+		*sum += type + len;
+	}
+	
+	*truncated = r.truncated;
+	journal_reader_close(&r);
+	
+	return count;
+}
+
+int test_journal()
+{
+	const char *filename = "journal_test.hnj";
+	const unsigned int record_count = 2000;
+	const unsigned int per_commit = 20;
+	char data[100];
+	unsigned int sum, expected = 0;
+	int truncated = 0;
+	
+	memset(data, 'x', sizeof(data));
+	remove(filename);
+	
+	// group commit with sync
+	journal *j = journal_open(filename, 1);
+	int failed = !j;
+	
+	const unsigned long start = sys_time_ms();
+	
+	for (unsigned int i=0; !failed && i < record_count; i++)
+	{
+		if (journal_append(j, 1 + i % 10, data, i % sizeof(data)) < 0 ||
+			((i + 1) % per_commit == 0 && journal_commit(j) < 0))
+			failed = 1;
+		
+		expected += 1 + i % 10 + i % sizeof(data);
+	}
+	
+	const unsigned long elapsed = sys_time_ms() - start;
+	
+	if (j)
+		journal_close(j);
+	
+	if (journal_count(filename, &sum, &truncated) != record_count || sum != expected || truncated)
+		failed = 1;
+	
+	// a torn record at the end is cut off on opening
+	FILE *fp = fopen(filename, "ab");
+	if (fp)
+	{
+		fwrite(data, 5, 1, fp);
+		fclose(fp);
+	}
+	
+	if (journal_count(filename, &sum, &truncated) != record_count || !truncated)
+		failed = 1;
+	
+	if (!failed && (j = journal_open(filename, 0)))
+	{
+		if (journal_append(j, 1, data, 10) < 0 || journal_commit(j) < 0)
+			failed = 1;
+		
+		// a checkpoint leaves only the records appended during it
+		if (journal_checkpoint_begin(j) < 0 ||
+			journal_append(j, 2, data, 20) < 0 || journal_append(j, 3, data, 30) < 0 ||
+			journal_checkpoint_end(j) < 0 ||
+			journal_append(j, 4, data, 40) < 0 || journal_commit(j) < 0)
+			failed = 1;
+		
+		journal_close(j);
+		
+		if (journal_count(filename, &sum, &truncated) != 3 || sum != 2+20 + 3+30 + 4+40 || truncated)
+			failed = 1;
+	}
+	else
+		failed = 1;
+	
+	remove(filename);
+	
+	log_msg("journal", "records=%u commits=%u synced in %lu ms", record_count,
+		record_count / per_commit, elapsed);
+	log_msg("journal", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+// count the lines of a log file; dropped: lines reported as dropped
+static unsigned int asynclog_count(const char *filename, unsigned long *dropped, bool *ordered)
+{
+	char line[LOG_LINE_MAX + 1];
+	unsigned int count = 0;
+	int last = -1, n;
+	unsigned long d;
+	
+	*dropped = 0;
+	*ordered = true;
+	
+	FILE *fp = fopen(filename, "r");
+	if (!fp)
+		return 0;
+	
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (sscanf(line, "[%*s %lu lines dropped", &d) == 1)
+			*dropped += d;
+		else if (sscanf(line, "[%*s line %d", &n) == 1)
+		{
+			if (n <= last)
+				*ordered = false;
+			
+			last = n;
+			count++;
+		}
+	}
+	
+	fclose(fp);
+	return count;
+}
+
+static unsigned long asynclog_run(const char *filename, bool async, int overflow, unsigned int lines)
+{
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+		return 0;
+	
+	log_set(fp, 0);
+	
+	if (async)
+		log_async_start(256, overflow);
+	
+	const unsigned long start = sys_time_ms();
+	
+	for (unsigned int i=0; i < lines; i++)
+		log_msg("test", "line %u of the log test with some text", i);
+	
+	const unsigned long elapsed = sys_time_ms() - start;
+	
+	log_async_stop();
+	log_set(stdout, 0);
+	fclose(fp);
+	
+	return elapsed;
+}
+
+int test_asynclog()
+{
+	const char *filename = "asynclog_test.log";
+	const unsigned int lines = 100000;
+	unsigned long dropped;
+	bool ordered;
+	int failed = 0;
+	
+	// synchronous for comparison
+	const unsigned long sync_ms = asynclog_run(filename, false, log_overflow_block, lines);
+	if (asynclog_count(filename, &dropped, &ordered) != lines || !ordered)
+		failed = 1;
+	
+	// blocking: nothing lost
+	const unsigned long block_ms = asynclog_run(filename, true, log_overflow_block, lines);
+	if (asynclog_count(filename, &dropped, &ordered) != lines || dropped || !ordered)
+		failed = 1;
+	
+	// dropping: every line either written or counted
+	const unsigned long drop_ms = asynclog_run(filename, true, log_overflow_drop, lines);
+	const unsigned int kept = asynclog_count(filename, &dropped, &ordered);
+	if (kept + dropped != lines || !ordered)
+		failed = 1;
+	
+#if !defined(PLATFORM_WINDOWS)
+	// lines still buffered survive a crash
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		FILE *fp = fopen(filename, "w");
+		log_set(fp, 0);
+		log_async_start(lines, log_overflow_block);
+		
+		for (unsigned int i=0; i < lines; i++)
+			log_msg("test", "line %u of the log test with some text", i);
+		
+		abort();
+	}
+	
+	int status;
+	waitpid(pid, &status, 0);
+	
+	if (!WIFSIGNALED(status) || asynclog_count(filename, &dropped, &ordered) != lines || !ordered)
+		failed = 1;
+#endif
+	
+	remove(filename);
+	
+	log_msg("asynclog", "%u lines: sync %lu ms, async %lu ms, dropping %lu ms (%u dropped)",
+		lines, sync_ms, block_ms, drop_ms, lines - kept);
+	log_msg("asynclog", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+static unsigned int logger_lines;
+
+static void logger_count(const char *line, unsigned int len)
+{
+	logger_lines++;
+}
+
+int test_logger()
+{
+	unsigned int evaluated = 0;
+	int failed = 0;
+	
+	log_set_writer(logger_count);
+	logger_lines = 0;
+	
+	// a suppressed call does not evaluate its arguments
+	log_set_level("logtest", LOG_WARN);
+	for (unsigned int i=0; i < 10; i++)
+	{
+		log_info("logtest", "%u", evaluated++);
+		log_warn("logtest", "%u", i);
+	}
+	
+	if (evaluated || logger_lines != 10)
+		failed = 1;
+	
+	// the cached categories follow changes
+	if (log_set_levels("logtest:error, other:debug", 1) != (LOG_MIN_LEVEL < LOG_DEBUG ? 1 : 0))
+		failed = 1;
+	
+	log_warn("logtest", "suppressed");
+	log_error("logtest", "logged");
+	log_msg("logtest", "suppressed");
+	
+	if (logger_lines != 11 || log_category_get("other")->level != LOG_MIN_LEVEL)
+		failed = 1;
+	
+	if (log_set_levels("logtest:loud", 1) != -1 || log_set_levels(":info", 1) != -1)
+		failed = 1;
+	
+	// a bad entry rejects the whole spec; unknown categories are not created
+	if (log_set_levels("logtest:info other:loud", 1) != -1 ||
+		log_set_levels("logtest:info tsetgol:info", 0) != -1 ||
+		log_category_find("logtest")->level != LOG_ERROR || log_category_find("tsetgol"))
+	{
+		failed = 1;
+	}
+	
+	// all categories
+	log_set_level("*", LOG_INFO);
+	log_info("logtest", "logged");
+	log_msg("logtest", "logged");
+	
+	if (logger_lines != 13 || log_category_get("new")->level != LOG_INFO)
+		failed = 1;
+	
+	// removed by the compiler below LOG_MIN_LEVEL
+	log_set_level("*", LOG_DEBUG);
+	log_debug("logtest", "%u", evaluated++);
+	
+	if (evaluated != (LOG_MIN_LEVEL >= LOG_DEBUG ? 1u : 0u))
+		failed = 1;
+	
+	log_set_level("*", LOG_MIN_LEVEL);
+	log_set_writer(NULL);
+	
+	log_msg("logger", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
+static void trace_test_event(unsigned int i, char *text, size_t size)
+{
+	const char *name = (i % 3) ? "alice" : "bob";
+	
+	trace("test", "game %d table %d: player %s action %u amount %5u (%.2f) %lx",
+		(int) i % 7 - 3, i % 5, name, i % 6, i * 10, i / 4.0, (unsigned long) i);
+	
+	if (text)
+		snprintf(text, size, "game %d table %d: player %s action %u amount %5u (%.2f) %lx",
+			(int) i % 7 - 3, i % 5, name, i % 6, i * 10, i / 4.0, (unsigned long) i);
+}
+
+static void trace_test_thread(void *arg)
+{
+	for (unsigned int i=0; i < 1000; i++)
+	{
+		trace("thread", "event %u", i);
+		
+		// rejected once, never written
+		trace("thread", "unsupported %p", arg);
+	}
+	
+	trace_flush();
+}
+
+int test_trace()
+{
+	const char *filename = "trace_test.hnt";
+	const unsigned int events = 200000;
+	char text[1024];
+	trace_entry e;
+	int failed = 0;
+	
+	// formatting each event for comparison
+	unsigned long start = sys_time_ms();
+	for (unsigned int i=0; i < events; i++)
+		trace_test_event(i, text, sizeof(text));
+	const unsigned long format_ms = sys_time_ms() - start;
+	
+	if (trace_open(filename, 64 * 1024 * 1024) < 0)
+		failed = 1;
+	
+	start = sys_time_ms();
+	for (unsigned int i=0; i < events; i++)
+		trace_test_event(i, NULL, 0);
+	const unsigned long trace_ms = sys_time_ms() - start;
+	
+	sys_thread thread;
+	sys_thread_create(&thread, trace_test_thread, NULL);
+	sys_thread_join(&thread);
+	
+	trace_close();
+	
+	// the reader renders the same text
+	unsigned int count = 0, thread_events = 0;
+	trace_reader *tr = trace_reader_open(filename);
+	
+	while (tr && trace_read(tr, &e))
+	{
+		if (!strcmp(e.category, "thread"))
+		{
+			snprintf(text, sizeof(text), "event %u", thread_events++);
+			if (strcmp(e.text, text) || e.thread == 1)
+				failed = 1;
+			continue;
+		}
+		
+		trace_test_event(count++, text, sizeof(text));
+		if (strcmp(e.text, text) || e.thread != 1)
+			failed = 1;
+	}
+	
+	if (!tr || trace_reader_error(tr) || count != events || thread_events != 1000)
+		failed = 1;
+	if (tr)
+		trace_reader_close(tr);
+	
+	// a full file is moved aside; the new one can be read on its own
+	if (trace_open(filename, 256 * 1024) < 0)
+		failed = 1;
+	
+	for (unsigned int i=0; i < events; i++)
+		trace_test_event(i, NULL, 0);
+	
+	trace_close();
+	
+	count = 0;
+	tr = trace_reader_open(filename);
+	while (tr && trace_read(tr, &e))
+		count++;
+	
+	trace_test_event(events - 1, text, sizeof(text));
+	if (!tr || trace_reader_error(tr) || !count || count >= events || strcmp(e.text, text))
+		failed = 1;
+	if (tr)
+		trace_reader_close(tr);
+	
+	remove(filename);
+	snprintf(text, sizeof(text), "%s.old", filename);
+	remove(text);
+	
+	log_msg("trace", "%u events: snprintf %lu ms, trace %lu ms", events, format_ms, trace_ms);
+	log_msg("trace", "result: %s", failed ? "FAIL" : "OK");
+	
+	return failed;
+}
+
 int main(void)
 {
 	//test_tokenizer();
 	
+	test_viewtokenizer();
+	
 	//test_sysaccess();
 	
 	//test_configparser();
 	
+	test_ringbuffer();
+	
+	test_wireprotocol();
+	
+#ifndef NOZLIB
+	test_zstream();
+#endif
+	
+	test_handlog();
+	
+	test_journal();
+	
+	test_asynclog();
+	
+	test_trace();
+	
+	test_logger();
+	
 	//const char *config_path = sys_config_path();
 	//log_msg("sys", "config-path: _%s_", config_path);
 	